@@ -0,0 +1,141 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <time.h>
+
+#include "data.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+
+using namespace gcview;
+
+// Compares, for arrays of 1K to 1M elements, the element-by-element
+// loops that ArrayData used to scan an array for changes and to copy
+// it to the previous value with the SimdUtils kernels of each level
+// and with Vector's bulk copy. The arrays are equal, so the scans go
+// over all elements (the case of an unchanged array).
+
+static const unsigned LENGTHS[] = { 1024, 16 * 1024, 128 * 1024, 1024 * 1024 };
+static const unsigned LENGTH_NUM = sizeof(LENGTHS) / sizeof(LENGTHS[0]);
+// elements scanned per length and mode
+static const double TARGET_ELEMS = 256.0 * 1024.0 * 1024.0;
+
+static double getNowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// Keeps the results live, so that the loops are not optimized away.
+static volatile unsigned long long sink;
+
+template <typename T>
+static unsigned scanLoop(const Vector<Element<SimpleElement<T> > >& a,
+                         const Vector<Element<SimpleElement<T> > >& b) {
+  const unsigned length = a.getLength();
+  for (unsigned i = 0; i < length; i += 1) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+  return length;
+}
+
+template <typename T>
+static unsigned scanKernel(const Vector<Element<SimpleElement<T> > >& a,
+                           const Vector<Element<SimpleElement<T> > >& b) {
+  return ElementScanner<SimpleElement<T> >::findFirstDiff(
+    a.getData(), b.getData(), 0, a.getLength());
+}
+
+template <typename T>
+static void copyLoop(Vector<Element<SimpleElement<T> > >* to,
+                     const Vector<Element<SimpleElement<T> > >& from) {
+  const unsigned length = from.getLength();
+  for (unsigned i = 0; i < length; i += 1) {
+    (*to)[i] = from[i];
+  }
+}
+
+template <typename T>
+static void copyBulk(Vector<Element<SimpleElement<T> > >* to,
+                     const Vector<Element<SimpleElement<T> > >& from) {
+  to->copyRangeFrom(from, 0, from.getLength());
+}
+
+static void report(const char* type_name, const char* mode,
+                   unsigned length, unsigned iters, double sec) {
+  const double elems = (double) length * (double) iters;
+  printf("%-7s %-13s %8u elems %8.3f ns/elem %10.1f us/array\n",
+         type_name, mode, length, sec * 1e9 / elems,
+         sec * 1e6 / (double) iters);
+}
+
+template <typename T>
+static void runBench(const char* type_name, T value) {
+  const SimdUtils::Level supported_level = SimdUtils::getSupportedLevel();
+  for (unsigned l = 0; l < LENGTH_NUM; l += 1) {
+    const unsigned length = LENGTHS[l];
+    const unsigned iters = (unsigned) (TARGET_ELEMS / (double) length);
+    Vector<Element<SimpleElement<T> > > a;
+    Vector<Element<SimpleElement<T> > > b;
+    a.resize(length);
+    b.resize(length);
+    for (unsigned i = 0; i < length; i += 1) {
+      a[i] = value;
+      b[i] = value;
+    }
+
+    double start_sec = getNowSec();
+    for (unsigned i = 0; i < iters; i += 1) {
+      sink += scanLoop(a, b);
+    }
+    report(type_name, "scan loop", length, iters, getNowSec() - start_sec);
+
+    for (unsigned s = SimdUtils::ScalarLevel; s <= supported_level; s += 1) {
+      const SimdUtils::Level level = (SimdUtils::Level) s;
+      SimdUtils::setLevel(level);
+      char mode[32];
+      Utils::formatStr(mode, 32, "scan %s", SimdUtils::getLevelStr(level));
+      start_sec = getNowSec();
+      for (unsigned i = 0; i < iters; i += 1) {
+        sink += scanKernel(a, b);
+      }
+      report(type_name, mode, length, iters, getNowSec() - start_sec);
+    }
+    SimdUtils::setLevel(supported_level);
+
+    start_sec = getNowSec();
+    for (unsigned i = 0; i < iters; i += 1) {
+      copyLoop(&b, a);
+      sink += (unsigned long long) (T) b[i % length];
+    }
+    report(type_name, "copy loop", length, iters, getNowSec() - start_sec);
+
+    start_sec = getNowSec();
+    for (unsigned i = 0; i < iters; i += 1) {
+      copyBulk(&b, a);
+      sink += (unsigned long long) (T) b[i % length];
+    }
+    report(type_name, "copy bulk", length, iters, getNowSec() - start_sec);
+  }
+}
+
+int main() {
+  runBench<unsigned char>("byte", 42);
+  runBench<int>("int", 123456);
+  runBench<double>("double", 1.25);
+
+  MM::print_report();
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <time.h>
+
+#include "async.hpp"
+#include "gcview.hpp"
+#include "json.hpp"
+
+using namespace gcview;
+
+// Compares the time a snapshot adds to the caller (i.e., to the GC
+// pause) when the JSON trace is written synchronously and when it is
+// written through an AsyncWriter with each policy.
+
+static const unsigned SPACE_NUM    =    8;
+static const unsigned ARRAY_LENGTH = 1024;
+static const unsigned SNAPSHOTS    =  200;
+// time between snapshots, spent "running the mutator"
+static const double   MUTATOR_SEC  = 0.005;
+
+static const char* OUTPUT_FILE_NAME = "/dev/null";
+
+static void setUp(GCview* gcview) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->addSpace(buffer);
+    space->addData<IntValue>("Int Value");
+    space->addData<DoubleValue>("Double Value");
+    space->addData<IntArray>("Int Array")->resize(ARRAY_LENGTH);
+    space->addData<DoubleArray>("Double Array")->resize(ARRAY_LENGTH);
+  }
+}
+
+static void update(GCview* gcview, unsigned iter) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->findSpace(buffer);
+    space->findIntValue("Int Value")->value() = (int) (iter * 1000 + i);
+    space->findDoubleValue("Double Value")->value() = iter * 0.125 + i;
+    IntArray* int_array = space->findIntArray("Int Array");
+    DoubleArray* double_array = space->findDoubleArray("Double Array");
+    for (unsigned j = 0; j < ARRAY_LENGTH; j += 1) {
+      int_array->value(j) = (int) (iter * 4096 + j * 17);
+      double_array->value(j) = (double) (iter + j) * 1.2345;
+    }
+  }
+}
+
+// CPU time of the calling thread: on a machine with fewer cores than
+// threads the wall-clock time of a snapshot would also include the
+// time the writer thread was scheduled in instead of the caller.
+static double getThreadCPUSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void runMutator() {
+  const double end_sec = Utils::getNowSec() + MUTATOR_SEC;
+  while (Utils::getNowSec() < end_sec) { }
+}
+
+static void printResult(const char* mode, double pause_sec, double total_sec,
+                        AsyncWriter* async_writer) {
+  printf("%-12s %10.0f ns/snapshot in pause (CPU) %10.3f sec total",
+         mode, pause_sec * 1e9 / (double) SNAPSHOTS, total_sec);
+  if (async_writer != NULL) {
+    printf(" %6llu dropped %6llu coalesced %8.3f sec writer thread",
+           async_writer->getDroppedNum(), async_writer->getCoalescedNum(),
+           async_writer->getWriterTimeSec());
+  }
+  printf("\n");
+}
+
+static void runSyncBench() {
+  GCview gcview("AsyncWriter Benchmark");
+  unsigned event_id = gcview.addEvent("Event");
+  setUp(&gcview);
+
+  JSONWriter writer(OUTPUT_FILE_NAME, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+  double pause_sec = 0.0;
+  const double start_sec = Utils::getNowSec();
+  {
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+
+    for (unsigned i = 0; i < SNAPSHOTS; i += 1) {
+      runMutator();
+      update(&gcview, i + 1);
+      gcview.eventStart(event_id);
+      gcview.eventEnd();
+
+      const double pause_start_sec = getThreadCPUSec();
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+      pause_sec += getThreadCPUSec() - pause_start_sec;
+    }
+  }
+  printResult("sync", pause_sec, Utils::getNowSec() - start_sec, NULL);
+}
+
+static void runAsyncBench(const char* mode, AsyncWriter::Policy policy) {
+  GCview gcview("AsyncWriter Benchmark");
+  unsigned event_id = gcview.addEvent("Event");
+  setUp(&gcview);
+
+  JSONWriter writer(OUTPUT_FILE_NAME, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+  double pause_sec = 0.0;
+  const double start_sec = Utils::getNowSec();
+  {
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    AsyncWriter async_writer(&writer, &array_writer, policy);
+    async_writer.writeMetadata(&gcview);
+
+    for (unsigned i = 0; i < SNAPSHOTS; i += 1) {
+      runMutator();
+      update(&gcview, i + 1);
+      gcview.eventStart(event_id);
+      gcview.eventEnd();
+
+      const double pause_start_sec = getThreadCPUSec();
+      async_writer.writeData(&gcview);
+      pause_sec += getThreadCPUSec() - pause_start_sec;
+    }
+    async_writer.flush(&gcview);
+    printResult(mode, pause_sec, Utils::getNowSec() - start_sec,
+                &async_writer);
+  }
+}
+
+int main() {
+  runSyncBench();
+  runAsyncBench("async-block", AsyncWriter::Block);
+  runAsyncBench("async-drop", AsyncWriter::DropNewest);
+  runAsyncBench("async-merge", AsyncWriter::Coalesce);
+
+  MM::print_report();
+}
@@ -0,0 +1,659 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.hpp"
+#include "async.hpp"
+#include "gcview.hpp"
+#include "json.hpp"
+#include "sink.hpp"
+#include "trace.hpp"
+
+using namespace gcview;
+
+// Runs scenarios (a number of spaces with a number of data each, of a
+// workload and array length, with a ratio of the values / elements
+// modified between snapshots) with each writer backend, and reports
+// per snapshot:
+//
+//   - the time the snapshot takes on the calling thread (i.e., the
+//     pause it adds to a GC): mean, p50, p99 and max,
+//   - the bytes emitted (compressed for gzip),
+//   - the allocations, if the library and the benchmark were built
+//     with -DGCVIEW_ENABLE_MM_SUMMARY=1 (see mm.hpp).
+//
+// Usage: gcview_bench [options]
+//
+//   --snapshots n      snapshots per run (default 200)
+//   --scenario name    only run the named scenario
+//   --backend name     only run the named backend
+//   --results file     also write the results to file as JSON
+//
+// Setting any of the following runs a single "custom" scenario,
+// starting from the parameters of the first default one:
+//
+//   --spaces n  --data n  --length n  --ratio r
+//   --workload numeric|strings|mixed
+//
+// The results file is an array with one object per run, so that runs
+// on different revisions can be compared by a script.
+
+static const char* OUTPUT_FILE_NAME = "/dev/null";
+static const unsigned DEFAULT_SNAPSHOTS = 200;
+// distinct strings the string data are set to
+static const unsigned STRING_NUM = 64;
+
+////////// Scenarios //////////
+
+typedef enum {
+  NumericWorkload,
+  StringWorkload,
+  MixedWorkload
+} Workload;
+
+static const char* WORKLOAD_NAMES[] = { "numeric", "strings", "mixed" };
+
+typedef struct {
+  const char* _name;
+  unsigned    _space_num;
+  unsigned    _data_num;
+  unsigned    _array_length;
+  double      _modified_ratio;
+  Workload    _workload;
+} Scenario;
+
+static const Scenario DEFAULT_SCENARIOS[] = {
+  { "small",          4,  8,   64, 1.00, NumericWorkload },
+  { "numeric-sparse", 8, 16, 1024, 0.01, NumericWorkload },
+  { "numeric-dense",  8, 16, 1024, 1.00, NumericWorkload },
+  { "strings",        8, 16,   64, 0.10, StringWorkload  },
+  { "mixed",          8, 16,  256, 0.10, MixedWorkload   },
+  { "many-spaces",   64, 32,   16, 0.10, NumericWorkload }
+};
+static const unsigned DEFAULT_SCENARIO_NUM =
+  sizeof(DEFAULT_SCENARIOS) / sizeof(DEFAULT_SCENARIOS[0]);
+
+////////// Backends //////////
+
+// Takes the snapshots of a GCview with one of the writers.
+class Backend {
+public:
+  virtual const char* getName() const = 0;
+  virtual void writeMetadata(GCview* gcview) = 0;
+  virtual void writeData(GCview* gcview) = 0;
+  // Ends the trace, after which getBytes() is final.
+  virtual void finish(GCview* gcview) = 0;
+  virtual unsigned long long getBytes() const = 0;
+
+  virtual ~Backend() { }
+};
+
+class JSONBackend : public Backend {
+private:
+  const char* const _name;
+  JSONWriter _writer;
+  JSONArrayWriter* _array_writer;
+
+public:
+  virtual const char* getName() const { return _name; }
+
+  virtual void writeMetadata(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONMetadata(&_writer);
+  }
+
+  virtual void writeData(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONData(&_writer);
+  }
+
+  virtual void finish(GCview*) {
+    delete _array_writer;
+    _array_writer = NULL;
+    _writer.flush();
+  }
+
+  virtual unsigned long long getBytes() const {
+    return _writer.getBytesWritten();
+  }
+
+  JSONBackend(const char* name, size_t buffer_size)
+      : _name(name), _writer(OUTPUT_FILE_NAME, buffer_size),
+        _array_writer(new JSONArrayWriter(&_writer,
+                                          true /* add_newlines */)) { }
+  virtual ~JSONBackend() {
+    if (_array_writer != NULL) {
+      delete _array_writer;
+    }
+  }
+};
+
+#if GCVIEW_ENABLE_ZLIB
+
+class GzipBackend : public Backend {
+private:
+  GzipSink _sink;
+  JSONWriter _writer;
+  JSONArrayWriter* _array_writer;
+
+public:
+  virtual const char* getName() const { return "gzip"; }
+
+  virtual void writeMetadata(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONMetadata(&_writer);
+  }
+
+  virtual void writeData(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONData(&_writer);
+  }
+
+  virtual void finish(GCview*) {
+    delete _array_writer;
+    _array_writer = NULL;
+    _writer.flush();
+  }
+
+  virtual unsigned long long getBytes() const {
+    return _sink.getBytesWritten();
+  }
+
+  GzipBackend()
+      : _sink(OUTPUT_FILE_NAME),
+        _writer(&_sink, GCVIEW_JSON_WRITER_BUFFER_SIZE),
+        _array_writer(new JSONArrayWriter(&_writer,
+                                          true /* add_newlines */)) { }
+  virtual ~GzipBackend() {
+    if (_array_writer != NULL) {
+      delete _array_writer;
+    }
+  }
+};
+
+#endif // GCVIEW_ENABLE_ZLIB
+
+class TraceBackend : public Backend {
+private:
+  TraceWriter _writer;
+
+public:
+  virtual const char* getName() const { return "trace"; }
+  virtual void writeMetadata(GCview* gcview) {
+    gcview->writeTraceMetadata(&_writer);
+  }
+  virtual void writeData(GCview* gcview) { gcview->writeTraceData(&_writer); }
+  virtual void finish(GCview*) { _writer.flush(); }
+  virtual unsigned long long getBytes() const {
+    return _writer.getBytesWritten();
+  }
+
+  TraceBackend() : _writer(OUTPUT_FILE_NAME) { }
+};
+
+class AsyncBackend : public Backend {
+private:
+  JSONWriter _writer;
+  JSONArrayWriter* _array_writer;
+  AsyncWriter* _async_writer;
+
+public:
+  virtual const char* getName() const { return "async"; }
+  virtual void writeMetadata(GCview* gcview) {
+    _async_writer->writeMetadata(gcview);
+  }
+  virtual void writeData(GCview* gcview) { _async_writer->writeData(gcview); }
+
+  virtual void finish(GCview* gcview) {
+    _async_writer->flush(gcview);
+    // stops the writer thread, which owns the writers until then
+    delete _async_writer;
+    _async_writer = NULL;
+    delete _array_writer;
+    _array_writer = NULL;
+    _writer.flush();
+  }
+
+  virtual unsigned long long getBytes() const {
+    return _writer.getBytesWritten();
+  }
+
+  AsyncBackend()
+      : _writer(OUTPUT_FILE_NAME, GCVIEW_JSON_WRITER_BUFFER_SIZE),
+        _array_writer(new JSONArrayWriter(&_writer, true /* add_newlines */)),
+        _async_writer(new AsyncWriter(&_writer, _array_writer,
+                                      AsyncWriter::Block,
+                                      GCVIEW_ASYNC_WRITER_QUEUE_LENGTH,
+                                      false /* charge_snapshot_time */)) { }
+  virtual ~AsyncBackend() {
+    if (_async_writer != NULL) {
+      delete _async_writer;
+      delete _array_writer;
+    }
+  }
+};
+
+static const char* BACKEND_NAMES[] = {
+  "json", "json-buffered", "trace", "gzip", "async"
+};
+static const unsigned BACKEND_NUM =
+  sizeof(BACKEND_NAMES) / sizeof(BACKEND_NAMES[0]);
+
+// NULL if the backend is not built in.
+static Backend* newBackend(unsigned index) {
+  switch (index) {
+  case 0: return new JSONBackend(BACKEND_NAMES[0], 0);
+  case 1: return new JSONBackend(BACKEND_NAMES[1],
+                                 GCVIEW_JSON_WRITER_BUFFER_SIZE);
+  case 2: return new TraceBackend();
+#if GCVIEW_ENABLE_ZLIB
+  case 3: return new GzipBackend();
+#endif // GCVIEW_ENABLE_ZLIB
+  case 4: return new AsyncBackend();
+  default: return NULL;
+  }
+}
+
+////////// Workload //////////
+
+typedef enum {
+  IntValueItem,
+  DoubleValueItem,
+  IntArrayItem,
+  DoubleArrayItem,
+  StringValueItem,
+  StringArrayItem
+} ItemType;
+
+typedef struct {
+  Data*    _data;
+  ItemType _type;
+} Item;
+
+static const char* STRINGS[STRING_NUM];
+
+static void initStrings() {
+  for (unsigned i = 0; i < STRING_NUM; i += 1) {
+    char buffer[32];
+    Utils::formatStr(buffer, 32, "string value %u", i);
+    STRINGS[i] = Utils::cloneStr(buffer);
+  }
+}
+
+static ItemType getItemType(Workload workload, unsigned index) {
+  static const ItemType numeric[] = {
+    IntValueItem, IntArrayItem, DoubleValueItem, DoubleArrayItem
+  };
+  static const ItemType strings[] = { StringValueItem, StringArrayItem };
+  static const ItemType mixed[] = {
+    IntValueItem, IntArrayItem, StringValueItem, DoubleArrayItem,
+    StringArrayItem, DoubleValueItem
+  };
+  switch (workload) {
+  case NumericWorkload : return numeric[index % 4];
+  case StringWorkload  : return strings[index % 2];
+  default              : return mixed[index % 6];
+  }
+}
+
+static void setUp(GCview* gcview, const Scenario* scenario,
+                  Array<Item>* items) {
+  char buffer[64];
+  for (unsigned s = 0; s < scenario->_space_num; s += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", s);
+    Space* space = gcview->addSpace(buffer);
+    for (unsigned d = 0; d < scenario->_data_num; d += 1) {
+      Utils::formatStr(buffer, 64, "Data %u", d);
+      Item item;
+      item._type = getItemType(scenario->_workload, d);
+      switch (item._type) {
+      case IntValueItem:
+        item._data = space->addData<IntValue>(buffer);
+        break;
+      case DoubleValueItem:
+        item._data = space->addData<DoubleValue>(buffer);
+        break;
+      case IntArrayItem: {
+        IntArray* array = space->addData<IntArray>(buffer);
+        array->resize(scenario->_array_length);
+        item._data = array;
+        break;
+      }
+      case DoubleArrayItem: {
+        DoubleArray* array = space->addData<DoubleArray>(buffer);
+        array->resize(scenario->_array_length);
+        item._data = array;
+        break;
+      }
+      case StringValueItem:
+        item._data = space->addData<StringValue>(buffer);
+        break;
+      default: {
+        StringArray* array = space->addData<StringArray>(buffer);
+        array->resize(scenario->_array_length);
+        item._data = array;
+        break;
+      }
+      }
+      items->add(item);
+    }
+  }
+}
+
+// Whether value / element index is modified in iteration iter: a
+// fixed pseudo-random subset of about ratio of them.
+static bool isModified(unsigned index, unsigned iter, double ratio) {
+  unsigned h = index * 2654435761u + iter * 40503u;
+  h ^= h >> 15;
+  h *= 2246822519u;
+  h ^= h >> 13;
+  return (double) (h % 10000) < ratio * 10000.0;
+}
+
+static void update(Array<Item>* items, const Scenario* scenario,
+                   unsigned iter) {
+  const double ratio = scenario->_modified_ratio;
+  const unsigned length = scenario->_array_length;
+  for (unsigned i = 0; i < items->getLength(); i += 1) {
+    const Item& item = (*items)[i];
+    switch (item._type) {
+    case IntValueItem:
+      if (isModified(i, iter, ratio)) {
+        ((IntValue*) item._data)->set((int) (iter * 31 + i));
+      }
+      break;
+    case DoubleValueItem:
+      if (isModified(i, iter, ratio)) {
+        ((DoubleValue*) item._data)->set((double) iter * 0.125 + i);
+      }
+      break;
+    case StringValueItem:
+      if (isModified(i, iter, ratio)) {
+        ((StringValue*) item._data)->set(STRINGS[(iter + i) % STRING_NUM]);
+      }
+      break;
+    case IntArrayItem: {
+      IntArray* array = (IntArray*) item._data;
+      for (unsigned j = 0; j < length; j += 1) {
+        if (isModified(i * length + j, iter, ratio)) {
+          array->set(j, (int) (iter * 4096 + j));
+        }
+      }
+      break;
+    }
+    case DoubleArrayItem: {
+      DoubleArray* array = (DoubleArray*) item._data;
+      for (unsigned j = 0; j < length; j += 1) {
+        if (isModified(i * length + j, iter, ratio)) {
+          array->set(j, (double) (iter + j) * 1.2345);
+        }
+      }
+      break;
+    }
+    default: {
+      StringArray* array = (StringArray*) item._data;
+      for (unsigned j = 0; j < length; j += 1) {
+        if (isModified(i * length + j, iter, ratio)) {
+          array->set(j, STRINGS[(iter + j) % STRING_NUM]);
+        }
+      }
+      break;
+    }
+    }
+  }
+}
+
+////////// Runs //////////
+
+typedef struct {
+  unsigned long long _bytes;
+  double _mean_ns;
+  double _p50_ns;
+  double _p99_ns;
+  double _max_ns;
+  double _allocs_per_snapshot;
+} Result;
+
+static int compareDoubles(const void* a, const void* b) {
+  const double x = *(const double*) a;
+  const double y = *(const double*) b;
+  return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+// Nearest rank, over sorted values.
+static double getPercentile(const double* sorted, unsigned num, double p) {
+  unsigned rank = (unsigned) (p * (double) num + 0.999999);
+  if (rank < 1) {
+    rank = 1;
+  }
+  if (rank > num) {
+    rank = num;
+  }
+  return sorted[rank - 1];
+}
+
+static void run(const Scenario* scenario, Backend* backend,
+                unsigned snapshots, Result* result) {
+  GCview gcview("GCview Benchmark", Utils::getNowSec());
+  const unsigned event_id = gcview.addEvent("Event");
+  Array<Item> items;
+  setUp(&gcview, scenario, &items);
+
+  double* pauses_ns = new double[snapshots];
+  GCVIEW_ALLOC_GUARANTEE(pauses_ns);
+  unsigned long long allocs = 0;
+  backend->writeMetadata(&gcview);
+  for (unsigned i = 0; i < snapshots; i += 1) {
+    update(&items, scenario, i + 1);
+    gcview.eventStart(event_id, Utils::getNowSec());
+    gcview.eventEnd(Utils::getNowSec());
+
+    const unsigned long long start_allocs = MM::getTotalAllocatedCount();
+    const double start_sec = Utils::getNowSec();
+    backend->writeData(&gcview);
+    pauses_ns[i] = (Utils::getNowSec() - start_sec) * 1e9;
+    allocs += MM::getTotalAllocatedCount() - start_allocs;
+  }
+  backend->finish(&gcview);
+
+  double total_ns = 0.0;
+  for (unsigned i = 0; i < snapshots; i += 1) {
+    total_ns += pauses_ns[i];
+  }
+  qsort(pauses_ns, snapshots, sizeof(double), compareDoubles);
+  result->_bytes = backend->getBytes();
+  result->_mean_ns = total_ns / (double) snapshots;
+  result->_p50_ns = getPercentile(pauses_ns, snapshots, 0.50);
+  result->_p99_ns = getPercentile(pauses_ns, snapshots, 0.99);
+  result->_max_ns = pauses_ns[snapshots - 1];
+  result->_allocs_per_snapshot = (double) allocs / (double) snapshots;
+  delete[] pauses_ns;
+}
+
+static void printHeader() {
+  printf("%-15s %-13s %12s %12s %12s %12s %14s %10s\n",
+         "scenario", "backend", "mean ns", "p50 ns", "p99 ns", "max ns",
+         "bytes/snap", "allocs/snap");
+}
+
+static void printResult(const Scenario* scenario, const Backend* backend,
+                        unsigned snapshots, const Result* result) {
+  printf("%-15s %-13s %12.0f %12.0f %12.0f %12.0f %14.1f",
+         scenario->_name, backend->getName(), result->_mean_ns,
+         result->_p50_ns, result->_p99_ns, result->_max_ns,
+         (double) result->_bytes / (double) snapshots);
+  if (MM::isEnabled()) {
+    printf(" %10.2f\n", result->_allocs_per_snapshot);
+  } else {
+    printf(" %10s\n", "-");
+  }
+}
+
+static void writeResult(JSONArrayWriter* y, JSONWriter* writer,
+                        const Scenario* scenario, const Backend* backend,
+                        unsigned snapshots, const Result* result) {
+  y->startElem();
+  JSONObjectWriter x(writer);
+  x.writePair("Scenario", scenario->_name);
+  x.writePair("Backend", backend->getName());
+  x.writePair("Spaces", scenario->_space_num);
+  x.writePair("DataPerSpace", scenario->_data_num);
+  x.writePair("ArrayLength", scenario->_array_length);
+  x.writePair("ModifiedRatio", scenario->_modified_ratio);
+  x.writePair("Workload", WORKLOAD_NAMES[scenario->_workload]);
+  x.writePair("Snapshots", snapshots);
+  x.writePair("MeanNs", result->_mean_ns);
+  x.writePair("P50Ns", result->_p50_ns);
+  x.writePair("P99Ns", result->_p99_ns);
+  x.writePair("MaxNs", result->_max_ns);
+  x.writePair("Bytes", (long long) result->_bytes);
+  if (MM::isEnabled()) {
+    x.writePair("AllocsPerSnapshot", result->_allocs_per_snapshot);
+  } else {
+    x.startPair("AllocsPerSnapshot");
+    writer->writeNull();
+  }
+}
+
+////////// Options //////////
+
+static void usage() {
+  fprintf(stderr,
+          "usage: gcview_bench [--snapshots n] [--scenario name] "
+          "[--backend name] [--results file]\n"
+          "                    [--spaces n] [--data n] [--length n] "
+          "[--ratio r] [--workload numeric|strings|mixed]\n");
+  exit(1);
+}
+
+static unsigned parseUnsigned(const char* str) {
+  char* end;
+  const unsigned long val = strtoul(str, &end, 10);
+  if (*str == '\0' || *end != '\0' || val == 0) {
+    usage();
+  }
+  return (unsigned) val;
+}
+
+int main(int argc, char* argv[]) {
+  unsigned snapshots = DEFAULT_SNAPSHOTS;
+  const char* scenario_name = NULL;
+  const char* backend_name = NULL;
+  const char* results_file_name = NULL;
+  Scenario custom = DEFAULT_SCENARIOS[0];
+  custom._name = "custom";
+  bool has_custom = false;
+
+  for (int i = 1; i < argc; i += 1) {
+    const char* opt = argv[i];
+    if (i + 1 >= argc) {
+      usage();
+    }
+    const char* val = argv[++i];
+    if (strcmp(opt, "--snapshots") == 0) {
+      snapshots = parseUnsigned(val);
+    } else if (strcmp(opt, "--scenario") == 0) {
+      scenario_name = val;
+    } else if (strcmp(opt, "--backend") == 0) {
+      backend_name = val;
+    } else if (strcmp(opt, "--results") == 0) {
+      results_file_name = val;
+    } else if (strcmp(opt, "--spaces") == 0) {
+      custom._space_num = parseUnsigned(val);
+      has_custom = true;
+    } else if (strcmp(opt, "--data") == 0) {
+      custom._data_num = parseUnsigned(val);
+      has_custom = true;
+    } else if (strcmp(opt, "--length") == 0) {
+      custom._array_length = parseUnsigned(val);
+      has_custom = true;
+    } else if (strcmp(opt, "--ratio") == 0) {
+      custom._modified_ratio = atof(val);
+      if (custom._modified_ratio < 0.0 || custom._modified_ratio > 1.0) {
+        usage();
+      }
+      has_custom = true;
+    } else if (strcmp(opt, "--workload") == 0) {
+      bool found = false;
+      for (unsigned w = 0; w < 3; w += 1) {
+        if (strcmp(val, WORKLOAD_NAMES[w]) == 0) {
+          custom._workload = (Workload) w;
+          found = true;
+        }
+      }
+      if (!found) {
+        usage();
+      }
+      has_custom = true;
+    } else {
+      usage();
+    }
+  }
+
+  const Scenario* scenarios = (has_custom) ? &custom : DEFAULT_SCENARIOS;
+  const unsigned scenario_num = (has_custom) ? 1 : DEFAULT_SCENARIO_NUM;
+
+  initStrings();
+  JSONWriter* results_writer = NULL;
+  JSONArrayWriter* results_array_writer = NULL;
+  if (results_file_name != NULL) {
+    results_writer = new JSONWriter(results_file_name);
+    results_array_writer =
+      new JSONArrayWriter(results_writer, true /* add_newlines */);
+  }
+
+  printHeader();
+  unsigned run_num = 0;
+  for (unsigned s = 0; s < scenario_num; s += 1) {
+    const Scenario* scenario = &scenarios[s];
+    if (scenario_name != NULL && strcmp(scenario_name, scenario->_name) != 0) {
+      continue;
+    }
+    for (unsigned b = 0; b < BACKEND_NUM; b += 1) {
+      if (backend_name != NULL && strcmp(backend_name, BACKEND_NAMES[b]) != 0) {
+        continue;
+      }
+      Backend* backend = newBackend(b);
+      if (backend == NULL) {
+        continue;
+      }
+      Result result;
+      run(scenario, backend, snapshots, &result);
+      printResult(scenario, backend, snapshots, &result);
+      if (results_array_writer != NULL) {
+        writeResult(results_array_writer, results_writer, scenario, backend,
+                    snapshots, &result);
+      }
+      run_num += 1;
+      delete backend;
+    }
+  }
+
+  if (results_writer != NULL) {
+    delete results_array_writer;
+    delete results_writer;
+  }
+  if (run_num == 0) {
+    fprintf(stderr, "no scenario / backend matched\n");
+    return 1;
+  }
+
+  for (unsigned i = 0; i < STRING_NUM; i += 1) {
+    delete[] STRINGS[i];
+  }
+  MM::print_report();
+  return 0;
+}
@@ -0,0 +1,144 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <time.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "sink.hpp"
+
+using namespace gcview;
+
+// Measures the CPU time a JSON snapshot costs when it is written as is
+// and when it is compressed by a GzipSink (one gzip member per
+// snapshot) at a few compression levels, and the compression ratio.
+
+static const unsigned SPACE_NUM    =    8;
+static const unsigned ARRAY_LENGTH = 1024;
+static const unsigned SNAPSHOTS    =  500;
+// elements of each array that change between snapshots
+static const unsigned CHANGED_NUM  =  384;
+
+static const char* OUTPUT_FILE_NAME = "/dev/null";
+
+static void setUp(GCview* gcview) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->addSpace(buffer);
+    space->addData<IntValue>("Int Value");
+    space->addData<DoubleValue>("Double Value");
+    space->addData<IntArray>("Int Array")->resize(ARRAY_LENGTH);
+    space->addData<DoubleArray>("Double Array")->resize(ARRAY_LENGTH);
+    space->addData<BoolArray>("Bool Array")->resize(ARRAY_LENGTH);
+  }
+}
+
+// Modifies the values and part of each array, so that the snapshots
+// are a mix of full arrays and unchanged data, like a real trace.
+static void update(GCview* gcview, unsigned iter) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->findSpace(buffer);
+    space->findIntValue("Int Value")->value() = (int) (iter * 1000 + i);
+    space->findDoubleValue("Double Value")->value() = iter * 0.125 + i;
+    IntArray* int_array = space->findIntArray("Int Array");
+    DoubleArray* double_array = space->findDoubleArray("Double Array");
+    BoolArray* bool_array = space->findBoolArray("Bool Array");
+    const unsigned start = (iter * 97) % ARRAY_LENGTH;
+    for (unsigned k = 0; k < CHANGED_NUM; k += 1) {
+      const unsigned j = (start + k) % ARRAY_LENGTH;
+      int_array->value(j) = (int) (iter * 64 + j);
+      double_array->value(j) = (double) (iter + j) * 0.5;
+      bool_array->value(j) = (iter + j) % 3 == 0;
+    }
+  }
+}
+
+static double getThreadCPUSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// level < 0 means no compression
+static void runBench(const char* mode, int level) {
+  GCview gcview("GzipSink Benchmark");
+  unsigned event_id = gcview.addEvent("Event");
+  setUp(&gcview);
+
+  OutputSink* sink;
+#if GCVIEW_ENABLE_ZLIB
+  GzipSink* gzip_sink = NULL;
+  if (level >= 0) {
+    gzip_sink = new GzipSink(OUTPUT_FILE_NAME, level);
+    GCVIEW_ALLOC_GUARANTEE(gzip_sink);
+    sink = gzip_sink;
+  } else
+#endif // GCVIEW_ENABLE_ZLIB
+  {
+    sink = new FileSink(OUTPUT_FILE_NAME);
+    GCVIEW_ALLOC_GUARANTEE(sink);
+  }
+
+  double snapshot_sec = 0.0;
+  unsigned long long json_bytes;
+  {
+    JSONWriter writer(sink, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    {
+      JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+      array_writer.startElem();
+      gcview.writeJSONMetadata(&writer);
+
+      for (unsigned i = 0; i < SNAPSHOTS; i += 1) {
+        update(&gcview, i + 1);
+        gcview.eventStart(event_id);
+        gcview.eventEnd();
+
+        const double start_sec = getThreadCPUSec();
+        array_writer.startElem();
+        gcview.writeJSONData(&writer);
+        snapshot_sec += getThreadCPUSec() - start_sec;
+      }
+    }
+    writer.flush();
+    json_bytes = writer.getBytesWritten();
+  }
+
+  printf("%-8s %10.0f ns/snapshot (CPU) %12llu bytes", mode,
+         snapshot_sec * 1e9 / (double) SNAPSHOTS, json_bytes);
+#if GCVIEW_ENABLE_ZLIB
+  if (gzip_sink != NULL) {
+    const unsigned long long gzip_bytes = gzip_sink->getBytesWritten();
+    printf(" -> %10llu bytes (%5.1fx) %6llu frames", gzip_bytes,
+           (double) json_bytes / (double) gzip_bytes,
+           gzip_sink->getFrameNum());
+  }
+#endif // GCVIEW_ENABLE_ZLIB
+  printf("\n");
+
+  delete sink;
+}
+
+int main() {
+  runBench("plain", -1);
+#if GCVIEW_ENABLE_ZLIB
+  runBench("gzip-1", 1);
+  runBench("gzip-6", 6);
+  runBench("gzip-9", 9);
+#endif // GCVIEW_ENABLE_ZLIB
+
+  MM::print_report();
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <time.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+
+using namespace gcview;
+
+static const unsigned SPACE_NUM    =    8;
+static const unsigned ARRAY_LENGTH = 1024;
+static const unsigned SNAPSHOTS    =  500;
+
+static const char* OUTPUT_FILE_NAME = "/dev/null";
+
+static double getNowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static void setUp(GCview* gcview) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->addSpace(buffer);
+    space->addData<IntValue>("Int Value");
+    space->addData<DoubleValue>("Double Value");
+    space->addData<IntArray>("Int Array")->resize(ARRAY_LENGTH);
+    space->addData<DoubleArray>("Double Array")->resize(ARRAY_LENGTH);
+    space->addData<BoolArray>("Bool Array")->resize(ARRAY_LENGTH);
+  }
+}
+
+// Modifies every value so that each snapshot writes all the data.
+static void update(GCview* gcview, unsigned iter) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->findSpace(buffer);
+    space->findIntValue("Int Value")->value() = (int) (iter * 1000 + i);
+    space->findDoubleValue("Double Value")->value() = iter * 0.125 + i;
+    IntArray* int_array = space->findIntArray("Int Array");
+    DoubleArray* double_array = space->findDoubleArray("Double Array");
+    BoolArray* bool_array = space->findBoolArray("Bool Array");
+    for (unsigned j = 0; j < ARRAY_LENGTH; j += 1) {
+      int_array->value(j) = (int) (iter * 4096 + j * 17);
+      double_array->value(j) = (double) (iter + j) * 1.2345;
+      bool_array->value(j) = ((iter + j) % 3) == 0;
+    }
+  }
+}
+
+static void runBench(const char* mode, size_t buffer_size) {
+  GCview gcview("JSONWriter Benchmark");
+  unsigned event_id = gcview.addEvent("Event");
+  setUp(&gcview);
+
+  JSONWriter writer(OUTPUT_FILE_NAME, buffer_size);
+  double total_sec = 0.0;
+  {
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+
+    for (unsigned i = 0; i < SNAPSHOTS; i += 1) {
+      update(&gcview, i + 1);
+      gcview.eventStart(event_id);
+      gcview.eventEnd();
+
+      const double start_sec = getNowSec();
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+      total_sec += getNowSec() - start_sec;
+    }
+  }
+
+  const double bytes = (double) writer.getBytesWritten();
+  printf("%-10s %10u snapshots %14.0f bytes %10.0f ns/snapshot %10.1f MB/s\n",
+         mode, SNAPSHOTS, bytes,
+         total_sec * 1e9 / (double) SNAPSHOTS,
+         bytes / total_sec / (1024.0 * 1024.0));
+}
+
+int main() {
+  runBench("stdio", 0);
+  runBench("buffered", GCVIEW_JSON_WRITER_BUFFER_SIZE);
+
+  MM::print_report();
+}
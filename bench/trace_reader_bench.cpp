@@ -0,0 +1,130 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "reader.hpp"
+#include "sink.hpp"
+
+using namespace gcview;
+
+// Writes a large JSON trace (plain and gzip-compressed) to temp files
+// and measures how fast a TraceReader reads it back.
+
+static const unsigned SPACE_NUM    =    8;
+static const unsigned ARRAY_LENGTH = 1024;
+static const unsigned SNAPSHOTS    = 1000;
+static const unsigned REPEATS      =    3;
+
+static void setUp(GCview* gcview) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->addSpace(buffer);
+    space->addData<IntValue>("Int Value");
+    space->addData<DoubleValue>("Double Value");
+    space->addData<IntArray>("Int Array")->resize(ARRAY_LENGTH);
+    space->addData<DoubleArray>("Double Array")->resize(ARRAY_LENGTH);
+    space->addData<BoolArray>("Bool Array")->resize(ARRAY_LENGTH);
+  }
+}
+
+static void update(GCview* gcview, unsigned iter) {
+  char buffer[64];
+  for (unsigned i = 0; i < SPACE_NUM; i += 1) {
+    Utils::formatStr(buffer, 64, "Space %u", i);
+    Space* space = gcview->findSpace(buffer);
+    space->findIntValue("Int Value")->value() = (int) (iter * 1000 + i);
+    space->findDoubleValue("Double Value")->value() = iter * 0.125 + i;
+    IntArray* int_array = space->findIntArray("Int Array");
+    DoubleArray* double_array = space->findDoubleArray("Double Array");
+    BoolArray* bool_array = space->findBoolArray("Bool Array");
+    for (unsigned j = 0; j < ARRAY_LENGTH; j += 1) {
+      int_array->value(j) = (int) (iter * 4096 + j * 17);
+      double_array->value(j) = (double) (iter + j) * 1.2345;
+      bool_array->value(j) = (iter + j) % 3 == 0;
+    }
+  }
+}
+
+static void writeTrace(OutputSink* sink) {
+  GCview gcview("TraceReader Benchmark");
+  unsigned event_id = gcview.addEvent("Event");
+  setUp(&gcview);
+
+  JSONWriter writer(sink, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+  {
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+    for (unsigned i = 0; i < SNAPSHOTS; i += 1) {
+      update(&gcview, i + 1);
+      gcview.eventStart(event_id);
+      gcview.eventEnd();
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+    }
+  }
+  writer.flush();
+}
+
+static void readTrace(const char* mode, const char* file_name) {
+  double best_sec = 0.0;
+  unsigned long long bytes = 0;
+  for (unsigned i = 0; i < REPEATS; i += 1) {
+    const double start_sec = Utils::getNowSec();
+    TraceReader reader(file_name);
+    while (reader.next()) { }
+    const double sec = Utils::getNowSec() - start_sec;
+    GCVIEW_GUARANTEE(reader.getSnapshotNum() == SNAPSHOTS,
+                     "unexpected snapshot number");
+    if (i == 0 || sec < best_sec) {
+      best_sec = sec;
+    }
+    bytes = reader.getBytesRead();
+  }
+  printf("%-6s %12llu bytes %8.3f sec %8.1f MB/s\n", mode, bytes, best_sec,
+         (double) bytes / (1024.0 * 1024.0) / best_sec);
+}
+
+int main() {
+  char json_file_name[] = "/tmp/gcview_reader_bench_XXXXXX";
+  const int fd = mkstemp(json_file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+  {
+    FileSink sink(json_file_name);
+    writeTrace(&sink);
+  }
+  readTrace("plain", json_file_name);
+  unlink(json_file_name);
+
+#if GCVIEW_ENABLE_ZLIB
+  char gzip_file_name[] = "/tmp/gcview_reader_bench_XXXXXX";
+  const int gzip_fd = mkstemp(gzip_file_name);
+  GCVIEW_GUARANTEE(gzip_fd >= 0, "could not create temp file");
+  close(gzip_fd);
+  {
+    GzipSink sink(gzip_file_name);
+    writeTrace(&sink);
+  }
+  readTrace("gzip", gzip_file_name);
+  unlink(gzip_file_name);
+#endif // GCVIEW_ENABLE_ZLIB
+
+  MM::print_report();
+}
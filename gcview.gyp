@@ -22,20 +22,70 @@
           'src/'
       ],
       'sources': [
+          'src/aggregate.hpp',
+          'src/arena.cpp',
+          'src/arena.hpp',
           'src/array.hpp',
+          'src/async.cpp',
+          'src/async.hpp',
+          'src/bitmap.hpp',
+          'src/buffer.hpp',
+          'src/clock.cpp',
+          'src/clock.hpp',
           'src/data.cpp',
           'src/data.hpp',
+          'src/encoding.hpp',
           'src/gcview.cpp',
           'src/gcview.hpp',
+          'src/handle.hpp',
+          'src/histogram.hpp',
+          'src/index.cpp',
+          'src/index.hpp',
           'src/json.hpp',
           'src/mm.cpp',
           'src/mm.hpp',
+          'src/name_index.hpp',
+          'src/policy.hpp',
+          'src/reader.cpp',
+          'src/reader.hpp',
+          'src/recorder.cpp',
+          'src/recorder.hpp',
+          'src/schema.hpp',
+          'src/simd.cpp',
+          'src/simd.hpp',
+          'src/sink.cpp',
+          'src/sink.hpp',
           'src/space.cpp',
           'src/space.hpp',
+          'src/staging.hpp',
+          'src/stream.cpp',
+          'src/stream.hpp',
+          'src/trace.cpp',
+          'src/trace.hpp',
           'src/utils.cpp',
           'src/utils.hpp',
           'src/vector.hpp'
-        ]
+        ],
+      'link_settings' : {
+          'libraries' : [
+              '-lpthread',
+              '-lz'
+          ]
+      }
+    },
+
+    {
+      'target_name' : 'clock_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/clock_units.cpp'
+      ]
     },
 
     {
@@ -106,6 +156,426 @@
       'sources' : [
           'units/value_units.cpp'
       ]
+    },
+
+    {
+      'target_name' : 'trace_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/trace_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'patch_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/patch_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'encoding_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/encoding_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'tile_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/tile_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'histogram_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/histogram_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'aggregate_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/aggregate_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'sink_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/sink_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'reader_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/reader_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'index_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/index_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'staging_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/staging_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'atomic_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/atomic_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'policy_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/policy_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'duration_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/duration_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'recorder_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/recorder_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'stream_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/stream_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'async_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/async_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'space_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/space_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'handle_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/handle_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'schema_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/schema_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'simd_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/simd_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'vector_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/vector_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'arena_units',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'units/arena_units.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'json_writer_bench',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'bench/json_writer_bench.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'async_writer_bench',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'bench/async_writer_bench.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'gzip_sink_bench',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'bench/gzip_sink_bench.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'trace_reader_bench',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'bench/trace_reader_bench.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'array_scan_bench',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'bench/array_scan_bench.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'gcview_bench',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'bench/gcview_bench.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'trace_to_json',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'tools/trace_to_json.cpp'
+      ]
+    },
+
+    {
+      'target_name' : 'read_trace',
+      'type' : 'executable',
+      'include_dirs' : [
+          'src/'
+      ],
+      'dependencies' : [
+          'gcview'
+      ],
+      'sources' : [
+          'tools/read_trace.cpp'
+      ]
     }
   ]
 }
@@ -47,8 +47,29 @@ var gcviewConstructor = function() {
                 'Event Name' : {
                     Formatter : eventNameFormatter,
                     ExcludeFromMenu : true
+                },
+                'Event Duration P50' : {
+                    Formatter : customizationShared.msFromSecFormatter
+                },
+                'Event Duration P99' : {
+                    Formatter : customizationShared.msFromSecFormatter
+                },
+                'Event Duration P999' : {
+                    Formatter : customizationShared.msFromSecFormatter
+                },
+                'Event Duration Max' : {
+                    Formatter : customizationShared.msFromSecFormatter
+                },
+                'Pause Budget' : {
+                    Formatter : customizationShared.msFromSecFormatter
+                },
+                'Last Write Time' : {
+                    Formatter : customizationShared.msFromSecFormatter
+                },
+                'Total Write Time' : {
+                    Formatter : customizationShared.secFromSecFormatter
                 }
-                
+
             }
         };
 
@@ -175,13 +196,15 @@ var gcviewConstructor = function() {
     }();
 
     function Data(id, name, spaceName, dataType, isArray,
-                  groupName, enumMembers, value) {
+                  groupName, enumMembers, labels, value) {
         this.id = id;
         this.name = name;
         this.dataType = dataType;
         this.isArray = isArray;
         this.groupName = groupName;
         this.enumMembers = enumMembers;
+        // names of the array indexes, e.g., histogram bucket ranges
+        this.labels = labels;
         this.value = value;
 
         var valueCellClassNames = {
@@ -379,10 +402,14 @@ var gcviewConstructor = function() {
                 if (jsonDatum.hasOwnProperty('Members')) {
                     enumMembers = jsonDatum.Members;
                 }
-                var value = jsonDatum.Value;
+                var labels = null;
+                if (jsonDatum.hasOwnProperty('Labels')) {
+                    labels = jsonDatum.Labels;
+                }
+                var value = utils.decodeValue(jsonDatum.Value, null);
                 var datum = new Data(dataID, dataName, spaceName,
-                                     dataType, isArray,
-                                     groupName, enumMembers, value);
+                                     dataType, isArray, groupName,
+                                     enumMembers, labels, value);
                 space.addData(datum);
             }
             gcview.addSpace(space);
@@ -808,7 +835,8 @@ var gcviewConstructor = function() {
                             for (var did = 0; did < jsonData.length; did += 1) {
                                 var valueID = jsonData[did].ID;
                                 var value = jsonData[did].Value;
-                                dataArray[valueID] = value;
+                                dataArray[valueID] = utils.decodeValue(value,
+                                                                       null);
                             }
                             spacesArray[spaceID] = dataArray;
                         }
@@ -827,6 +855,9 @@ var gcviewConstructor = function() {
                                         var data = dataArray[did];
                                         if (data == null) {
                                             dataArray[did] = prevSpaceArray[sid][did];
+                                        } else {
+                                            dataArray[did] = utils.decodeValue(
+                                                data, prevSpaceArray[sid][did]);
                                         }
                                     }
                                 }
@@ -1607,8 +1638,13 @@ var gcviewConstructor = function() {
         function updateChartPanel() {
             var data = dataMenu.tGetSelectedData();
             var groupName = data.groupName;
-            var labelsDataName = space.groupLabelNames[groupName];
-            var labelsData = space.findData(labelsDataName);
+            var labelsData = null;
+            if (data.labels != null) {
+                labelsData = { value : data.labels };
+            } else {
+                var labelsDataName = space.groupLabelNames[groupName];
+                labelsData = space.findData(labelsDataName);
+            }
             chartPanel.update(data, labelsData);
         }
 
@@ -27,8 +27,108 @@ var utils = function() {
         return array.indexOf(elem) > -1;
     }
 
+    // Returns the full value of a datum given the (possibly encoded)
+    // value in a GCviewData object (or, for RLE arrays, in the
+    // metadata) and the datum's previous value.
+    function decodeValue(value, prevValue) {
+        if (value == null || value instanceof Array ||
+            typeof value != 'object') {
+            return value;
+        }
+        if (value.hasOwnProperty('Patch')) {
+            var patch = value.Patch;
+            var res = prevValue.slice(0);
+            for (var i = 0; i < patch.length; i += 2) {
+                res[patch[i]] = patch[i + 1];
+            }
+            return res;
+        }
+        if (value.hasOwnProperty('RunPatch')) {
+            // index / run / value triples, see TileArray
+            var patch = value.RunPatch;
+            var res = prevValue.slice(0);
+            for (var i = 0; i < patch.length; i += 3) {
+                for (var j = 0; j < patch[i + 1]; j += 1) {
+                    res[patch[i] + j] = patch[i + 2];
+                }
+            }
+            return res;
+        }
+        if (value.hasOwnProperty('RLE')) {
+            // value / run pairs, it does not need the previous value
+            var runs = value.RLE;
+            var res = [];
+            for (var i = 0; i < runs.length; i += 2) {
+                for (var j = 0; j < runs[i + 1]; j += 1) {
+                    res.push(runs[i]);
+                }
+            }
+            return res;
+        }
+        if (value.hasOwnProperty('Delta')) {
+            var delta = value.Delta;
+            var res = new Array(delta.length);
+            for (var i = 0; i < delta.length; i += 1) {
+                res[i] = prevValue[i] + delta[i];
+            }
+            return res;
+        }
+        if (value.hasOwnProperty('Varint')) {
+            // zig-zag varints of the differences from the previous
+            // values (arithmetic, since they can exceed 32 bits)
+            var bytes = atob(value.Varint);
+            var res = [];
+            var val = 0;
+            var mul = 1;
+            for (var i = 0; i < bytes.length; i += 1) {
+                var b = bytes.charCodeAt(i);
+                val += (b & 0x7f) * mul;
+                mul *= 128;
+                if ((b & 0x80) == 0) {
+                    var d = (val % 2 == 0) ? val / 2 : -(val + 1) / 2;
+                    res.push(prevValue[res.length] + d);
+                    val = 0;
+                    mul = 1;
+                }
+            }
+            return res;
+        }
+        if (value.hasOwnProperty('XorFloat')) {
+            // each element XOR-ed with the previous element in the array
+            var bytes = atob(value.XorFloat);
+            var view = new DataView(new ArrayBuffer(8));
+            var res = [];
+            var hi = 0;
+            var lo = 0;
+            var pos = 0;
+            while (pos < bytes.length) {
+                var header = bytes.charCodeAt(pos);
+                pos += 1;
+                if (header != 0x80) {
+                    var lead = header >> 4;
+                    var trail = header & 0x0f;
+                    for (var i = lead; i < 8 - trail; i += 1) {
+                        var b = bytes.charCodeAt(pos);
+                        pos += 1;
+                        if (i < 4) {
+                            hi = (hi ^ (b << (24 - 8 * i))) >>> 0;
+                        } else {
+                            lo = (lo ^ (b << (56 - 8 * i))) >>> 0;
+                        }
+                    }
+                }
+                view.setUint32(0, hi);
+                view.setUint32(4, lo);
+                res.push(view.getFloat64(0));
+            }
+            return res;
+        }
+        throw new Error('unknown value encoding');
+    }
+
     return { getArray      : getArray,
-             arrayContains : arrayContains };
+             arrayContains : arrayContains,
+             decodeValue   : decodeValue };
 }();
 
 var customizationShared = function() {
@@ -14,11 +14,15 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
-import json, sys
+import gzip, json, sys
 
 class IncJSONReader:
     def __init__(self, file_name):
-        self.file = open(file_name)
+        # gzip-compressed traces (see GzipSink) are read frame by frame
+        if file_name.endswith('.gz'):
+            self.file = gzip.open(file_name)
+        else:
+            self.file = open(file_name)
         self.BufferSize = 1024
         self.buffer = ''
         self.index = 0
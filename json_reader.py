@@ -14,6 +14,8 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import base64
+import struct
 import sys
 
 from inc_json_reader import IncJSONReader
@@ -39,6 +41,67 @@ def array_to_str(array, enum_members = None):
         array_str = ""
     return "len:%d [%s ]" % ( len(array), array_str )
 
+def decode_value(value, prev_value):
+    if not isinstance(value, dict):
+        return value
+    if 'Patch' in value:
+        patch = value['Patch']
+        value = list(prev_value)
+        for i in range(0, len(patch), 2):
+            value[patch[i]] = patch[i + 1]
+        return value
+    if 'RunPatch' in value:
+        # index / run / value triples, see TileArray
+        patch = value['RunPatch']
+        value = list(prev_value)
+        for i in range(0, len(patch), 3):
+            for j in range(patch[i + 1]):
+                value[patch[i] + j] = patch[i + 2]
+        return value
+    if 'RLE' in value:
+        # value / run pairs, it does not need the previous value
+        runs = value['RLE']
+        res = []
+        for i in range(0, len(runs), 2):
+            res.extend([ runs[i] ] * runs[i + 1])
+        return res
+    if 'Delta' in value:
+        delta = value['Delta']
+        return [ prev_value[i] + delta[i] for i in range(len(delta)) ]
+    if 'Varint' in value:
+        # zig-zag varints of the differences from the previous values
+        res = []
+        val = 0
+        shift = 0
+        for b in bytearray(base64.b64decode(value['Varint'])):
+            val |= (b & 0x7f) << shift
+            shift += 7
+            if (b & 0x80) == 0:
+                res.append(prev_value[len(res)] + ((val >> 1) ^ -(val & 1)))
+                val = 0
+                shift = 0
+        return res
+    if 'XorFloat' in value:
+        # each element XOR-ed with the previous element in the array
+        res = []
+        bits = 0
+        data = bytearray(base64.b64decode(value['XorFloat']))
+        pos = 0
+        while pos < len(data):
+            header = data[pos]
+            pos += 1
+            if header != 0x80:
+                lead = header >> 4
+                trail = header & 0x0f
+                x = 0
+                for i in range(lead, 8 - trail):
+                    x |= data[pos] << (56 - 8 * i)
+                    pos += 1
+                bits ^= x
+            res.append(struct.unpack('<d', struct.pack('<Q', bits))[0])
+        return res
+    raise ValueError('unknown value encoding')
+
 def to_str(value, enum_members = None):
     if not isinstance(value, list):
         return value_to_str(value, enum_members)
@@ -47,13 +110,14 @@ def to_str(value, enum_members = None):
 
 class Data:
     def __init__(self, data_id, data_name, data_type,
-                 is_array, group_name, enum_members, value):
+                 is_array, group_name, enum_members, labels, value):
         self.data_id = data_id
         self.data_name = data_name
         self.data_type = data_type
         self.is_array = is_array
         self.group_name = group_name
         self.enum_members = enum_members
+        self.labels = labels
         self.value = value
         self.dirty = True
 
@@ -64,6 +128,9 @@ class Data:
         self.value = value
         self.dirty = True
 
+    def update_value(self, value):
+        self.set_value(decode_value(value, self.value))
+
     def clear_dirty(self):
         self.dirty = False
 
@@ -90,6 +157,8 @@ class Data:
             self.data_type, is_array_str, self.value_to_str() )
         if self.enum_members != None:
             print 'Metadata       Enum Members %s' % array_to_str(self.enum_members)
+        if self.labels != None:
+            print 'Metadata       Labels %s' % array_to_str(self.labels)
 
     def print_data(self):
         print '    Data [%2d] "%s" | %s' % ( self.data_id, self.data_name,
@@ -149,7 +218,7 @@ class GCview:
         return None
 
     def set_value(self, space_id, data_id, value):
-        self.get_space(space_id).get_data(data_id).set_value(value)
+        self.get_space(space_id).get_data(data_id).update_value(value)
 
     def clear_dirty(self):
         for space in self.spaces:
@@ -203,9 +272,12 @@ for json_obj in json_reader:
                 enum_members = None
                 if 'Members' in data_obj:
                     enum_members = data_obj['Members']
-                value = data_obj['Value']
-                data = Data(data_id, data_name, data_type,
-                            is_array, group_name, enum_members, value)
+                labels = None
+                if 'Labels' in data_obj:
+                    labels = data_obj['Labels']
+                value = decode_value(data_obj['Value'], None)
+                data = Data(data_id, data_name, data_type, is_array,
+                            group_name, enum_members, labels, value)
                 space.add_data(data)
 
         gcview.print_metadata()
@@ -0,0 +1,242 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_AGGREGATE_HPP
+
+#define _GCVIEW_AGGREGATE_HPP
+
+#include <math.h>
+
+#include "utils.hpp"
+
+namespace gcview {
+
+// Estimates a quantile of a stream of values in constant memory, with
+// the P-square algorithm (Jain and Chlamtac, 1985): five markers track
+// the minimum, the maximum, the quantile and two points half-way
+// between them, and each new value moves the middle markers towards
+// their desired positions along a parabola through their neighbours.
+// Until there are five values, the quantile is exact.
+class QuantileEstimator {
+private:
+  static const unsigned MarkerNum = 5;
+
+  double _quantile;
+  long long _count;
+  // marker heights, actual and desired positions, and how much the
+  // desired positions move with each value
+  double _heights[MarkerNum];
+  double _positions[MarkerNum];
+  double _desired[MarkerNum];
+  double _increments[MarkerNum];
+
+  double getParabolic(unsigned i, double d) const {
+    const double* q = _heights;
+    const double* n = _positions;
+    return q[i] + d / (n[i + 1] - n[i - 1]) *
+      ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+       (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+  }
+
+  double getLinear(unsigned i, int d) const {
+    return _heights[i] + d * (_heights[i + d] - _heights[i]) /
+      (_positions[i + d] - _positions[i]);
+  }
+
+  void addFirst(double value) {
+    // insertion sort of the first values
+    unsigned i = (unsigned) _count;
+    while (i > 0 && _heights[i - 1] > value) {
+      _heights[i] = _heights[i - 1];
+      i -= 1;
+    }
+    _heights[i] = value;
+    _count += 1;
+  }
+
+public:
+  // quantile is in [0, 1], e.g., 0.99.
+  void reset(double quantile) {
+    GCVIEW_ASSERT(quantile >= 0.0 && quantile <= 1.0);
+    _quantile = quantile;
+    _count = 0;
+    for (unsigned i = 0; i < MarkerNum; i += 1) {
+      _heights[i] = 0.0;
+      _positions[i] = (double) i;
+    }
+    _desired[0] = 0.0;
+    _desired[1] = 2.0 * quantile;
+    _desired[2] = 4.0 * quantile;
+    _desired[3] = 2.0 + 2.0 * quantile;
+    _desired[4] = 4.0;
+    _increments[0] = 0.0;
+    _increments[1] = quantile / 2.0;
+    _increments[2] = quantile;
+    _increments[3] = (1.0 + quantile) / 2.0;
+    _increments[4] = 1.0;
+  }
+
+  void reset() { reset(_quantile); }
+
+  void add(double value) {
+    if (_count < (long long) MarkerNum) {
+      addFirst(value);
+      return;
+    }
+    _count += 1;
+
+    unsigned k;
+    if (value < _heights[0]) {
+      _heights[0] = value;
+      k = 0;
+    } else if (value >= _heights[MarkerNum - 1]) {
+      _heights[MarkerNum - 1] = value;
+      k = MarkerNum - 2;
+    } else {
+      k = 0;
+      while (value >= _heights[k + 1]) {
+        k += 1;
+      }
+    }
+    for (unsigned i = k + 1; i < MarkerNum; i += 1) {
+      _positions[i] += 1.0;
+    }
+    for (unsigned i = 0; i < MarkerNum; i += 1) {
+      _desired[i] += _increments[i];
+    }
+
+    for (unsigned i = 1; i < MarkerNum - 1; i += 1) {
+      const double d = _desired[i] - _positions[i];
+      if ((d >= 1.0 && _positions[i + 1] - _positions[i] > 1.0) ||
+          (d <= -1.0 && _positions[i - 1] - _positions[i] < -1.0)) {
+        const int sign = (d >= 0.0) ? 1 : -1;
+        const double height = getParabolic(i, (double) sign);
+        if (_heights[i - 1] < height && height < _heights[i + 1]) {
+          _heights[i] = height;
+        } else {
+          _heights[i] = getLinear(i, sign);
+        }
+        _positions[i] += (double) sign;
+      }
+    }
+  }
+
+  long long getCount() const { return _count; }
+
+  // 0.0 if there are no values.
+  double get() const {
+    if (_count == 0) {
+      return 0.0;
+    }
+    if (_count < (long long) MarkerNum) {
+      // nearest rank
+      double rank = ceil(_quantile * (double) _count);
+      unsigned index = (rank < 1.0) ? 0 : (unsigned) rank - 1;
+      return _heights[index];
+    }
+    return _heights[2];
+  }
+
+  QuantileEstimator(double quantile = 0.5) { reset(quantile); }
+};
+
+// The count, sum, min, max and a few quantiles of a stream of values,
+// in constant memory.
+class Aggregate {
+public:
+  typedef enum {
+    CountStat,
+    SumStat,
+    MinStat,
+    MaxStat,
+    MeanStat,
+    P50Stat,
+    P90Stat,
+    P99Stat,
+    StatNum
+  } Stat;
+
+private:
+  long long _count;
+  double _sum;
+  double _min;
+  double _max;
+  QuantileEstimator _p50;
+  QuantileEstimator _p90;
+  QuantileEstimator _p99;
+
+public:
+  static const char* getStatStr(Stat stat) {
+    switch (stat) {
+    case CountStat : return "Count";
+    case SumStat   : return "Sum";
+    case MinStat   : return "Min";
+    case MaxStat   : return "Max";
+    case MeanStat  : return "Mean";
+    case P50Stat   : return "P50";
+    case P90Stat   : return "P90";
+    case P99Stat   : return "P99";
+    default: GCVIEW_UNREACHABLE_NULL("unknown stat");
+    }
+  }
+
+  void add(double value) {
+    if (_count == 0 || value < _min) {
+      _min = value;
+    }
+    if (_count == 0 || value > _max) {
+      _max = value;
+    }
+    _count += 1;
+    _sum += value;
+    _p50.add(value);
+    _p90.add(value);
+    _p99.add(value);
+  }
+
+  void reset() {
+    _count = 0;
+    _sum = 0.0;
+    _min = 0.0;
+    _max = 0.0;
+    _p50.reset();
+    _p90.reset();
+    _p99.reset();
+  }
+
+  long long getCount() const { return _count; }
+
+  // All stats are 0.0 if there are no values.
+  double get(Stat stat) const {
+    switch (stat) {
+    case CountStat : return (double) _count;
+    case SumStat   : return _sum;
+    case MinStat   : return _min;
+    case MaxStat   : return _max;
+    case MeanStat  : return (_count > 0) ? _sum / (double) _count : 0.0;
+    case P50Stat   : return _p50.get();
+    case P90Stat   : return _p90.get();
+    case P99Stat   : return _p99.get();
+    default: GCVIEW_UNREACHABLE_0("unknown stat");
+    }
+  }
+
+  Aggregate()
+      : _count(0), _sum(0.0), _min(0.0), _max(0.0),
+        _p50(0.5), _p90(0.9), _p99(0.99) { }
+};
+
+}
+
+#endif // _GCVIEW_AGGREGATE_HPP
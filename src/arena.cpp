@@ -0,0 +1,73 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+
+#include "arena.hpp"
+
+namespace gcview {
+
+// All of the pool's state is statically initialized, so that it can be
+// used before and after the constructors / destructors of other
+// statics run. Its strings are bump allocated from chunks that are
+// never freed.
+StringPool::Entry StringPool::_entries[StringPool::Capacity];
+unsigned StringPool::_length = 0;
+
+static pthread_mutex_t PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static char* PoolTop = NULL;
+static size_t PoolLeft = 0;
+
+const char* StringPool::insert(const char* str, size_t length,
+                               unsigned str_hash) {
+  pthread_mutex_lock(&PoolLock);
+  const char* res = NULL;
+  const unsigned mask = Capacity - 1;
+  unsigned index = str_hash & mask;
+  while (true) {
+    // another thread might have inserted it since the lookup
+    const char* entry_str = _entries[index]._str;
+    if (entry_str == NULL) {
+      break;
+    }
+    if (_entries[index]._hash == str_hash && strcmp(entry_str, str) == 0) {
+      res = entry_str;
+      break;
+    }
+    index = (index + 1) & mask;
+  }
+
+  if (res == NULL && _length < GCVIEW_STRING_POOL_MAX_STRS) {
+    if (length + 1 > PoolLeft) {
+      PoolLeft = GCVIEW_ARENA_CHUNK_SIZE;
+      PoolTop = new char[PoolLeft];
+      GCVIEW_ALLOC_GUARANTEE(PoolTop);
+    }
+    char* copy = PoolTop;
+    memcpy(copy, str, length + 1);
+    PoolTop += length + 1;
+    PoolLeft -= length + 1;
+
+    _entries[index]._hash = str_hash;
+    // the string and the hash have to be visible before the entry is
+    __sync_synchronize();
+    _entries[index]._str = copy;
+    _length += 1;
+    res = copy;
+  }
+  pthread_mutex_unlock(&PoolLock);
+  return res;
+}
+
+}
@@ -0,0 +1,190 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_ARENA_HPP
+
+#define _GCVIEW_ARENA_HPP
+
+#include <string.h>
+
+#include "utils.hpp"
+
+// The size of the chunks an Arena allocates (larger allocations get a
+// chunk of their own).
+#define GCVIEW_ARENA_CHUNK_SIZE (4 * 1024)
+
+// The StringPool interns at most this many strings, of at most this
+// many characters; the others are copied as before.
+#define GCVIEW_STRING_POOL_MAX_STRS   4096
+#define GCVIEW_STRING_POOL_MAX_LENGTH  128
+
+namespace gcview {
+
+// A bump allocator for memory that lives as long as its owner, e.g.,
+// the names and the Data objects of a GCview (see Space::addData()).
+// Nothing is freed individually, all chunks are freed when the arena
+// is destroyed; objects allocated in it have to be destroyed
+// explicitly, without delete.
+class Arena {
+private:
+  static const size_t Alignment = sizeof(double) > sizeof(void*) ?
+                                  sizeof(double) : sizeof(void*);
+
+  // Each chunk starts with a pointer to the previous one.
+  char*  _chunks;
+  char*  _top;
+  size_t _left;
+
+  static size_t alignUp(size_t size) {
+    return (size + Alignment - 1) & ~(Alignment - 1);
+  }
+
+  char* allocChunk(size_t size) {
+    const size_t header_size = alignUp(sizeof(char*));
+    char* chunk = new char[header_size + size];
+    GCVIEW_ALLOC_GUARANTEE(chunk);
+    *(char**) chunk = _chunks;
+    _chunks = chunk;
+    return chunk + header_size;
+  }
+
+  // not copyable
+  Arena(const Arena&);
+  Arena& operator=(const Arena&);
+
+public:
+  void* alloc(size_t size) {
+    size = alignUp((size > 0) ? size : 1);
+    if (size > _left) {
+      if (size > GCVIEW_ARENA_CHUNK_SIZE / 4) {
+        // not worth wasting what is left of the current chunk
+        return allocChunk(size);
+      }
+      _top = allocChunk(GCVIEW_ARENA_CHUNK_SIZE);
+      _left = GCVIEW_ARENA_CHUNK_SIZE;
+    }
+    char* res = _top;
+    _top += size;
+    _left -= size;
+    return res;
+  }
+
+  // Same as Utils::cloneStr(), but the copy is in the arena.
+  const char* cloneStr(const char* str) {
+    if (str == NULL || *str == '\0') {
+      return NULL;
+    }
+    const size_t length = strlen(str);
+    char* res = (char*) alloc(length + 1);
+    memcpy(res, str, length + 1);
+    return res;
+  }
+
+  Arena() : _chunks(NULL), _top(NULL), _left(0) { }
+
+  ~Arena() {
+    while (_chunks != NULL) {
+      char* prev = *(char**) _chunks;
+      delete[] _chunks;
+      _chunks = prev;
+    }
+  }
+};
+
+// The process-wide pool of interned strings used by StringElement (see
+// data.hpp). Interning a string returns the same pointer for equal
+// strings, so two interned strings are equal if and only if their
+// pointers are, and they never have to be freed. Callers that set the
+// same labels over and over can intern them once:
+//
+//   static const char* free_label = StringPool::intern("free");
+//   ...
+//   ranges->value(i) = free_label;   // only a pointer compare
+//
+// The pool is bounded, so that arbitrary strings (e.g., formatted
+// numbers) cannot make it grow without limits: intern() returns NULL
+// when the pool is full or the string is too long. The strings are
+// never reclaimed.
+//
+// Lookups do not lock. Insertions are serialized by a lock, and an
+// entry is published only after its string has been written.
+class StringPool {
+private:
+  static const unsigned Capacity = 2 * GCVIEW_STRING_POOL_MAX_STRS;
+
+  typedef struct {
+    const char* volatile _str;
+    unsigned             _hash;
+  } Entry;
+
+  static Entry _entries[Capacity];
+  static unsigned _length;
+
+  // FNV-1a, as NameIndex. Returns false if str is too long.
+  static bool hash(const char* str, unsigned* str_hash, size_t* length) {
+    unsigned res = 2166136261u;
+    const unsigned char* p = (const unsigned char*) str;
+    for (; *p != '\0'; p += 1) {
+      if (p - (const unsigned char*) str == GCVIEW_STRING_POOL_MAX_LENGTH) {
+        return false;
+      }
+      res ^= *p;
+      res *= 16777619u;
+    }
+    *str_hash = res;
+    *length = (size_t) (p - (const unsigned char*) str);
+    return true;
+  }
+
+  // Takes the lock.
+  static const char* insert(const char* str, size_t length, unsigned str_hash);
+
+public:
+  // Returns the interned copy of str, or NULL if it cannot be interned.
+  // The empty string is interned as "".
+  static const char* intern(const char* str) {
+    str = Utils::getStrOrEmptyStr(str);
+    unsigned str_hash;
+    size_t length;
+    if (!hash(str, &str_hash, &length)) {
+      return NULL;
+    }
+    const unsigned mask = Capacity - 1;
+    for (unsigned index = str_hash & mask; ; index = (index + 1) & mask) {
+      const char* entry_str = _entries[index]._str;
+      if (entry_str == NULL) {
+        return insert(str, length, str_hash);
+      }
+      if (_entries[index]._hash == str_hash && strcmp(entry_str, str) == 0) {
+        return entry_str;
+      }
+    }
+  }
+
+  static unsigned getLength() { return _length; }
+};
+
+}
+
+// new (arena) T(...) allocates the object in the arena. It does not
+// need <new>, which does not get along with the MM summary operators
+// (see mm.hpp).
+inline void* operator new(size_t size, gcview::Arena* arena) {
+  return arena->alloc(size);
+}
+
+// only called if a constructor throws
+inline void operator delete(void*, gcview::Arena*) { }
+
+#endif // _GCVIEW_ARENA_HPP
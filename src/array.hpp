@@ -18,7 +18,9 @@
 
 #include "utils.hpp"
 
-#define GCVIEW_ARRAY_MAX_LENGTH 64
+// Number of elements that are stored inline, before an Array
+// allocates storage.
+#define GCVIEW_ARRAY_INLINE_LENGTH 16
 
 #define GCVIEW_ARRAY_ITERATE(__array__, __type__, __elem__, __cmd__) \
 do { \
@@ -36,30 +38,80 @@ do { \
 
 namespace gcview {
 
-template <typename T, unsigned MaxLength = GCVIEW_ARRAY_MAX_LENGTH>
+// A growable array. The first InlineLength elements are stored in the
+// array object itself, so small arrays do not allocate; larger ones
+// move to a heap block that doubles in size. Either way the elements
+// are contiguous. Adding elements can move them, so references
+// returned by operator[] should not be held across add().
+template <typename T, unsigned InlineLength = GCVIEW_ARRAY_INLINE_LENGTH>
 class Array {
 private:
+  T*       _elems;
   unsigned _length;
-  T        _array[MaxLength];
+  unsigned _capacity;
+  T        _inline_elems[InlineLength];
+
+  bool isInline() const { return _elems == _inline_elems; }
+
+  void grow() {
+    const unsigned new_capacity = 2 * _capacity;
+    GCVIEW_GUARANTEE(new_capacity > _capacity, "array too long");
+    T* new_elems = new T[new_capacity];
+    GCVIEW_ALLOC_GUARANTEE(new_elems);
+    for (unsigned i = 0; i < _length; i += 1) {
+      new_elems[i] = _elems[i];
+    }
+    if (!isInline()) {
+      delete[] _elems;
+    }
+    _elems = new_elems;
+    _capacity = new_capacity;
+  }
+
+  // not copyable
+  Array(const Array&);
+  Array& operator=(const Array&);
 
 public:
   unsigned getLength() const { return _length; }
+  unsigned getCapacity() const { return _capacity; }
 
   unsigned add(T elem) {
-    GCVIEW_ASSERT(_length <= MaxLength);
-    GCVIEW_GUARANTEE(_length < MaxLength, "array full");
+    GCVIEW_ASSERT(_length <= _capacity);
+    if (_length == _capacity) {
+      grow();
+    }
     unsigned index = _length;
-    _array[index] = elem;
+    _elems[index] = elem;
     _length += 1;
     return index;
   }
 
+  void removeLast() {
+    GCVIEW_ASSERT(_length > 0);
+    _length -= 1;
+  }
+
+  void clear() { _length = 0; }
+
   T& operator[](unsigned index) {
     GCVIEW_ASSERT(index < _length);
-    return _array[index];
+    return _elems[index];
+  }
+
+  const T& operator[](unsigned index) const {
+    GCVIEW_ASSERT(index < _length);
+    return _elems[index];
   }
 
-  Array() : _length(0) { }
+  Array()
+      : _elems(_inline_elems), _length(0), _capacity(InlineLength) { }
+
+  ~Array() {
+    if (!isInline()) {
+      delete[] _elems;
+    }
+  }
 };
 
 }
@@ -0,0 +1,239 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "async.hpp"
+#include "gcview.hpp"
+#include "json.hpp"
+#include "utils.hpp"
+
+namespace gcview {
+
+void* AsyncWriter::threadEntry(void* arg) {
+  ((AsyncWriter*) arg)->threadLoop();
+  return NULL;
+}
+
+void AsyncWriter::threadLoop() {
+  pthread_mutex_lock(&_lock);
+  while (true) {
+    if (_queued_num == 0) {
+      if (_writing) {
+        // the queue has been drained, write out what has been
+        // converted so far
+        pthread_mutex_unlock(&_lock);
+        const double start_sec = Utils::getNowSec();
+        _writer->flush();
+        const double sec = Utils::getNowSec() - start_sec;
+        pthread_mutex_lock(&_lock);
+
+        _writer_time_sec += sec;
+        _writing = false;
+        pthread_cond_broadcast(&_idle);
+        continue;
+      }
+      if (_stopping) break;
+      pthread_cond_wait(&_not_empty, &_lock);
+      continue;
+    }
+
+    _pending.swap(&_slots[_head]._buffer);
+    _head = (_head + 1) % _slot_num;
+    _queued_num -= 1;
+    _writing = true;
+    pthread_cond_signal(&_not_full);
+    pthread_mutex_unlock(&_lock);
+
+    const double start_sec = Utils::getNowSec();
+    _array_writer->startElem();
+    const size_t length =
+      _converter.convertRecord(_writer, _pending.getData(),
+                               _pending.getLength());
+    GCVIEW_GUARANTEE(length == _pending.getLength(), "malformed snapshot");
+    const double sec = Utils::getNowSec() - start_sec;
+    pthread_mutex_lock(&_lock);
+
+    _writer_time_sec += sec;
+    _written_num += 1;
+  }
+  pthread_mutex_unlock(&_lock);
+}
+
+void AsyncWriter::waitForRoom() {
+  while (_queued_num == _slot_num) {
+    pthread_cond_wait(&_not_full, &_lock);
+  }
+}
+
+unsigned AsyncWriter::getTail() const {
+  return (_head + _queued_num) % _slot_num;
+}
+
+void AsyncWriter::enqueue(bool is_metadata) {
+  GCVIEW_ASSERT(_queued_num < _slot_num);
+  Slot* slot = &_slots[getTail()];
+  // the slot gets the snapshot, the snapshot buffer gets the (already
+  // grown) buffer that was last written out from the slot
+  slot->_buffer.swap(&_snapshot);
+  slot->_is_metadata = is_metadata;
+  _queued_num += 1;
+  pthread_cond_signal(&_not_empty);
+}
+
+void AsyncWriter::writeMetadata(GCview* gcview) {
+  pthread_mutex_lock(&_lock);
+  waitForRoom();
+  pthread_mutex_unlock(&_lock);
+
+  _snapshot.clear();
+  gcview->writeTraceMetadata(&_trace_writer);
+  _next_is_keyframe = false;
+
+  pthread_mutex_lock(&_lock);
+  enqueue(true /* is_metadata */);
+  pthread_mutex_unlock(&_lock);
+}
+
+void AsyncWriter::writeData(GCview* gcview) {
+  const double start_sec = Utils::getNowSec();
+
+  pthread_mutex_lock(&_lock);
+  _snapshot_num += 1;
+  if (_queued_num == _slot_num) {
+    switch (_policy) {
+    case Block:
+      waitForRoom();
+      break;
+    case DropNewest:
+      // the writer thread only takes slots from the head, so the
+      // newest one is still queued until the lock is released
+      if (_slots[(getTail() + _slot_num - 1) % _slot_num]._is_metadata) {
+        waitForRoom();
+      } else {
+        _queued_num -= 1;
+        _dropped_num += 1;
+        _next_is_keyframe = true;
+      }
+      break;
+    case Coalesce:
+      _coalesced_num += 1;
+      _has_coalesced_data = true;
+      pthread_mutex_unlock(&_lock);
+      return;
+    default:
+      GCVIEW_UNREACHABLE_BREAK("unknown policy");
+    }
+  }
+  pthread_mutex_unlock(&_lock);
+
+  takeDataSnapshot(gcview, start_sec);
+}
+
+void AsyncWriter::takeDataSnapshot(GCview* gcview, double start_sec) {
+  // Only the producer adds to the queue, so there is still room after
+  // the lock is released. The writer thread keeps going while the
+  // snapshot is being taken.
+  _snapshot.clear();
+  gcview->writeTraceData(&_trace_writer, _next_is_keyframe);
+  _next_is_keyframe = false;
+  _has_coalesced_data = false;
+
+  pthread_mutex_lock(&_lock);
+  enqueue(false /* is_metadata */);
+  const double sec = Utils::getNowSec() - start_sec;
+  _snapshot_time_sec += sec;
+  pthread_mutex_unlock(&_lock);
+
+  // with a clock, the GCview charges the snapshot time itself
+  if (_charge_snapshot_time && gcview->getClock() == NULL) {
+    gcview->addDataCollectionTime(sec);
+  }
+}
+
+void AsyncWriter::flush(GCview* gcview) {
+  if (gcview != NULL && _has_coalesced_data) {
+    const double start_sec = Utils::getNowSec();
+    pthread_mutex_lock(&_lock);
+    waitForRoom();
+    // it is written out after all
+    _coalesced_num -= 1;
+    pthread_mutex_unlock(&_lock);
+    takeDataSnapshot(gcview, start_sec);
+  }
+
+  pthread_mutex_lock(&_lock);
+  while (_queued_num > 0 || _writing) {
+    pthread_cond_wait(&_idle, &_lock);
+  }
+  pthread_mutex_unlock(&_lock);
+}
+
+#define ASYNC_WRITER_LOCKED_GETTER(__type__, __name__, __field__) \
+__type__ AsyncWriter::__name__() {                                \
+  pthread_mutex_lock(&_lock);                                      \
+  const __type__ res = __field__;                                  \
+  pthread_mutex_unlock(&_lock);                                    \
+  return res;                                                      \
+}
+
+ASYNC_WRITER_LOCKED_GETTER(unsigned long long, getSnapshotNum, _snapshot_num)
+ASYNC_WRITER_LOCKED_GETTER(unsigned long long, getWrittenNum, _written_num)
+ASYNC_WRITER_LOCKED_GETTER(unsigned long long, getDroppedNum, _dropped_num)
+ASYNC_WRITER_LOCKED_GETTER(unsigned long long, getCoalescedNum, _coalesced_num)
+ASYNC_WRITER_LOCKED_GETTER(double, getSnapshotTimeSec, _snapshot_time_sec)
+ASYNC_WRITER_LOCKED_GETTER(double, getWriterTimeSec, _writer_time_sec)
+
+#undef ASYNC_WRITER_LOCKED_GETTER
+
+AsyncWriter::AsyncWriter(JSONWriter* writer, JSONArrayWriter* array_writer,
+                         Policy policy, unsigned queue_length,
+                         bool charge_snapshot_time)
+    : _writer(writer), _array_writer(array_writer), _policy(policy),
+      _charge_snapshot_time(charge_snapshot_time),
+      _trace_writer(&_snapshot), _next_is_keyframe(false),
+      _has_coalesced_data(false),
+      _slots(NULL), _slot_num(queue_length), _head(0), _queued_num(0),
+      _writing(false), _stopping(false),
+      _snapshot_num(0), _written_num(0), _dropped_num(0), _coalesced_num(0),
+      _snapshot_time_sec(0.0), _writer_time_sec(0.0) {
+  GCVIEW_ASSERT(writer != NULL);
+  GCVIEW_ASSERT(array_writer != NULL);
+  GCVIEW_GUARANTEE(queue_length > 0, "the queue length should be positive");
+
+  _slots = new Slot[_slot_num];
+  GCVIEW_ALLOC_GUARANTEE(_slots);
+
+  GCVIEW_GUARANTEE(pthread_mutex_init(&_lock, NULL) == 0 &&
+                   pthread_cond_init(&_not_empty, NULL) == 0 &&
+                   pthread_cond_init(&_not_full, NULL) == 0 &&
+                   pthread_cond_init(&_idle, NULL) == 0,
+                   "could not initialize the writer thread synchronization");
+  GCVIEW_GUARANTEE(pthread_create(&_thread, NULL, threadEntry, this) == 0,
+                   "could not start the writer thread");
+}
+
+AsyncWriter::~AsyncWriter() {
+  pthread_mutex_lock(&_lock);
+  _stopping = true;
+  pthread_cond_signal(&_not_empty);
+  pthread_mutex_unlock(&_lock);
+  pthread_join(_thread, NULL);
+
+  pthread_cond_destroy(&_idle);
+  pthread_cond_destroy(&_not_full);
+  pthread_cond_destroy(&_not_empty);
+  pthread_mutex_destroy(&_lock);
+  delete[] _slots;
+}
+
+}
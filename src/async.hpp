@@ -0,0 +1,151 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_ASYNC_HPP
+
+#define _GCVIEW_ASYNC_HPP
+
+#include <pthread.h>
+
+#include "buffer.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+#define GCVIEW_ASYNC_WRITER_QUEUE_LENGTH 16
+
+namespace gcview {
+
+class GCview;
+class JSONArrayWriter;
+class JSONWriter;
+
+// Takes the GCview snapshots on the calling thread as binary trace
+// records in memory (no formatting, no I/O) and hands them over to a
+// writer thread, which converts them to JSON and writes them out.
+//
+// The snapshots go through a bounded single-producer / single-consumer
+// queue. When it is full, the policy decides what happens to a new
+// data snapshot:
+//
+//   Block      : wait for the writer thread to make room.
+//   DropNewest : discard the newest queued data snapshot and take the
+//                new one as a keyframe in its place. The snapshots
+//                still queued are deltas against the ones before
+//                them, which are all written out; dropping the oldest
+//                one instead would leave the next one a delta (and
+//                its patches) against values readers never got.
+//   Coalesce   : do not take the snapshot; the changes are carried
+//                over to the next one, since the previous values are
+//                only updated when a snapshot is taken.
+//
+// Metadata is never dropped or coalesced.
+class AsyncWriter {
+public:
+  typedef enum {
+    Block,
+    DropNewest,
+    Coalesce
+  } Policy;
+
+private:
+  typedef struct {
+    ByteBuffer _buffer;
+    bool       _is_metadata;
+  } Slot;
+
+  JSONWriter* const      _writer;
+  JSONArrayWriter* const _array_writer;
+  const Policy           _policy;
+  const bool             _charge_snapshot_time;
+
+  // only accessed by the producer
+  ByteBuffer  _snapshot;
+  TraceWriter _trace_writer;
+  bool        _next_is_keyframe;
+  bool        _has_coalesced_data;
+
+  // only accessed by the writer thread
+  TraceConverter _converter;
+  ByteBuffer     _pending;
+
+  // protected by _lock
+  pthread_mutex_t _lock;
+  pthread_cond_t  _not_empty;
+  pthread_cond_t  _not_full;
+  pthread_cond_t  _idle;
+  Slot*    _slots;
+  unsigned _slot_num;
+  unsigned _head;
+  unsigned _queued_num;
+  bool     _writing;
+  bool     _stopping;
+
+  unsigned long long _snapshot_num;
+  unsigned long long _written_num;
+  unsigned long long _dropped_num;
+  unsigned long long _coalesced_num;
+  double             _snapshot_time_sec;
+  double             _writer_time_sec;
+
+  pthread_t _thread;
+
+  static void* threadEntry(void* arg);
+  void threadLoop();
+
+  // All are called with _lock held.
+  void waitForRoom();
+  unsigned getTail() const;
+  void enqueue(bool is_metadata);
+
+  void takeDataSnapshot(GCview* gcview, double start_sec);
+
+public:
+  Policy getPolicy() const { return _policy; }
+
+  void writeMetadata(GCview* gcview);
+  void writeData(GCview* gcview);
+
+  // Waits until all queued snapshots have been written out. If gcview
+  // is not NULL and the last data snapshot was coalesced, it is taken
+  // first, so that the trace ends with the latest values.
+  void flush(GCview* gcview = NULL);
+
+  // Statistics: snapshots requested through writeData, records the
+  // writer thread wrote out (metadata included), data snapshots
+  // discarded by DropNewest or skipped by Coalesce, time spent taking
+  // snapshots on the calling thread and time the writer thread spent
+  // converting and writing.
+  unsigned long long getSnapshotNum();
+  unsigned long long getWrittenNum();
+  unsigned long long getDroppedNum();
+  unsigned long long getCoalescedNum();
+  double getSnapshotTimeSec();
+  double getWriterTimeSec();
+
+  // writer and array_writer are owned by the writer thread until the
+  // AsyncWriter is destroyed. If charge_snapshot_time is true, the
+  // time spent taking a snapshot is added to the data collection time
+  // of the next event (see GCview::addDataCollectionTime()), unless the
+  // GCview has a clock and does that itself; it should be false when
+  // the GCview timestamps are not real time.
+  AsyncWriter(JSONWriter* writer, JSONArrayWriter* array_writer,
+              Policy policy = Block,
+              unsigned queue_length = GCVIEW_ASYNC_WRITER_QUEUE_LENGTH,
+              bool charge_snapshot_time = true);
+  ~AsyncWriter();
+};
+
+}
+
+#endif // _GCVIEW_ASYNC_HPP
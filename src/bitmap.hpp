@@ -0,0 +1,222 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_BITMAP_HPP
+
+#define _GCVIEW_BITMAP_HPP
+
+#include <string.h>
+
+#include "utils.hpp"
+
+namespace gcview {
+
+// A bitmap that keeps track of the range of words that might have
+// bits set, so that scanning and clearing a sparsely populated bitmap
+// only touches that range.
+class Bitmap {
+private:
+  static const unsigned BitsPerWord = 32;
+
+  uint32_t* _words;
+  unsigned  _length;
+  unsigned  _word_num;
+  // [_min_word, _max_word] covers all words with set bits, the bitmap
+  // is empty when _min_word > _max_word
+  unsigned  _min_word;
+  unsigned  _max_word;
+
+  static unsigned getWordNum(unsigned length) {
+    return (length + BitsPerWord - 1) / BitsPerWord;
+  }
+
+  static unsigned countTrailingZeros(uint32_t word) {
+    GCVIEW_ASSERT(word != 0);
+#if defined(__GNUC__)
+    return (unsigned) __builtin_ctz(word);
+#else
+    unsigned res = 0;
+    while ((word & 1) == 0) {
+      word >>= 1;
+      res += 1;
+    }
+    return res;
+#endif
+  }
+
+public:
+  unsigned getLength() const { return _length; }
+
+  bool isEmpty() const { return _min_word > _max_word; }
+
+  bool isSet(unsigned index) const {
+    GCVIEW_ASSERT(index < _length);
+    return (_words[index / BitsPerWord] &
+            ((uint32_t) 1 << (index % BitsPerWord))) != 0;
+  }
+
+  void set(unsigned index) {
+    GCVIEW_ASSERT(index < _length);
+    const unsigned word_index = index / BitsPerWord;
+    _words[word_index] |= (uint32_t) 1 << (index % BitsPerWord);
+    if (isEmpty()) {
+      _min_word = word_index;
+      _max_word = word_index;
+    } else if (word_index < _min_word) {
+      _min_word = word_index;
+    } else if (word_index > _max_word) {
+      _max_word = word_index;
+    }
+  }
+
+  // A word at a time, since ranges can be long (e.g., see TileArray).
+  void setRange(unsigned from, unsigned to) {
+    GCVIEW_ASSERT(from <= to && to <= _length);
+    if (from == to) return;
+    const unsigned first_word = from / BitsPerWord;
+    const unsigned last_word = (to - 1) / BitsPerWord;
+    for (unsigned i = first_word; i <= last_word; i += 1) {
+      uint32_t mask = ~(uint32_t) 0;
+      if (i == first_word) {
+        mask &= (uint32_t) ~0 << (from % BitsPerWord);
+      }
+      if (i == last_word && (to % BitsPerWord) != 0) {
+        mask &= ((uint32_t) 1 << (to % BitsPerWord)) - 1;
+      }
+      _words[i] |= mask;
+    }
+    if (isEmpty()) {
+      _min_word = first_word;
+      _max_word = last_word;
+    } else {
+      if (first_word < _min_word) {
+        _min_word = first_word;
+      }
+      if (last_word > _max_word) {
+        _max_word = last_word;
+      }
+    }
+  }
+
+  void clear() {
+    if (!isEmpty()) {
+      memset(_words + _min_word, 0,
+             (_max_word - _min_word + 1) * sizeof(uint32_t));
+    }
+    _min_word = 1;
+    _max_word = 0;
+  }
+
+  // Returns the index of the first set bit at or after from, or the
+  // length of the bitmap if there is none.
+  unsigned findNext(unsigned from) const {
+    if (isEmpty() || from >= _length) {
+      return _length;
+    }
+    unsigned word_index = from / BitsPerWord;
+    if (word_index < _min_word) {
+      word_index = _min_word;
+      from = word_index * BitsPerWord;
+    }
+    if (word_index > _max_word) {
+      return _length;
+    }
+    uint32_t word = _words[word_index] &
+                    ((uint32_t) ~0 << (from % BitsPerWord));
+    while (word == 0) {
+      word_index += 1;
+      if (word_index > _max_word) {
+        return _length;
+      }
+      word = _words[word_index];
+    }
+    return word_index * BitsPerWord + countTrailingZeros(word);
+  }
+
+  // Returns the index of the first clear bit at or after from, or the
+  // length of the bitmap if there is none.
+  unsigned findNextClear(unsigned from) const {
+    if (from >= _length) {
+      return _length;
+    }
+    unsigned word_index = from / BitsPerWord;
+    if (isEmpty() || word_index < _min_word || word_index > _max_word) {
+      return from;
+    }
+    uint32_t word = ~_words[word_index] &
+                    ((uint32_t) ~0 << (from % BitsPerWord));
+    while (word == 0) {
+      word_index += 1;
+      if (word_index > _max_word) {
+        // the words past _max_word are clear
+        return (word_index * BitsPerWord < _length) ? word_index * BitsPerWord
+                                                    : _length;
+      }
+      word = ~_words[word_index];
+    }
+    // the bits past the length are clear
+    const unsigned res = word_index * BitsPerWord + countTrailingZeros(word);
+    return (res < _length) ? res : _length;
+  }
+
+  // Bits of indexes that are below both the old and the new length
+  // are preserved, all other bits are clear.
+  void resize(unsigned new_length) {
+    const unsigned new_word_num = getWordNum(new_length);
+    if (new_word_num != _word_num) {
+      uint32_t* new_words = NULL;
+      if (new_word_num > 0) {
+        new_words = new uint32_t[new_word_num];
+        GCVIEW_ALLOC_GUARANTEE(new_words);
+        memset(new_words, 0, new_word_num * sizeof(uint32_t));
+        const unsigned copy_num =
+          (new_word_num < _word_num) ? new_word_num : _word_num;
+        if (copy_num > 0) {
+          memcpy(new_words, _words, copy_num * sizeof(uint32_t));
+        }
+      }
+      if (_words != NULL) {
+        delete[] _words;
+      }
+      _words = new_words;
+      _word_num = new_word_num;
+    }
+    _length = new_length;
+    if (new_word_num > 0 && (new_length % BitsPerWord) != 0) {
+      // clear the bits past the end of the last word
+      _words[new_word_num - 1] &=
+        ((uint32_t) 1 << (new_length % BitsPerWord)) - 1;
+    }
+    if (!isEmpty() && _max_word >= _word_num) {
+      if (_min_word >= _word_num) {
+        _min_word = 1;
+        _max_word = 0;
+      } else {
+        _max_word = _word_num - 1;
+      }
+    }
+  }
+
+  Bitmap()
+      : _words(NULL), _length(0), _word_num(0), _min_word(1), _max_word(0) { }
+  ~Bitmap() {
+    if (_words != NULL) {
+      delete[] _words;
+    }
+  }
+};
+
+}
+
+#endif // _GCVIEW_BITMAP_HPP
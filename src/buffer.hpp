@@ -0,0 +1,112 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_BUFFER_HPP
+
+#define _GCVIEW_BUFFER_HPP
+
+#include <string.h>
+
+#include "utils.hpp"
+
+namespace gcview {
+
+// A growable, contiguous byte buffer. It never shrinks, so once it
+// has reached its steady-state size appending to it does not allocate.
+class ByteBuffer {
+private:
+  unsigned char* _data;
+  size_t         _capacity;
+  size_t         _length;
+
+  void grow(size_t min_capacity) {
+    size_t new_capacity = (_capacity > 0) ? 2 * _capacity : 256;
+    while (new_capacity < min_capacity) {
+      new_capacity *= 2;
+    }
+    unsigned char* new_data = new unsigned char[new_capacity];
+    GCVIEW_ALLOC_GUARANTEE(new_data);
+    if (_length > 0) {
+      memcpy(new_data, _data, _length);
+    }
+    if (_data != NULL) {
+      delete[] _data;
+    }
+    _data = new_data;
+    _capacity = new_capacity;
+  }
+
+public:
+  const unsigned char* getData() const { return _data; }
+  size_t getLength() const { return _length; }
+  size_t getCapacity() const { return _capacity; }
+
+  void clear() { _length = 0; }
+
+  // Exchanges the contents of the two buffers without copying them.
+  void swap(ByteBuffer* other) {
+    unsigned char* data = _data;
+    size_t capacity = _capacity;
+    size_t length = _length;
+    _data = other->_data;
+    _capacity = other->_capacity;
+    _length = other->_length;
+    other->_data = data;
+    other->_capacity = capacity;
+    other->_length = length;
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity > _capacity) {
+      grow(capacity);
+    }
+  }
+
+  void append(const void* data, size_t length) {
+    if (length > _capacity - _length) {
+      grow(_length + length);
+    }
+    memcpy(_data + _length, data, length);
+    _length += length;
+  }
+
+  // Appends length uninitialized bytes and returns a pointer to them.
+  unsigned char* extend(size_t length) {
+    if (length > _capacity - _length) {
+      grow(_length + length);
+    }
+    unsigned char* res = _data + _length;
+    _length += length;
+    return res;
+  }
+
+  void appendByte(unsigned char b) {
+    if (_length == _capacity) {
+      grow(_length + 1);
+    }
+    _data[_length] = b;
+    _length += 1;
+  }
+
+  ByteBuffer() : _data(NULL), _capacity(0), _length(0) { }
+  ~ByteBuffer() {
+    if (_data != NULL) {
+      delete[] _data;
+    }
+  }
+};
+
+}
+
+#endif // _GCVIEW_BUFFER_HPP
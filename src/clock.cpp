@@ -0,0 +1,119 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "clock.hpp"
+
+#if GCVIEW_ENABLE_TSC_CLOCK
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif // GCVIEW_ENABLE_TSC_CLOCK
+
+namespace gcview {
+
+const char* Clock::getSourceStr(Source source) {
+  switch (source) {
+  case TSCSource          : return "TSC";
+  case MonotonicRawSource : return "CLOCK_MONOTONIC_RAW";
+  case MonotonicSource    : return "CLOCK_MONOTONIC";
+  default: GCVIEW_UNREACHABLE_NULL("unknown clock source");
+  }
+}
+
+Clock* Clock::create(Source source) {
+  Clock* clock = NULL;
+  if (source == TSCSource && TSCClock::isAvailable()) {
+    clock = new TSCClock();
+  } else if (source != MonotonicSource &&
+             PosixClock::isAvailable(MonotonicRawSource)) {
+    clock = new PosixClock(MonotonicRawSource);
+  } else {
+    clock = new PosixClock(MonotonicSource);
+  }
+  GCVIEW_ALLOC_GUARANTEE(clock);
+  return clock;
+}
+
+////////// PosixClock //////////
+
+bool PosixClock::isAvailable(Source source) {
+  switch (source) {
+  case MonotonicRawSource:
+#if defined(CLOCK_MONOTONIC_RAW)
+    {
+      struct timespec ts;
+      return clock_gettime(CLOCK_MONOTONIC_RAW, &ts) == 0;
+    }
+#else // defined(CLOCK_MONOTONIC_RAW)
+    return false;
+#endif // defined(CLOCK_MONOTONIC_RAW)
+  case MonotonicSource:
+    return true;
+  default:
+    return false;
+  }
+}
+
+PosixClock::PosixClock(Source source)
+    : _source(source), _clock_id(CLOCK_MONOTONIC) {
+  GCVIEW_GUARANTEE(isAvailable(source), "clock source not available");
+#if defined(CLOCK_MONOTONIC_RAW)
+  if (source == MonotonicRawSource) {
+    _clock_id = CLOCK_MONOTONIC_RAW;
+  }
+#endif // defined(CLOCK_MONOTONIC_RAW)
+}
+
+////////// TSCClock //////////
+
+unsigned long long TSCClock::readTicks() {
+#if GCVIEW_ENABLE_TSC_CLOCK
+  return (unsigned long long) __rdtsc();
+#else // GCVIEW_ENABLE_TSC_CLOCK
+  GCVIEW_UNREACHABLE_0("built without TSCClock");
+#endif // GCVIEW_ENABLE_TSC_CLOCK
+}
+
+bool TSCClock::isAvailable() {
+#if GCVIEW_ENABLE_TSC_CLOCK
+  // CPUID leaf 0x80000007, EDX bit 8: invariant TSC
+  unsigned eax, ebx, ecx, edx;
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+      eax < 0x80000007) {
+    return false;
+  }
+  __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+  return (edx & (1u << 8)) != 0 &&
+    PosixClock::isAvailable(MonotonicRawSource);
+#else // GCVIEW_ENABLE_TSC_CLOCK
+  return false;
+#endif // GCVIEW_ENABLE_TSC_CLOCK
+}
+
+TSCClock::TSCClock(unsigned long long calibration_ns)
+    : _base_ticks(0), _base_ns(0), _ns_per_tick(1.0) {
+  GCVIEW_GUARANTEE(isAvailable(), "no invariant TSC");
+  PosixClock raw_clock(MonotonicRawSource);
+  _base_ns = raw_clock.getNowNs();
+  _base_ticks = readTicks();
+  unsigned long long now_ns;
+  do {
+    now_ns = raw_clock.getNowNs();
+  } while (now_ns - _base_ns < calibration_ns);
+  const unsigned long long ticks = readTicks();
+  GCVIEW_GUARANTEE(ticks > _base_ticks, "the TSC does not tick");
+  _ns_per_tick = (double) (now_ns - _base_ns) /
+    (double) (ticks - _base_ticks);
+}
+
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_CLOCK_HPP
+
+#define _GCVIEW_CLOCK_HPP
+
+#include <time.h>
+
+// Set to 0 to build without TSCClock (Clock::create() then falls back
+// to CLOCK_MONOTONIC_RAW).
+#ifndef GCVIEW_ENABLE_TSC_CLOCK
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GCVIEW_ENABLE_TSC_CLOCK 1
+#else
+#define GCVIEW_ENABLE_TSC_CLOCK 0
+#endif
+#endif // GCVIEW_ENABLE_TSC_CLOCK
+
+#include "utils.hpp"
+
+// How long TSCClock compares the TSC with CLOCK_MONOTONIC_RAW to find
+// its frequency.
+#define GCVIEW_TSC_CLOCK_CALIBRATION_NS (10 * 1000 * 1000)
+
+namespace gcview {
+
+// Where a GCview reads the time when eventStart() / eventEnd() are not
+// given one (see GCview::setClock()), in integer nanoseconds from an
+// arbitrary starting point. A clock never goes backwards.
+class Clock {
+public:
+  typedef enum {
+    // the time stamp counter of x86 CPUs, calibrated against
+    // CLOCK_MONOTONIC_RAW: the cheapest to read
+    TSCSource,
+    // not adjusted by NTP
+    MonotonicRawSource,
+    MonotonicSource,
+    SourceNum
+  } Source;
+
+  static const char* getSourceStr(Source source);
+
+  virtual unsigned long long getNowNs() const = 0;
+  virtual Source getSource() const = 0;
+
+  // A clock of the given source, or of the next one in the list above
+  // if it is not available (e.g., TSCSource without an invariant TSC).
+  // The caller owns it.
+  static Clock* create(Source source);
+
+  virtual ~Clock() { }
+};
+
+// clock_gettime() with CLOCK_MONOTONIC_RAW or CLOCK_MONOTONIC.
+class PosixClock : public Clock {
+private:
+  const Source _source;
+  clockid_t _clock_id;
+
+public:
+  static bool isAvailable(Source source);
+
+  virtual unsigned long long getNowNs() const {
+    struct timespec ts;
+    clock_gettime(_clock_id, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL +
+      (unsigned long long) ts.tv_nsec;
+  }
+
+  virtual Source getSource() const { return _source; }
+
+  PosixClock(Source source);
+};
+
+// rdtsc, scaled to ns by the ratio of TSC ticks to CLOCK_MONOTONIC_RAW
+// ns over a calibration interval (the constructor spins for it). It
+// needs an invariant TSC, i.e., one that ticks at the same rate on all
+// cores and in all power states.
+class TSCClock : public Clock {
+private:
+  unsigned long long _base_ticks;
+  unsigned long long _base_ns;
+  double _ns_per_tick;
+
+  static unsigned long long readTicks();
+
+public:
+  static bool isAvailable();
+
+  virtual unsigned long long getNowNs() const {
+    const unsigned long long ticks = readTicks();
+    if (ticks <= _base_ticks) {
+      return _base_ns;
+    }
+    return _base_ns +
+      (unsigned long long) ((double) (ticks - _base_ticks) * _ns_per_tick);
+  }
+
+  virtual Source getSource() const { return TSCSource; }
+
+  // The TSC frequency, in ticks per second.
+  double getFrequency() const { return 1.0e9 / _ns_per_tick; }
+
+  TSCClock(unsigned long long calibration_ns =
+                                     GCVIEW_TSC_CLOCK_CALIBRATION_NS);
+};
+
+}
+
+#endif // _GCVIEW_CLOCK_HPP
@@ -19,9 +19,31 @@ namespace gcview {
 #define ITERATE_ENUM_MEMBERS(__cmd__) \
   GCVIEW_ARRAY_ITERATE(_enum_members, const char*, the_enum_member, __cmd__)
 
+#define ITERATE_LABELS(__cmd__) \
+  GCVIEW_ARRAY_ITERATE(_labels, const char*, the_label, __cmd__)
+
 unsigned Data::addEnumMember(const char* enum_member) {
   GCVIEW_ASSERT(_enum_members != NULL);
-  return _enum_members->add(Utils::cloneStr(enum_member));
+  return _enum_members->add(cloneStr(enum_member));
+}
+
+unsigned Data::addLabel(const char* label) {
+  GCVIEW_ASSERT(_is_array);
+  if (_labels == NULL) {
+    _labels = new Array<const char*>();
+    GCVIEW_ALLOC_GUARANTEE(_labels);
+  }
+  return _labels->add(cloneStr(label));
+}
+
+void Data::clearLabels() {
+  if (_labels != NULL) {
+    if (_arena == NULL) {
+      ITERATE_LABELS({ delete[] the_label; });
+    }
+    delete _labels;
+    _labels = NULL;
+  }
 }
 
 void Data::writeJSONMetadata(JSONWriter* writer) const {
@@ -34,6 +56,9 @@ void Data::writeJSONMetadata(JSONWriter* writer) const {
     if (_group_name != NULL) {
       x.writePair("Group", _group_name);
     }
+    if (_encoding != PlainEncoding) {
+      x.writePair("Encoding", getEncodingStr(_encoding));
+    }
     if (_enum_members != NULL) {
       x.startPair("Members");
       {
@@ -41,17 +66,50 @@ void Data::writeJSONMetadata(JSONWriter* writer) const {
         ITERATE_ENUM_MEMBERS({ y.writeElem(the_enum_member); });
       }
     }
+    if (_labels != NULL) {
+      x.startPair("Labels");
+      {
+        JSONArrayWriter y(writer);
+        ITERATE_LABELS({ y.writeElem(the_label); });
+      }
+    }
     x.startPair("Value");
     writeJSONDataSpecial(writer);
   }
 }
 
+void Data::writeTraceMetadata(TraceWriter* writer) const {
+  writer->writeVarint(_id);
+  writer->write(_name);
+  writer->write((unsigned char) _data_type);
+  writer->write(_is_array);
+  writer->write(_group_name);
+  writer->write((unsigned char) _encoding);
+  if (_enum_members != NULL) {
+    writer->writeLength(_enum_members->getLength());
+    ITERATE_ENUM_MEMBERS({ writer->write(the_enum_member); });
+  }
+  writer->writeLength(getLabelNum());
+  if (_labels != NULL) {
+    ITERATE_LABELS({ writer->write(the_label); });
+  }
+  writeTraceDataSpecial(writer);
+}
+
+const char* Data::cloneStr(const char* str) const {
+  return (_arena != NULL) ? _arena->cloneStr(str) : Utils::cloneStr(str);
+}
+
 Data::Data(const char* name, DataType data_type,
-           bool is_array, const char* group_name)
-    : _name(Utils::cloneStr(name)),
+           bool is_array, const char* group_name, Arena* arena)
+    : _name((arena != NULL) ? arena->cloneStr(name) : Utils::cloneStr(name)),
       _data_type(data_type), _is_array(is_array),
-      _group_name(Utils::cloneStr(group_name)),
+      _group_name((arena != NULL) ? arena->cloneStr(group_name)
+                                  : Utils::cloneStr(group_name)),
       _enum_members((data_type == EnumType) ? new Array<const char*>() : NULL),
+      _labels(NULL),
+      _encoding(PlainEncoding), _arena(arena), _is_in_arena(false),
+      _is_concurrent(false), _is_windowed(false),
       _modified(false) {
   if (data_type == EnumType) {
     GCVIEW_ALLOC_GUARANTEE(_enum_members);
@@ -61,14 +119,19 @@ Data::Data(const char* name, DataType data_type,
 }
 
 Data::~Data() {
-  delete[] _name;
-  if (_group_name != NULL) {
-    delete[] _group_name;
+  if (_arena == NULL) {
+    delete[] _name;
+    if (_group_name != NULL) {
+      delete[] _group_name;
+    }
   }
   if (_enum_members != NULL) {
-    ITERATE_ENUM_MEMBERS({ delete[] the_enum_member; });
+    if (_arena == NULL) {
+      ITERATE_ENUM_MEMBERS({ delete[] the_enum_member; });
+    }
     delete _enum_members;
   }
+  clearLabels();
 }
 
 }
@@ -16,8 +16,15 @@
 
 #define _GCVIEW_DATA_HPP
 
+#include "aggregate.hpp"
+#include "arena.hpp"
 #include "array.hpp"
+#include "bitmap.hpp"
+#include "encoding.hpp"
+#include "histogram.hpp"
 #include "json.hpp"
+#include "simd.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 #include "vector.hpp"
 
@@ -25,6 +32,39 @@ namespace gcview {
 
 class Space;
 
+////////// Data Kinds //////////
+
+// Identifies the exact class of a data, so that loops over all data
+// (e.g., Space::updateModifiedFlags()) can call the implementation of
+// the classes below directly, and so that the typed lookups (e.g.,
+// Space::findTypedData()) only cast a data to its own class. Any other
+// class is GenericDataKind and goes through the virtual methods.
+typedef enum {
+  GenericDataKind,
+  BoolValueKind,
+  ByteValueKind,
+  IntValueKind,
+  DoubleValueKind,
+  StringValueKind,
+  EnumValueKind,
+  BoolArrayKind,
+  ByteArrayKind,
+  IntArrayKind,
+  DoubleArrayKind,
+  StringArrayKind,
+  EnumArrayKind,
+  TileArrayKind,
+  HistogramDataKind,
+  AggregateValueKind,
+  AtomicIntValueKind,
+  ShardedIntValueKind,
+  AtomicIntArrayKind
+} DataKind;
+
+// The kind of class D (see the end of this file).
+template <typename D>
+struct DataKindOf;
+
 ////////// Class Data //////////
 
 class Data {
@@ -40,6 +80,15 @@ public:
     EnumType
   } DataType;
 
+  // See encoding.hpp.
+  typedef enum {
+    PlainEncoding,
+    DeltaEncoding,
+    VarintEncoding,
+    XorFloatEncoding,
+    RunLengthEncoding
+  } Encoding;
+
 private:
   void setID(unsigned id) { _id = id; }
 
@@ -50,25 +99,33 @@ protected:
   const bool _is_array;
   const char* const _group_name;
   Array<const char*>* const _enum_members;
+  // Names of the array indexes (see addLabel()), NULL if there are none.
+  Array<const char*>* _labels;
+  Encoding _encoding;
+  // Where the names and the data itself are allocated (see
+  // Space::addData()), NULL if they are on the heap.
+  Arena* const _arena;
+  // Whether the data itself is in the arena, it is then destroyed
+  // without delete.
+  bool _is_in_arena;
+  // Whether other threads update the value concurrently (see
+  // AtomicIntValue), it then has to be captured before each snapshot.
+  bool _is_concurrent;
+  // Whether the value covers the values set since the last data record
+  // (see AggregateValue), it then has to be restarted after each data
+  // record, but not after the metadata.
+  bool _is_windowed;
 
   bool _modified;
 
-  static const char* getDataTypeStr(DataType data_type) {
-    switch (data_type) {
-    case BoolType   : return "Bool";
-    case ByteType   : return "Byte";
-    case IntType    : return "Int";
-    case DoubleType : return "Double";
-    case StringType : return "String";
-    case EnumType   : return "Enum";
-    default: GCVIEW_UNREACHABLE_NULL("unknown data type");
-    }
-  }
-
   bool isModified() const { return _modified; }
 
   virtual bool isValueModified() const = 0;
   virtual void updatePrevValue() = 0;
+  // Only called for concurrent data (see Space::captureValues()).
+  virtual void captureValue() { }
+  // Only called for windowed data (see Space::endWindows()).
+  virtual void endWindow() { }
 
   void updateModifiedFlag()              { _modified = isValueModified(); }
   void updateModifiedFlag(bool modified) { _modified = modified;          }
@@ -83,25 +140,79 @@ protected:
   void writeJSONMetadata(JSONWriter* writer) const;
   void writeJSONData(JSONWriter* writer) const {
     if (_modified) {
-      writeJSONDataSpecial(writer);
+      writeJSONDataUpdate(writer);
     } else {
       writer->writeNull();
     }
   }
+  // Writes the full value.
   virtual void writeJSONDataSpecial(JSONWriter* writer) const = 0;
+  // Writes the value as an update over the previous one, it can be
+  // more compact than the full value.
+  virtual void writeJSONDataUpdate(JSONWriter* writer) const {
+    writeJSONDataSpecial(writer);
+  }
+
+  void writeTraceMetadata(TraceWriter* writer) const;
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const = 0;
+  virtual void writeTraceDataUpdate(TraceWriter* writer) const {
+    writeTraceDataSpecial(writer);
+  }
 
   virtual void validate() const = 0;
 
+  // In the arena if there is one.
+  const char* cloneStr(const char* str) const;
+
+  void clearLabels();
+
   Data(const char* name, DataType data_type, bool is_array,
-       const char* group_name = NULL);
+       const char* group_name = NULL, Arena* arena = NULL);
 
 public:
+  static const char* getDataTypeStr(DataType data_type) {
+    switch (data_type) {
+    case BoolType   : return "Bool";
+    case ByteType   : return "Byte";
+    case IntType    : return "Int";
+    case DoubleType : return "Double";
+    case StringType : return "String";
+    case EnumType   : return "Enum";
+    default: GCVIEW_UNREACHABLE_NULL("unknown data type");
+    }
+  }
+
+  static const char* getEncodingStr(Encoding encoding) {
+    switch (encoding) {
+    case PlainEncoding    : return "Plain";
+    case DeltaEncoding    : return "Delta";
+    case VarintEncoding   : return "Varint";
+    case XorFloatEncoding : return "XorFloat";
+    case RunLengthEncoding: return "RLE";
+    default: GCVIEW_UNREACHABLE_NULL("unknown encoding");
+    }
+  }
+
+  unsigned getID() const { return _id; }
   const char* getName() const { return _name; }
   DataType getDataType() const { return _data_type; }
   bool isArray() const { return _is_array; }
+  Encoding getEncoding() const { return _encoding; }
+  bool isConcurrent() const { return _is_concurrent; }
+  // The exact class of the data; subclasses of the classes that have
+  // a kind share it.
+  virtual DataKind getKind() const { return GenericDataKind; }
 
   unsigned addEnumMember(const char* enum_member);
 
+  // Adds the name of the next array index (e.g., the range of a
+  // histogram bucket). The labels are written once, in the metadata.
+  // They should be added before the metadata is written.
+  unsigned addLabel(const char* label);
+  unsigned getLabelNum() const {
+    return (_labels != NULL) ? _labels->getLength() : 0;
+  }
+
   virtual ~Data();
 };
 
@@ -123,17 +234,49 @@ public:
   T get() const { return _value; }
   void reset() { set((T) 0); }
   void set(T value) { _value = value; }
+  void set(const SimpleElement<T>& other) { _value = other._value; }
   bool isEqualTo(T value) const { return _value == value; }
+  bool isEqualTo(const SimpleElement<T>& other) const {
+    return _value == other._value;
+  }
 };
 
+// The strings are interned in the StringPool (see arena.hpp) when
+// possible, so that setting a string that is already there, comparing
+// two elements or copying one to another (e.g., to the previous value)
+// does not allocate and usually does not need a strcmp.
 class StringElement {
 private:
   const char* _str;
+  bool _is_interned;
 
   void reclaim() {
     if (_str != NULL) {
-      delete[] _str;
+      if (!_is_interned) {
+        delete[] _str;
+      }
       _str = NULL;
+      _is_interned = false;
+    }
+  }
+
+  void setInterned(const char* str) {
+    reclaim();
+    _str = str;
+    _is_interned = true;
+  }
+
+  void setNew(const char* str) {
+    if (str == NULL || *str == '\0') {
+      reclaim();
+      return;
+    }
+    const char* interned = StringPool::intern(str);
+    if (interned != NULL) {
+      setInterned(interned);
+    } else {
+      reclaim();
+      _str = Utils::cloneStr(str);
     }
   }
 
@@ -142,18 +285,34 @@ public:
 
   static const char* getDefault() { return NULL; }
 
-  StringElement() : _str(NULL) { }
+  StringElement() : _str(NULL), _is_interned(false) { }
   ~StringElement() { reclaim(); }
 
   const char* get() const { return Utils::getStrOrEmptyStr(_str); }
   void reset() { reclaim(); }
   void set(const char* str) {
     if (!isEqualTo(str)) {
-      reclaim();
-      _str = Utils::cloneStr(str);
+      setNew(str);
+    }
+  }
+  void set(const StringElement& other) {
+    if (other._is_interned) {
+      if (_str != other._str) {
+        setInterned(other._str);
+      }
+    } else {
+      set(other._str);
     }
   }
-  bool isEqualTo(const char* str) const { return Utils::areStrsEqual(str, _str); }
+  bool isEqualTo(const char* str) const {
+    return str == _str || Utils::areStrsEqual(str, _str);
+  }
+  bool isEqualTo(const StringElement& other) const {
+    if (_is_interned && other._is_interned) {
+      return _str == other._str;
+    }
+    return isEqualTo(other._str);
+  }
 };
 
 template <typename E>
@@ -169,6 +328,7 @@ private:
   void set(T value) { _elem.set(value); }
 
   bool isEqualTo(T value) const { return _elem.isEqualTo(value); }
+  bool isEqualTo(const ET& other) const { return _elem.isEqualTo(other._elem); }
 
   void add(T value) {
     GCVIEW_ASSERT(E::ArithmeticOpsAreAllowed);
@@ -189,13 +349,13 @@ public:
   operator T() const { return get(); }
 
   void operator=(T value) { set(value); }
-  void operator=(const ET& other) { set(other.get()); }
+  void operator=(const ET& other) { _elem.set(other._elem); }
 
   bool operator==(T value) const { return isEqualTo(value); }
-  bool operator==(const ET& other) const { return isEqualTo(other.get()); }
+  bool operator==(const ET& other) const { return isEqualTo(other); }
 
   bool operator!=(T value) const { return !isEqualTo(value); }
-  bool operator!=(const ET& other) const { return !isEqualTo(other.get()); }
+  bool operator!=(const ET& other) const { return !isEqualTo(other); }
 
   void operator+=(T value) { add(value); }
   void operator+=(const ET& other) { add(other.get()); }
@@ -204,10 +364,44 @@ public:
   void operator-=(const ET& other) { sub(other.get()); }
 };
 
+// A SimpleElement is just its value, so arrays of them can be copied
+// in bulk (see Vector).
+template <typename T>
+struct IsTriviallyCopyable<Element<SimpleElement<T> > > {
+  static const bool Value = true;
+};
+
+// Scans a range of two element arrays for the first index at which
+// they differ (see ArrayData), element by element in general, and
+// with SimdUtils for SimpleElements.
+template <typename ET>
+struct ElementScanner {
+  static unsigned findFirstDiff(const Element<ET>* a, const Element<ET>* b,
+                                unsigned from, unsigned to) {
+    for (unsigned i = from; i < to; i += 1) {
+      if (a[i] != b[i]) {
+        return i;
+      }
+    }
+    return to;
+  }
+};
+
+template <typename T>
+struct ElementScanner<SimpleElement<T> > {
+  static unsigned findFirstDiff(const Element<SimpleElement<T> >* a,
+                                const Element<SimpleElement<T> >* b,
+                                unsigned from, unsigned to) {
+    return SimdUtils::findFirstDiff((const T*) a, (const T*) b, from, to);
+  }
+};
+
 ////////// ValueData Classes //////////
 
 template <typename ET, Data::DataType DT>
 class ValueData : public Data {
+  friend class Space;
+
 private:
   typedef typename ET::ValueType T;
   typedef ValueData<ET, DT> VDT;
@@ -230,6 +424,10 @@ protected:
     writer->write((T) _value);
   }
 
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    writer->write((T) _value);
+  }
+
   virtual void validate() const {
     if (_data_type == EnumType) {
       validateEnumValue((uintptr_t) get());
@@ -237,8 +435,12 @@ protected:
   }
 
 public:
+  static const DataType StaticDataType = DT;
   static const DataType StaticValueDataType = DT;
   static const bool StaticIsArray = false;
+  static const bool StaticIsConcurrent = false;
+
+  virtual DataKind getKind() const { return DataKindOf<ValueData>::Value; }
 
   void reset() { set(ET::getDefault()); }
 
@@ -248,8 +450,9 @@ public:
 
   Element<ET>& value() { return _value; }
 
-  ValueData(const char* name, const char* group_name = NULL)
-      : Data(name, DT, false /* is_array */, group_name) { }
+  ValueData(const char* name, const char* group_name = NULL,
+            Arena* arena = NULL)
+      : Data(name, DT, false /* is_array */, group_name, arena) { }
 };
 
 typedef ValueData<SimpleElement<bool>, Data::BoolType> BoolValue;
@@ -261,8 +464,17 @@ typedef ValueData<SimpleElement<unsigned char>, Data::EnumType> EnumValue;
 
 ////////// ArrayData Classes //////////
 
+// An array update is written as a patch (a list of index / value
+// pairs) instead of the full array when the array has at least
+// GCVIEW_ARRAY_PATCH_MIN_LENGTH elements, its length has not changed,
+// and at most 1 / GCVIEW_ARRAY_PATCH_RATIO of its elements have changed.
+#define GCVIEW_ARRAY_PATCH_MIN_LENGTH 16
+#define GCVIEW_ARRAY_PATCH_RATIO       4
+
 template <typename ET, Data::DataType DT>
 class ArrayData : public Data {
+  friend class Space;
+
 private:
   typedef typename ET::ValueType T;
   typedef ValueData<ET, DT> VDT;
@@ -270,17 +482,137 @@ private:
   Vector<Element<ET> > _prev_array;
   Vector<Element<ET> > _array;
 
+  // Elements that might have changed since the last snapshot. Only
+  // these need to be compared against / copied to _prev_array, as long
+  // as the length has not changed.
+  Bitmap _dirty;
+
+// Goes over the runs [__from__, __to__) of consecutive dirty elements.
+#define ITERATE_DIRTY_RUNS(__from__, __to__, __cmd__) \
+  do { \
+    const unsigned __length__ = _array.getLength(); \
+    for (unsigned __from__ = _dirty.findNext(0), \
+                  __to__ = _dirty.findNextClear(__from__); \
+         __from__ < __length__; \
+         __from__ = _dirty.findNext(__to__), \
+         __to__ = _dirty.findNextClear(__from__)) { \
+      __cmd__ \
+    } \
+  } while (false)
+
+// Goes over the dirty elements that differ from _prev_array, which
+// should be as long as the array. The runs are scanned in bulk (see
+// ElementScanner).
+#define ITERATE_CHANGED_ELEMS(__index__, __cmd__) \
+  ITERATE_DIRTY_RUNS(__run_from__, __run_to__, { \
+    for (unsigned __index__ = findFirstDiff(__run_from__, __run_to__); \
+         __index__ < __run_to__; \
+         __index__ = findFirstDiff(__index__ + 1, __run_to__)) { \
+      __cmd__ \
+    } \
+  })
+
+  unsigned findFirstDiff(unsigned from, unsigned to) const {
+    return ElementScanner<ET>::findFirstDiff(_array.getData(),
+                                             _prev_array.getData(),
+                                             from, to);
+  }
+
   bool areArraysEqual() const {
+    if (_array.getLength() != _prev_array.getLength()) {
+      return false;
+    }
+    ITERATE_CHANGED_ELEMS(i, {
+      return false;
+    });
+    return true;
+  }
+
+  unsigned getChangedNum() const {
+    GCVIEW_ASSERT(_array.getLength() == _prev_array.getLength());
+    unsigned changed_num = 0;
+    ITERATE_CHANGED_ELEMS(i, {
+      changed_num += 1;
+    });
+    return changed_num;
+  }
+
+  bool shouldWritePatch(unsigned* changed_num) const {
     const unsigned length = _array.getLength();
-    if (length != _prev_array.getLength()) {
+    if (length < GCVIEW_ARRAY_PATCH_MIN_LENGTH ||
+        length != _prev_array.getLength()) {
       return false;
     }
-    for (unsigned i = 0; i < length; i += 1) {
-      if (_array[i] != _prev_array[i]) {
-        return false;
+    *changed_num = getChangedNum();
+    return *changed_num * GCVIEW_ARRAY_PATCH_RATIO <= length;
+  }
+
+  bool shouldWriteEncoded() const {
+    switch (_encoding) {
+    case PlainEncoding:
+      return false;
+    case XorFloatEncoding:
+      return true;
+    default:
+      return _array.getLength() == _prev_array.getLength();
+    }
+  }
+
+  long long getDelta(unsigned index) const {
+    return EncodingUtils::asInt((T) _array[index]) -
+           EncodingUtils::asInt((T) _prev_array[index]);
+  }
+
+  // Appends the encoded elements, in the same way for JSON (before
+  // the base64 encoding) and for binary traces.
+  void appendEncodedBytes(ByteBuffer* buffer) const {
+    const unsigned length = _array.getLength();
+    if (_encoding == XorFloatEncoding) {
+      uint64_t prev_bits = 0;
+      for (unsigned i = 0; i < length; i += 1) {
+        EncodingUtils::appendXorFloat(buffer,
+                                      EncodingUtils::asDouble((T) _array[i]),
+                                      &prev_bits);
+      }
+    } else {
+      for (unsigned i = 0; i < length; i += 1) {
+        EncodingUtils::appendVarint(buffer,
+                                    EncodingUtils::zigZag(getDelta(i)));
+      }
+    }
+  }
+
+  void writeJSONDataEncoded(JSONWriter* writer) const {
+    JSONObjectWriter x(writer);
+    x.startPair(getEncodingStr(_encoding));
+    if (_encoding == DeltaEncoding) {
+      JSONArrayWriter y(writer);
+      const unsigned length = _array.getLength();
+      for (unsigned i = 0; i < length; i += 1) {
+        y.writeElem(getDelta(i));
+      }
+    } else {
+      ByteBuffer* bytes = writer->getScratchBytes();
+      appendEncodedBytes(bytes);
+      ByteBuffer* str = writer->getScratchStr();
+      EncodingUtils::appendBase64(str, bytes->getData(), bytes->getLength());
+      writer->write((const char*) str->getData());
+    }
+  }
+
+  void writeTraceDataEncoded(TraceWriter* writer) const {
+    const unsigned length = _array.getLength();
+    writer->writeArrayHeader(length, TraceWriter::EncodedArray);
+    if (_encoding == XorFloatEncoding) {
+      ByteBuffer* bytes = writer->getScratch();
+      appendEncodedBytes(bytes);
+      writer->writeLength(bytes->getLength());
+      writer->writeBytes(bytes->getData(), bytes->getLength());
+    } else {
+      for (unsigned i = 0; i < length; i += 1) {
+        writer->writeZigZag(getDelta(i));
       }
     }
-    return true;
   }
 
 protected:
@@ -288,14 +620,23 @@ protected:
 
   virtual void updatePrevValue() {
     if (_modified) {
-      const unsigned length = _array.getLength();
-      _prev_array.resize(length);
-      for (unsigned i = 0; i < length; i += 1) {
-        _prev_array[i] = _array[i];
+      if (_array.getLength() != _prev_array.getLength()) {
+        // in bulk, and without allocating once _prev_array is as long
+        // as the array has ever been
+        _prev_array.copyFrom(_array);
+      } else {
+        // Unlike AtomicIntArray, which refills a snapshot array before
+        // every snapshot, _array is the one that is updated and has to
+        // keep its values: swapping would mean copying all of them
+        // back, instead of only the dirty runs.
+        ITERATE_DIRTY_RUNS(from, to, {
+          _prev_array.copyRangeFrom(_array, from, to);
+        });
       }
     } else {
       GCVIEW_ASSERT(areArraysEqual());
     }
+    _dirty.clear();
   }
 
   virtual void writeJSONDataSpecial(JSONWriter* writer) const {
@@ -306,6 +647,58 @@ protected:
     }
   }
 
+  // A patch is written as { "Patch" : [ index0, value0, index1, ... ] }.
+  virtual void writeJSONDataUpdate(JSONWriter* writer) const {
+    unsigned changed_num;
+    if (!shouldWritePatch(&changed_num)) {
+      if (shouldWriteEncoded()) {
+        writeJSONDataEncoded(writer);
+      } else {
+        writeJSONDataSpecial(writer);
+      }
+      return;
+    }
+
+    JSONObjectWriter x(writer);
+    x.startPair("Patch");
+    JSONArrayWriter y(writer);
+    ITERATE_CHANGED_ELEMS(i, {
+      y.writeElem(i);
+      y.writeElem((T) _array[i]);
+    });
+  }
+
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    const unsigned length = _array.getLength();
+    writer->writeArrayHeader(length, TraceWriter::FullArray);
+    for (unsigned i = 0; i < length; i += 1) {
+      writer->write((T) _array[i]);
+    }
+  }
+
+  virtual void writeTraceDataUpdate(TraceWriter* writer) const {
+    unsigned changed_num;
+    if (!shouldWritePatch(&changed_num)) {
+      if (shouldWriteEncoded()) {
+        writeTraceDataEncoded(writer);
+      } else {
+        writeTraceDataSpecial(writer);
+      }
+      return;
+    }
+
+    writer->writeArrayHeader(changed_num, TraceWriter::PatchArray);
+    unsigned prev_index = 0;
+    ITERATE_CHANGED_ELEMS(i, {
+      writer->writeLength(i - prev_index);
+      writer->write((T) _array[i]);
+      prev_index = i;
+    });
+  }
+
+#undef ITERATE_CHANGED_ELEMS
+#undef ITERATE_DIRTY_RUNS
+
   virtual void validate() const {
     const unsigned length = _array.getLength();
     if (_data_type == EnumType) {
@@ -315,8 +708,24 @@ protected:
     }
   }
 public:
+  static const DataType StaticDataType = DT;
   static const DataType StaticArrayDataType = DT;
   static const bool StaticIsArray = true;
+  static const bool StaticIsConcurrent = false;
+
+  virtual DataKind getKind() const { return DataKindOf<ArrayData>::Value; }
+
+  // Sets the encoding of the array updates (see encoding.hpp). Delta
+  // and Varint are only supported by IntArrays and XorFloat only by
+  // DoubleArrays. It should be set before the metadata is written.
+  void setEncoding(Encoding encoding) {
+    GCVIEW_GUARANTEE(encoding == PlainEncoding ||
+                     (DT == IntType && (encoding == DeltaEncoding ||
+                                        encoding == VarintEncoding)) ||
+                     (DT == DoubleType && encoding == XorFloatEncoding),
+                     "encoding not supported by the array type");
+    _encoding = encoding;
+  }
 
   void reset() { reset(ET::getDefault()); }
 
@@ -327,18 +736,36 @@ public:
     }
   }
 
-  void resize(unsigned new_length) { _array.resize(new_length); }
+  void resize(unsigned new_length) {
+    const unsigned length = _array.getLength();
+    _array.resize(new_length);
+    _dirty.resize(new_length);
+    if (new_length > length) {
+      // the new elements might not be equal to the ones at the same
+      // index in _prev_array (if the array shrank before growing again)
+      _dirty.setRange(length, new_length);
+    }
+  }
 
   unsigned getLength() const { return _array.getLength(); }
 
   T get(unsigned index) const { return (T) _array[index]; }
 
-  void set(unsigned index, T value) { _array[index] = value; }
+  void set(unsigned index, T value) {
+    _dirty.set(index);
+    _array[index] = value;
+  }
 
-  Element<ET>& value(unsigned index) { return _array[index]; }
+  // The element is conservatively considered modified, since it can
+  // be updated through the returned reference.
+  Element<ET>& value(unsigned index) {
+    _dirty.set(index);
+    return _array[index];
+  }
 
-  ArrayData(const char* name, const char* group_name = NULL)
-      : Data(name, DT, true /* is_array */, group_name)  { }
+  ArrayData(const char* name, const char* group_name = NULL,
+            Arena* arena = NULL)
+      : Data(name, DT, true /* is_array */, group_name, arena)  { }
 };
 
 typedef ArrayData<SimpleElement<bool>, Data::BoolType> BoolArray;
@@ -348,6 +775,826 @@ typedef ArrayData<SimpleElement<double>, Data::DoubleType> DoubleArray;
 typedef ArrayData<StringElement, Data::StringType> StringArray;
 typedef ArrayData<SimpleElement<unsigned char>, Data::EnumType> EnumArray;
 
+////////// TileArray //////////
+
+// A heap map: the state (an enum member, e.g., free, young, old or
+// pinned) of each of a large number of tiles (regions, pages, cards),
+// one byte per tile.
+//
+//   TileArray* regions = space->addData<TileArray>("Region States");
+//   regions->addEnumMember("Free");
+//   regions->addEnumMember("Young");
+//   ...
+//   regions->resize(region_num);           // the new tiles are Free
+//   regions->setRange(from, to, YOUNG);    // e.g., a new young space
+//
+// Neighbouring tiles are mostly in the same state, so the full value
+// (in the metadata, and in updates that change many runs) is run-length
+// encoded, as { "RLE" : [ state0, run0, state1, run1, ... ] }. Other
+// updates list the runs of changed tiles, as
+// { "RunPatch" : [ index0, run0, state0, index1, ... ] }, each run
+// setting the tiles [ index, index + run ) to state. Only the tiles set
+// since the last snapshot are compared against their previous states.
+//
+// In the metadata and the traces it is an Enum array with the RLE
+// encoding.
+class TileArray : public Data {
+  friend class Space;
+
+private:
+  Vector<unsigned char> _prev_tiles;
+  Vector<unsigned char> _tiles;
+  Bitmap _dirty;
+
+// Goes over the runs [__from__, __to__) of consecutive dirty tiles.
+#define ITERATE_DIRTY_RUNS(__from__, __to__, __cmd__) \
+  do { \
+    const unsigned __length__ = _tiles.getLength(); \
+    for (unsigned __from__ = _dirty.findNext(0), \
+                  __to__ = _dirty.findNextClear(__from__); \
+         __from__ < __length__; \
+         __from__ = _dirty.findNext(__to__), \
+         __to__ = _dirty.findNextClear(__from__)) { \
+      __cmd__ \
+    } \
+  } while (false)
+
+// Goes over the runs [__from__, __to__) of dirty tiles in the same
+// state that start with a changed tile, _prev_tiles should be as long
+// as _tiles. A run also covers the unchanged tiles that follow in the
+// same state, so that setting a range that partly had the new state
+// is still a single run.
+#define ITERATE_CHANGED_RUNS(__from__, __to__, __cmd__) \
+  ITERATE_DIRTY_RUNS(__dirty_from__, __dirty_to__, { \
+    unsigned __from__ = findFirstDiff(__dirty_from__, __dirty_to__); \
+    while (__from__ < __dirty_to__) { \
+      const unsigned __to__ = findRunEnd(__from__, __dirty_to__); \
+      __cmd__ \
+      __from__ = findFirstDiff(__to__, __dirty_to__); \
+    } \
+  })
+
+  unsigned findFirstDiff(unsigned from, unsigned to) const {
+    return SimdUtils::findFirstDiff(_tiles.getData(), _prev_tiles.getData(),
+                                    from, to);
+  }
+
+  // Returns the end of the run of tiles in the state of the tile at
+  // from, up to to.
+  unsigned findRunEnd(unsigned from, unsigned to) const {
+    const unsigned char* tiles = _tiles.getData();
+    const unsigned char state = tiles[from];
+    unsigned i = from + 1;
+    while (i < to && tiles[i] == state) {
+      i += 1;
+    }
+    return i;
+  }
+
+  bool areTilesEqual() const {
+    if (_tiles.getLength() != _prev_tiles.getLength()) {
+      return false;
+    }
+    ITERATE_CHANGED_RUNS(from, to, {
+      return false;
+    });
+    return true;
+  }
+
+  unsigned getChangedRunNum() const {
+    GCVIEW_ASSERT(_tiles.getLength() == _prev_tiles.getLength());
+    unsigned changed_run_num = 0;
+    ITERATE_CHANGED_RUNS(from, to, {
+      changed_run_num += 1;
+    });
+    return changed_run_num;
+  }
+
+  // Whether the full value has at least run_num runs. It stops
+  // counting once it gets there.
+  bool hasRunNumAtLeast(unsigned run_num) const {
+    const unsigned length = _tiles.getLength();
+    unsigned n = 0;
+    for (unsigned from = 0; from < length && n < run_num;
+         from = findRunEnd(from, length)) {
+      n += 1;
+    }
+    return n >= run_num;
+  }
+
+  // A changed run takes three numbers and a run of the full value two.
+  bool shouldWriteRunPatch(unsigned* changed_run_num) const {
+    if (_tiles.getLength() != _prev_tiles.getLength()) {
+      return false;
+    }
+    *changed_run_num = getChangedRunNum();
+    return hasRunNumAtLeast((3 * *changed_run_num + 1) / 2);
+  }
+
+protected:
+  virtual bool isValueModified() const { return !areTilesEqual(); }
+
+  virtual void updatePrevValue() {
+    if (_modified) {
+      if (_tiles.getLength() != _prev_tiles.getLength()) {
+        _prev_tiles.copyFrom(_tiles);
+      } else {
+        ITERATE_DIRTY_RUNS(from, to, {
+          _prev_tiles.copyRangeFrom(_tiles, from, to);
+        });
+      }
+    } else {
+      GCVIEW_ASSERT(areTilesEqual());
+    }
+    _dirty.clear();
+  }
+
+  virtual void writeJSONDataSpecial(JSONWriter* writer) const {
+    JSONObjectWriter x(writer);
+    x.startPair(getEncodingStr(_encoding));
+    JSONArrayWriter y(writer);
+    const unsigned length = _tiles.getLength();
+    for (unsigned from = 0, to; from < length; from = to) {
+      to = findRunEnd(from, length);
+      y.writeElem(_tiles[from]);
+      y.writeElem(to - from);
+    }
+  }
+
+  virtual void writeJSONDataUpdate(JSONWriter* writer) const {
+    unsigned changed_run_num;
+    if (!shouldWriteRunPatch(&changed_run_num)) {
+      writeJSONDataSpecial(writer);
+      return;
+    }
+
+    JSONObjectWriter x(writer);
+    x.startPair("RunPatch");
+    JSONArrayWriter y(writer);
+    ITERATE_CHANGED_RUNS(from, to, {
+      y.writeElem(from);
+      y.writeElem(to - from);
+      y.writeElem(_tiles[from]);
+    });
+  }
+
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    const unsigned length = _tiles.getLength();
+    writer->writeArrayHeader(length, TraceWriter::EncodedArray);
+    for (unsigned from = 0, to; from < length; from = to) {
+      to = findRunEnd(from, length);
+      writer->write(_tiles[from]);
+      writer->writeLength(to - from);
+    }
+  }
+
+  virtual void writeTraceDataUpdate(TraceWriter* writer) const {
+    unsigned changed_run_num;
+    if (!shouldWriteRunPatch(&changed_run_num)) {
+      writeTraceDataSpecial(writer);
+      return;
+    }
+
+    writer->writeArrayHeader(changed_run_num, TraceWriter::RunPatchArray);
+    unsigned prev_to = 0;
+    ITERATE_CHANGED_RUNS(from, to, {
+      writer->writeLength(from - prev_to);
+      writer->writeLength(to - from);
+      writer->write(_tiles[from]);
+      prev_to = to;
+    });
+  }
+
+  // The tiles that were not set since the last snapshot were checked
+  // before.
+  virtual void validate() const {
+    ITERATE_DIRTY_RUNS(from, to, {
+      for (unsigned i = from; i < to; i += 1) {
+        validateEnumValue((uintptr_t) _tiles[i]);
+      }
+    });
+  }
+
+#undef ITERATE_CHANGED_RUNS
+#undef ITERATE_DIRTY_RUNS
+
+public:
+  static const DataType StaticDataType = EnumType;
+  static const DataType StaticArrayDataType = EnumType;
+  static const bool StaticIsArray = true;
+  static const bool StaticIsConcurrent = false;
+
+  virtual DataKind getKind() const { return TileArrayKind; }
+
+  // The new tiles are in state 0.
+  void resize(unsigned new_length) {
+    const unsigned length = _tiles.getLength();
+    _tiles.resize(new_length);
+    _dirty.resize(new_length);
+    if (new_length > length) {
+      memset(_tiles.getData() + length, 0, new_length - length);
+      _dirty.setRange(length, new_length);
+    }
+  }
+
+  unsigned getLength() const { return _tiles.getLength(); }
+
+  unsigned char get(unsigned index) const { return _tiles[index]; }
+
+  void set(unsigned index, unsigned char state) {
+    _dirty.set(index);
+    _tiles[index] = state;
+  }
+
+  // Sets the tiles [from, to) to state.
+  void setRange(unsigned from, unsigned to, unsigned char state) {
+    GCVIEW_ASSERT(from <= to && to <= _tiles.getLength());
+    if (from < to) {
+      memset(_tiles.getData() + from, state, to - from);
+      _dirty.setRange(from, to);
+    }
+  }
+
+  void reset() { setRange(0, _tiles.getLength(), 0); }
+
+  TileArray(const char* name, const char* group_name = NULL,
+            Arena* arena = NULL)
+      : Data(name, EnumType, true /* is_array */, group_name, arena) {
+    _encoding = RunLengthEncoding;
+  }
+};
+
+////////// HistogramData //////////
+
+// Counts of values in log-linear buckets (see histogram.hpp), e.g.,
+// of allocation sizes or object lifetimes:
+//
+//   HistogramData* sizes = space->addData<HistogramData>("Alloc Sizes");
+//   sizes->configure(3, 24);    // optional, before the metadata
+//   ...
+//   sizes->record(size_bytes);
+//
+// In the metadata and the traces it is an Int array with one count per
+// bucket, which has the bucket ranges as the labels of its indexes, so
+// the ranges are only written once. Updates are patches of the buckets
+// whose counts changed (with the same rule as ArrayData). The counts
+// add up until reset().
+//
+// Threads that record concurrently should each record into their own
+// Histogram with the same layout, which is then merged in with
+// merge() before the snapshot.
+class HistogramData : public Data {
+  friend class Space;
+
+private:
+  Histogram _histogram;
+  Vector<long long> _prev_counts;
+
+  const Vector<long long>& getCounts() const {
+    return _histogram.getCounts();
+  }
+
+  unsigned findFirstDiff(unsigned from) const {
+    return SimdUtils::findFirstDiff(getCounts().getData(),
+                                    _prev_counts.getData(),
+                                    from, getCounts().getLength());
+  }
+
+  bool areCountsEqual() const {
+    const unsigned length = getCounts().getLength();
+    return length == _prev_counts.getLength() && findFirstDiff(0) == length;
+  }
+
+  // Same rule as for the other arrays (see ArrayData).
+  bool shouldWritePatch(unsigned* changed_num) const {
+    const unsigned length = getCounts().getLength();
+    if (length < GCVIEW_ARRAY_PATCH_MIN_LENGTH ||
+        length != _prev_counts.getLength()) {
+      return false;
+    }
+    *changed_num = 0;
+    for (unsigned i = findFirstDiff(0); i < length; i = findFirstDiff(i + 1)) {
+      *changed_num += 1;
+    }
+    return *changed_num * GCVIEW_ARRAY_PATCH_RATIO <= length;
+  }
+
+  void addBucketLabels() {
+    clearLabels();
+    char buffer[64];
+    const unsigned bucket_num = _histogram.getBucketNum();
+    for (unsigned i = 0; i < bucket_num; i += 1) {
+      _histogram.formatBucketLabel(i, buffer, sizeof(buffer));
+      addLabel(buffer);
+    }
+  }
+
+protected:
+  virtual bool isValueModified() const { return !areCountsEqual(); }
+
+  virtual void updatePrevValue() {
+    if (_modified) {
+      _prev_counts.copyFrom(getCounts());
+    }
+  }
+
+  virtual void writeJSONDataSpecial(JSONWriter* writer) const {
+    JSONArrayWriter y(writer);
+    const Vector<long long>& counts = getCounts();
+    for (unsigned i = 0; i < counts.getLength(); i += 1) {
+      y.writeElem(counts[i]);
+    }
+  }
+
+  virtual void writeJSONDataUpdate(JSONWriter* writer) const {
+    unsigned changed_num;
+    if (!shouldWritePatch(&changed_num)) {
+      writeJSONDataSpecial(writer);
+      return;
+    }
+
+    JSONObjectWriter x(writer);
+    x.startPair("Patch");
+    JSONArrayWriter y(writer);
+    const Vector<long long>& counts = getCounts();
+    const unsigned length = counts.getLength();
+    for (unsigned i = findFirstDiff(0); i < length; i = findFirstDiff(i + 1)) {
+      y.writeElem(i);
+      y.writeElem(counts[i]);
+    }
+  }
+
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    const Vector<long long>& counts = getCounts();
+    writer->writeArrayHeader(counts.getLength(), TraceWriter::FullArray);
+    for (unsigned i = 0; i < counts.getLength(); i += 1) {
+      writer->write(counts[i]);
+    }
+  }
+
+  virtual void writeTraceDataUpdate(TraceWriter* writer) const {
+    unsigned changed_num;
+    if (!shouldWritePatch(&changed_num)) {
+      writeTraceDataSpecial(writer);
+      return;
+    }
+
+    writer->writeArrayHeader(changed_num, TraceWriter::PatchArray);
+    unsigned prev_index = 0;
+    const Vector<long long>& counts = getCounts();
+    const unsigned length = counts.getLength();
+    for (unsigned i = findFirstDiff(0); i < length; i = findFirstDiff(i + 1)) {
+      writer->writeLength(i - prev_index);
+      writer->write(counts[i]);
+      prev_index = i;
+    }
+  }
+
+  virtual void validate() const { }
+
+public:
+  static const DataType StaticDataType = IntType;
+  static const DataType StaticArrayDataType = IntType;
+  static const bool StaticIsArray = true;
+  static const bool StaticIsConcurrent = false;
+
+  virtual DataKind getKind() const { return HistogramDataKind; }
+
+  // Sets the layout of the buckets (see Histogram::configure()) and
+  // clears the counts. It should be set before the metadata is
+  // written.
+  void configure(unsigned sub_bucket_bits, unsigned max_value_bits) {
+    _histogram.configure(sub_bucket_bits, max_value_bits);
+    addBucketLabels();
+  }
+
+  void record(unsigned long long value, long long count = 1) {
+    _histogram.record(value, count);
+  }
+
+  // Adds the counts of a histogram with the same layout.
+  void merge(const Histogram& other) { _histogram.merge(other); }
+
+  void reset() { _histogram.reset(); }
+
+  const Histogram& getHistogram() const { return _histogram; }
+
+  HistogramData(const char* name, const char* group_name = NULL,
+                Arena* arena = NULL)
+      : Data(name, IntType, true /* is_array */, group_name, arena) {
+    addBucketLabels();
+  }
+};
+
+////////// AggregateValue //////////
+
+// A Double value that keeps the count, sum, min, max, mean and the
+// 50th / 90th / 99th percentiles (estimated, see aggregate.hpp) of all
+// the values set since the last snapshot, in constant memory, so that
+// values in between snapshots (e.g., the worst pause in a burst of
+// pauses) are not lost when snapshots are taken less often:
+//
+//   AggregateValue* pauses = space->addData<AggregateValue>("Pauses");
+//   ...
+//   pauses->set(pause_ms);    // any number of times per snapshot
+//
+// In the metadata and the traces it is a Double array with one element
+// per stat, which has the names of the stats as the labels of its
+// indexes. A snapshot without any values has all stats equal to 0.
+class AggregateValue : public Data {
+  friend class Space;
+
+private:
+  Aggregate _aggregate;
+  double _prev_stats[Aggregate::StatNum];
+
+  double getStat(unsigned stat) const {
+    return _aggregate.get((Aggregate::Stat) stat);
+  }
+
+protected:
+  virtual bool isValueModified() const {
+    for (unsigned i = 0; i < Aggregate::StatNum; i += 1) {
+      if (getStat(i) != _prev_stats[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  virtual void updatePrevValue() {
+    if (_modified) {
+      for (unsigned i = 0; i < Aggregate::StatNum; i += 1) {
+        _prev_stats[i] = getStat(i);
+      }
+    }
+  }
+
+  // After each data record: the metadata (e.g., the one a StreamServer
+  // writes for a late subscriber) does not end the window.
+  virtual void endWindow() { _aggregate.reset(); }
+
+  virtual void writeJSONDataSpecial(JSONWriter* writer) const {
+    JSONArrayWriter y(writer);
+    for (unsigned i = 0; i < Aggregate::StatNum; i += 1) {
+      y.writeElem(getStat(i));
+    }
+  }
+
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    writer->writeArrayHeader(Aggregate::StatNum, TraceWriter::FullArray);
+    for (unsigned i = 0; i < Aggregate::StatNum; i += 1) {
+      writer->write(getStat(i));
+    }
+  }
+
+  virtual void validate() const { }
+
+public:
+  static const DataType StaticDataType = DoubleType;
+  static const DataType StaticArrayDataType = DoubleType;
+  static const bool StaticIsArray = true;
+  static const bool StaticIsConcurrent = false;
+
+  virtual DataKind getKind() const { return AggregateValueKind; }
+
+  void set(double value) { _aggregate.add(value); }
+
+  // The values set since the last data record.
+  const Aggregate& getAggregate() const { return _aggregate; }
+
+  AggregateValue(const char* name, const char* group_name = NULL,
+                 Arena* arena = NULL)
+      : Data(name, DoubleType, true /* is_array */, group_name, arena) {
+    _is_windowed = true;
+    for (unsigned i = 0; i < Aggregate::StatNum; i += 1) {
+      _prev_stats[i] = 0.0;
+      addLabel(Aggregate::getStatStr((Aggregate::Stat) i));
+    }
+  }
+};
+
+////////// Atomic Data Classes //////////
+
+// Int data that any number of threads can update concurrently with
+// relaxed atomic operations, i.e., without locks:
+//
+//   AtomicIntValue* allocs = space->addData<AtomicIntValue>("Allocs");
+//   ...
+//   allocs->increment();           // on any thread
+//
+// Each snapshot reads the value once (see Space::captureValues()) and
+// uses what it read to decide whether it changed, to write it and as
+// the previous value, so what is written is consistent even if the
+// value keeps changing. In the metadata and the traces they are normal
+// Int data (with 64-bit values).
+//
+// An AtomicIntValue is a single counter on its own cache line. A
+// ShardedIntValue spreads the updates over GCVIEW_ATOMIC_SHARD_NUM
+// counters, each on its own cache line, picked by the CPU the thread
+// runs on, so that threads on different CPUs seldom update the same
+// line; reading it adds up the shards. The elements of an
+// AtomicIntArray are contiguous.
+//
+// set(), reset() and resize() should not race with the updates.
+
+#define GCVIEW_ATOMIC_SHARD_NUM 8
+
+template <unsigned ShardNum>
+class AtomicValueData : public Data {
+  friend class Space;
+
+private:
+  char* _shard_memory;
+  void* _shards;
+  long long _snapshot_value;
+  long long _prev_value;
+
+  volatile long long* getShard(unsigned index) const {
+    return (volatile long long*) CacheLineUtils::getSlot(_shards, index);
+  }
+
+  // not copyable
+  AtomicValueData(const AtomicValueData&);
+  AtomicValueData& operator=(const AtomicValueData&);
+
+protected:
+  virtual void captureValue() { _snapshot_value = get(); }
+
+  virtual bool isValueModified() const {
+    return _snapshot_value != _prev_value;
+  }
+
+  virtual void updatePrevValue() { _prev_value = _snapshot_value; }
+
+  virtual void writeJSONDataSpecial(JSONWriter* writer) const {
+    writer->write(_snapshot_value);
+  }
+
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    writer->write(_snapshot_value);
+  }
+
+  virtual void validate() const { }
+
+public:
+  static const DataType StaticDataType = IntType;
+  static const DataType StaticValueDataType = IntType;
+  static const bool StaticIsArray = false;
+  static const bool StaticIsConcurrent = true;
+
+  virtual DataKind getKind() const {
+    return DataKindOf<AtomicValueData>::Value;
+  }
+
+  void add(long long delta) {
+    const unsigned shard =
+      (ShardNum == 1) ? 0 : Utils::getCPUIndex() % ShardNum;
+    AtomicUtils::add(getShard(shard), delta);
+  }
+
+  void increment() { add(1); }
+
+  long long get() const {
+    long long value = 0;
+    for (unsigned i = 0; i < ShardNum; i += 1) {
+      value += AtomicUtils::load(getShard(i));
+    }
+    return value;
+  }
+
+  void set(long long value) {
+    AtomicUtils::store(getShard(0), value);
+    for (unsigned i = 1; i < ShardNum; i += 1) {
+      AtomicUtils::store(getShard(i), 0);
+    }
+  }
+
+  void reset() { set(0); }
+
+  AtomicValueData(const char* name, const char* group_name = NULL,
+                  Arena* arena = NULL)
+      : Data(name, IntType, false /* is_array */, group_name, arena),
+        _shard_memory(NULL), _shards(NULL),
+        _snapshot_value(0), _prev_value(0) {
+    _is_concurrent = true;
+    _shards = CacheLineUtils::alloc(ShardNum, sizeof(long long),
+                                    &_shard_memory);
+  }
+
+  virtual ~AtomicValueData() {
+    CacheLineUtils::release(_shard_memory);
+  }
+};
+
+typedef AtomicValueData<1> AtomicIntValue;
+typedef AtomicValueData<GCVIEW_ATOMIC_SHARD_NUM> ShardedIntValue;
+
+class AtomicIntArray : public Data {
+  friend class Space;
+
+private:
+  volatile long long* _array;
+  unsigned _length;
+  Vector<long long> _snapshot_array;
+  Vector<long long> _prev_array;
+
+  unsigned findFirstDiff(unsigned from) const {
+    return SimdUtils::findFirstDiff(_snapshot_array.getData(),
+                                    _prev_array.getData(),
+                                    from, _snapshot_array.getLength());
+  }
+
+  bool areArraysEqual() const {
+    const unsigned length = _snapshot_array.getLength();
+    return length == _prev_array.getLength() && findFirstDiff(0) == length;
+  }
+
+  // Same rule as for the other arrays (see ArrayData).
+  bool shouldWritePatch(unsigned* changed_num) const {
+    const unsigned length = _snapshot_array.getLength();
+    if (length < GCVIEW_ARRAY_PATCH_MIN_LENGTH ||
+        length != _prev_array.getLength()) {
+      return false;
+    }
+    *changed_num = 0;
+    for (unsigned i = findFirstDiff(0); i < length; i = findFirstDiff(i + 1)) {
+      *changed_num += 1;
+    }
+    return *changed_num * GCVIEW_ARRAY_PATCH_RATIO <= length;
+  }
+
+  volatile long long* getElem(unsigned index) const {
+    GCVIEW_ASSERT(index < _length);
+    return &_array[index];
+  }
+
+  // not copyable
+  AtomicIntArray(const AtomicIntArray&);
+  AtomicIntArray& operator=(const AtomicIntArray&);
+
+protected:
+  virtual void captureValue() {
+    _snapshot_array.resize(_length);
+    for (unsigned i = 0; i < _length; i += 1) {
+      _snapshot_array[i] = AtomicUtils::load(&_array[i]);
+    }
+  }
+
+  virtual bool isValueModified() const { return !areArraysEqual(); }
+
+  // The next captureValue() overwrites all of _snapshot_array, so the
+  // two can be swapped instead of copied.
+  virtual void updatePrevValue() { _prev_array.swap(&_snapshot_array); }
+
+  virtual void writeJSONDataSpecial(JSONWriter* writer) const {
+    JSONArrayWriter y(writer);
+    const unsigned length = _snapshot_array.getLength();
+    for (unsigned i = 0; i < length; i += 1) {
+      y.writeElem(_snapshot_array[i]);
+    }
+  }
+
+  virtual void writeJSONDataUpdate(JSONWriter* writer) const {
+    unsigned changed_num;
+    if (!shouldWritePatch(&changed_num)) {
+      writeJSONDataSpecial(writer);
+      return;
+    }
+
+    JSONObjectWriter x(writer);
+    x.startPair("Patch");
+    JSONArrayWriter y(writer);
+    const unsigned length = _snapshot_array.getLength();
+    for (unsigned i = findFirstDiff(0); i < length; i = findFirstDiff(i + 1)) {
+      y.writeElem(i);
+      y.writeElem(_snapshot_array[i]);
+    }
+  }
+
+  virtual void writeTraceDataSpecial(TraceWriter* writer) const {
+    const unsigned length = _snapshot_array.getLength();
+    writer->writeArrayHeader(length, TraceWriter::FullArray);
+    for (unsigned i = 0; i < length; i += 1) {
+      writer->write(_snapshot_array[i]);
+    }
+  }
+
+  virtual void writeTraceDataUpdate(TraceWriter* writer) const {
+    unsigned changed_num;
+    if (!shouldWritePatch(&changed_num)) {
+      writeTraceDataSpecial(writer);
+      return;
+    }
+
+    writer->writeArrayHeader(changed_num, TraceWriter::PatchArray);
+    unsigned prev_index = 0;
+    const unsigned length = _snapshot_array.getLength();
+    for (unsigned i = findFirstDiff(0); i < length; i = findFirstDiff(i + 1)) {
+      writer->writeLength(i - prev_index);
+      writer->write(_snapshot_array[i]);
+      prev_index = i;
+    }
+  }
+
+  virtual void validate() const { }
+
+public:
+  static const DataType StaticDataType = IntType;
+  static const DataType StaticArrayDataType = IntType;
+  static const bool StaticIsArray = true;
+  static const bool StaticIsConcurrent = true;
+
+  virtual DataKind getKind() const { return AtomicIntArrayKind; }
+
+  // The new elements are 0.
+  void resize(unsigned new_length) {
+    if (new_length == _length) return;
+    volatile long long* new_array = NULL;
+    if (new_length > 0) {
+      new_array = new long long[new_length];
+      GCVIEW_ALLOC_GUARANTEE(new_array);
+      for (unsigned i = 0; i < new_length; i += 1) {
+        new_array[i] = (i < _length) ? _array[i] : 0;
+      }
+    }
+    if (_array != NULL) {
+      delete[] _array;
+    }
+    _array = new_array;
+    _length = new_length;
+  }
+
+  unsigned getLength() const { return _length; }
+
+  void add(unsigned index, long long delta) {
+    AtomicUtils::add(getElem(index), delta);
+  }
+
+  void increment(unsigned index) { add(index, 1); }
+
+  long long get(unsigned index) const {
+    return AtomicUtils::load(getElem(index));
+  }
+
+  void set(unsigned index, long long value) {
+    AtomicUtils::store(getElem(index), value);
+  }
+
+  void reset() {
+    for (unsigned i = 0; i < _length; i += 1) {
+      set(i, 0);
+    }
+  }
+
+  AtomicIntArray(const char* name, const char* group_name = NULL,
+                 Arena* arena = NULL)
+      : Data(name, IntType, true /* is_array */, group_name, arena),
+        _array(NULL), _length(0) {
+    _is_concurrent = true;
+  }
+
+  virtual ~AtomicIntArray() {
+    if (_array != NULL) {
+      delete[] _array;
+    }
+  }
+};
+
+////////// Data Kinds //////////
+
+template <typename D>
+struct DataKindOf {
+  static const DataKind Value = GenericDataKind;
+};
+
+#define GCVIEW_DATA_KIND_OF(__class__, __kind__) \
+template <> \
+struct DataKindOf<__class__> { \
+  static const DataKind Value = __kind__; \
+}
+
+GCVIEW_DATA_KIND_OF(BoolValue,   BoolValueKind);
+GCVIEW_DATA_KIND_OF(ByteValue,   ByteValueKind);
+GCVIEW_DATA_KIND_OF(IntValue,    IntValueKind);
+GCVIEW_DATA_KIND_OF(DoubleValue, DoubleValueKind);
+GCVIEW_DATA_KIND_OF(StringValue, StringValueKind);
+GCVIEW_DATA_KIND_OF(EnumValue,   EnumValueKind);
+GCVIEW_DATA_KIND_OF(BoolArray,   BoolArrayKind);
+GCVIEW_DATA_KIND_OF(ByteArray,   ByteArrayKind);
+GCVIEW_DATA_KIND_OF(IntArray,    IntArrayKind);
+GCVIEW_DATA_KIND_OF(DoubleArray, DoubleArrayKind);
+GCVIEW_DATA_KIND_OF(StringArray, StringArrayKind);
+GCVIEW_DATA_KIND_OF(EnumArray,   EnumArrayKind);
+GCVIEW_DATA_KIND_OF(TileArray,   TileArrayKind);
+GCVIEW_DATA_KIND_OF(HistogramData, HistogramDataKind);
+GCVIEW_DATA_KIND_OF(AggregateValue, AggregateValueKind);
+GCVIEW_DATA_KIND_OF(AtomicIntValue,  AtomicIntValueKind);
+GCVIEW_DATA_KIND_OF(ShardedIntValue, ShardedIntValueKind);
+GCVIEW_DATA_KIND_OF(AtomicIntArray,  AtomicIntArrayKind);
+
+#undef GCVIEW_DATA_KIND_OF
+
 }
 
 #endif // _GCVIEW_DATA_HPP
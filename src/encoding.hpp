@@ -0,0 +1,177 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_ENCODING_HPP
+
+#define _GCVIEW_ENCODING_HPP
+
+#include <string.h>
+
+#include "buffer.hpp"
+#include "utils.hpp"
+
+// Array encodings (see ArrayData::setEncoding())
+//
+// They are only used for array updates whose length has not changed
+// since the previous snapshot (except for XorFloat, which does not
+// depend on the previous snapshot), the metadata always has the full
+// arrays.
+//
+//   Delta    : { "Delta" : [ v0 - p0, v1 - p1, ... ] }
+//   Varint   : { "Varint" : base64( varint( zigzag( v0 - p0 ) ) ... ) }
+//   XorFloat : { "XorFloat" : base64( xor_float( v0 ) ... ) }
+//
+// where vi / pi are the current / previous values of element i.
+//
+// TileArrays always use RLE, which does not depend on the previous
+// snapshot either and is also used in the metadata:
+//
+//   RLE      : { "RLE" : [ v0, n0, v1, n1, ... ] }
+//
+// where run i is ni elements equal to vi.
+//
+//   varint    := LEB128, 7 bits per byte, least significant first
+//   zigzag(d) := ( d << 1 ) ^ ( d >> 63 )
+//   xor_float := x = bits( vi ) ^ bits( vi-1 ), with bits( v-1 ) = 0
+//                header:u8 u8[ 8 - lead - trail ]
+//                header = ( lead << 4 ) | trail, where lead / trail are
+//                the leading / trailing zero bytes of x, followed by
+//                the remaining bytes of x, most significant first;
+//                header = 0x80 (no bytes) when x is 0
+//
+// base64 is the standard alphabet with '=' padding.
+
+namespace gcview {
+
+class EncodingUtils {
+public:
+  static unsigned long long zigZag(long long val) {
+    return ((unsigned long long) val << 1) ^ (unsigned long long) (val >> 63);
+  }
+
+  static void appendVarint(ByteBuffer* buffer, unsigned long long val) {
+    while (val >= 0x80) {
+      buffer->appendByte((unsigned char) (val | 0x80));
+      val >>= 7;
+    }
+    buffer->appendByte((unsigned char) val);
+  }
+
+  // prev_bits is the bit pattern of the previous element and it is
+  // updated to the one of val.
+  static void appendXorFloat(ByteBuffer* buffer, double val,
+                             uint64_t* prev_bits) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    const uint64_t x = bits ^ *prev_bits;
+    *prev_bits = bits;
+    if (x == 0) {
+      buffer->appendByte(0x80);
+      return;
+    }
+    unsigned lead = 0;
+    while (((x >> (56 - 8 * lead)) & 0xff) == 0) {
+      lead += 1;
+    }
+    unsigned trail = 0;
+    while (((x >> (8 * trail)) & 0xff) == 0) {
+      trail += 1;
+    }
+    buffer->appendByte((unsigned char) ((lead << 4) | trail));
+    for (unsigned i = lead; i < 8 - trail; i += 1) {
+      buffer->appendByte((unsigned char) (x >> (56 - 8 * i)));
+    }
+  }
+
+  // Appends the base64 encoding of data, followed by a NULL.
+  static void appendBase64(ByteBuffer* buffer,
+                           const unsigned char* data, size_t length) {
+    static const char* const chars =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    unsigned char* out = buffer->extend((length + 2) / 3 * 4 + 1);
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+      const unsigned val = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+      out[0] = chars[(val >> 18) & 0x3f];
+      out[1] = chars[(val >> 12) & 0x3f];
+      out[2] = chars[(val >> 6) & 0x3f];
+      out[3] = chars[val & 0x3f];
+      out += 4;
+    }
+    if (i < length) {
+      const bool two = (i + 1 < length);
+      const unsigned val = (data[i] << 16) | ((two) ? (data[i + 1] << 8) : 0);
+      out[0] = chars[(val >> 18) & 0x3f];
+      out[1] = chars[(val >> 12) & 0x3f];
+      out[2] = (two) ? chars[(val >> 6) & 0x3f] : '=';
+      out[3] = '=';
+      out += 4;
+    }
+    out[0] = '\0';
+  }
+
+  // Appends the bytes that str (base64, NULL-terminated) encodes.
+  // Returns false if str is not valid base64.
+  static bool appendFromBase64(ByteBuffer* buffer, const char* str) {
+    const size_t length = strlen(str);
+    if (length % 4 != 0) return false;
+    for (size_t i = 0; i < length; i += 4) {
+      unsigned val = 0;
+      unsigned pad_num = 0;
+      for (unsigned j = 0; j < 4; j += 1) {
+        const char c = str[i + j];
+        unsigned bits;
+        if (c >= 'A' && c <= 'Z') {
+          bits = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+          bits = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+          bits = c - '0' + 52;
+        } else if (c == '+') {
+          bits = 62;
+        } else if (c == '/') {
+          bits = 63;
+        } else if (c == '=' && i + 4 == length && j >= 2) {
+          bits = 0;
+          pad_num += 1;
+        } else {
+          return false;
+        }
+        if (pad_num > 0 && c != '=') return false;
+        val = (val << 6) | bits;
+      }
+      const unsigned char bytes[3] = {
+        (unsigned char) (val >> 16),
+        (unsigned char) (val >> 8),
+        (unsigned char) val
+      };
+      buffer->append(bytes, 3 - pad_num);
+    }
+    return true;
+  }
+
+  // Only IntArrays can use Delta / Varint and only DoubleArrays can
+  // use XorFloat; the templates let the other arrays compile.
+  template <typename T>
+  static long long asInt(T) { GCVIEW_UNREACHABLE_0("not an int"); }
+  static long long asInt(int val) { return val; }
+
+  template <typename T>
+  static double asDouble(T) { GCVIEW_UNREACHABLE_0("not a double"); }
+  static double asDouble(double val) { return val; }
+};
+
+}
+
+#endif // _GCVIEW_ENCODING_HPP
@@ -12,10 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits.h>
 #include <string.h>
 
 #include "gcview.hpp"
+#include "index.hpp"
 #include "json.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 namespace gcview {
@@ -29,10 +32,9 @@ unsigned GCview::getEventNum() const {
 }
 
 unsigned GCview::findEventID(const char* event_name) const {
-  for (unsigned i = 0; i < getEventNum(); i += 1) {
-    if (_event_names_array->value(i) == event_name) return i;
-  }
-  GCVIEW_UNREACHABLE_0("event not found");
+  const unsigned event_id = _event_index.find(event_name);
+  GCVIEW_GUARANTEE(event_id != NameIndex::NotFound, "event not found");
+  return event_id;
 }
 
 void GCview::updateModifiedFlags() {
@@ -59,6 +61,12 @@ void GCview::updatePrevValues() {
   });
 }
 
+void GCview::endWindows() {
+  ITERATE_SPACES({
+    the_space->endWindows();
+  });
+}
+
 void GCview::initGCviewSpace(const char* name) {
   Space* space = addSpace("GCview Data");
   StringValue* name_value = space->addData<StringValue>("Name");
@@ -71,9 +79,51 @@ void GCview::initGCviewSpace(const char* name) {
   _total_data_collection_time_value = space->addData<DoubleValue>("Total Data Collection Time");
   _event_names_array = space->addData<StringArray>("Event Name");
   _event_counts_array = space->addData<IntArray>("Event Count");
+  _event_duration_p50_array =
+    space->addData<DoubleArray>("Event Duration P50");
+  _event_duration_p99_array =
+    space->addData<DoubleArray>("Event Duration P99");
+  _event_duration_p999_array =
+    space->addData<DoubleArray>("Event Duration P999");
+  _event_duration_max_array =
+    space->addData<DoubleArray>("Event Duration Max");
+  _pause_budget_value = space->addData<DoubleValue>("Pause Budget");
+  _pause_budget_violation_counts_array =
+    space->addData<IntArray>("Pause Budget Violation Count");
+  _over_pause_budget_value = space->addData<BoolValue>("Over Pause Budget");
+  _last_write_time_value = space->addData<DoubleValue>("Last Write Time");
+  _total_write_time_value = space->addData<DoubleValue>("Total Write Time");
+  _last_write_bytes_value = space->addData<IntValue>("Last Write Bytes");
+}
+
+double GCview::getNowSec(double now_sec, unsigned long long* now_ns) const {
+  if (now_sec >= 0.0 || _clock == NULL) {
+    if (now_ns != NULL) {
+      *now_ns = 0;
+    }
+    return now_sec;
+  }
+  const unsigned long long ns = _clock->getNowNs();
+  if (now_ns != NULL) {
+    *now_ns = ns;
+  }
+  return _start_sec + _clock_base_sec +
+    (double) (ns - _clock_base_ns) / 1.0e9;
 }
 
 void GCview::updateGCviewSpaceData(double collection_time_sec) {
+  // the pending time is measured with a different clock than the
+  // timestamps, it is capped so that the actual elapsed time does not
+  // become negative
+  const double max_pending_sec = _last_timestamp_sec - collection_time_sec -
+                           (double) _total_data_collection_time_value->value();
+  if (_pending_data_collection_time_sec > max_pending_sec) {
+    _pending_data_collection_time_sec =
+                         (max_pending_sec > 0.0) ? max_pending_sec : 0.0;
+  }
+  collection_time_sec += _pending_data_collection_time_sec;
+  _pending_data_collection_time_sec = 0.0;
+
   _elapsed_time_value->value() = _last_timestamp_sec;
   _last_data_collection_time_value->value() = collection_time_sec;
   _total_data_collection_time_value->value() += collection_time_sec;
@@ -83,9 +133,42 @@ void GCview::updateGCviewSpaceData(double collection_time_sec) {
                            (double) _total_data_collection_time_value->value();
 }
 
+void GCview::recordEventDuration(unsigned event_id,
+                                 unsigned long long duration_ns) {
+  _event_duration_histograms[event_id]->record(duration_ns);
+
+  const double budget_sec = (double) _pause_budget_value->value();
+  const bool over_budget = budget_sec > 0.0 &&
+    (double) duration_ns / 1.0e9 > budget_sec;
+  if (over_budget) {
+    _pause_budget_violation_counts_array->value(event_id) += 1;
+  }
+  _over_pause_budget_value->value() = over_budget;
+}
+
+void GCview::updateEventDurationArrays() {
+  const unsigned event_num = getEventNum();
+  for (unsigned i = 0; i < event_num; i += 1) {
+    const Histogram* histogram = _event_duration_histograms[i];
+    const long long count = histogram->getTotalCount();
+    // the percentiles only change when events are recorded
+    if (count == _event_duration_reported_counts[i]) continue;
+    _event_duration_reported_counts[i] = count;
+
+    _event_duration_p50_array->value(i) =
+      (double) histogram->getValueAtPercentile(50.0) / 1.0e9;
+    _event_duration_p99_array->value(i) =
+      (double) histogram->getValueAtPercentile(99.0) / 1.0e9;
+    _event_duration_p999_array->value(i) =
+      (double) histogram->getValueAtPercentile(99.9) / 1.0e9;
+    _event_duration_max_array->value(i) =
+      (double) histogram->getMaxValue() / 1.0e9;
+  }
+}
+
 Space* GCview::addSpace(const char* name) {
-  Space* space = new Space(name);
-  GCVIEW_ALLOC_GUARANTEE(space);
+  Space* space = new (&_arena) Space(name, &_arena);
+  space->_is_in_arena = true;
   return addSpace(space);
 }
 
@@ -93,19 +176,23 @@ Space* GCview::addSpace(Space* space) {
   GCVIEW_GUARANTEE(findSpace(space->getName(), false /* should_succeed */) == NULL,
                   "space with that name already exists");
   unsigned id = _spaces.add(space);
+  _space_index.add(space->getName(), id);
   space->setID(id);
   return space;
 }
 
 Space* GCview::findSpace(const char* name, bool should_succeed) const {
-  ITERATE_SPACES({
-    if (!strcmp(name, the_space->getName())) return the_space;
-  });
+  const unsigned id = _space_index.find(name);
+  if (id != NameIndex::NotFound) {
+    return _spaces[id];
+  }
   GCVIEW_GUARANTEE(!should_succeed, "space not found");
   return NULL;
 }
 
 unsigned GCview::addEvent(const char* event_name) {
+  GCVIEW_GUARANTEE(_thread_num == 0,
+                   "events have to be added before threads register");
   unsigned event_id = _event_value->addEnumMember(event_name);
   GCVIEW_ASSERT(event_id == _event_names_array->getLength());
   GCVIEW_ASSERT(event_id == _event_counts_array->getLength());
@@ -114,6 +201,25 @@ unsigned GCview::addEvent(const char* event_name) {
   _event_names_array->value(event_id) = event_name;
   _event_counts_array->resize(event_id + 1);
   _event_counts_array->value(event_id) = 0;
+  DoubleArray* duration_arrays[] = {
+    _event_duration_p50_array, _event_duration_p99_array,
+    _event_duration_p999_array, _event_duration_max_array
+  };
+  for (unsigned i = 0; i < sizeof(duration_arrays) / sizeof(DoubleArray*);
+       i += 1) {
+    duration_arrays[i]->resize(event_id + 1);
+    duration_arrays[i]->value(event_id) = 0.0;
+  }
+  _pause_budget_violation_counts_array->resize(event_id + 1);
+  _pause_budget_violation_counts_array->value(event_id) = 0;
+  Histogram* histogram =
+    new Histogram(GCVIEW_EVENT_DURATION_SUB_BUCKET_BITS,
+                  GCVIEW_EVENT_DURATION_MAX_VALUE_BITS);
+  GCVIEW_ALLOC_GUARANTEE(histogram);
+  _event_duration_histograms.add(histogram);
+  _event_duration_reported_counts.add(0);
+  // if the name is already there, the first event keeps it
+  _event_index.add(event_name, event_id);
 
   return event_id;
 }
@@ -129,7 +235,7 @@ bool GCview::eventStart(unsigned event_id, double now_sec) {
   _event_value->value() = event_id;
   _total_event_count_value->value() += 1;
   _event_counts_array->value(event_id) += 1;
-  updateLastTimestampSec(now_sec);
+  updateLastTimestampSec(getNowSec(now_sec, &_last_event_start_ns));
   _last_event_start_timestamp_sec = _last_timestamp_sec;
 
   return true;
@@ -138,15 +244,159 @@ bool GCview::eventStart(unsigned event_id, double now_sec) {
 void GCview::eventEnd(double now_sec) {
   GCVIEW_ASSERT(_last_event_start_timestamp_sec >= 0.0);
 
-  updateLastTimestampSec(now_sec);
+  unsigned long long now_ns;
+  updateLastTimestampSec(getNowSec(now_sec, &now_ns));
   GCVIEW_ASSERT(_last_timestamp_sec >= _last_event_start_timestamp_sec);
   const double collection_time_sec =
                         _last_timestamp_sec - _last_event_start_timestamp_sec;
+  // exact if both ends were read from the clock
+  const unsigned long long duration_ns =
+    (now_ns != 0 && _last_event_start_ns != 0 &&
+     now_ns >= _last_event_start_ns)
+    ? now_ns - _last_event_start_ns
+    : (unsigned long long) (collection_time_sec * 1.0e9 + 0.5);
   _last_event_start_timestamp_sec = -1.0;
+  _last_event_start_ns = 0;
+  _last_event_duration_sec = collection_time_sec;
+  recordEventDuration((unsigned) _event_value->value(), duration_ns);
   updateGCviewSpaceData(collection_time_sec);
 }
 
+void GCview::setClock(Clock* clock) {
+  _clock = clock;
+  if (clock != NULL) {
+    _clock_base_ns = clock->getNowNs();
+    _clock_base_sec = _last_timestamp_sec;
+  }
+  _last_event_start_ns = 0;
+}
+
+void GCview::setPauseBudgetSec(double budget_sec) {
+  GCVIEW_ASSERT(budget_sec >= 0.0);
+  _pause_budget_value->value() = budget_sec;
+}
+
+unsigned GCview::registerThread() {
+  const unsigned thread_id = __sync_fetch_and_add(&_thread_num, 1);
+  GCVIEW_GUARANTEE(thread_id < GCVIEW_MAX_THREADS, "too many threads");
+  ThreadEvents* thread_events = new ThreadEvents(getEventNum());
+  GCVIEW_ALLOC_GUARANTEE(thread_events);
+  // publish it only after it is initialized
+  AtomicUtils::storeRelease(&_thread_events[thread_id], thread_events);
+  return thread_id;
+}
+
+StagedIntValue* GCview::addStagedValue(IntValue* value) {
+  GCVIEW_GUARANTEE(_thread_num == 0,
+                   "staged values have to be added before threads register");
+  StagedIntValue* staged_value = new StagedIntValue(value);
+  GCVIEW_ALLOC_GUARANTEE(staged_value);
+  _stagings.add(staged_value);
+  return staged_value;
+}
+
+StagedDoubleValue* GCview::addStagedValue(DoubleValue* value) {
+  GCVIEW_GUARANTEE(_thread_num == 0,
+                   "staged values have to be added before threads register");
+  StagedDoubleValue* staged_value = new StagedDoubleValue(value);
+  GCVIEW_ALLOC_GUARANTEE(staged_value);
+  _stagings.add(staged_value);
+  return staged_value;
+}
+
+void GCview::threadEventStart(unsigned thread_id, unsigned event_id,
+                              double now_sec) {
+  ThreadEvents* thread_events = getThreadEvents(thread_id);
+  GCVIEW_ASSERT(event_id < thread_events->_event_num);
+  GCVIEW_ASSERT(thread_events->_slot->_event_start_timestamp_sec < 0.0);
+
+  const double timestamp_sec = getTimestampSec(getNowSec(now_sec, NULL));
+  thread_events->_slot->_event_start_timestamp_sec = timestamp_sec;
+  volatile unsigned* count = &thread_events->_counts[event_id];
+  AtomicUtils::store(count, AtomicUtils::load(count) + 1);
+  thread_events->updateLastTimestampSec(timestamp_sec);
+}
+
+void GCview::threadEventEnd(unsigned thread_id, double now_sec) {
+  ThreadEvents* thread_events = getThreadEvents(thread_id);
+  GCVIEW_ASSERT(thread_events->_slot->_event_start_timestamp_sec >= 0.0);
+
+  const double timestamp_sec = getTimestampSec(getNowSec(now_sec, NULL));
+  thread_events->_slot->_event_start_timestamp_sec = -1.0;
+  thread_events->updateLastTimestampSec(timestamp_sec);
+}
+
+void GCview::mergeStaged() {
+  const unsigned thread_num = getThreadNum();
+  if (thread_num == 0) return;
+
+  GCVIEW_ARRAY_ITERATE(&_stagings, Staging*, staging, {
+    staging->merge(thread_num);
+  });
+
+  double last_timestamp_sec = _last_timestamp_sec;
+  for (unsigned i = 0; i < thread_num; i += 1) {
+    ThreadEvents* thread_events =
+      AtomicUtils::loadAcquire(&_thread_events[i]);
+    // registered, but not published yet
+    if (thread_events == NULL) continue;
+
+    unsigned total_delta = 0;
+    for (unsigned e = 0; e < thread_events->_event_num; e += 1) {
+      const unsigned count = AtomicUtils::load(&thread_events->_counts[e]);
+      const unsigned delta = count - thread_events->_merged_counts[e];
+      if (delta > 0) {
+        thread_events->_merged_counts[e] = count;
+        _event_counts_array->value(e) += (int) delta;
+        total_delta += delta;
+      }
+    }
+    if (total_delta > 0) {
+      _total_event_count_value->value() += (int) total_delta;
+    }
+    const double timestamp_sec =
+      AtomicUtils::load(&thread_events->_slot->_last_timestamp_sec);
+    if (timestamp_sec > last_timestamp_sec) {
+      last_timestamp_sec = timestamp_sec;
+    }
+  }
+  if (last_timestamp_sec > _last_timestamp_sec) {
+    _last_timestamp_sec = last_timestamp_sec;
+    _elapsed_time_value->value() = _last_timestamp_sec;
+    _actual_elapsed_time_value->value() = _last_timestamp_sec -
+                           (double) _total_data_collection_time_value->value();
+  }
+}
+
+void GCview::prepareSnapshot() {
+  mergeStaged();
+  updateEventDurationArrays();
+  ITERATE_SPACES({
+    the_space->captureValues();
+  });
+}
+
+void GCview::addDataCollectionTime(double sec) {
+  GCVIEW_ASSERT(sec >= 0.0);
+  _pending_data_collection_time_sec += sec;
+}
+
+void GCview::endWrite(unsigned long long start_ns, unsigned long long bytes) {
+  if (_clock == NULL) return;
+  const unsigned long long end_ns = _clock->getNowNs();
+  const double sec =
+    (end_ns > start_ns) ? (double) (end_ns - start_ns) / 1.0e9 : 0.0;
+  _last_write_time_value->value() = sec;
+  _total_write_time_value->value() += sec;
+  _last_write_bytes_value->value() =
+    (bytes < (unsigned long long) INT_MAX) ? (int) bytes : INT_MAX;
+  addDataCollectionTime(sec);
+}
+
 void GCview::writeJSONMetadata(JSONWriter* writer) {
+  const unsigned long long start_ns = startWrite();
+  const unsigned long long start_bytes = writer->getBytesWritten();
+  prepareSnapshot();
   validate();
   updateModifiedFlags(true);
 
@@ -167,12 +417,49 @@ void GCview::writeJSONMetadata(JSONWriter* writer) {
   }
   writer->flush();
 
+  TraceIndexWriter* index_writer = writer->getIndexWriter();
+  if (index_writer != NULL) {
+    index_writer->startRecord(_spaces.getLength());
+    ITERATE_SPACES({
+      index_writer->setSpaceModified(the_space->_id);
+    });
+    index_writer->endRecord(TraceIndexWriter::MetadataRecord,
+                            writer->getSinkOffset(),
+                            (unsigned) _event_value->value(),
+                            _last_timestamp_sec);
+  }
+
   updatePrevValues();
+  snapshotTaken();
+  endWrite(start_ns, writer->getBytesWritten() - start_bytes);
 }
 
-void GCview::writeJSONData(JSONWriter* writer) {
+void GCview::writeJSONData(JSONWriter* writer, bool keyframe) {
+  const unsigned long long start_ns = startWrite();
+  const unsigned long long start_bytes = writer->getBytesWritten();
+  prepareSnapshot();
   validate();
-  updateModifiedFlags();
+  TraceIndexWriter* index_writer = writer->getIndexWriter();
+  if (index_writer != NULL && index_writer->isKeyframeDue()) {
+    keyframe = true;
+  }
+  if (keyframe && index_writer == NULL) {
+    updateModifiedFlags(true);
+  } else {
+    updateModifiedFlags();
+    if (index_writer != NULL) {
+      // the index has the spaces that changed, even for keyframes
+      index_writer->startRecord(_spaces.getLength());
+      ITERATE_SPACES({
+        if (the_space->isModified()) {
+          index_writer->setSpaceModified(the_space->_id);
+        }
+      });
+    }
+    if (keyframe) {
+      updateModifiedFlags(true);
+    }
+  }
 
   {
     JSONObjectWriter x(writer);
@@ -182,7 +469,7 @@ void GCview::writeJSONData(JSONWriter* writer) {
       JSONArrayWriter y(writer);
       ITERATE_SPACES({
         y.startElem();
-        the_space->writeJSONData(writer);
+        the_space->writeJSONData(writer, keyframe);
       });
     } else {
       writer->writeNull();
@@ -190,7 +477,71 @@ void GCview::writeJSONData(JSONWriter* writer) {
   }
   writer->flush();
 
+  if (index_writer != NULL) {
+    index_writer->endRecord((keyframe) ? TraceIndexWriter::KeyframeRecord
+                                       : TraceIndexWriter::DataRecord,
+                            writer->getSinkOffset(),
+                            (unsigned) _event_value->value(),
+                            _last_timestamp_sec);
+  }
+
   updatePrevValues();
+  endWindows();
+  snapshotTaken();
+  endWrite(start_ns, writer->getBytesWritten() - start_bytes);
+}
+
+void GCview::writeTraceMetadata(TraceWriter* writer) {
+  const unsigned long long start_ns = startWrite();
+  const unsigned long long start_bytes = writer->getBytesWritten();
+  prepareSnapshot();
+  validate();
+  updateModifiedFlags(true);
+
+  writer->startRecord(TraceWriter::MetadataRecord);
+  writer->writeLength(_spaces.getLength());
+  ITERATE_SPACES({
+    the_space->writeTraceMetadata(writer);
+  });
+  writer->endRecord();
+  writer->flush();
+
+  updatePrevValues();
+  snapshotTaken();
+  endWrite(start_ns, writer->getBytesWritten() - start_bytes);
+}
+
+void GCview::writeTraceData(TraceWriter* writer, bool keyframe) {
+  const unsigned long long start_ns = startWrite();
+  const unsigned long long start_bytes = writer->getBytesWritten();
+  prepareSnapshot();
+  validate();
+  if (keyframe) {
+    updateModifiedFlags(true);
+  } else {
+    updateModifiedFlags();
+  }
+
+  writer->startRecord(TraceWriter::DataRecord);
+  unsigned modified_num = 0;
+  ITERATE_SPACES({
+    if (the_space->isModified()) {
+      modified_num += 1;
+    }
+  });
+  writer->writeLength(modified_num);
+  ITERATE_SPACES({
+    if (the_space->isModified()) {
+      the_space->writeTraceData(writer, keyframe);
+    }
+  });
+  writer->endRecord();
+  writer->flush();
+
+  updatePrevValues();
+  endWindows();
+  snapshotTaken();
+  endWrite(start_ns, writer->getBytesWritten() - start_bytes);
 }
 
 void GCview::validate() const {
@@ -198,19 +549,46 @@ void GCview::validate() const {
 }
 
 GCview::GCview(const char* name, double now_sec)
-    : _modified(false), _start_sec(now_sec),
-      _last_timestamp_sec(0.0), _last_event_start_timestamp_sec(-1.0), 
+    : _space_index(&_arena), _event_index(&_arena),
+      _modified(false), _start_sec(now_sec),
+      _last_timestamp_sec(0.0), _last_event_start_timestamp_sec(-1.0),
+      _last_event_duration_sec(0.0),
+      _pending_data_collection_time_sec(0.0),
+      _clock(NULL), _clock_base_ns(0), _clock_base_sec(0.0),
+      _last_event_start_ns(0),
       _event_value(NULL), _total_event_count_value(NULL),
       _elapsed_time_value(NULL), _actual_elapsed_time_value(NULL),
       _last_data_collection_time_value(NULL),
       _total_data_collection_time_value(NULL),
-      _event_names_array(NULL), _event_counts_array(NULL) {
+      _event_names_array(NULL), _event_counts_array(NULL),
+      _event_duration_p50_array(NULL), _event_duration_p99_array(NULL),
+      _event_duration_p999_array(NULL), _event_duration_max_array(NULL),
+      _pause_budget_value(NULL), _pause_budget_violation_counts_array(NULL),
+      _over_pause_budget_value(NULL), _last_write_time_value(NULL),
+      _total_write_time_value(NULL), _last_write_bytes_value(NULL),
+      _thread_num(0), _snapshot_policy(NULL) {
+  for (unsigned i = 0; i < GCVIEW_MAX_THREADS; i += 1) {
+    _thread_events[i] = NULL;
+  }
   updateLastTimestampSec(now_sec);
   initGCviewSpace(name);
 }
 
 GCview::~GCview() {
-  ITERATE_SPACES({ delete the_space; });
+  ITERATE_SPACES({
+    if (the_space->_is_in_arena) {
+      the_space->~Space();
+    } else {
+      delete the_space;
+    }
+  });
+  GCVIEW_ARRAY_ITERATE(&_stagings, Staging*, staging, { delete staging; });
+  for (unsigned i = 0; i < getThreadNum(); i += 1) {
+    delete _thread_events[i];
+  }
+  GCVIEW_ARRAY_ITERATE(&_event_duration_histograms, Histogram*, histogram, {
+    delete histogram;
+  });
 }
 
 }
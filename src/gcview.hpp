@@ -16,22 +16,50 @@
 
 #define _GCVIEW_GCVIEW_HPP
 
+#include "arena.hpp"
 #include "array.hpp"
+#include "clock.hpp"
+#include "histogram.hpp"
+#include "name_index.hpp"
+#include "policy.hpp"
+#include "schema.hpp"
 #include "space.hpp"
+#include "staging.hpp"
+
+// The layout of the histograms of the event durations (in ns): 2^3 = 8
+// buckets per power of two (i.e., a percentile is at most 12.5% above
+// the exact one), for durations up to 2^40 ns (about 18 minutes).
+#define GCVIEW_EVENT_DURATION_SUB_BUCKET_BITS  3
+#define GCVIEW_EVENT_DURATION_MAX_VALUE_BITS  40
 
 namespace gcview {
 
 class JSONWriter;
+class TraceWriter;
 
 class GCview {
 private:
+  // The spaces that addSpace() creates, their data and all their names
+  // (see Space::addData()). It is destroyed last.
+  Arena _arena;
   Array<Space*> _spaces;
+  NameIndex _space_index;
+  NameIndex _event_index;
 
   bool _modified;
   const double _start_sec;
   double _last_timestamp_sec;
   double _last_event_start_timestamp_sec;
-  
+  double _last_event_duration_sec;
+  double _pending_data_collection_time_sec;
+
+  // see setClock(); the clock time (in ns) of the last eventStart(), 0
+  // if it was given its time
+  Clock* _clock;
+  unsigned long long _clock_base_ns;
+  double _clock_base_sec;
+  unsigned long long _last_event_start_ns;
+
   EnumValue* _event_value;
   IntValue* _total_event_count_value;
   DoubleValue* _elapsed_time_value;
@@ -40,6 +68,33 @@ private:
   DoubleValue* _total_data_collection_time_value;
   StringArray* _event_names_array;
   IntArray* _event_counts_array;
+  DoubleArray* _event_duration_p50_array;
+  DoubleArray* _event_duration_p99_array;
+  DoubleArray* _event_duration_p999_array;
+  DoubleArray* _event_duration_max_array;
+  DoubleValue* _pause_budget_value;
+  IntArray* _pause_budget_violation_counts_array;
+  BoolValue* _over_pause_budget_value;
+  DoubleValue* _last_write_time_value;
+  DoubleValue* _total_write_time_value;
+  IntValue* _last_write_bytes_value;
+
+  // per event, the durations of the events that ended, and the number
+  // of them when the duration arrays were last updated
+  Array<Histogram*> _event_duration_histograms;
+  Array<long long> _event_duration_reported_counts;
+
+  // per-thread staging (see staging.hpp)
+  Array<Staging*> _stagings;
+  ThreadEvents* volatile _thread_events[GCVIEW_MAX_THREADS];
+  volatile unsigned _thread_num;
+
+  SnapshotPolicy* _snapshot_policy;
+
+  // now_sec, or the time of the clock if it is not given (i.e., < 0.0)
+  // and there is one. *now_ns is the clock time, or 0 if the clock was
+  // not read.
+  double getNowSec(double now_sec, unsigned long long* now_ns) const;
 
   double getTimestampSec(const double now_sec) const {
     return (now_sec > _start_sec) ? now_sec - _start_sec : 0.0;
@@ -53,28 +108,138 @@ private:
   }
 
   unsigned getEventNum() const;
-  unsigned findEventID(const char* event_name) const;
 
   void updateModifiedFlags();
   void updateModifiedFlags(bool modified);
   void updatePrevValues();
+  void endWindows();
 
   void initGCviewSpace(const char* name);
   void updateGCviewSpaceData(double collection_time_sec);
+  void recordEventDuration(unsigned event_id,
+                           unsigned long long duration_ns);
+  void updateEventDurationArrays();
+  // The overhead of the write methods below, only measured when there
+  // is a clock.
+  unsigned long long startWrite() const {
+    return (_clock != NULL) ? _clock->getNowNs() : 0;
+  }
+  void endWrite(unsigned long long start_ns, unsigned long long bytes);
+
+  unsigned getThreadNum() const {
+    const unsigned thread_num = AtomicUtils::load(&_thread_num);
+    return (thread_num < GCVIEW_MAX_THREADS) ? thread_num : GCVIEW_MAX_THREADS;
+  }
+  ThreadEvents* getThreadEvents(unsigned thread_id) const {
+    GCVIEW_ASSERT(thread_id < getThreadNum());
+    ThreadEvents* thread_events = _thread_events[thread_id];
+    GCVIEW_ASSERT(thread_events != NULL);
+    return thread_events;
+  }
+  void mergeStaged();
+  // Called before each snapshot: merges the staged values / thread
+  // events and captures the concurrent data.
+  void prepareSnapshot();
+  void snapshotTaken() {
+    if (_snapshot_policy != NULL) {
+      _snapshot_policy->snapshotTaken(_total_event_count_value->get(),
+                                      _last_timestamp_sec);
+    }
+  }
 
 public:
   Space* addSpace(const char* space_name);
   Space* addSpace(Space* space);
+  // A space with a static layout L (see schema.hpp), in the arena.
+  template <typename L>
+  StaticSpace<L>* addStaticSpace(const char* space_name) {
+    StaticSpace<L>* space = new (&_arena) StaticSpace<L>(space_name, &_arena);
+    space->_is_in_arena = true;
+    addSpace(space);
+    return space;
+  }
   Space* findSpace(const char* name, bool should_succeeded = true) const;
 
   unsigned addEvent(const char* event_name);
+  // The event ID can be passed to eventStart() instead of the name.
+  unsigned findEventID(const char* event_name) const;
 
   bool eventStart(const char* event_name, double now_sec = -1.0);
   bool eventStart(unsigned event_id, double now_sec = -1.0);
   void eventEnd(double now_sec = -1.0);
+  // The duration of the last event that ended.
+  double getLastEventDurationSec() const { return _last_event_duration_sec; }
+
+  // The durations of the events that ended (see eventEnd()), in ns, per
+  // event. Recording one does not allocate: the histograms are created
+  // by addEvent(). The "Event Duration P50 / P99 / P999 / Max" arrays
+  // of the GCview Data space are updated from them before each
+  // snapshot. The thread events (see below) are not recorded.
+  const Histogram& getEventDurationHistogram(unsigned event_id) const {
+    GCVIEW_ASSERT(event_id < getEventNum());
+    return *_event_duration_histograms[event_id];
+  }
+
+  // The pause time SLO: each event that ends after taking longer than
+  // the budget counts as a violation in the "Pause Budget Violation
+  // Count" array, and "Over Pause Budget" is true while the last event
+  // that ended did. 0.0 : no budget.
+  void setPauseBudgetSec(double budget_sec);
+  double getPauseBudgetSec() const { return _pause_budget_value->get(); }
+  bool isOverPauseBudget() const { return _over_pause_budget_value->get(); }
+
+  // Per-thread staging (see staging.hpp). registerThread() can be
+  // called concurrently by the threads that want their own slots and
+  // returns the ID they pass to the methods below and to
+  // StagedValue::add(). The thread events only update the event
+  // counts and the elapsed time, and each thread can have one event in
+  // flight, independently of the other threads and of eventStart().
+  unsigned registerThread();
+  StagedIntValue* addStagedValue(IntValue* value);
+  StagedDoubleValue* addStagedValue(DoubleValue* value);
+  void threadEventStart(unsigned thread_id, unsigned event_id,
+                        double now_sec = -1.0);
+  void threadEventEnd(unsigned thread_id, double now_sec = -1.0);
+
+  // The clock that eventStart(), eventEnd() and the thread events read
+  // when they are not given the time, continuing from the last
+  // timestamp. It is not owned by the GCview, NULL removes it. With a
+  // clock, the durations of the events are measured in integer ns, and
+  // the GCview measures its own overhead: the time each write method
+  // takes is charged to the data collection time of the next event
+  // (see addDataCollectionTime()), and it and the bytes written (before
+  // any compression) go into the "Last Write Time", "Total Write Time"
+  // and "Last Write Bytes" data of the GCview Data space, which the
+  // next record has.
+  void setClock(Clock* clock);
+  Clock* getClock() const { return _clock; }
+
+  // Charges time that was spent collecting data outside an
+  // eventStart / eventEnd pair (e.g., taking a snapshot after
+  // eventEnd) to the data collection time of the next event.
+  void addDataCollectionTime(double sec);
+
+  // See policy.hpp. The policy is not owned by the GCview, NULL
+  // removes it. Without a policy, a snapshot is always due.
+  void setSnapshotPolicy(SnapshotPolicy* policy) { _snapshot_policy = policy; }
+  SnapshotPolicy* getSnapshotPolicy() const { return _snapshot_policy; }
+  bool isSnapshotDue() const {
+    return _snapshot_policy == NULL ||
+      _snapshot_policy->isSnapshotDue(_total_event_count_value->get(),
+                                      _last_timestamp_sec);
+  }
 
+  // If the writer has an index writer (see index.hpp), both add an
+  // entry to the index and writeJSONData() writes a keyframe whenever
+  // the index asks for one. A keyframe is a data record with the full
+  // values of all data, so a reader can start from it without having
+  // seen the preceding records.
   void writeJSONMetadata(JSONWriter* writer);
-  void writeJSONData(JSONWriter* writer);
+  void writeJSONData(JSONWriter* writer, bool keyframe = false);
+
+  // Binary equivalents of the above (see trace.hpp).
+  void writeTraceMetadata(TraceWriter* writer);
+  void writeTraceData(TraceWriter* writer, bool keyframe = false);
 
   void validate() const;
 
@@ -0,0 +1,72 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_HANDLE_HPP
+
+#define _GCVIEW_HANDLE_HPP
+
+#include "gcview.hpp"
+#include "space.hpp"
+#include "utils.hpp"
+
+namespace gcview {
+
+// A data of class D (e.g., IntValue) that is looked up by name once,
+// typically when the spaces are set up, so that updating it on every
+// event does not involve any name lookups:
+//
+//   DataHandle<IntValue> size(gcview, "Old Space", "Size");
+//   ...
+//   size->value() = old_space_size;
+
+template <typename D>
+class DataHandle {
+private:
+  D* _data;
+
+public:
+  bool isResolved() const { return _data != NULL; }
+
+  void resolve(Space* space, const char* data_name) {
+    GCVIEW_ASSERT(space != NULL);
+    _data = space->findTypedData<D>(data_name);
+  }
+
+  void resolve(GCview* gcview, const char* space_name, const char* data_name) {
+    GCVIEW_ASSERT(gcview != NULL);
+    resolve(gcview->findSpace(space_name), data_name);
+  }
+
+  D* get() const {
+    GCVIEW_ASSERT(isResolved());
+    return _data;
+  }
+
+  D* operator->() const { return get(); }
+  D& operator*() const { return *get(); }
+
+  DataHandle() : _data(NULL) { }
+  DataHandle(D* data) : _data(data) { }
+  DataHandle(Space* space, const char* data_name) : _data(NULL) {
+    resolve(space, data_name);
+  }
+  DataHandle(GCview* gcview, const char* space_name, const char* data_name)
+      : _data(NULL) {
+    resolve(gcview, space_name, data_name);
+  }
+};
+
+}
+
+#endif // _GCVIEW_HANDLE_HPP
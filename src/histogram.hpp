@@ -0,0 +1,215 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_HISTOGRAM_HPP
+
+#define _GCVIEW_HISTOGRAM_HPP
+
+#include <math.h>
+
+#include "utils.hpp"
+#include "vector.hpp"
+
+// The default layout of a Histogram: 2^2 = 4 buckets per power of two
+// (i.e., a bucket is at most 25% wide), for values up to 2^32.
+#define GCVIEW_HISTOGRAM_SUB_BUCKET_BITS  2
+#define GCVIEW_HISTOGRAM_MAX_VALUE_BITS  32
+
+namespace gcview {
+
+// Counts of non-negative integer values (e.g., sizes in bytes,
+// durations in ns) in log-linear buckets, as HDR histograms do. With
+// S sub-bucket bits, the values below 2^S each have their own bucket,
+// and each power of two range [2^e, 2^(e+1)) above that is split into
+// 2^S buckets of the same width. The bucket of a value is computed from
+// the position of its highest set bit, i.e., in constant time, and the
+// values from 2^M up (M is the max value bits) all go to the last one.
+//
+// Recording a value does not allocate, and histograms with the same
+// layout can be merged, so that each thread can record into its own
+// histogram and the histograms can be merged into a HistogramData
+// (see data.hpp) before each snapshot.
+class Histogram {
+private:
+  unsigned _sub_bucket_bits;
+  unsigned _max_value_bits;
+  Vector<long long> _counts;
+  long long _total_count;
+  unsigned long long _max_value;
+
+  static unsigned countLeadingZeros(unsigned long long value) {
+    GCVIEW_ASSERT(value != 0);
+#if defined(__GNUC__)
+    return (unsigned) __builtin_clzll(value);
+#else
+    unsigned res = 0;
+    while ((value & (1ULL << 63)) == 0) {
+      value <<= 1;
+      res += 1;
+    }
+    return res;
+#endif
+  }
+
+  // not copyable
+  Histogram(const Histogram&);
+  Histogram& operator=(const Histogram&);
+
+public:
+  static unsigned getBucketNum(unsigned sub_bucket_bits,
+                               unsigned max_value_bits) {
+    return (max_value_bits - sub_bucket_bits + 1) << sub_bucket_bits;
+  }
+
+  // Sets the layout and clears the counts.
+  void configure(unsigned sub_bucket_bits, unsigned max_value_bits) {
+    GCVIEW_GUARANTEE(sub_bucket_bits <= 8 &&
+                     sub_bucket_bits < max_value_bits &&
+                     max_value_bits <= 64,
+                     "unsupported histogram layout");
+    _sub_bucket_bits = sub_bucket_bits;
+    _max_value_bits = max_value_bits;
+    _counts.resize(getBucketNum(sub_bucket_bits, max_value_bits));
+    reset();
+  }
+
+  unsigned getSubBucketBits() const { return _sub_bucket_bits; }
+  unsigned getMaxValueBits() const { return _max_value_bits; }
+  unsigned getBucketNum() const { return _counts.getLength(); }
+
+  unsigned getBucketIndex(unsigned long long value) const {
+    if (value < (1ULL << _sub_bucket_bits)) {
+      return (unsigned) value;
+    }
+    const unsigned shift = 63 - countLeadingZeros(value) - _sub_bucket_bits;
+    const unsigned index =
+      (shift << _sub_bucket_bits) + (unsigned) (value >> shift);
+    const unsigned bucket_num = _counts.getLength();
+    return (index < bucket_num) ? index : bucket_num - 1;
+  }
+
+  // The smallest value in the bucket.
+  unsigned long long getBucketLowerBound(unsigned index) const {
+    GCVIEW_ASSERT(index < _counts.getLength());
+    const unsigned sub_bucket_num = 1u << _sub_bucket_bits;
+    if (index < sub_bucket_num) {
+      return index;
+    }
+    const unsigned shift = (index >> _sub_bucket_bits) - 1;
+    return (unsigned long long) (index - (shift << _sub_bucket_bits))
+      << shift;
+  }
+
+  // The largest value in the bucket (for the last bucket, the largest
+  // value that does not go to it only because it is out of range).
+  unsigned long long getBucketUpperBound(unsigned index) const {
+    if (index + 1 < _counts.getLength()) {
+      return getBucketLowerBound(index + 1) - 1;
+    }
+    return (_max_value_bits == 64) ? ~0ULL
+                                   : (1ULL << _max_value_bits) - 1;
+  }
+
+  // e.g., "4", "8-9" or "4096-5119", and "3758096384+" for the last
+  // bucket of the default layout (which also has the values out of
+  // range).
+  void formatBucketLabel(unsigned index, char* buffer,
+                         size_t buffer_size) const {
+    const unsigned long long lower = getBucketLowerBound(index);
+    if (index + 1 == _counts.getLength()) {
+      Utils::formatStr(buffer, buffer_size, "%llu+", lower);
+    } else {
+      const unsigned long long upper = getBucketUpperBound(index);
+      if (upper == lower) {
+        Utils::formatStr(buffer, buffer_size, "%llu", lower);
+      } else {
+        Utils::formatStr(buffer, buffer_size, "%llu-%llu", lower, upper);
+      }
+    }
+  }
+
+  void record(unsigned long long value, long long count = 1) {
+    _counts[getBucketIndex(value)] += count;
+    _total_count += count;
+    if (value > _max_value) {
+      _max_value = value;
+    }
+  }
+
+  // Adds the counts of other, which should have the same layout.
+  void merge(const Histogram& other) {
+    GCVIEW_GUARANTEE(other._sub_bucket_bits == _sub_bucket_bits &&
+                     other._max_value_bits == _max_value_bits,
+                     "merging histograms of different layouts");
+    const unsigned bucket_num = _counts.getLength();
+    for (unsigned i = 0; i < bucket_num; i += 1) {
+      _counts[i] += other._counts[i];
+    }
+    _total_count += other._total_count;
+    if (other._max_value > _max_value) {
+      _max_value = other._max_value;
+    }
+  }
+
+  void reset() {
+    const unsigned bucket_num = _counts.getLength();
+    for (unsigned i = 0; i < bucket_num; i += 1) {
+      _counts[i] = 0;
+    }
+    _total_count = 0;
+    _max_value = 0;
+  }
+
+  long long getCount(unsigned index) const { return _counts[index]; }
+  const Vector<long long>& getCounts() const { return _counts; }
+  long long getTotalCount() const { return _total_count; }
+  // 0 if no values were recorded.
+  unsigned long long getMaxValue() const { return _max_value; }
+
+  // The largest value of the bucket that has the given percentile
+  // (e.g., 99.9) of the values, capped at the max value, or 0 if no
+  // values were recorded. It is at most a bucket width above the exact
+  // percentile.
+  unsigned long long getValueAtPercentile(double percentile) const {
+    if (_total_count <= 0) {
+      return 0;
+    }
+    long long target =
+      (long long) ceil((percentile / 100.0) * (double) _total_count);
+    if (target < 1) {
+      target = 1;
+    }
+    long long count = 0;
+    const unsigned bucket_num = _counts.getLength();
+    for (unsigned i = 0; i < bucket_num; i += 1) {
+      count += _counts[i];
+      if (count >= target) {
+        const unsigned long long upper = getBucketUpperBound(i);
+        return (upper < _max_value) ? upper : _max_value;
+      }
+    }
+    return _max_value;
+  }
+
+  Histogram(unsigned sub_bucket_bits = GCVIEW_HISTOGRAM_SUB_BUCKET_BITS,
+            unsigned max_value_bits = GCVIEW_HISTOGRAM_MAX_VALUE_BITS)
+      : _sub_bucket_bits(0), _max_value_bits(0),
+        _total_count(0), _max_value(0) {
+    configure(sub_bucket_bits, max_value_bits);
+  }
+};
+
+}
+
+#endif // _GCVIEW_HISTOGRAM_HPP
@@ -0,0 +1,194 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "index.hpp"
+
+namespace gcview {
+
+static const char* const HexDigits = "0123456789abcdef";
+
+static int getHexDigitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+const char* TraceIndexWriter::getRecordKindStr(RecordKind kind) {
+  switch (kind) {
+  case MetadataRecord: return "Metadata";
+  case KeyframeRecord: return "Keyframe";
+  case DataRecord:     return "Data";
+  default:
+    GCVIEW_UNREACHABLE_0("unknown record kind");
+  }
+}
+
+void TraceIndexWriter::endRecord(RecordKind kind,
+                                 unsigned long long end_offset,
+                                 unsigned event_id, double timestamp_sec) {
+  GCVIEW_ASSERT(end_offset >= _offset);
+  char timestamp[Utils::FormatBufferSize];
+  Utils::formatDouble(timestamp, timestamp_sec);
+  fprintf(_fout, "{ \"Record\" : %llu, \"Kind\" : \"%s\", "
+          "\"Offset\" : %llu, \"Length\" : %llu, "
+          "\"EventID\" : %u, \"Timestamp\" : %s, \"Spaces\" : \"",
+          _record_num, getRecordKindStr(kind),
+          _offset, end_offset - _offset, event_id, timestamp);
+  const unsigned space_num = _modified_spaces.getLength();
+  for (unsigned i = 0; i < space_num; i += 4) {
+    unsigned digit = 0;
+    for (unsigned b = 0; b < 4 && i + b < space_num; b += 1) {
+      if (_modified_spaces.isSet(i + b)) {
+        digit |= 1 << b;
+      }
+    }
+    fputc(HexDigits[digit], _fout);
+  }
+  fputs("\" }\n", _fout);
+  // so that the index keeps up with the trace, which is flushed
+  // after every record
+  fflush(_fout);
+
+  _record_num += 1;
+  _offset = end_offset;
+  if (kind == DataRecord) {
+    _since_keyframe += 1;
+  } else {
+    _since_keyframe = 0;
+  }
+}
+
+TraceIndexWriter::TraceIndexWriter(const char* file_name,
+                                   unsigned keyframe_interval)
+    : _fout(NULL), _keyframe_interval(keyframe_interval),
+      _since_keyframe(0), _record_num(0), _offset(0) {
+  GCVIEW_ASSERT(file_name != NULL);
+  _fout = fopen(file_name, "w");
+  GCVIEW_GUARANTEE(_fout != NULL, "could not open file");
+}
+
+TraceIndexWriter::~TraceIndexWriter() {
+  fclose(_fout);
+}
+
+bool TraceIndex::Entry::isSpaceModified(unsigned space_id) const {
+  const char* spaces = Utils::getStrOrEmptyStr(_spaces);
+  const size_t digit_index = space_id / 4;
+  if (digit_index >= strlen(spaces)) return false;
+  const int digit = getHexDigitValue(spaces[digit_index]);
+  return (digit & (1 << (space_id % 4))) != 0;
+}
+
+void TraceIndex::malformed(unsigned long long line_num,
+                           const char* msg) const {
+  char buffer[256];
+  Utils::formatStr(buffer, 256, "malformed index at line %llu : %s",
+                   line_num, msg);
+  Utils::raiseError(buffer, __FILE__, __LINE__);
+}
+
+unsigned long long TraceIndex::findKeyframe(unsigned long long record) const {
+  GCVIEW_ASSERT(record < getEntryNum());
+  while (getEntry(record)->getKind() == TraceIndexWriter::DataRecord) {
+    GCVIEW_ASSERT(record > 0);
+    record -= 1;
+  }
+  return record;
+}
+
+unsigned long long TraceIndex::findMetadata(unsigned long long record) const {
+  GCVIEW_ASSERT(record < getEntryNum());
+  while (getEntry(record)->getKind() != TraceIndexWriter::MetadataRecord) {
+    GCVIEW_ASSERT(record > 0);
+    record -= 1;
+  }
+  return record;
+}
+
+TraceIndex::TraceIndex(const char* file_name) {
+  GCVIEW_ASSERT(file_name != NULL);
+  FILE* fin = fopen(file_name, "r");
+  GCVIEW_GUARANTEE(fin != NULL, "could not open file");
+
+  char* line = NULL;
+  size_t line_capacity = 0;
+  ssize_t line_length;
+  unsigned long long snapshot_num = 0;
+  while ((line_length = getline(&line, &line_capacity, fin)) > 0) {
+    const unsigned long long line_num = _entries.getLength() + 1;
+    if (line[line_length - 1] != '\n') {
+      // the last line of an index that was not closed properly
+      break;
+    }
+
+    unsigned long long record;
+    char kind[16];
+    Entry entry;
+    int spaces_start = -1;
+    sscanf(line, "{ \"Record\" : %llu, \"Kind\" : \"%15[A-Za-z]\", "
+           "\"Offset\" : %llu, \"Length\" : %llu, "
+           "\"EventID\" : %u, \"Timestamp\" : %lf, \"Spaces\" : \"%n",
+           &record, kind, &entry._offset, &entry._length,
+           &entry._event_id, &entry._timestamp_sec, &spaces_start);
+    if (spaces_start < 0) {
+      malformed(line_num, "unexpected format");
+    }
+    if (record != _entries.getLength()) {
+      malformed(line_num, "unexpected record number");
+    }
+    if (strcmp(kind, "Metadata") == 0) {
+      entry._kind = TraceIndexWriter::MetadataRecord;
+    } else if (strcmp(kind, "Keyframe") == 0) {
+      entry._kind = TraceIndexWriter::KeyframeRecord;
+    } else if (strcmp(kind, "Data") == 0) {
+      entry._kind = TraceIndexWriter::DataRecord;
+    } else {
+      malformed(line_num, "unknown record kind");
+    }
+    if (record == 0 && entry._kind != TraceIndexWriter::MetadataRecord) {
+      malformed(line_num, "data before metadata");
+    }
+
+    char* spaces = line + spaces_start;
+    char* spaces_end = spaces;
+    while (getHexDigitValue(*spaces_end) >= 0) {
+      spaces_end += 1;
+    }
+    if (strcmp(spaces_end, "\" }\n") != 0) {
+      malformed(line_num, "unexpected format");
+    }
+    *spaces_end = '\0';
+    entry._spaces = Utils::cloneStr(spaces);
+
+    entry._snapshot_num = snapshot_num;
+    if (entry._kind != TraceIndexWriter::MetadataRecord) {
+      snapshot_num += 1;
+    }
+    _entries.add(entry);
+  }
+
+  free(line);
+  fclose(fin);
+}
+
+TraceIndex::~TraceIndex() {
+  for (unsigned i = 0; i < _entries.getLength(); i += 1) {
+    delete[] _entries[i]._spaces;
+  }
+}
+
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_INDEX_HPP
+
+#define _GCVIEW_INDEX_HPP
+
+#include <stdio.h>
+
+#include "array.hpp"
+#include "bitmap.hpp"
+#include "utils.hpp"
+
+// A data record is written as a keyframe after this many records that
+// are not keyframes (see TraceIndexWriter).
+#define GCVIEW_INDEX_KEYFRAME_INTERVAL 64
+
+// Index sidecar of a JSON trace
+//
+// It has one line per record of the trace, in the same order, each of
+// them a JSON object:
+//
+//   { "Record" : 12, "Kind" : "Data", "Offset" : 4096, "Length" : 210,
+//     "EventID" : 3, "Timestamp" : 1.25, "Spaces" : "5" }
+//
+//   Kind      : "Metadata", "Keyframe" or "Data". A keyframe is a data
+//               record with the full values of all data, the state of
+//               the GCview after any record can be reconstructed from
+//               the closest metadata / keyframe record before it and
+//               the data records in between.
+//   Offset    : where the frame of the record starts in the trace file
+//               (the compressed offset, if the trace was written with a
+//               GzipSink); a TraceReader can start reading at it (see
+//               TraceReader::seek()).
+//   Length    : the length of the frame, i.e., up to the next one.
+//   EventID   : the ID of the last event that was started.
+//   Timestamp : the time of the last event start / end.
+//   Spaces    : the spaces whose data changed since the previous
+//               record, as a bitmap in hex. Digit i (from the left)
+//               has the bits of spaces 4i to 4i+3, the least
+//               significant one for space 4i. Metadata records have
+//               all spaces.
+//
+// The index is written after each record has been flushed, so it never
+// points past the end of the trace.
+
+namespace gcview {
+
+class TraceIndexWriter {
+public:
+  typedef enum {
+    MetadataRecord,
+    KeyframeRecord,
+    DataRecord
+  } RecordKind;
+
+  static const char* getRecordKindStr(RecordKind kind);
+
+private:
+  FILE* _fout;
+  const unsigned _keyframe_interval;
+  unsigned _since_keyframe;
+  unsigned long long _record_num;
+  // where the frame of the next record starts
+  unsigned long long _offset;
+  Bitmap _modified_spaces;
+
+  // not copyable
+  TraceIndexWriter(const TraceIndexWriter&);
+  TraceIndexWriter& operator=(const TraceIndexWriter&);
+
+public:
+  // A keyframe_interval of 0 only writes keyframes when the caller
+  // asks for them (see GCview::writeJSONData()).
+  TraceIndexWriter(const char* file_name,
+                   unsigned keyframe_interval = GCVIEW_INDEX_KEYFRAME_INTERVAL);
+
+  unsigned long long getRecordNum() const { return _record_num; }
+
+  bool isKeyframeDue() const {
+    return _keyframe_interval > 0 && _since_keyframe >= _keyframe_interval;
+  }
+
+  // GCview calls these for each record it writes: startRecord() and
+  // setSpaceModified() before writing it, endRecord() after flushing
+  // it, with the sink offset at which it ended.
+  void startRecord(unsigned space_num) {
+    _modified_spaces.resize(space_num);
+    _modified_spaces.clear();
+  }
+  void setSpaceModified(unsigned space_id) {
+    _modified_spaces.set(space_id);
+  }
+  void endRecord(RecordKind kind, unsigned long long end_offset,
+                 unsigned event_id, double timestamp_sec);
+
+  ~TraceIndexWriter();
+};
+
+// An index sidecar, as read back for random access into its trace
+// (see TraceReader::readRecord()). An index that ends with an
+// incomplete line (e.g., of a process that crashed) is read up to its
+// last complete line.
+class TraceIndex {
+public:
+  class Entry {
+    friend class TraceIndex;
+
+  private:
+    TraceIndexWriter::RecordKind _kind;
+    unsigned long long _offset;
+    unsigned long long _length;
+    // data records before this one
+    unsigned long long _snapshot_num;
+    unsigned _event_id;
+    double _timestamp_sec;
+    const char* _spaces;
+
+  public:
+    TraceIndexWriter::RecordKind getKind() const { return _kind; }
+    unsigned long long getOffset() const { return _offset; }
+    unsigned long long getLength() const { return _length; }
+    unsigned long long getSnapshotNum() const { return _snapshot_num; }
+    unsigned getEventID() const { return _event_id; }
+    double getTimestampSec() const { return _timestamp_sec; }
+    bool isSpaceModified(unsigned space_id) const;
+  };
+
+private:
+  Array<Entry> _entries;
+
+  void malformed(unsigned long long line_num, const char* msg) const;
+
+  // not copyable
+  TraceIndex(const TraceIndex&);
+  TraceIndex& operator=(const TraceIndex&);
+
+public:
+  TraceIndex(const char* file_name);
+
+  unsigned long long getEntryNum() const { return _entries.getLength(); }
+  const Entry* getEntry(unsigned long long record) const {
+    return &_entries[(unsigned) record];
+  }
+
+  // The closest metadata / keyframe record at or before record.
+  unsigned long long findKeyframe(unsigned long long record) const;
+  // The closest metadata record at or before record.
+  unsigned long long findMetadata(unsigned long long record) const;
+
+  ~TraceIndex();
+};
+
+}
+
+#endif // _GCVIEW_INDEX_HPP
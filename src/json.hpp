@@ -17,7 +17,10 @@
 #define _GCVIEW_JSON_HPP
 
 #include <stdio.h>
+#include <string.h>
 
+#include "buffer.hpp"
+#include "sink.hpp"
 #include "utils.hpp"
 
 namespace gcview {
@@ -25,6 +28,10 @@ namespace gcview {
 class JSONScope;
 class JSONObjectWriter;
 class JSONArrayWriter;
+class TraceIndexWriter;
+
+// The default size of the output buffer of a buffered JSONWriter.
+#define GCVIEW_JSON_WRITER_BUFFER_SIZE (1024 * 1024)
 
 class JSONWriter {
   friend class JSONScope;
@@ -32,53 +39,94 @@ class JSONWriter {
   friend class JSONArrayWriter;
 
 private:
-  FILE*       _fout;
-  const char* _file_name;
+  OutputSink* _sink;
+  bool        _owns_sink;
   unsigned    _active_objects;
   unsigned    _active_arrays;
   unsigned    _active_with_newlines;
 
+  // When _buffer is not NULL all output is appended to it and it is
+  // only handed to the sink when it fills up or when flush() is called.
+  char*       _buffer;
+  size_t      _buffer_capacity;
+  size_t      _buffer_length;
+  unsigned long long _bytes_written;
+
+  TraceIndexWriter* _index_writer;
+
+  // Reused by the arrays that write their updates encoded (see
+  // ArrayData::writeJSONDataEncoded()): the encoded bytes and their
+  // base64 string. They only allocate until they have grown to the
+  // largest update.
+  ByteBuffer _scratch_bytes;
+  ByteBuffer _scratch_str;
+
+  void flushBuffer() {
+    if (_buffer_length > 0) {
+      _sink->write(_buffer, _buffer_length);
+      _buffer_length = 0;
+    }
+  }
+
+  void baseWrite(const char* str, size_t length) {
+    GCVIEW_ASSERT(str != NULL);
+    _bytes_written += (unsigned long long) length;
+    if (_buffer != NULL) {
+      if (length > _buffer_capacity - _buffer_length) {
+        flushBuffer();
+        if (length > _buffer_capacity) {
+          _sink->write(str, length);
+          return;
+        }
+      }
+      memcpy(_buffer + _buffer_length, str, length);
+      _buffer_length += length;
+    } else {
+      _sink->write(str, length);
+    }
+  }
+
   void baseWrite(const char* str) {
     GCVIEW_ASSERT(str != NULL);
-    fprintf(_fout, "%s", str);
+    baseWrite(str, strlen(str));
   }
 
   void writeSeparator(unsigned count, bool add_newline) {
     if (count > 0) {
-      baseWrite(",");
+      baseWrite(",", 1);
     }
     if (add_newline) {
       writeNewline();
       unsigned count = _active_with_newlines - 1;
       for (unsigned i = 0; i < count; i += 1) {
-        baseWrite(" ");
+        baseWrite(" ", 1);
       }
     }
-    baseWrite(" ");
+    baseWrite(" ", 1);
   }
 
   void writeNewline() {
-    baseWrite("\n");
+    baseWrite("\n", 1);
   }
 
   void startObject() {
     _active_objects += 1;
-    baseWrite("{");
+    baseWrite("{", 1);
   }
 
   void endObject() {
-    baseWrite(" }");
+    baseWrite(" }", 2);
     GCVIEW_ASSERT(_active_objects > 0);
     _active_objects -= 1;
   }
 
   void startArray() {
     _active_arrays += 1;
-    baseWrite("[");
+    baseWrite("[", 1);
   }
 
   void endArray() {
-    baseWrite(" ]");
+    baseWrite(" ]", 2);
     GCVIEW_ASSERT(_active_arrays > 0);
     _active_arrays -= 1;
   }
@@ -89,75 +137,126 @@ private:
     _active_with_newlines -= 1;
   }
 
+  void initBuffer(size_t buffer_size) {
+    if (buffer_size > 0) {
+      _buffer = new char[buffer_size];
+      GCVIEW_ALLOC_GUARANTEE(_buffer);
+      _buffer_capacity = buffer_size;
+    }
+  }
+
 public:
-  JSONWriter(FILE* fout = stdout)
-      : _fout(fout), _file_name(NULL),
-        _active_objects(0), _active_arrays(0), _active_with_newlines(0) { }
+  // A buffer_size of 0 writes every token straight to stdio, any
+  // other value makes the writer buffer its output (see
+  // GCVIEW_JSON_WRITER_BUFFER_SIZE for a reasonable size).
+  JSONWriter(FILE* fout = stdout, size_t buffer_size = 0)
+      : _sink(new FileSink(fout)), _owns_sink(true),
+        _active_objects(0), _active_arrays(0), _active_with_newlines(0),
+        _buffer(NULL), _buffer_capacity(0), _buffer_length(0),
+        _bytes_written(0), _index_writer(NULL) {
+    GCVIEW_ALLOC_GUARANTEE(_sink);
+    initBuffer(buffer_size);
+  }
+
+  JSONWriter(const char* file_name, size_t buffer_size = 0)
+      : _sink(new FileSink(file_name)), _owns_sink(true),
+        _active_objects(0), _active_arrays(0), _active_with_newlines(0),
+        _buffer(NULL), _buffer_capacity(0), _buffer_length(0),
+        _bytes_written(0), _index_writer(NULL) {
+    GCVIEW_ALLOC_GUARANTEE(_sink);
+    initBuffer(buffer_size);
+  }
+
+  // The sink is not owned by the writer and has to outlive it (e.g., a
+  // GzipSink, see sink.hpp). Every flush() ends a frame of the sink.
+  JSONWriter(OutputSink* sink, size_t buffer_size = 0)
+      : _sink(sink), _owns_sink(false),
+        _active_objects(0), _active_arrays(0), _active_with_newlines(0),
+        _buffer(NULL), _buffer_capacity(0), _buffer_length(0),
+        _bytes_written(0), _index_writer(NULL) {
+    GCVIEW_ASSERT(sink != NULL);
+    initBuffer(buffer_size);
+  }
+
+  bool isBuffered() const { return _buffer != NULL; }
 
-  JSONWriter(const char* file_name)
-      : _fout(NULL), _file_name(file_name),
-        _active_objects(0), _active_arrays(0), _active_with_newlines(0) {
-    GCVIEW_ASSERT(file_name != NULL);
-    _fout = fopen(file_name, "w");
-    GCVIEW_GUARANTEE(_fout != NULL, "could not open file");
+  // Both are empty when returned and only valid until the next call.
+  ByteBuffer* getScratchBytes() {
+    _scratch_bytes.clear();
+    return &_scratch_bytes;
+  }
+  ByteBuffer* getScratchStr() {
+    _scratch_str.clear();
+    return &_scratch_str;
+  }
+
+  // Before any compression by the sink.
+  unsigned long long getBytesWritten() const { return _bytes_written; }
+  // After any compression by the sink, only valid right after flush().
+  unsigned long long getSinkOffset() const {
+    GCVIEW_ASSERT(_buffer_length == 0);
+    return _sink->getOffset();
   }
 
+  // When set, GCview adds an entry to the index for every record it
+  // writes with this writer and writes keyframes when the index asks
+  // for them (see index.hpp). The index writer is not owned by the
+  // writer.
+  void setIndexWriter(TraceIndexWriter* index_writer) {
+    _index_writer = index_writer;
+  }
+  TraceIndexWriter* getIndexWriter() const { return _index_writer; }
+
   void writeNull() {
-    baseWrite("null");
+    baseWrite("null", 4);
   }
 
   void write(bool val) {
     if (!val) {
-      baseWrite("false");
+      baseWrite("false", 5);
     } else {
-      baseWrite("true");
+      baseWrite("true", 4);
     }
   }
 
   void write(unsigned char val) {
-    char buffer[8];
-    Utils::formatStr(buffer, 8, "%hhu", val);
-    baseWrite((const char*) buffer);
+    char buffer[Utils::FormatBufferSize];
+    baseWrite(buffer, Utils::formatUnsigned(buffer, val));
   }
 
   void write(int val) {
-    char buffer[16];
-    Utils::formatStr(buffer, 16, "%d", val);
-    baseWrite((const char*) buffer);
+    char buffer[Utils::FormatBufferSize];
+    baseWrite(buffer, Utils::formatInt(buffer, val));
   }
 
   void write(unsigned val) {
-    char buffer[16];
-    Utils::formatStr(buffer, 16, "%u", val);
-    baseWrite((const char*) buffer);
+    char buffer[Utils::FormatBufferSize];
+    baseWrite(buffer, Utils::formatUnsigned(buffer, val));
+  }
+
+  void write(long long val) {
+    char buffer[Utils::FormatBufferSize];
+    baseWrite(buffer, Utils::formatInt(buffer, val));
   }
 
   void write(double val) {
-    char buffer[64];
-    Utils::formatStr(buffer, 64, "%1.10f", val);
-    unsigned index = strlen(buffer) - 1;
-    while (buffer[index] == '0') {
-      index -= 1;
-    }
-    if (buffer[index] == '.') {
-      index -= 1;
-    }
-    buffer[index + 1] = '\0';
-    baseWrite((const char*) buffer);
+    char buffer[Utils::FormatBufferSize];
+    baseWrite(buffer, Utils::formatDouble(buffer, val));
   }
 
   void write(const char* str) {
     if (str == NULL) {
-      baseWrite("\"\"");
+      baseWrite("\"\"", 2);
     } else {
-      baseWrite("\"");
+      baseWrite("\"", 1);
       baseWrite(str);
-      baseWrite("\"");
+      baseWrite("\"", 1);
     }
   }
 
   void flush() {
-    fflush(_fout);
+    flushBuffer();
+    _sink->endFrame();
   }
 
   ~JSONWriter() {
@@ -165,8 +264,13 @@ public:
     GCVIEW_ASSERT(_active_arrays == 0);
     GCVIEW_ASSERT(_active_with_newlines == 0);
 
-    if (_file_name != NULL) {
-      fclose(_fout);
+    flushBuffer();
+    if (_buffer != NULL) {
+      delete[] _buffer;
+    }
+
+    if (_owns_sink) {
+      delete _sink;
     }
   }
 };
@@ -207,7 +311,7 @@ public:
   void startPair(const char* str) {
     writeSeparator();
     _writer->write(str);
-    _writer->baseWrite(" : ");
+    _writer->baseWrite(" : ", 3);
   }
 
   template <typename T>
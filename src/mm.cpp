@@ -21,18 +21,24 @@
 namespace gcview {
 
 size_t MM::_curr_allocated_count = 0;
+unsigned long long MM::_total_allocated_count = 0;
 unsigned long long MM::_total_allocated_bytes = 0;
 unsigned long long MM::_total_array_allocated_bytes = 0;
 
 void* MM::alloc(size_t size_bytes, bool is_array) {
   void *res = malloc(size_bytes);
 
+  // the counters are atomically updated, since the AsyncWriter thread
+  // allocates too
   if (res != NULL) {
-    _curr_allocated_count += 1;
+    __sync_fetch_and_add(&_curr_allocated_count, 1);
+    __sync_fetch_and_add(&_total_allocated_count, 1ULL);
     if (!is_array) {
-      _total_allocated_bytes += (unsigned long long) size_bytes;
+      __sync_fetch_and_add(&_total_allocated_bytes,
+                           (unsigned long long) size_bytes);
     } else {
-      _total_array_allocated_bytes += (unsigned long long) size_bytes;
+      __sync_fetch_and_add(&_total_array_allocated_bytes,
+                           (unsigned long long) size_bytes);
     }
   }
 
@@ -50,7 +56,7 @@ void MM::free(void* ptr, bool is_array) {
   }
 
   if (ptr != NULL) {
-    _curr_allocated_count -= 1;
+    __sync_fetch_and_sub(&_curr_allocated_count, 1);
   }
 
   ::free(ptr);
@@ -68,6 +74,7 @@ void MM::print_report() {
   printf("\n");
   printf("## GCview allocations\n");
   printf("##   allocated count       %20ld\n", _curr_allocated_count);
+  printf("##   total alloc count     %20lld\n", _total_allocated_count);
   printf("##   total allocated       %20lld bytes\n", _total_allocated_bytes);
   printf("##   total array allocated %20lld bytes\n", _total_array_allocated_bytes);
 }
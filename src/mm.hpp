@@ -18,8 +18,13 @@
 
 #include <stdlib.h>
 
+// Both can be set to 1 from the build.
+#ifndef GCVIEW_ENABLE_MM_SUMMARY
 #define GCVIEW_ENABLE_MM_SUMMARY    0
+#endif // GCVIEW_ENABLE_MM_SUMMARY
+#ifndef GCVIEW_ENABLE_MM_TRACING
 #define GCVIEW_ENABLE_MM_TRACING    0
+#endif // GCVIEW_ENABLE_MM_TRACING
 
 #if GCVIEW_ENABLE_MM_SUMMARY
 
@@ -28,6 +33,7 @@ namespace gcview {
 class MM {
 private:
   static size_t _curr_allocated_count;
+  static unsigned long long _total_allocated_count;
   static unsigned long long _total_allocated_bytes;
   static unsigned long long _total_array_allocated_bytes;
 
@@ -38,6 +44,14 @@ public:
   static void* alloc(size_t size_bytes, bool is_array);
   static void free(void* ptr, bool is_array);
   static void print_report();
+
+  static bool isEnabled() { return true; }
+  static unsigned long long getTotalAllocatedCount() {
+    return _total_allocated_count;
+  }
+  static unsigned long long getCurrAllocatedCount() {
+    return (unsigned long long) _curr_allocated_count;
+  }
 };
 
 }
@@ -58,6 +72,18 @@ inline void operator delete[](void* ptr) {
   gcview::MM::free(ptr, true /* is_array */);
 }
 
+// With sized deallocation (the default since C++14), delete calls
+// these instead of the ones above.
+#if defined(__cpp_sized_deallocation)
+inline void operator delete(void* ptr, size_t) {
+  gcview::MM::free(ptr, false /* is_array */);
+}
+
+inline void operator delete[](void* ptr, size_t) {
+  gcview::MM::free(ptr, true /* is_array */);
+}
+#endif // defined(__cpp_sized_deallocation)
+
 #else // GCVIEW_ENABLE_MM_SUMMARY
 
 namespace gcview {
@@ -65,6 +91,11 @@ namespace gcview {
 class MM {
 public:
   static void print_report() { }
+
+  // There are no counts without GCVIEW_ENABLE_MM_SUMMARY.
+  static bool isEnabled() { return false; }
+  static unsigned long long getTotalAllocatedCount() { return 0; }
+  static unsigned long long getCurrAllocatedCount() { return 0; }
 };
 
 }
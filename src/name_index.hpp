@@ -0,0 +1,153 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_NAME_INDEX_HPP
+
+#define _GCVIEW_NAME_INDEX_HPP
+
+#include <string.h>
+
+#include "arena.hpp"
+#include "utils.hpp"
+
+namespace gcview {
+
+// Maps names to IDs (e.g., the IDs of the spaces of a GCview). It is
+// an open-addressing hash table with linear probing that is kept at
+// most half full. The index keeps its own copies of the names, in the
+// arena if it has one. A NULL name is the same as the empty string.
+class NameIndex {
+public:
+  static const unsigned NotFound = (unsigned) -1;
+
+private:
+  typedef struct {
+    const char* _name;
+    unsigned    _hash;
+    unsigned    _id;
+  } Entry;
+
+  static const unsigned InitialCapacity = 16;
+
+  Arena* const _arena;
+  Entry*   _entries;
+  unsigned _capacity;
+  unsigned _length;
+
+  static unsigned hash(const char* name) {
+    // FNV-1a
+    unsigned res = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*) name; *p != '\0';
+         p += 1) {
+      res ^= *p;
+      res *= 16777619u;
+    }
+    return res;
+  }
+
+  static Entry* allocEntries(unsigned capacity) {
+    Entry* entries = new Entry[capacity];
+    GCVIEW_ALLOC_GUARANTEE(entries);
+    for (unsigned i = 0; i < capacity; i += 1) {
+      entries[i]._name = NULL;
+      entries[i]._hash = 0;
+      entries[i]._id = NotFound;
+    }
+    return entries;
+  }
+
+  // Returns the entry with that name, or the empty entry where it
+  // should go.
+  Entry* findEntry(const char* name, unsigned name_hash) const {
+    const unsigned mask = _capacity - 1;
+    unsigned index = name_hash & mask;
+    while (true) {
+      Entry* entry = &_entries[index];
+      if (entry->_id == NotFound ||
+          (entry->_hash == name_hash && strcmp(entry->_name, name) == 0)) {
+        return entry;
+      }
+      index = (index + 1) & mask;
+    }
+  }
+
+  void grow() {
+    Entry* old_entries = _entries;
+    const unsigned old_capacity = _capacity;
+    _capacity = 2 * old_capacity;
+    _entries = allocEntries(_capacity);
+    for (unsigned i = 0; i < old_capacity; i += 1) {
+      if (old_entries[i]._id != NotFound) {
+        *findEntry(old_entries[i]._name, old_entries[i]._hash) = old_entries[i];
+      }
+    }
+    delete[] old_entries;
+  }
+
+  // not copyable
+  NameIndex(const NameIndex&);
+  NameIndex& operator=(const NameIndex&);
+
+public:
+  unsigned getLength() const { return _length; }
+
+  // Returns the ID of the name, or NotFound.
+  unsigned find(const char* name) const {
+    name = Utils::getStrOrEmptyStr(name);
+    return findEntry(name, hash(name))->_id;
+  }
+
+  // Returns false, without adding it, if the name is already there.
+  bool add(const char* name, unsigned id) {
+    GCVIEW_ASSERT(id != NotFound);
+    if (2 * (_length + 1) > _capacity) {
+      grow();
+    }
+    name = Utils::getStrOrEmptyStr(name);
+    const unsigned name_hash = hash(name);
+    Entry* entry = findEntry(name, name_hash);
+    if (entry->_id != NotFound) {
+      return false;
+    }
+    const size_t length = strlen(name);
+    char* name_copy = (_arena != NULL) ? (char*) _arena->alloc(length + 1)
+                                       : new char[length + 1];
+    GCVIEW_ALLOC_GUARANTEE(name_copy);
+    memcpy(name_copy, name, length + 1);
+    entry->_name = name_copy;
+    entry->_hash = name_hash;
+    entry->_id = id;
+    _length += 1;
+    return true;
+  }
+
+  explicit NameIndex(Arena* arena = NULL)
+      : _arena(arena), _entries(allocEntries(InitialCapacity)),
+        _capacity(InitialCapacity), _length(0) { }
+
+  ~NameIndex() {
+    if (_arena == NULL) {
+      for (unsigned i = 0; i < _capacity; i += 1) {
+        if (_entries[i]._id != NotFound) {
+          delete[] _entries[i]._name;
+        }
+      }
+    }
+    delete[] _entries;
+  }
+};
+
+}
+
+#endif // _GCVIEW_NAME_INDEX_HPP
@@ -0,0 +1,166 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_POLICY_HPP
+
+#define _GCVIEW_POLICY_HPP
+
+#include "array.hpp"
+#include "data.hpp"
+
+// Snapshot policy
+//
+// Taking a snapshot after every event can cost more than the events
+// themselves when there are thousands of them per second. A
+// SnapshotPolicy set on a GCview (see GCview::setSnapshotPolicy())
+// decides whether a snapshot is due:
+//
+//   if (gcview.isSnapshotDue()) {
+//     gcview.writeJSONData(&writer);
+//   }
+//
+// A snapshot is due when all the conditions that were set hold:
+//
+//   setEventInterval(n)      : at least n events started since the last
+//                              snapshot.
+//   setMinIntervalSec(sec)   : at least sec seconds (of GCview time)
+//                              passed since the last snapshot.
+//   watch(value, threshold)  : one of the watched values changed by at
+//                              least threshold since the last snapshot.
+//
+// Skipping snapshots does not lose updates: the next snapshot writes
+// all data that changed since the previous one, and the event counts
+// (including the "Event Count" array) count every event. Only the
+// intermediate values are lost. The caller should take a last snapshot
+// before closing the trace, whether it is due or not.
+//
+// The decision only compares a few numbers, so it can be made inline
+// after every event.
+
+namespace gcview {
+
+class SnapshotPolicy {
+private:
+  template <typename V, typename T>
+  struct Watched {
+    V* _value;
+    T  _threshold;
+    T  _snapshot_value;
+  };
+
+  typedef Watched<IntValue, int>       WatchedInt;
+  typedef Watched<DoubleValue, double> WatchedDouble;
+
+  unsigned _event_interval;
+  double _min_interval_sec;
+  Array<WatchedInt> _watched_ints;
+  Array<WatchedDouble> _watched_doubles;
+
+  long long _snapshot_event_count;
+  double _snapshot_timestamp_sec;
+  unsigned long long _snapshot_num;
+
+  template <typename W>
+  static bool hasChanged(const Array<W>* watched) {
+    const unsigned length = watched->getLength();
+    for (unsigned i = 0; i < length; i += 1) {
+      const W& w = (*watched)[i];
+      const double delta =
+        (double) w._value->get() - (double) w._snapshot_value;
+      if (delta >= (double) w._threshold || -delta >= (double) w._threshold) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // not copyable
+  SnapshotPolicy(const SnapshotPolicy&);
+  SnapshotPolicy& operator=(const SnapshotPolicy&);
+
+public:
+  // 0 or 1 : every event.
+  void setEventInterval(unsigned event_interval) {
+    _event_interval = event_interval;
+  }
+  unsigned getEventInterval() const { return _event_interval; }
+
+  // 0.0 : no limit.
+  void setMinIntervalSec(double min_interval_sec) {
+    GCVIEW_ASSERT(min_interval_sec >= 0.0);
+    _min_interval_sec = min_interval_sec;
+  }
+  double getMinIntervalSec() const { return _min_interval_sec; }
+
+  // The threshold should be positive.
+  void watch(IntValue* value, int threshold) {
+    GCVIEW_ASSERT(value != NULL);
+    GCVIEW_ASSERT(threshold > 0);
+    WatchedInt w;
+    w._value = value;
+    w._threshold = threshold;
+    w._snapshot_value = value->get();
+    _watched_ints.add(w);
+  }
+  void watch(DoubleValue* value, double threshold) {
+    GCVIEW_ASSERT(value != NULL);
+    GCVIEW_ASSERT(threshold > 0.0);
+    WatchedDouble w;
+    w._value = value;
+    w._threshold = threshold;
+    w._snapshot_value = value->get();
+    _watched_doubles.add(w);
+  }
+
+  // The number of snapshots taken while the policy was set.
+  unsigned long long getSnapshotNum() const { return _snapshot_num; }
+
+  // GCview passes its total event count and last timestamp.
+  bool isSnapshotDue(long long event_count, double timestamp_sec) const {
+    if (_event_interval > 1 &&
+        event_count - _snapshot_event_count < (long long) _event_interval) {
+      return false;
+    }
+    if (_min_interval_sec > 0.0 && _snapshot_num > 0 &&
+        timestamp_sec - _snapshot_timestamp_sec < _min_interval_sec) {
+      return false;
+    }
+    if (_watched_ints.getLength() + _watched_doubles.getLength() > 0) {
+      return hasChanged(&_watched_ints) || hasChanged(&_watched_doubles);
+    }
+    return true;
+  }
+
+  // GCview calls it after each snapshot, due or not.
+  void snapshotTaken(long long event_count, double timestamp_sec) {
+    _snapshot_event_count = event_count;
+    _snapshot_timestamp_sec = timestamp_sec;
+    _snapshot_num += 1;
+    for (unsigned i = 0; i < _watched_ints.getLength(); i += 1) {
+      _watched_ints[i]._snapshot_value = _watched_ints[i]._value->get();
+    }
+    for (unsigned i = 0; i < _watched_doubles.getLength(); i += 1) {
+      _watched_doubles[i]._snapshot_value = _watched_doubles[i]._value->get();
+    }
+  }
+
+  SnapshotPolicy()
+      : _event_interval(1), _min_interval_sec(0.0),
+        _snapshot_event_count(0), _snapshot_timestamp_sec(0.0),
+        _snapshot_num(0) { }
+};
+
+}
+
+#endif // _GCVIEW_POLICY_HPP
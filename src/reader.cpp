@@ -0,0 +1,937 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "encoding.hpp"
+#include "index.hpp"
+#include "reader.hpp"
+
+namespace gcview {
+
+void ReaderData::clearElems() {
+  if (_data_type == Data::StringType) {
+    for (unsigned i = 0; i < _elems.getLength(); i += 1) {
+      if (_elems[i]._str != NULL) {
+        delete[] _elems[i]._str;
+      }
+    }
+  }
+  _elems.clear();
+}
+
+void ReaderData::setStr(unsigned index, const char* str) {
+  if (_elems[index]._str != NULL) {
+    delete[] _elems[index]._str;
+  }
+  _elems[index]._str = Utils::cloneStr(str);
+}
+
+ReaderData::ReaderData(unsigned id, const char* name)
+    : _id(id), _name(Utils::cloneStr(name)), _group_name(NULL),
+      _data_type(Data::IntType), _is_array(false),
+      _encoding(Data::PlainEncoding), _modified(true) { }
+
+ReaderData::~ReaderData() {
+  clearElems();
+  GCVIEW_ARRAY_ITERATE(&_enum_members, const char*, member, {
+    delete[] member;
+  });
+  GCVIEW_ARRAY_ITERATE(&_labels, const char*, label, {
+    delete[] label;
+  });
+  delete[] _group_name;
+  delete[] _name;
+}
+
+ReaderData* ReaderSpace::findData(const char* name) const {
+  const unsigned id = _data_index.find(name);
+  return (id != NameIndex::NotFound) ? _data[id] : NULL;
+}
+
+ReaderSpace::ReaderSpace(unsigned id, const char* name)
+    : _id(id), _name(Utils::cloneStr(name)), _modified(true) { }
+
+ReaderSpace::~ReaderSpace() {
+  GCVIEW_ARRAY_ITERATE(&_data, ReaderData*, data, { delete data; });
+  delete[] _name;
+}
+
+size_t TraceReader::readInput(char* buffer, size_t length) {
+#if GCVIEW_ENABLE_ZLIB
+  // a truncated gzip member reads as the end of the input
+  const int res = gzread(_gzin, buffer, (unsigned) length);
+  return (res > 0) ? (size_t) res : 0;
+#else // GCVIEW_ENABLE_ZLIB
+  return fread(buffer, 1, length, _fin);
+#endif // GCVIEW_ENABLE_ZLIB
+}
+
+bool TraceReader::refill(size_t length) {
+  size_t available = _end - _pos;
+  if (available >= length) return true;
+  if (_eof) return false;
+
+  GCVIEW_ASSERT(length <= GCVIEW_TRACE_READER_BUFFER_SIZE);
+  _buffer_offset += (unsigned long long) (_pos - _buffer);
+  memmove(_buffer, _pos, available);
+  _pos = _buffer;
+  while (available < length && !_eof) {
+    const size_t read_length =
+      readInput(_buffer + available,
+                GCVIEW_TRACE_READER_BUFFER_SIZE - available);
+    if (read_length == 0) {
+      _eof = true;
+    }
+    available += read_length;
+  }
+  _end = _buffer + available;
+  return available >= length;
+}
+
+void TraceReader::malformed(const char* msg) const {
+  char buffer[256];
+  Utils::formatStr(buffer, 256, "malformed trace at byte %llu : %s",
+                   getBytesRead(), msg);
+  Utils::raiseError(buffer, __FILE__, __LINE__);
+}
+
+void TraceReader::expect(char c) {
+  if (peek() != (unsigned char) c) {
+    char buffer[32];
+    Utils::formatStr(buffer, 32, "expected '%c'", c);
+    malformed(buffer);
+  }
+  _pos += 1;
+}
+
+void TraceReader::expectLiteral(const char* literal, size_t length) {
+  if (!refill(length) || memcmp(_pos, literal, length) != 0) {
+    malformed("unexpected literal");
+  }
+  _pos += length;
+}
+
+bool TraceReader::parseBool() {
+  if (peek() == 't') {
+    expectLiteral("true", 4);
+    return true;
+  }
+  expectLiteral("false", 5);
+  return false;
+}
+
+long long TraceReader::parseInt() {
+  peek();
+  refill(GCVIEW_TRACE_READER_MAX_TOKEN_LENGTH);
+  const char* p = _pos;
+  const bool negative = (p < _end && *p == '-');
+  if (negative) {
+    p += 1;
+  }
+  const char* digits = p;
+  unsigned long long val = 0;
+  while (p < _end && *p >= '0' && *p <= '9') {
+    val = 10 * val + (unsigned long long) (*p - '0');
+    p += 1;
+  }
+  if (p == digits || p - digits > 19 ||
+      (p < _end && (*p == '.' || *p == 'e' || *p == 'E'))) {
+    malformed("integer expected");
+  }
+  _pos = p;
+  return (negative) ? -(long long) val : (long long) val;
+}
+
+double TraceReader::parseDoubleSlow(const char* start, const char* end) {
+  char buffer[GCVIEW_TRACE_READER_MAX_TOKEN_LENGTH + 1];
+  const size_t length = end - start;
+  memcpy(buffer, start, length);
+  buffer[length] = '\0';
+  char* str_end;
+  const double res = strtod(buffer, &str_end);
+  if (str_end != buffer + length) {
+    malformed("number expected");
+  }
+  return res;
+}
+
+double TraceReader::parseDouble() {
+  // Up to 15 significant digits and a power of ten up to 10^22 are
+  // exact as doubles, so a single multiplication / division gives the
+  // correctly rounded result; GCview writes at most 10 decimals, so
+  // this covers nearly all the values in a trace.
+  static const double powers[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  peek();
+  refill(GCVIEW_TRACE_READER_MAX_TOKEN_LENGTH);
+  const char* start = _pos;
+  const char* p = start;
+  const bool negative = (p < _end && *p == '-');
+  if (negative) {
+    p += 1;
+  }
+  unsigned long long mantissa = 0;
+  unsigned digit_num = 0;
+  int exponent = 0;
+  while (p < _end && *p >= '0' && *p <= '9') {
+    mantissa = 10 * mantissa + (unsigned long long) (*p - '0');
+    digit_num += (mantissa > 0) ? 1 : 0;
+    p += 1;
+  }
+  bool fast = (p > start + ((negative) ? 1 : 0));
+  if (p < _end && *p == '.') {
+    p += 1;
+    while (p < _end && *p >= '0' && *p <= '9') {
+      mantissa = 10 * mantissa + (unsigned long long) (*p - '0');
+      digit_num += (mantissa > 0) ? 1 : 0;
+      exponent -= 1;
+      p += 1;
+    }
+  }
+  if (p < _end && (*p == 'e' || *p == 'E' || *p == 'n' || *p == 'i' ||
+                   *p == 'N' || *p == 'I')) {
+    fast = false;
+    while (p < _end && *p != ',' && *p != ' ' && *p != ']' && *p != '}' &&
+           *p != '\n') {
+      p += 1;
+    }
+  }
+  if (p - start >= GCVIEW_TRACE_READER_MAX_TOKEN_LENGTH) {
+    malformed("number too long");
+  }
+  _pos = p;
+  if (fast && digit_num <= 15 && exponent >= -22) {
+    const double abs_res = (double) mantissa / powers[-exponent];
+    return (negative) ? -abs_res : abs_res;
+  }
+  return parseDoubleSlow(start, p);
+}
+
+const char* TraceReader::parseStr() {
+  expect('"');
+  _str.clear();
+  while (true) {
+    // copy the run up to the next quote / escape in one go
+    const char* p = _pos;
+    while (p < _end && *p != '"' && *p != '\\') {
+      p += 1;
+    }
+    _str.append(_pos, p - _pos);
+    _pos = p;
+    if (_pos == _end) {
+      if (!refill(1)) {
+        malformed("unterminated string");
+      }
+      continue;
+    }
+    if (*_pos == '"') {
+      _pos += 1;
+      break;
+    }
+    // escape
+    if (!refill(2)) {
+      malformed("unterminated string");
+    }
+    char c = _pos[1];
+    _pos += 2;
+    switch (c) {
+    case 'b': c = '\b'; break;
+    case 'f': c = '\f'; break;
+    case 'n': c = '\n'; break;
+    case 'r': c = '\r'; break;
+    case 't': c = '\t'; break;
+    case '"': case '\\': case '/': break;
+    case 'u': {
+      if (!refill(4)) {
+        malformed("unterminated string");
+      }
+      unsigned code = 0;
+      for (unsigned i = 0; i < 4; i += 1) {
+        const char h = _pos[i];
+        code <<= 4;
+        if (h >= '0' && h <= '9') {
+          code |= h - '0';
+        } else if (h >= 'a' && h <= 'f') {
+          code |= h - 'a' + 10;
+        } else if (h >= 'A' && h <= 'F') {
+          code |= h - 'A' + 10;
+        } else {
+          malformed("bad \\u escape");
+        }
+      }
+      _pos += 4;
+      // UTF-8 (surrogate pairs are kept as two code points)
+      if (code < 0x80) {
+        _str.appendByte((unsigned char) code);
+      } else if (code < 0x800) {
+        _str.appendByte((unsigned char) (0xc0 | (code >> 6)));
+        _str.appendByte((unsigned char) (0x80 | (code & 0x3f)));
+      } else {
+        _str.appendByte((unsigned char) (0xe0 | (code >> 12)));
+        _str.appendByte((unsigned char) (0x80 | ((code >> 6) & 0x3f)));
+        _str.appendByte((unsigned char) (0x80 | (code & 0x3f)));
+      }
+      continue;
+    }
+    default:
+      malformed("bad escape");
+    }
+    _str.appendByte((unsigned char) c);
+  }
+  _str.appendByte('\0');
+  return (const char*) _str.getData();
+}
+
+void TraceReader::skipValue() {
+  switch (peek()) {
+  case '"':
+    parseStr();
+    break;
+  case '[':
+    _pos += 1;
+    if (!consumeIf(']')) {
+      do {
+        skipValue();
+      } while (consumeIf(','));
+      expect(']');
+    }
+    break;
+  case '{':
+    _pos += 1;
+    if (!consumeIf('}')) {
+      do {
+        parseStr();
+        expect(':');
+        skipValue();
+      } while (consumeIf(','));
+      expect('}');
+    }
+    break;
+  case 't':
+  case 'f':
+    parseBool();
+    break;
+  case 'n':
+    parseNull();
+    break;
+  default:
+    parseDouble();
+    break;
+  }
+}
+
+void TraceReader::reclaimSpaces() {
+  GCVIEW_ARRAY_ITERATE(&_spaces, ReaderSpace*, space, { delete space; });
+  _spaces.clear();
+  delete _space_index;
+  _space_index = new NameIndex();
+  GCVIEW_ALLOC_GUARANTEE(_space_index);
+}
+
+void TraceReader::parseMetadata() {
+  reclaimSpaces();
+
+  expect('{');
+  if (!consumeIf('}')) {
+    do {
+      if (strcmp(parseStr(), "Spaces") == 0) {
+        expect(':');
+        expect('[');
+        if (!consumeIf(']')) {
+          do {
+            parseSpaceMetadata();
+          } while (consumeIf(','));
+          expect(']');
+        }
+      } else {
+        expect(':');
+        skipValue();
+      }
+    } while (consumeIf(','));
+    expect('}');
+  }
+}
+
+void TraceReader::parseSpaceMetadata() {
+  ReaderSpace* space = NULL;
+  long long id = -1;
+  expect('{');
+  if (!consumeIf('}')) {
+    do {
+      const char* key = parseStr();
+      expect(':');
+      if (strcmp(key, "ID") == 0) {
+        id = parseInt();
+      } else if (strcmp(key, "Name") == 0) {
+        if (id != (long long) _spaces.getLength()) {
+          malformed("unexpected space ID");
+        }
+        const char* name = parseStr();
+        space = new ReaderSpace((unsigned) id, name);
+        GCVIEW_ALLOC_GUARANTEE(space);
+        _spaces.add(space);
+        if (!_space_index->add(name, space->getID())) {
+          malformed("duplicate space name");
+        }
+      } else if (strcmp(key, "Data") == 0) {
+        if (space == NULL) {
+          malformed("space data before space name");
+        }
+        expect('[');
+        if (!consumeIf(']')) {
+          do {
+            parseDataMetadata(space);
+          } while (consumeIf(','));
+          expect(']');
+        }
+      } else {
+        skipValue();
+      }
+    } while (consumeIf(','));
+    expect('}');
+  }
+  if (space == NULL) {
+    malformed("space without a name");
+  }
+}
+
+void TraceReader::parseDataMetadata(ReaderSpace* space) {
+  ReaderData* data = NULL;
+  long long id = -1;
+  bool has_type = false;
+  bool has_value = false;
+  expect('{');
+  if (!consumeIf('}')) {
+    do {
+      const char* key = parseStr();
+      expect(':');
+      if (strcmp(key, "ID") == 0) {
+        id = parseInt();
+      } else if (strcmp(key, "Name") == 0) {
+        if (id != (long long) space->_data.getLength()) {
+          malformed("unexpected data ID");
+        }
+        const char* name = parseStr();
+        data = new ReaderData((unsigned) id, name);
+        GCVIEW_ALLOC_GUARANTEE(data);
+        space->_data.add(data);
+        if (!space->_data_index.add(name, data->getID())) {
+          malformed("duplicate data name");
+        }
+      } else if (data == NULL) {
+        malformed("data attribute before data name");
+      } else if (strcmp(key, "DataType") == 0) {
+        const char* type = parseStr();
+        unsigned i = Data::BoolType;
+        while (i <= Data::EnumType &&
+               strcmp(type, Data::getDataTypeStr((Data::DataType) i)) != 0) {
+          i += 1;
+        }
+        if (i > Data::EnumType) {
+          malformed("unknown data type");
+        }
+        data->_data_type = (Data::DataType) i;
+        has_type = true;
+      } else if (strcmp(key, "IsArray") == 0) {
+        data->_is_array = parseBool();
+      } else if (strcmp(key, "Group") == 0) {
+        data->_group_name = Utils::cloneStr(parseStr());
+      } else if (strcmp(key, "Encoding") == 0) {
+        const char* encoding = parseStr();
+        unsigned i = Data::PlainEncoding;
+        while (i <= Data::RunLengthEncoding &&
+               strcmp(encoding,
+                      Data::getEncodingStr((Data::Encoding) i)) != 0) {
+          i += 1;
+        }
+        if (i > Data::RunLengthEncoding) {
+          malformed("unknown encoding");
+        }
+        data->_encoding = (Data::Encoding) i;
+      } else if (strcmp(key, "Members") == 0) {
+        expect('[');
+        if (!consumeIf(']')) {
+          do {
+            data->_enum_members.add(Utils::cloneStr(parseStr()));
+          } while (consumeIf(','));
+          expect(']');
+        }
+      } else if (strcmp(key, "Labels") == 0) {
+        expect('[');
+        if (!consumeIf(']')) {
+          do {
+            data->_labels.add(Utils::cloneStr(parseStr()));
+          } while (consumeIf(','));
+          expect(']');
+        }
+      } else if (strcmp(key, "Value") == 0) {
+        if (!has_type) {
+          malformed("data value before data type");
+        }
+        if (data->_is_array) {
+          // RLE arrays are encoded in the metadata too
+          data->clearElems();
+          parseValue(data);
+        } else {
+          data->_elems.add(ReaderData::Elem());
+          data->_elems[0]._str = NULL;
+          parseElem(data, 0);
+        }
+        has_value = true;
+      } else {
+        skipValue();
+      }
+    } while (consumeIf(','));
+    expect('}');
+  }
+  if (data == NULL) {
+    malformed("data without a name");
+  }
+  if (!has_value) {
+    malformed("data without a value");
+  }
+}
+
+void TraceReader::parseData() {
+  GCVIEW_ARRAY_ITERATE(&_spaces, ReaderSpace*, space, {
+    space->_modified = false;
+    GCVIEW_ARRAY_ITERATE(&space->_data, ReaderData*, data, {
+      data->_modified = false;
+    });
+  });
+
+  if (parseNull()) return;
+
+  unsigned space_id = 0;
+  expect('[');
+  if (!consumeIf(']')) {
+    do {
+      if (space_id >= _spaces.getLength()) {
+        malformed("more spaces than in the metadata");
+      }
+      parseSpaceData(_spaces[space_id]);
+      space_id += 1;
+    } while (consumeIf(','));
+    expect(']');
+  }
+}
+
+void TraceReader::parseSpaceData(ReaderSpace* space) {
+  if (parseNull()) return;
+
+  unsigned data_id = 0;
+  expect('[');
+  if (!consumeIf(']')) {
+    do {
+      if (data_id >= space->_data.getLength()) {
+        malformed("more data than in the metadata");
+      }
+      if (!parseNull()) {
+        ReaderData* data = space->_data[data_id];
+        parseValue(data);
+        data->_modified = true;
+        space->_modified = true;
+      }
+      data_id += 1;
+    } while (consumeIf(','));
+    expect(']');
+  }
+}
+
+void TraceReader::parseValue(ReaderData* data) {
+  if (!data->_is_array) {
+    parseElem(data, 0);
+  } else if (peek() == '[') {
+    parseFullArray(data);
+  } else {
+    parseEncodedArray(data);
+  }
+}
+
+void TraceReader::parseElem(ReaderData* data, unsigned index) {
+  ReaderData::Elem* elem = &data->_elems[index];
+  switch (data->_data_type) {
+  case Data::BoolType:
+    elem->_int = (parseBool()) ? 1 : 0;
+    break;
+  case Data::ByteType:
+  case Data::IntType:
+    elem->_int = parseInt();
+    break;
+  case Data::EnumType:
+    elem->_int = parseInt();
+    if (elem->_int < 0 ||
+        elem->_int >= (long long) data->_enum_members.getLength()) {
+      malformed("enum value out of range");
+    }
+    break;
+  case Data::DoubleType:
+    elem->_double = parseDouble();
+    break;
+  case Data::StringType:
+    data->setStr(index, parseStr());
+    break;
+  default:
+    GCVIEW_UNREACHABLE_BREAK("unknown data type");
+  }
+}
+
+void TraceReader::parseFullArray(ReaderData* data) {
+  data->clearElems();
+  expect('[');
+  if (!consumeIf(']')) {
+    do {
+      const unsigned index = data->_elems.add(ReaderData::Elem());
+      data->_elems[index]._str = NULL;
+      parseElem(data, index);
+    } while (consumeIf(','));
+    expect(']');
+  }
+}
+
+void TraceReader::parseEncodedArray(ReaderData* data) {
+  expect('{');
+  const char* key = parseStr();
+  expect(':');
+  const unsigned length = data->_elems.getLength();
+  if (strcmp(key, "Patch") == 0) {
+    expect('[');
+    if (!consumeIf(']')) {
+      do {
+        const long long index = parseInt();
+        if (index < 0 || index >= (long long) length) {
+          malformed("patch index out of range");
+        }
+        expect(',');
+        parseElem(data, (unsigned) index);
+      } while (consumeIf(','));
+      expect(']');
+    }
+  } else if (strcmp(key, "Delta") == 0) {
+    if (data->_data_type != Data::IntType) {
+      malformed("Delta encoding of a non-Int array");
+    }
+    unsigned index = 0;
+    expect('[');
+    if (!consumeIf(']')) {
+      do {
+        if (index >= length) {
+          malformed("Delta longer than the array");
+        }
+        data->_elems[index]._int += parseInt();
+        index += 1;
+      } while (consumeIf(','));
+      expect(']');
+    }
+    if (index != length) {
+      malformed("Delta shorter than the array");
+    }
+  } else if (strcmp(key, "RunPatch") == 0) {
+    if (data->_data_type == Data::DoubleType ||
+        data->_data_type == Data::StringType) {
+      malformed("RunPatch of a Double / String array");
+    }
+    expect('[');
+    if (!consumeIf(']')) {
+      do {
+        const long long index = parseInt();
+        expect(',');
+        const long long run = parseInt();
+        if (index < 0 || run <= 0 || index + run > (long long) length) {
+          malformed("run patch out of range");
+        }
+        expect(',');
+        parseElem(data, (unsigned) index);
+        for (unsigned i = 1; i < (unsigned) run; i += 1) {
+          data->_elems[(unsigned) index + i] = data->_elems[(unsigned) index];
+        }
+      } while (consumeIf(','));
+      expect(']');
+    }
+  } else if (strcmp(key, "RLE") == 0) {
+    decodeRuns(data);
+  } else if (strcmp(key, "Varint") == 0) {
+    decodeVarints(data);
+  } else if (strcmp(key, "XorFloat") == 0) {
+    decodeXorFloats(data);
+  } else {
+    malformed("unknown array encoding");
+  }
+  expect('}');
+}
+
+void TraceReader::decodeRuns(ReaderData* data) {
+  if (data->_data_type == Data::DoubleType ||
+      data->_data_type == Data::StringType) {
+    malformed("RLE encoding of a Double / String array");
+  }
+  data->clearElems();
+  expect('[');
+  if (!consumeIf(']')) {
+    do {
+      const unsigned index = data->_elems.add(ReaderData::Elem());
+      data->_elems[index]._str = NULL;
+      parseElem(data, index);
+      expect(',');
+      const long long run = parseInt();
+      if (run <= 0 || run > (long long) (unsigned) ~0u - index) {
+        malformed("bad RLE run");
+      }
+      const ReaderData::Elem elem = data->_elems[index];
+      for (unsigned i = 1; i < (unsigned) run; i += 1) {
+        data->_elems.add(elem);
+      }
+    } while (consumeIf(','));
+    expect(']');
+  }
+}
+
+void TraceReader::decodeVarints(ReaderData* data) {
+  if (data->_data_type != Data::IntType) {
+    malformed("Varint encoding of a non-Int array");
+  }
+  _bytes.clear();
+  if (!EncodingUtils::appendFromBase64(&_bytes, parseStr())) {
+    malformed("bad base64");
+  }
+  const unsigned length = data->_elems.getLength();
+  const unsigned char* p = _bytes.getData();
+  const unsigned char* end = p + _bytes.getLength();
+  for (unsigned i = 0; i < length; i += 1) {
+    unsigned long long val = 0;
+    unsigned shift = 0;
+    while (true) {
+      if (p == end || shift >= 64) {
+        malformed("bad varint");
+      }
+      const unsigned char b = *p;
+      p += 1;
+      val |= (unsigned long long) (b & 0x7f) << shift;
+      if ((b & 0x80) == 0) break;
+      shift += 7;
+    }
+    data->_elems[i]._int += (long long) (val >> 1) ^ -(long long) (val & 1);
+  }
+  if (p != end) {
+    malformed("Varint longer than the array");
+  }
+}
+
+void TraceReader::decodeXorFloats(ReaderData* data) {
+  if (data->_data_type != Data::DoubleType) {
+    malformed("XorFloat encoding of a non-Double array");
+  }
+  _bytes.clear();
+  if (!EncodingUtils::appendFromBase64(&_bytes, parseStr())) {
+    malformed("bad base64");
+  }
+  data->clearElems();
+  const unsigned char* p = _bytes.getData();
+  const unsigned char* end = p + _bytes.getLength();
+  uint64_t bits = 0;
+  while (p < end) {
+    const unsigned header = *p;
+    p += 1;
+    if (header != 0x80) {
+      const unsigned lead = header >> 4;
+      const unsigned trail = header & 0x0f;
+      if (lead + trail >= 8 || (unsigned) (end - p) < 8 - lead - trail) {
+        malformed("bad XorFloat");
+      }
+      uint64_t x = 0;
+      for (unsigned i = lead; i < 8 - trail; i += 1) {
+        x |= (uint64_t) *p << (56 - 8 * i);
+        p += 1;
+      }
+      bits ^= x;
+    }
+    ReaderData::Elem elem;
+    memcpy(&elem._double, &bits, sizeof(bits));
+    data->_elems.add(elem);
+  }
+}
+
+bool TraceReader::next() {
+  if (_finished) return false;
+
+  if (!_started) {
+    _started = true;
+    if (peek() == EOF) {
+      _finished = true;
+      _truncated = true;
+      return false;
+    }
+    expect('[');
+    if (consumeIf(']')) {
+      _finished = true;
+      return false;
+    }
+  } else {
+    if (consumeIf(']')) {
+      _finished = true;
+      return false;
+    }
+    if (peek() != EOF) {
+      expect(',');
+    }
+    if (peek() == EOF) {
+      _finished = true;
+      _truncated = true;
+      return false;
+    }
+  }
+
+  expect('{');
+  const char* key = parseStr();
+  if (strcmp(key, "GCviewMetadata") == 0) {
+    expect(':');
+    parseMetadata();
+    _is_metadata = true;
+    _metadata_record = _record_num;
+  } else if (strcmp(key, "GCviewData") == 0) {
+    if (_record_num == 0) {
+      malformed("data before metadata");
+    }
+    expect(':');
+    parseData();
+    _is_metadata = false;
+    _snapshot_num += 1;
+  } else {
+    malformed("unknown record");
+  }
+  expect('}');
+  _record_num += 1;
+  return true;
+}
+
+ReaderSpace* TraceReader::findSpace(const char* name) const {
+  const unsigned id = _space_index->find(name);
+  return (id != NameIndex::NotFound) ? _spaces[id] : NULL;
+}
+
+void TraceReader::openInput(unsigned long long offset) {
+#if GCVIEW_ENABLE_ZLIB
+  // gzread() reads files that are not compressed as they are, and a
+  // compressed trace can be read from the start of any of its frames
+  const int fd = ::open(_file_name, O_RDONLY);
+  GCVIEW_GUARANTEE(fd >= 0, "could not open file");
+  if (offset > 0) {
+    GCVIEW_GUARANTEE(lseek(fd, (off_t) offset, SEEK_SET) == (off_t) offset,
+                     "could not seek");
+  }
+  _gzin = gzdopen(fd, "rb");
+  GCVIEW_GUARANTEE(_gzin != NULL, "could not open file");
+  gzbuffer(_gzin, 128 * 1024);
+#else // GCVIEW_ENABLE_ZLIB
+  _fin = fopen(_file_name, "rb");
+  GCVIEW_GUARANTEE(_fin != NULL, "could not open file");
+  if (offset > 0) {
+    GCVIEW_GUARANTEE(fseeko(_fin, (off_t) offset, SEEK_SET) == 0,
+                     "could not seek");
+  }
+#endif // GCVIEW_ENABLE_ZLIB
+  _pos = _buffer;
+  _end = _buffer;
+  _eof = false;
+  _buffer_offset = 0;
+}
+
+void TraceReader::closeInput() {
+#if GCVIEW_ENABLE_ZLIB
+  gzclose(_gzin);
+#else // GCVIEW_ENABLE_ZLIB
+  fclose(_fin);
+#endif // GCVIEW_ENABLE_ZLIB
+}
+
+void TraceReader::open(const char* file_name) {
+  GCVIEW_ASSERT(file_name != NULL);
+  _file_name = Utils::cloneStr(file_name);
+  GCVIEW_GUARANTEE(_file_name != NULL, "empty file name");
+  _buffer = new char[GCVIEW_TRACE_READER_BUFFER_SIZE];
+  GCVIEW_ALLOC_GUARANTEE(_buffer);
+  openInput(0);
+  _space_index = new NameIndex();
+  GCVIEW_ALLOC_GUARANTEE(_space_index);
+}
+
+void TraceReader::seek(unsigned long long offset,
+                       unsigned long long record_num,
+                       unsigned long long snapshot_num) {
+  closeInput();
+  openInput(offset);
+  // only the first record starts with the opening bracket
+  _started = (record_num > 0);
+  _finished = false;
+  _truncated = false;
+  _record_num = record_num;
+  _snapshot_num = snapshot_num;
+}
+
+void TraceReader::seekTo(const TraceIndex* index, unsigned long long record) {
+  const TraceIndex::Entry* entry = index->getEntry(record);
+  seek(entry->getOffset(), record, entry->getSnapshotNum());
+}
+
+bool TraceReader::readRecord(const TraceIndex* index,
+                             unsigned long long record) {
+  GCVIEW_GUARANTEE(record < index->getEntryNum(), "record is not indexed");
+  const unsigned long long keyframe = index->findKeyframe(record);
+  // reading on from the current record is cheaper, if it is not past
+  // the requested one and is not before the keyframe
+  const bool read_on = _record_num > keyframe && _record_num <= record + 1 &&
+                       !_finished;
+  if (!read_on) {
+    const unsigned long long metadata = index->findMetadata(keyframe);
+    // a keyframe replaces all values, so the metadata only needs to
+    // be read again if it is not the current one
+    if (keyframe == metadata || _record_num == 0 ||
+        _metadata_record != metadata) {
+      seekTo(index, metadata);
+      if (!next()) return false;
+    }
+    if (keyframe != metadata) {
+      seekTo(index, keyframe);
+      if (!next()) return false;
+    }
+  }
+  while (_record_num <= record) {
+    if (!next()) return false;
+  }
+  return true;
+}
+TraceReader::TraceReader(const char* file_name)
+    : _file_name(NULL),
+      _buffer(NULL), _pos(NULL), _end(NULL), _eof(false),
+      _buffer_offset(0), _space_index(NULL),
+      _started(false), _finished(false), _truncated(false),
+      _is_metadata(false), _record_num(0), _snapshot_num(0),
+      _metadata_record(0) {
+  open(file_name);
+}
+
+TraceReader::~TraceReader() {
+  GCVIEW_ARRAY_ITERATE(&_spaces, ReaderSpace*, space, { delete space; });
+  delete _space_index;
+  delete[] _buffer;
+  closeInput();
+  delete[] _file_name;
+}
+
+}
@@ -0,0 +1,313 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_READER_HPP
+
+#define _GCVIEW_READER_HPP
+
+#include <stdio.h>
+
+#include "array.hpp"
+#include "buffer.hpp"
+#include "data.hpp"
+#include "name_index.hpp"
+#include "sink.hpp"
+#include "utils.hpp"
+
+// The size of the input buffer of a TraceReader.
+#define GCVIEW_TRACE_READER_BUFFER_SIZE (1024 * 1024)
+// The longest number / literal that a TraceReader accepts.
+#define GCVIEW_TRACE_READER_MAX_TOKEN_LENGTH 64
+
+namespace gcview {
+
+class TraceIndex;
+class TraceReader;
+
+// The state of a datum, as reconstructed by a TraceReader.
+class ReaderData {
+  friend class ReaderSpace;
+  friend class TraceReader;
+
+public:
+  typedef union {
+    long long   _int;     // Bool, Byte, Int, Enum
+    double      _double;  // Double
+    const char* _str;     // String (NULL for the empty string)
+  } Elem;
+
+private:
+  const unsigned _id;
+  const char* const _name;
+  const char* _group_name;
+  Data::DataType _data_type;
+  bool _is_array;
+  Data::Encoding _encoding;
+  Array<const char*> _enum_members;
+  Array<const char*> _labels;
+  Array<Elem> _elems;
+  bool _modified;
+
+  void clearElems();
+  void setStr(unsigned index, const char* str);
+
+  // not copyable
+  ReaderData(const ReaderData&);
+  ReaderData& operator=(const ReaderData&);
+
+  ReaderData(unsigned id, const char* name);
+  ~ReaderData();
+
+public:
+  unsigned getID() const { return _id; }
+  const char* getName() const { return _name; }
+  const char* getGroupName() const { return _group_name; }
+  Data::DataType getDataType() const { return _data_type; }
+  bool isArray() const { return _is_array; }
+  Data::Encoding getEncoding() const { return _encoding; }
+
+  // Whether the value was in the last record (always true for
+  // metadata records).
+  bool isModified() const { return _modified; }
+
+  // The names of the array indexes (see Data::addLabel()), if any.
+  unsigned getLabelNum() const { return _labels.getLength(); }
+  const char* getLabel(unsigned index) const { return _labels[index]; }
+
+  unsigned getEnumMemberNum() const { return _enum_members.getLength(); }
+  const char* getEnumMember(unsigned index) const {
+    return _enum_members[index];
+  }
+
+  // 1 for values.
+  unsigned getLength() const { return _elems.getLength(); }
+
+  long long getInt(unsigned index = 0) const {
+    GCVIEW_ASSERT(_data_type != Data::DoubleType &&
+                  _data_type != Data::StringType);
+    return _elems[index]._int;
+  }
+  bool getBool(unsigned index = 0) const {
+    GCVIEW_ASSERT(_data_type == Data::BoolType);
+    return _elems[index]._int != 0;
+  }
+  double getDouble(unsigned index = 0) const {
+    GCVIEW_ASSERT(_data_type == Data::DoubleType);
+    return _elems[index]._double;
+  }
+  const char* getStr(unsigned index = 0) const {
+    GCVIEW_ASSERT(_data_type == Data::StringType);
+    return Utils::getStrOrEmptyStr(_elems[index]._str);
+  }
+  const char* getEnumMemberOf(unsigned index = 0) const {
+    GCVIEW_ASSERT(_data_type == Data::EnumType);
+    return _enum_members[(unsigned) _elems[index]._int];
+  }
+};
+
+// The state of a space, as reconstructed by a TraceReader.
+class ReaderSpace {
+  friend class TraceReader;
+
+private:
+  const unsigned _id;
+  const char* const _name;
+  Array<ReaderData*> _data;
+  NameIndex _data_index;
+  bool _modified;
+
+  // not copyable
+  ReaderSpace(const ReaderSpace&);
+  ReaderSpace& operator=(const ReaderSpace&);
+
+  ReaderSpace(unsigned id, const char* name);
+  ~ReaderSpace();
+
+public:
+  unsigned getID() const { return _id; }
+  const char* getName() const { return _name; }
+  bool isModified() const { return _modified; }
+
+  unsigned getDataNum() const { return _data.getLength(); }
+  ReaderData* getData(unsigned id) const { return _data[id]; }
+  // Returns NULL if there is no data with that name.
+  ReaderData* findData(const char* name) const;
+};
+
+// Streams a JSON trace (plain or, with zlib, gzip-compressed) and
+// reconstructs the state of the GCview one record at a time:
+//
+//   TraceReader reader("trace.json");
+//   while (reader.next()) {
+//     ... reader.getSpace(i)->getData(j)->getInt() ...
+//   }
+//
+// A metadata record replaces all spaces and data. A data record only
+// updates the values it has: a null snapshot, space or datum means
+// unchanged, and patches / encoded arrays are applied to the previous
+// values. After next(), isModified() tells which ones were updated.
+//
+// A malformed trace raises an error that includes the offset at which
+// it was found. A trace that ends between two records (e.g., the
+// trace of a process that crashed) is read up to its last record and
+// isTruncated() then returns true.
+class TraceReader {
+private:
+  const char* _file_name;
+
+#if GCVIEW_ENABLE_ZLIB
+  gzFile _gzin;
+#else // GCVIEW_ENABLE_ZLIB
+  FILE*  _fin;
+#endif // GCVIEW_ENABLE_ZLIB
+
+  char*       _buffer;
+  const char* _pos;
+  const char* _end;
+  bool        _eof;
+  // bytes read before the ones in _buffer
+  unsigned long long _buffer_offset;
+
+  ByteBuffer _str;
+  ByteBuffer _bytes;
+
+  Array<ReaderSpace*> _spaces;
+  NameIndex* _space_index;
+
+  bool _started;
+  bool _finished;
+  bool _truncated;
+  bool _is_metadata;
+  unsigned long long _record_num;
+  unsigned long long _snapshot_num;
+  // the number of the last metadata record read
+  unsigned long long _metadata_record;
+
+  // Makes at least length bytes available after _pos, unless the
+  // input ends first; returns whether it did.
+  bool refill(size_t length);
+  size_t readInput(char* buffer, size_t length);
+
+  void malformed(const char* msg) const;
+
+  // Returns the next non-whitespace character without consuming it,
+  // or EOF.
+  int peek() {
+    while (true) {
+      while (_pos < _end) {
+        const char c = *_pos;
+        if (c != ' ' && c != '\n' && c != '\t' && c != '\r') {
+          return (unsigned char) c;
+        }
+        _pos += 1;
+      }
+      if (!refill(1)) return EOF;
+    }
+  }
+
+  bool consumeIf(char c) {
+    if (peek() == (unsigned char) c) {
+      _pos += 1;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c);
+  void expectLiteral(const char* literal, size_t length);
+
+  bool parseNull() {
+    if (peek() == 'n') {
+      expectLiteral("null", 4);
+      return true;
+    }
+    return false;
+  }
+
+  bool parseBool();
+  long long parseInt();
+  double parseDouble();
+  double parseDoubleSlow(const char* start, const char* end);
+  // The result is valid until the next call.
+  const char* parseStr();
+  void skipValue();
+
+  void reclaimSpaces();
+
+  void parseMetadata();
+  void parseSpaceMetadata();
+  void parseDataMetadata(ReaderSpace* space);
+  void parseData();
+  void parseSpaceData(ReaderSpace* space);
+
+  void parseValue(ReaderData* data);
+  void parseElem(ReaderData* data, unsigned index);
+  void parseFullArray(ReaderData* data);
+  void parseEncodedArray(ReaderData* data);
+  void decodeRuns(ReaderData* data);
+  void decodeVarints(ReaderData* data);
+  void decodeXorFloats(ReaderData* data);
+
+  void openInput(unsigned long long offset);
+  void closeInput();
+  void open(const char* file_name);
+  void seekTo(const TraceIndex* index, unsigned long long record);
+
+  // not copyable
+  TraceReader(const TraceReader&);
+  TraceReader& operator=(const TraceReader&);
+
+public:
+  TraceReader(const char* file_name);
+
+  // Reads the next record; returns false at the end of the trace.
+  bool next();
+
+  bool isMetadata() const { return _is_metadata; }
+  bool isTruncated() const { return _truncated; }
+
+  // Random access through the index sidecar of the trace (see
+  // index.hpp). seek() makes the reader continue at offset, which has
+  // to be where the frame of a record starts, as if record_num records
+  // (snapshot_num of them data records) had been read; the state of
+  // the spaces is kept, so the record there should be a metadata
+  // record / keyframe, or the one after the last record read.
+  // readRecord() reads up to and including the given record (numbered
+  // from 0), starting from the closest keyframe before it unless it
+  // is cheaper to read on; it returns false if the trace ends first.
+  void seek(unsigned long long offset, unsigned long long record_num,
+            unsigned long long snapshot_num);
+  bool readRecord(const TraceIndex* index, unsigned long long record);
+
+  // Records / data records read so far, i.e., the number of the next
+  // record.
+  unsigned long long getRecordNum() const { return _record_num; }
+  unsigned long long getSnapshotNum() const { return _snapshot_num; }
+  // Input bytes consumed (uncompressed) since the trace was opened or
+  // since the last seek().
+  unsigned long long getBytesRead() const {
+    return _buffer_offset + (unsigned long long) (_pos - _buffer);
+  }
+
+  unsigned getSpaceNum() const { return _spaces.getLength(); }
+  ReaderSpace* getSpace(unsigned id) const { return _spaces[id]; }
+  // Returns NULL if there is no space with that name.
+  ReaderSpace* findSpace(const char* name) const;
+
+  ~TraceReader();
+};
+
+}
+
+#endif // _GCVIEW_READER_HPP
@@ -0,0 +1,130 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+
+#include "recorder.hpp"
+
+namespace gcview {
+
+static FlightRecorder* volatile SignalRecorder = NULL;
+
+static void handleSignal(int) {
+  FlightRecorder* recorder = SignalRecorder;
+  if (recorder != NULL) {
+    recorder->requestDump();
+  }
+}
+
+void FlightRecorder::dumpToFile() {
+  if (_dump_file_name == NULL) return;
+  char file_name[1024];
+  Utils::formatStr(file_name, 1024, "%s.%u", _dump_file_name, _dump_num);
+  dump(file_name);
+  _dump_num += 1;
+}
+
+void FlightRecorder::setDumpFileName(const char* dump_file_name) {
+  if (_dump_file_name != NULL) {
+    delete[] _dump_file_name;
+  }
+  _dump_file_name = Utils::cloneStr(dump_file_name);
+}
+
+void FlightRecorder::record() {
+  const bool keyframe =
+    _keyframe_due || _since_keyframe >= _keyframe_interval;
+  if (keyframe) {
+    _sink.markKeyframe();
+  }
+  _gcview->writeJSONData(&_writer, keyframe);
+  _since_keyframe = (keyframe) ? 0 : _since_keyframe + 1;
+  _keyframe_due = false;
+
+  if (_sink.getDroppedFrameNum() != _dropped_frame_num) {
+    // the records that are left in the ring lead up to the one that
+    // was dropped, they cannot be used any more
+    _dropped_frame_num = _sink.getDroppedFrameNum();
+    _sink.clear();
+    _keyframe_due = true;
+  }
+
+  const bool too_long = _latency_threshold_sec > 0.0 &&
+    _gcview->getLastEventDurationSec() > _latency_threshold_sec;
+  if (too_long || _dump_requested) {
+    _dump_requested = 0;
+    dumpToFile();
+  }
+}
+
+unsigned FlightRecorder::dump(const char* file_name) {
+  const unsigned frame_num = _sink.getFrameNum();
+  unsigned first_frame = 0;
+  while (first_frame < frame_num && !_sink.isKeyframe(first_frame)) {
+    first_frame += 1;
+  }
+
+  FileSink sink(file_name);
+  {
+    // unbuffered, so that its output and the copied frames are in order
+    JSONWriter writer(&sink);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    _gcview->writeJSONMetadata(&writer);
+    for (unsigned i = first_frame; i < frame_num; i += 1) {
+      array_writer.startElem();
+      _sink.copyFrame(i, &sink);
+    }
+  }
+  sink.endFrame();
+
+  // the metadata was the last snapshot, the next record has to have
+  // the full values for the records in the ring to follow each other
+  _keyframe_due = true;
+  return frame_num - first_frame;
+}
+
+void FlightRecorder::dumpOnSignal(int signum) {
+  SignalRecorder = this;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handleSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  GCVIEW_GUARANTEE(sigaction(signum, &action, NULL) == 0,
+                   "could not install signal handler");
+}
+
+FlightRecorder::FlightRecorder(GCview* gcview, size_t capacity,
+                               unsigned max_record_num,
+                               unsigned keyframe_interval)
+    : _gcview(gcview), _sink(capacity, max_record_num),
+      _writer(&_sink, GCVIEW_FLIGHT_RECORDER_BUFFER_SIZE),
+      _keyframe_interval(keyframe_interval), _since_keyframe(0),
+      _keyframe_due(true), _dropped_frame_num(0),
+      _latency_threshold_sec(0.0), _dump_file_name(NULL), _dump_num(0),
+      _dump_requested(0) {
+  GCVIEW_ASSERT(gcview != NULL);
+}
+
+FlightRecorder::~FlightRecorder() {
+  if (SignalRecorder == this) {
+    SignalRecorder = NULL;
+  }
+  if (_dump_file_name != NULL) {
+    delete[] _dump_file_name;
+  }
+}
+
+}
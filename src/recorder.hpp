@@ -0,0 +1,132 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_RECORDER_HPP
+
+#define _GCVIEW_RECORDER_HPP
+
+#include <signal.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "sink.hpp"
+
+// The default number of records a FlightRecorder keeps.
+#define GCVIEW_FLIGHT_RECORDER_MAX_RECORDS 256
+// A record is written as a keyframe after this many records that are
+// not keyframes.
+#define GCVIEW_FLIGHT_RECORDER_KEYFRAME_INTERVAL 16
+// The size of the output buffer of the JSONWriter of a FlightRecorder.
+#define GCVIEW_FLIGHT_RECORDER_BUFFER_SIZE (4 * 1024)
+
+// Flight recorder
+//
+// Keeps the last records of a GCview in memory instead of writing a
+// trace, and writes them to a file only when asked to, e.g., after a
+// long pause:
+//
+//   FlightRecorder recorder(&gcview, 1024 * 1024);
+//   recorder.setDumpFileName("gcview_dump");
+//   recorder.setLatencyThresholdSec(0.1);
+//   ...
+//   gcview.eventEnd();
+//   recorder.record();
+//
+// The records are JSON data records kept in a RingSink. All memory is
+// allocated when the recorder is created, record() does not allocate
+// (apart from writing a dump). The exception are the arrays that write
+// their updates encoded (see ArrayData::setEncoding()): their bytes go
+// through scratch buffers of the JSONWriter, which grow during the
+// first records until they fit the largest update.
+// The ring keeps at most max_record_num records and at most capacity
+// bytes of them, dropping the oldest ones first; every
+// keyframe_interval + 1 records one is a keyframe (see index.hpp), so
+// that a dump can start from it.
+//
+// A dump is a normal JSON trace: the current metadata, followed by the
+// records in the ring from the oldest keyframe on. It is written by:
+//
+//   dump()        : when called.
+//   record()      : if the event that just ended took longer than the
+//                   latency threshold (after recording it), or if a
+//                   dump was requested since the last record() (see
+//                   requestDump()).
+//
+// The recorder takes the snapshots of the GCview, it should not be
+// written to other writers at the same time.
+
+namespace gcview {
+
+class FlightRecorder {
+private:
+  GCview* const _gcview;
+  RingSink _sink;
+  JSONWriter _writer;
+
+  const unsigned _keyframe_interval;
+  unsigned _since_keyframe;
+  bool _keyframe_due;
+  unsigned long long _dropped_frame_num;
+
+  double _latency_threshold_sec;
+  const char* _dump_file_name;
+  unsigned _dump_num;
+  volatile sig_atomic_t _dump_requested;
+
+  void dumpToFile();
+
+  // not copyable
+  FlightRecorder(const FlightRecorder&);
+  FlightRecorder& operator=(const FlightRecorder&);
+
+public:
+  FlightRecorder(GCview* gcview, size_t capacity,
+                 unsigned max_record_num = GCVIEW_FLIGHT_RECORDER_MAX_RECORDS,
+                 unsigned keyframe_interval =
+                                     GCVIEW_FLIGHT_RECORDER_KEYFRAME_INTERVAL);
+
+  // The dumps that record() writes go to <dump file name>.<n>, n
+  // starting at 0. Without a file name, record() does not dump.
+  void setDumpFileName(const char* dump_file_name);
+  // 0.0 : no threshold.
+  void setLatencyThresholdSec(double latency_threshold_sec) {
+    GCVIEW_ASSERT(latency_threshold_sec >= 0.0);
+    _latency_threshold_sec = latency_threshold_sec;
+  }
+
+  // Takes a snapshot into the ring and dumps if needed.
+  void record();
+
+  // Writes the dump, returns the number of records in it (not counting
+  // the metadata).
+  unsigned dump(const char* file_name);
+
+  // Can be called from a signal handler, the dump is written by the
+  // next record().
+  void requestDump() { _dump_requested = 1; }
+  // Calls requestDump() on this recorder when the process receives
+  // signum (e.g., SIGUSR1). Only one recorder can be dumped on
+  // signals.
+  void dumpOnSignal(int signum);
+
+  unsigned getRecordNum() const { return _sink.getFrameNum(); }
+  // The dumps record() wrote.
+  unsigned getDumpNum() const { return _dump_num; }
+
+  ~FlightRecorder();
+};
+
+}
+
+#endif // _GCVIEW_RECORDER_HPP
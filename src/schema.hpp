@@ -0,0 +1,211 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_SCHEMA_HPP
+
+#define _GCVIEW_SCHEMA_HPP
+
+#include "arena.hpp"
+#include "data.hpp"
+#include "json.hpp"
+#include "space.hpp"
+#include "trace.hpp"
+
+// Static schemas
+//
+// A space whose data are known when the code is written can declare
+// them as the fields of a layout type instead of adding them with
+// Space::addData() and looking them up by name (the fields macro is
+// one line per field, with line continuations):
+//
+//   #define OLD_SPACE_FIELDS(__field__)
+//     __field__(IntValue, size,   "Size",   NULL)
+//     __field__(IntArray, starts, "Starts", "Pages")
+//     __field__(IntArray, used,   "Used",   "Pages")
+//
+//   GCVIEW_SPACE_LAYOUT(OldSpaceLayout, OLD_SPACE_FIELDS);
+//
+//   StaticSpace<OldSpaceLayout>* old_space =
+//     gcview.addStaticSpace<OldSpaceLayout>("Old Space");
+//   ...
+//   old_space->fields().size.set(old_space_size);
+//
+// Each line is (class, member, name, group name); the class is one of
+// the data classes in data.hpp (e.g., IntValue, AtomicIntArray). The
+// data are laid out in the space object itself, in that order, and
+// are updated through the members, without name lookups or pointers.
+// They are also added to the space in that order, so the metadata is
+// the same as that of a space with the same data added by addData()
+// and findData() still finds them.
+//
+// A snapshot goes over the fields through the layout's visit(), which
+// calls the methods of the exact data classes, so change detection,
+// the previous value updates and the data records involve no virtual
+// calls and can be inlined. A StaticSpace cannot have data other than
+// its fields.
+
+namespace gcview {
+
+// The base of the layouts, so that the generated constructor can
+// start its initializer list with it.
+struct SpaceLayout {
+};
+
+#define GCVIEW_LAYOUT_DECLARE_FIELD(__class__, __member__, __name__, \
+                                    __group__) \
+  __class__ __member__;
+
+#define GCVIEW_LAYOUT_INIT_FIELD(__class__, __member__, __name__, __group__) \
+  , __member__(__name__, __group__, arena)
+
+#define GCVIEW_LAYOUT_VISIT_FIELD(__class__, __member__, __name__, __group__) \
+  (*visitor)(&__member__);
+
+#define GCVIEW_SPACE_LAYOUT(__layout__, __fields__) \
+struct __layout__ : public SpaceLayout { \
+  __fields__(GCVIEW_LAYOUT_DECLARE_FIELD) \
+  \
+  template <typename V> \
+  void visit(V* visitor) { \
+    __fields__(GCVIEW_LAYOUT_VISIT_FIELD) \
+  } \
+  \
+  template <typename V> \
+  void visit(V* visitor) const { \
+    __fields__(GCVIEW_LAYOUT_VISIT_FIELD) \
+  } \
+  \
+  explicit __layout__(Arena* arena) \
+      : SpaceLayout() __fields__(GCVIEW_LAYOUT_INIT_FIELD) { } \
+}
+
+template <typename L>
+class StaticSpace : public Space {
+private:
+  L _fields;
+
+  ///// Visitors over the fields /////
+
+  class FieldAdder {
+  private:
+    StaticSpace* const _space;
+  public:
+    template <typename D>
+    void operator()(D* data) { _space->addStaticData(data); }
+    FieldAdder(StaticSpace* space) : _space(space) { }
+  };
+
+  class ModifiedFlagUpdater {
+  private:
+    StaticSpace* const _space;
+  public:
+    bool _modified;
+    template <typename D>
+    void operator()(D* data) {
+      if (_space->updateStaticModifiedFlag(data)) {
+        _modified = true;
+      }
+    }
+    ModifiedFlagUpdater(StaticSpace* space)
+        : _space(space), _modified(false) { }
+  };
+
+  class PrevValueUpdater {
+  public:
+    template <typename D>
+    void operator()(D* data) { Space::updateStaticPrevValue(data); }
+  };
+
+  class JSONDataWriter {
+  private:
+    JSONArrayWriter* const _array_writer;
+    JSONWriter* const _writer;
+    const bool _keyframe;
+  public:
+    template <typename D>
+    void operator()(const D* data) {
+      _array_writer->startElem();
+      Space::writeStaticJSONData(_writer, data, _keyframe);
+    }
+    JSONDataWriter(JSONArrayWriter* array_writer, JSONWriter* writer,
+                   bool keyframe)
+        : _array_writer(array_writer), _writer(writer),
+          _keyframe(keyframe) { }
+  };
+
+  class TraceDataWriter {
+  private:
+    const StaticSpace* const _space;
+    TraceWriter* const _writer;
+    const bool _keyframe;
+  public:
+    template <typename D>
+    void operator()(const D* data) {
+      _space->writeStaticTraceData(_writer, data, _keyframe);
+    }
+    TraceDataWriter(const StaticSpace* space, TraceWriter* writer,
+                    bool keyframe)
+        : _space(space), _writer(writer), _keyframe(keyframe) { }
+  };
+
+  // not copyable
+  StaticSpace(const StaticSpace&);
+  StaticSpace& operator=(const StaticSpace&);
+
+protected:
+  virtual void updateModifiedFlags() {
+    ModifiedFlagUpdater updater(this);
+    _fields.visit(&updater);
+    _modified = updater._modified;
+  }
+
+  virtual void updatePrevValues() {
+    PrevValueUpdater updater;
+    _fields.visit(&updater);
+  }
+
+  virtual void writeJSONData(JSONWriter* writer, bool keyframe) const {
+    if (_modified) {
+      JSONArrayWriter y(writer, true /* add_newlines */);
+      JSONDataWriter data_writer(&y, writer, keyframe);
+      _fields.visit(&data_writer);
+    } else {
+      writer->writeNull();
+    }
+  }
+
+  virtual void writeTraceData(TraceWriter* writer, bool keyframe) const {
+    GCVIEW_ASSERT(_modified);
+    writer->writeVarint(_id);
+    writer->writeLength(getModifiedDataNum());
+    TraceDataWriter data_writer(this, writer, keyframe);
+    _fields.visit(&data_writer);
+  }
+
+public:
+  L& fields() { return _fields; }
+  const L& fields() const { return _fields; }
+
+  // If there is an arena, the names are allocated in it.
+  StaticSpace(const char* name, Arena* arena = NULL)
+      : Space(name, arena), _fields(arena) {
+    FieldAdder adder(this);
+    _fields.visit(&adder);
+    _has_static_layout = true;
+  }
+};
+
+}
+
+#endif // _GCVIEW_SCHEMA_HPP
@@ -0,0 +1,194 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "simd.hpp"
+
+#if GCVIEW_ENABLE_SIMD
+#include <immintrin.h>
+#endif // GCVIEW_ENABLE_SIMD
+
+namespace gcview {
+
+////////// Scalar Kernels //////////
+
+static size_t findDiffBytesScalar(const unsigned char* a,
+                                  const unsigned char* b, size_t length) {
+  for (size_t i = 0; i < length; i += 1) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+  return length;
+}
+
+static size_t findDiffDoublesScalar(const double* a, const double* b,
+                                    size_t length) {
+  for (size_t i = 0; i < length; i += 1) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+  return length;
+}
+
+#if GCVIEW_ENABLE_SIMD
+
+////////// SSE2 Kernels //////////
+
+// A cleared bit in mask is an element that differs.
+
+__attribute__((target("sse2")))
+static size_t findDiffBytesSSE2(const unsigned char* a,
+                                const unsigned char* b, size_t length) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    const __m128i va = _mm_loadu_si128((const __m128i*) (a + i));
+    const __m128i vb = _mm_loadu_si128((const __m128i*) (b + i));
+    const unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+    if (mask != 0xFFFFu) {
+      return i + (size_t) __builtin_ctz(~mask);
+    }
+  }
+  return i + findDiffBytesScalar(a + i, b + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static size_t findDiffDoublesSSE2(const double* a, const double* b,
+                                  size_t length) {
+  size_t i = 0;
+  for (; i + 2 <= length; i += 2) {
+    const __m128d va = _mm_loadu_pd(a + i);
+    const __m128d vb = _mm_loadu_pd(b + i);
+    const unsigned mask = (unsigned) _mm_movemask_pd(_mm_cmpeq_pd(va, vb));
+    if (mask != 0x3u) {
+      return i + (size_t) __builtin_ctz(~mask);
+    }
+  }
+  return i + findDiffDoublesScalar(a + i, b + i, length - i);
+}
+
+////////// AVX2 Kernels //////////
+
+__attribute__((target("avx2")))
+static size_t findDiffBytesAVX2(const unsigned char* a,
+                                const unsigned char* b, size_t length) {
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    const __m256i va = _mm256_loadu_si256((const __m256i*) (a + i));
+    const __m256i vb = _mm256_loadu_si256((const __m256i*) (b + i));
+    const unsigned mask =
+      (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+    if (mask != 0xFFFFFFFFu) {
+      return i + (size_t) __builtin_ctz(~mask);
+    }
+  }
+  return i + findDiffBytesSSE2(a + i, b + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t findDiffDoublesAVX2(const double* a, const double* b,
+                                  size_t length) {
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    const __m256d va = _mm256_loadu_pd(a + i);
+    const __m256d vb = _mm256_loadu_pd(b + i);
+    const unsigned mask =
+      (unsigned) _mm256_movemask_pd(_mm256_cmp_pd(va, vb, _CMP_EQ_OQ));
+    if (mask != 0xFu) {
+      return i + (size_t) __builtin_ctz(~mask);
+    }
+  }
+  return i + findDiffDoublesSSE2(a + i, b + i, length - i);
+}
+
+#endif // GCVIEW_ENABLE_SIMD
+
+////////// Dispatch //////////
+
+// Both start as the dispatch functions, which pick the kernels on the
+// first scan. Threads that race on it pick the same ones.
+SimdUtils::FindDiffBytesFunc SimdUtils::_find_diff_bytes =
+  &SimdUtils::dispatchFindDiffBytes;
+SimdUtils::FindDiffDoublesFunc SimdUtils::_find_diff_doubles =
+  &SimdUtils::dispatchFindDiffDoubles;
+
+SimdUtils::Level SimdUtils::getSupportedLevel() {
+#if GCVIEW_ENABLE_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return AVX2Level;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SSE2Level;
+  }
+#endif // GCVIEW_ENABLE_SIMD
+  return ScalarLevel;
+}
+
+SimdUtils::Level SimdUtils::getLevel() {
+  if (_find_diff_bytes == &dispatchFindDiffBytes) {
+    selectKernels();
+  }
+#if GCVIEW_ENABLE_SIMD
+  if (_find_diff_bytes == &findDiffBytesAVX2) {
+    return AVX2Level;
+  }
+  if (_find_diff_bytes == &findDiffBytesSSE2) {
+    return SSE2Level;
+  }
+#endif // GCVIEW_ENABLE_SIMD
+  return ScalarLevel;
+}
+
+void SimdUtils::setLevel(Level level) {
+  const Level supported_level = getSupportedLevel();
+  if (level > supported_level) {
+    level = supported_level;
+  }
+  switch (level) {
+#if GCVIEW_ENABLE_SIMD
+  case AVX2Level:
+    _find_diff_bytes = &findDiffBytesAVX2;
+    _find_diff_doubles = &findDiffDoublesAVX2;
+    break;
+  case SSE2Level:
+    _find_diff_bytes = &findDiffBytesSSE2;
+    _find_diff_doubles = &findDiffDoublesSSE2;
+    break;
+#endif // GCVIEW_ENABLE_SIMD
+  default:
+    _find_diff_bytes = &findDiffBytesScalar;
+    _find_diff_doubles = &findDiffDoublesScalar;
+    break;
+  }
+}
+
+void SimdUtils::selectKernels() {
+  setLevel(getSupportedLevel());
+}
+
+size_t SimdUtils::dispatchFindDiffBytes(const unsigned char* a,
+                                        const unsigned char* b,
+                                        size_t length) {
+  selectKernels();
+  return _find_diff_bytes(a, b, length);
+}
+
+size_t SimdUtils::dispatchFindDiffDoubles(const double* a, const double* b,
+                                          size_t length) {
+  selectKernels();
+  return _find_diff_doubles(a, b, length);
+}
+
+}
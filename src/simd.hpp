@@ -0,0 +1,130 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_SIMD_HPP
+
+#define _GCVIEW_SIMD_HPP
+
+// Set to 0 to build the scans below without the SSE2 / AVX2 kernels.
+#ifndef GCVIEW_ENABLE_SIMD
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define GCVIEW_ENABLE_SIMD 1
+#else
+#define GCVIEW_ENABLE_SIMD 0
+#endif
+#endif // GCVIEW_ENABLE_SIMD
+
+#include "utils.hpp"
+
+// Change detection scans
+//
+// Finding which elements of a numeric array changed since the previous
+// snapshot (see ArrayData) is a scan for the elements of two arrays
+// that are not equal. SimdUtils does it 16 (SSE2) or 32 (AVX2) bytes
+// at a time, with the kernel picked for the CPU the first time a scan
+// runs, and a scalar loop on other CPUs / platforms.
+//
+// The integer scans compare bytes, which gives the same result as
+// comparing the elements. The double scan compares the elements as
+// doubles, as operator== does: 0.0 and -0.0 are equal, and a NaN is
+// never equal to anything (so it is always considered changed).
+
+namespace gcview {
+
+class SimdUtils {
+public:
+  typedef enum {
+    ScalarLevel,
+    SSE2Level,
+    AVX2Level
+  } Level;
+
+  typedef size_t (*FindDiffBytesFunc)(const unsigned char* a,
+                                      const unsigned char* b,
+                                      size_t length);
+  typedef size_t (*FindDiffDoublesFunc)(const double* a, const double* b,
+                                        size_t length);
+
+private:
+  static FindDiffBytesFunc   _find_diff_bytes;
+  static FindDiffDoublesFunc _find_diff_doubles;
+
+  static void selectKernels();
+
+  static size_t dispatchFindDiffBytes(const unsigned char* a,
+                                      const unsigned char* b,
+                                      size_t length);
+  static size_t dispatchFindDiffDoubles(const double* a, const double* b,
+                                        size_t length);
+
+public:
+  static const char* getLevelStr(Level level) {
+    switch (level) {
+    case ScalarLevel : return "Scalar";
+    case SSE2Level   : return "SSE2";
+    case AVX2Level   : return "AVX2";
+    default: GCVIEW_UNREACHABLE_NULL("unknown SIMD level");
+    }
+  }
+
+  // The best level the CPU supports.
+  static Level getSupportedLevel();
+  // The level of the kernels the scans use.
+  static Level getLevel();
+  // Uses the kernels of the given level, or of the supported level if
+  // that is lower (e.g., to compare them in benchmarks). Not thread
+  // safe with respect to concurrent scans.
+  static void setLevel(Level level);
+
+  // Returns the index of the first byte / double that differs, or
+  // length if there is none.
+  static size_t findFirstDiffBytes(const unsigned char* a,
+                                   const unsigned char* b, size_t length) {
+    return _find_diff_bytes(a, b, length);
+  }
+
+  static size_t findFirstDiffDoubles(const double* a, const double* b,
+                                     size_t length) {
+    return _find_diff_doubles(a, b, length);
+  }
+
+  // Returns the first index in [from, to) at which a and b differ, or
+  // to if there is none. T is an integer type, or bool.
+  template <typename T>
+  static unsigned findFirstDiff(const T* a, const T* b,
+                                unsigned from, unsigned to) {
+    GCVIEW_ASSERT(from <= to);
+    const size_t byte_index =
+      findFirstDiffBytes((const unsigned char*) (a + from),
+                         (const unsigned char*) (b + from),
+                         (size_t) (to - from) * sizeof(T));
+    return from + (unsigned) (byte_index / sizeof(T));
+  }
+
+  static unsigned findFirstDiff(const double* a, const double* b,
+                                unsigned from, unsigned to) {
+    GCVIEW_ASSERT(from <= to);
+    return from + (unsigned) findFirstDiffDoubles(a + from, b + from,
+                                                  (size_t) (to - from));
+  }
+
+  template <typename T>
+  static bool areEqual(const T* a, const T* b, unsigned length) {
+    return findFirstDiff(a, b, 0, length) == length;
+  }
+};
+
+}
+
+#endif // _GCVIEW_SIMD_HPP
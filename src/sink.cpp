@@ -0,0 +1,182 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+
+#include "sink.hpp"
+
+namespace gcview {
+
+void RingSink::dropFirstFrame() {
+  GCVIEW_ASSERT(_frame_num > 0);
+  _used -= _frames[_first_frame]._length;
+  _first_frame = (_first_frame + 1) % _max_frame_num;
+  _frame_num -= 1;
+}
+
+void RingSink::copyFrame(unsigned index, OutputSink* sink) const {
+  const Frame* frame = getFrame(index);
+  // it can wrap around the end of the ring
+  const size_t first_length = (frame->_length < _capacity - frame->_start) ?
+    frame->_length : _capacity - frame->_start;
+  sink->write(_ring + frame->_start, first_length);
+  if (first_length < frame->_length) {
+    sink->write(_ring, frame->_length - first_length);
+  }
+}
+
+void RingSink::clear() {
+  _first_frame = 0;
+  _frame_num = 0;
+  _used = 0;
+}
+
+void RingSink::write(const void* data, size_t length) {
+  _offset += (unsigned long long) length;
+  if (_frame_is_dropped) return;
+  if (length > _capacity - _frame_length) {
+    _frame_is_dropped = true;
+    return;
+  }
+
+  while (_used + _frame_length + length > _capacity) {
+    dropFirstFrame();
+  }
+  const size_t pos = (_frame_start + _frame_length) % _capacity;
+  const size_t first_length =
+    (length < _capacity - pos) ? length : _capacity - pos;
+  memcpy(_ring + pos, data, first_length);
+  if (first_length < length) {
+    memcpy(_ring, (const char*) data + first_length, length - first_length);
+  }
+  _frame_length += length;
+}
+
+void RingSink::endFrame() {
+  if (_frame_is_dropped) {
+    _dropped_frame_num += 1;
+  } else if (_frame_length > 0) {
+    if (_frame_num == _max_frame_num) {
+      dropFirstFrame();
+    }
+    Frame* frame = &_frames[(_first_frame + _frame_num) % _max_frame_num];
+    frame->_start = _frame_start;
+    frame->_length = _frame_length;
+    frame->_is_keyframe = _frame_is_keyframe;
+    _frame_num += 1;
+    _used += _frame_length;
+    _frame_start = (_frame_start + _frame_length) % _capacity;
+  }
+  _frame_length = 0;
+  _frame_is_keyframe = false;
+  _frame_is_dropped = false;
+}
+
+RingSink::RingSink(size_t capacity, unsigned max_frame_num)
+    : _ring(NULL), _capacity(capacity), _frames(NULL),
+      _max_frame_num(max_frame_num), _first_frame(0), _frame_num(0),
+      _used(0), _frame_start(0), _frame_length(0),
+      _frame_is_keyframe(false), _frame_is_dropped(false),
+      _offset(0), _dropped_frame_num(0) {
+  GCVIEW_ASSERT(capacity > 0);
+  GCVIEW_ASSERT(max_frame_num > 0);
+  _ring = new char[capacity];
+  GCVIEW_ALLOC_GUARANTEE(_ring);
+  _frames = new Frame[max_frame_num];
+  GCVIEW_ALLOC_GUARANTEE(_frames);
+}
+
+RingSink::~RingSink() {
+  delete[] _frames;
+  delete[] _ring;
+}
+
+#if GCVIEW_ENABLE_ZLIB
+
+void GzipSink::init(int level) {
+  _stream.zalloc = Z_NULL;
+  _stream.zfree = Z_NULL;
+  _stream.opaque = Z_NULL;
+  // 16 + window bits: gzip header / trailer instead of zlib ones
+  const int ret = deflateInit2(&_stream, level, Z_DEFLATED, 16 + MAX_WBITS,
+                               8 /* mem level */, Z_DEFAULT_STRATEGY);
+  GCVIEW_GUARANTEE(ret == Z_OK, "could not initialize zlib");
+  _chunk = new unsigned char[GCVIEW_GZIP_SINK_CHUNK_SIZE];
+  GCVIEW_ALLOC_GUARANTEE(_chunk);
+}
+
+void GzipSink::deflateInput(int flush) {
+  do {
+    _stream.next_out = _chunk;
+    _stream.avail_out = GCVIEW_GZIP_SINK_CHUNK_SIZE;
+    const int ret = deflate(&_stream, flush);
+    GCVIEW_GUARANTEE(ret != Z_STREAM_ERROR, "zlib stream error");
+    const size_t length = GCVIEW_GZIP_SINK_CHUNK_SIZE - _stream.avail_out;
+    if (length > 0) {
+      fwrite(_chunk, 1, length, _fout);
+      _bytes_written += (unsigned long long) length;
+    }
+  } while (_stream.avail_out == 0);
+}
+
+void GzipSink::write(const void* data, size_t length) {
+  if (length == 0) return;
+
+  _in_frame = true;
+  _bytes_in += (unsigned long long) length;
+  _stream.next_in = (Bytef*) data;
+  _stream.avail_in = (uInt) length;
+  deflateInput(Z_NO_FLUSH);
+  GCVIEW_ASSERT(_stream.avail_in == 0);
+}
+
+void GzipSink::endFrame() {
+  if (_in_frame) {
+    deflateInput(Z_FINISH);
+    // starts a new gzip member
+    deflateReset(&_stream);
+    _in_frame = false;
+    _frame_num += 1;
+  }
+  fflush(_fout);
+}
+
+GzipSink::GzipSink(FILE* fout, int level)
+    : _fout(fout), _owns_file(false), _chunk(NULL), _in_frame(false),
+      _frame_num(0), _bytes_in(0), _bytes_written(0) {
+  GCVIEW_ASSERT(fout != NULL);
+  init(level);
+}
+
+GzipSink::GzipSink(const char* file_name, int level)
+    : _fout(NULL), _owns_file(true), _chunk(NULL), _in_frame(false),
+      _frame_num(0), _bytes_in(0), _bytes_written(0) {
+  GCVIEW_ASSERT(file_name != NULL);
+  _fout = fopen(file_name, "wb");
+  GCVIEW_GUARANTEE(_fout != NULL, "could not open file");
+  init(level);
+}
+
+GzipSink::~GzipSink() {
+  endFrame();
+  deflateEnd(&_stream);
+  delete[] _chunk;
+  if (_owns_file) {
+    fclose(_fout);
+  }
+}
+
+#endif // GCVIEW_ENABLE_ZLIB
+
+}
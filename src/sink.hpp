@@ -0,0 +1,213 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_SINK_HPP
+
+#define _GCVIEW_SINK_HPP
+
+#include <stdio.h>
+
+#include "utils.hpp"
+
+// Set to 0 to build without zlib (i.e., without GzipSink).
+#ifndef GCVIEW_ENABLE_ZLIB
+#define GCVIEW_ENABLE_ZLIB 1
+#endif
+
+#if GCVIEW_ENABLE_ZLIB
+#include <zlib.h>
+#endif
+
+#define GCVIEW_GZIP_SINK_LEVEL      6
+#define GCVIEW_GZIP_SINK_CHUNK_SIZE (64 * 1024)
+
+namespace gcview {
+
+// Where a JSONWriter sends its output. The output is split into frames
+// by endFrame(), which JSONWriter::flush() calls, so there is a frame
+// boundary after every record GCview writes.
+class OutputSink {
+public:
+  virtual void write(const void* data, size_t length) = 0;
+  // Ends the current frame and hands it to the OS.
+  virtual void endFrame() = 0;
+  // The file offset at which the next frame will start, only valid
+  // right after endFrame() (see TraceIndexWriter).
+  virtual unsigned long long getOffset() const = 0;
+
+  virtual ~OutputSink() { }
+};
+
+// Writes the output as is; a frame boundary is just an fflush().
+class FileSink : public OutputSink {
+private:
+  FILE* _fout;
+  const bool _owns_file;
+  // relative to where the file was when the sink was created
+  unsigned long long _offset;
+
+public:
+  FileSink(FILE* fout) : _fout(fout), _owns_file(false), _offset(0) {
+    GCVIEW_ASSERT(fout != NULL);
+  }
+
+  FileSink(const char* file_name)
+      : _fout(NULL), _owns_file(true), _offset(0) {
+    GCVIEW_ASSERT(file_name != NULL);
+    _fout = fopen(file_name, "w");
+    GCVIEW_GUARANTEE(_fout != NULL, "could not open file");
+  }
+
+  virtual void write(const void* data, size_t length) {
+    fwrite(data, 1, length, _fout);
+    _offset += (unsigned long long) length;
+  }
+
+  virtual void endFrame() {
+    fflush(_fout);
+  }
+
+  virtual unsigned long long getOffset() const { return _offset; }
+
+  virtual ~FileSink() {
+    if (_owns_file) {
+      fclose(_fout);
+    }
+  }
+};
+
+// Keeps the last frames in a ring of fixed size, allocated up front,
+// so writing never allocates (see FlightRecorder). When a frame does
+// not fit, the oldest frames are dropped to make room for it; the
+// number of frames it keeps is also bounded. A frame longer than the
+// whole ring is dropped instead.
+class RingSink : public OutputSink {
+private:
+  typedef struct {
+    size_t _start;
+    size_t _length;
+    bool   _is_keyframe;
+  } Frame;
+
+  char* _ring;
+  const size_t _capacity;
+  Frame* _frames;
+  const unsigned _max_frame_num;
+  unsigned _first_frame;
+  unsigned _frame_num;
+  // bytes of the complete frames
+  size_t _used;
+
+  // the frame being written
+  size_t _frame_start;
+  size_t _frame_length;
+  bool _frame_is_keyframe;
+  bool _frame_is_dropped;
+
+  unsigned long long _offset;
+  unsigned long long _dropped_frame_num;
+
+  const Frame* getFrame(unsigned index) const {
+    GCVIEW_ASSERT(index < _frame_num);
+    return &_frames[(_first_frame + index) % _max_frame_num];
+  }
+
+  void dropFirstFrame();
+
+  // not copyable
+  RingSink(const RingSink&);
+  RingSink& operator=(const RingSink&);
+
+public:
+  RingSink(size_t capacity, unsigned max_frame_num);
+
+  // Marks the frame being written as one that a reader can start
+  // from. Frames are not, by default.
+  void markKeyframe() { _frame_is_keyframe = true; }
+
+  // The complete frames in the ring, 0 is the oldest one.
+  unsigned getFrameNum() const { return _frame_num; }
+  bool isKeyframe(unsigned index) const {
+    return getFrame(index)->_is_keyframe;
+  }
+  size_t getFrameLength(unsigned index) const {
+    return getFrame(index)->_length;
+  }
+  // Writes a frame to another sink, without ending a frame there.
+  void copyFrame(unsigned index, OutputSink* sink) const;
+
+  // Frames that were longer than the ring.
+  unsigned long long getDroppedFrameNum() const { return _dropped_frame_num; }
+
+  // Drops all complete frames.
+  void clear();
+
+  virtual void write(const void* data, size_t length);
+  virtual void endFrame();
+  // All bytes written, including the ones that were dropped since.
+  virtual unsigned long long getOffset() const { return _offset; }
+
+  virtual ~RingSink();
+};
+
+#if GCVIEW_ENABLE_ZLIB
+
+// Compresses the output with zlib. Every frame is a complete gzip
+// member and a gzip file can have any number of them, so the file can
+// be read with gzip -dc / zcat at any time, a process that crashes
+// leaves all its complete frames readable, and a reader can start
+// decompressing at the start of any frame (see getBytesWritten()).
+// Frames with no output are not written.
+class GzipSink : public OutputSink {
+private:
+  FILE*          _fout;
+  const bool     _owns_file;
+  z_stream       _stream;
+  unsigned char* _chunk;
+  bool           _in_frame;
+
+  unsigned long long _frame_num;
+  unsigned long long _bytes_in;
+  unsigned long long _bytes_written;
+
+  void init(int level);
+  void deflateInput(int flush);
+
+  // not copyable
+  GzipSink(const GzipSink&);
+  GzipSink& operator=(const GzipSink&);
+
+public:
+  GzipSink(FILE* fout, int level = GCVIEW_GZIP_SINK_LEVEL);
+  GzipSink(const char* file_name, int level = GCVIEW_GZIP_SINK_LEVEL);
+
+  // Complete frames, uncompressed bytes and compressed bytes so far.
+  // Right after endFrame(), getBytesWritten() is the file offset at
+  // which the next frame will start.
+  unsigned long long getFrameNum() const { return _frame_num; }
+  unsigned long long getBytesIn() const { return _bytes_in; }
+  unsigned long long getBytesWritten() const { return _bytes_written; }
+
+  virtual void write(const void* data, size_t length);
+  virtual void endFrame();
+  virtual unsigned long long getOffset() const { return _bytes_written; }
+
+  virtual ~GzipSink();
+};
+
+#endif // GCVIEW_ENABLE_ZLIB
+
+}
+
+#endif // _GCVIEW_SINK_HPP
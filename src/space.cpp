@@ -14,6 +14,7 @@
 
 #include "json.hpp"
 #include "space.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 
 namespace gcview {
@@ -21,20 +22,53 @@ namespace gcview {
 #define ITERATE_DATA(__cmd__) \
   GCVIEW_ARRAY_ITERATE(&_data, Data*, the_data, __cmd__)
 
+#define DATA_KIND_CASE(__kind__, __class__) \
+  case __kind__: \
+    modified = ((__class__*) the_data)->__class__::isValueModified(); \
+    break
+
+void Space::captureValues() {
+  GCVIEW_ARRAY_ITERATE(&_concurrent_data, Data*, the_data, {
+    the_data->captureValue();
+  });
+}
+
 void Space::updateModifiedFlags() {
-  bool modified = false;
-  ITERATE_DATA({
-    the_data->updateModifiedFlag();
-    if (the_data->isModified()) {
-      modified = true;
+  bool space_modified = false;
+  const unsigned length = _data.getLength();
+  for (unsigned i = 0; i < length; i += 1) {
+    Data* the_data = _data[i];
+    bool modified;
+    switch (_data_kinds[i]) {
+    DATA_KIND_CASE(BoolValueKind,   BoolValue);
+    DATA_KIND_CASE(ByteValueKind,   ByteValue);
+    DATA_KIND_CASE(IntValueKind,    IntValue);
+    DATA_KIND_CASE(DoubleValueKind, DoubleValue);
+    DATA_KIND_CASE(StringValueKind, StringValue);
+    DATA_KIND_CASE(EnumValueKind,   EnumValue);
+    DATA_KIND_CASE(BoolArrayKind,   BoolArray);
+    DATA_KIND_CASE(ByteArrayKind,   ByteArray);
+    DATA_KIND_CASE(IntArrayKind,    IntArray);
+    DATA_KIND_CASE(DoubleArrayKind, DoubleArray);
+    DATA_KIND_CASE(StringArrayKind, StringArray);
+    DATA_KIND_CASE(EnumArrayKind,   EnumArray);
+    default:
+      modified = the_data->isValueModified();
+      break;
     }
-  });
-  _modified = modified;
+    the_data->updateModifiedFlag(modified);
+    _data_modified[i] = modified;
+    space_modified = space_modified || modified;
+  }
+  _modified = space_modified;
 }
 
+#undef DATA_KIND_CASE
+
 void Space::updateModifiedFlags(bool modified) {
   ITERATE_DATA({
     the_data->updateModifiedFlag(modified);
+    _data_modified[the_index] = modified;
   });
   _modified = modified;
 }
@@ -45,19 +79,37 @@ void Space::updatePrevValues() {
   });
 }
 
-Data* Space::addData(Data* data) {
+void Space::endWindows() {
+  GCVIEW_ARRAY_ITERATE(&_windowed_data, Data*, the_data, {
+    the_data->endWindow();
+  });
+}
+
+Data* Space::addData(Data* data, DataKind kind) {
+  GCVIEW_GUARANTEE(!_has_static_layout,
+                   "data cannot be added to a static space");
   GCVIEW_GUARANTEE(findData(data->getName(), false /* should succeed */) == NULL,
                    "data with that name alredy exist");
   unsigned id = _data.add(data);
+  _data_index.add(data->getName(), id);
+  _data_kinds.add((unsigned char) kind);
+  _data_modified.add(data->isModified());
+  if (data->isConcurrent()) {
+    _concurrent_data.add(data);
+  }
+  if (data->_is_windowed) {
+    _windowed_data.add(data);
+  }
   data->setID(id);
   return data;
 }
 
 Data* Space::findData(const char* name,
                       bool should_succeed) const {
-  ITERATE_DATA({
-    if (!strcmp(name, the_data->getName())) return the_data;
-  });
+  const unsigned id = _data_index.find(name);
+  if (id != NameIndex::NotFound) {
+    return _data[id];
+  }
   GCVIEW_GUARANTEE(!should_succeed, "data not found");
   return NULL;
 }
@@ -78,28 +130,82 @@ void Space::writeJSONMetadata(JSONWriter *writer) const {
   }
 }
 
-void Space::writeJSONData(JSONWriter *writer) const {
+void Space::writeJSONData(JSONWriter *writer, bool keyframe) const {
   if (_modified) {
     JSONArrayWriter y(writer, true /* add_newlines */);
     ITERATE_DATA({
         y.startElem();
-        the_data->writeJSONData(writer);
+        if (keyframe) {
+          the_data->writeJSONDataSpecial(writer);
+        } else {
+          the_data->writeJSONData(writer);
+        }
       });
   } else {
     writer->writeNull();
   }
 }
 
+void Space::writeTraceMetadata(TraceWriter *writer) const {
+  writer->writeVarint(_id);
+  writer->write(_name);
+  writer->writeLength(_data.getLength());
+  ITERATE_DATA({
+    the_data->writeTraceMetadata(writer);
+  });
+}
+
+unsigned Space::getModifiedDataNum() const {
+  unsigned modified_num = 0;
+  const unsigned length = _data_modified.getLength();
+  for (unsigned i = 0; i < length; i += 1) {
+    if (_data_modified[i]) {
+      modified_num += 1;
+    }
+  }
+  return modified_num;
+}
+
+void Space::writeTraceData(TraceWriter *writer, bool keyframe) const {
+  GCVIEW_ASSERT(_modified);
+  writer->writeVarint(_id);
+  writer->writeLength(getModifiedDataNum());
+  ITERATE_DATA({
+    if (_data_modified[the_index]) {
+      writer->writeVarint(the_data->_id);
+      if (keyframe) {
+        the_data->writeTraceDataSpecial(writer);
+      } else {
+        the_data->writeTraceDataUpdate(writer);
+      }
+    }
+  });
+}
+
 void Space::validate() const {
   ITERATE_DATA({ the_data->validate(); });
 }
 
-Space::Space(const char* name)
-    : _name(Utils::cloneStr(name)), _modified(false) { }
+Space::Space(const char* name, Arena* arena)
+    : _arena(arena), _is_in_arena(false),
+      _name((arena != NULL) ? arena->cloneStr(name) : Utils::cloneStr(name)),
+      _data_index(arena), _modified(false), _has_static_layout(false) { }
 
 Space::~Space() {
-  delete[] _name;
-  ITERATE_DATA({ delete the_data; });
+  if (_arena == NULL) {
+    delete[] _name;
+  }
+  if (_has_static_layout) {
+    // the fields were already destroyed
+    return;
+  }
+  ITERATE_DATA({
+    if (the_data->_is_in_arena) {
+      the_data->~Data();
+    } else {
+      delete the_data;
+    }
+  });
 }
 
 }
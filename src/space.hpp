@@ -16,65 +16,174 @@
 
 #define _GCVIEW_SPACE_HPP
 
+#include "arena.hpp"
 #include "array.hpp"
 #include "data.hpp"
+#include "name_index.hpp"
 
 namespace gcview {
 
 class GCview;
 class JSONWriter;
+class TraceWriter;
 
 class Space {
   friend class GCview;
+  template <typename L> friend class StaticSpace;
 
 private:
+  // Where the name, the data and their names are allocated, NULL if
+  // they are on the heap (see GCview::addSpace()).
+  Arena* const _arena;
+  // Whether the space itself is in the arena.
+  bool _is_in_arena;
   unsigned _id;
   const char* const _name;
   Array<Data*> _data;
+  // Side table with one entry per data, in the same order as _data,
+  // so that the per-snapshot scans go over contiguous bytes.
+  Array<unsigned char> _data_kinds;
+  Array<bool> _data_modified;
+  // the data that is updated concurrently (see Data::isConcurrent())
+  Array<Data*> _concurrent_data;
+  // the data that is restarted after each data record (see
+  // Data::endWindow())
+  Array<Data*> _windowed_data;
+  NameIndex _data_index;
   bool _modified;
+  // Whether the data are the fields of a StaticSpace (see schema.hpp),
+  // they are then destroyed with it and no other data can be added.
+  bool _has_static_layout;
 
   void setID(unsigned id) { _id = id; }
 
   bool isModified() const { return _modified; }
-
-  void updateModifiedFlags();
+  unsigned getModifiedDataNum() const;
+
+  // Reads the concurrent data once for the next snapshot.
+  void captureValues();
+  // Called after each data record, not after the metadata.
+  void endWindows();
+  // The per-snapshot loops over the data are virtual, so that a
+  // StaticSpace can go over its fields directly instead.
+  virtual void updateModifiedFlags();
   void updateModifiedFlags(bool modified);
-  void updatePrevValues();
-
-  Data* findData(const char* name, bool should_succeed = true) const;
+  virtual void updatePrevValues();
 
   void writeJSONMetadata(JSONWriter *writer) const;
-  void writeJSONData(JSONWriter *writer) const;
+  virtual void writeJSONData(JSONWriter *writer, bool keyframe) const;
+
+  void writeTraceMetadata(TraceWriter *writer) const;
+  virtual void writeTraceData(TraceWriter *writer, bool keyframe) const;
 
   void validate() const;
 
+  ///// Snapshot steps for a data of known class D (see StaticSpace) /////
+
+  // The methods of D are called directly, not through the vtable.
+
+  template <typename D>
+  void addStaticData(D* data) {
+    addData(data, DataKindOf<D>::Value);
+  }
+
+  template <typename D>
+  bool updateStaticModifiedFlag(D* data) {
+    const bool modified = data->D::isValueModified();
+    data->updateModifiedFlag(modified);
+    _data_modified[data->_id] = modified;
+    return modified;
+  }
+
+  template <typename D>
+  static void updateStaticPrevValue(D* data) { data->D::updatePrevValue(); }
+
+  template <typename D>
+  static void writeStaticJSONData(JSONWriter* writer, const D* data,
+                                  bool keyframe) {
+    if (keyframe) {
+      data->D::writeJSONDataSpecial(writer);
+    } else if (data->_modified) {
+      data->D::writeJSONDataUpdate(writer);
+    } else {
+      writer->writeNull();
+    }
+  }
+
+  template <typename D>
+  void writeStaticTraceData(TraceWriter* writer, const D* data,
+                            bool keyframe) const {
+    if (_data_modified[data->_id]) {
+      writer->writeVarint(data->_id);
+      if (keyframe) {
+        data->D::writeTraceDataSpecial(writer);
+      } else {
+        data->D::writeTraceDataUpdate(writer);
+      }
+    }
+  }
+
   template <typename VDT>
   VDT* findValue(const char* name, bool should_succeed = true) const {
-    VDT* res = (VDT*) findData(name, should_succeed);
-    GCVIEW_ASSERT(VDT::StaticValueDataType == res->getDataType());
-    GCVIEW_ASSERT(!VDT::StaticIsArray);
-    GCVIEW_ASSERT(!res->isArray());
-    return res;
+    Data* res = findData(name, should_succeed);
+    if (res != NULL) {
+      GCVIEW_ASSERT(DataKindOf<VDT>::Value == res->getKind());
+      GCVIEW_ASSERT(VDT::StaticValueDataType == res->getDataType());
+      GCVIEW_ASSERT(!VDT::StaticIsArray);
+      GCVIEW_ASSERT(!res->isArray());
+      GCVIEW_ASSERT(VDT::StaticIsConcurrent == res->isConcurrent());
+    }
+    return (VDT*) res;
   }
 
   template <typename ADT>
   ADT* findArray(const char* name, bool should_succeed = true) const {
-    ADT* res = (ADT*) findData(name, should_succeed);
-    GCVIEW_ASSERT(ADT::StaticArrayDataType == res->getDataType());
-    GCVIEW_ASSERT(ADT::StaticIsArray);
-    GCVIEW_ASSERT(res->isArray());
-    return res;
+    Data* res = findData(name, should_succeed);
+    if (res != NULL) {
+      GCVIEW_ASSERT(DataKindOf<ADT>::Value == res->getKind());
+      GCVIEW_ASSERT(ADT::StaticArrayDataType == res->getDataType());
+      GCVIEW_ASSERT(ADT::StaticIsArray);
+      GCVIEW_ASSERT(res->isArray());
+      GCVIEW_ASSERT(ADT::StaticIsConcurrent == res->isConcurrent());
+    }
+    return (ADT*) res;
   }
 
 public:
   const char* getName() const { return _name; }
 
-  Data* addData(Data* data);
+  Data* findData(const char* name, bool should_succeed = true) const;
+
+  // Looks up a data of class D (e.g., IntValue), and checks that the
+  // data is of that class (see DataKind); for a class without a kind,
+  // only its type can be checked. See also DataHandle (handle.hpp).
+  template <typename D>
+  D* findTypedData(const char* name, bool should_succeed = true) const {
+    Data* res = findData(name, should_succeed);
+    if (res != NULL) {
+      GCVIEW_GUARANTEE((DataKindOf<D>::Value == GenericDataKind ||
+                        DataKindOf<D>::Value == res->getKind()) &&
+                       D::StaticDataType == res->getDataType() &&
+                       D::StaticIsArray == res->isArray() &&
+                       D::StaticIsConcurrent == res->isConcurrent(),
+                       "data is of a different class");
+    }
+    return (D*) res;
+  }
+
+  Data* addData(Data* data, DataKind kind = GenericDataKind);
+  // If the space has an arena, the data is allocated in it.
   template <typename D>
   D* addData(const char* name, const char* group_name = NULL) {
-    D* data = new D(name, group_name);
-    GCVIEW_ALLOC_GUARANTEE(data);
-    addData(data);
+    D* data;
+    if (_arena != NULL) {
+      data = new (_arena) D(name, group_name, _arena);
+      data->_is_in_arena = true;
+    } else {
+      data = new D(name, group_name);
+      GCVIEW_ALLOC_GUARANTEE(data);
+    }
+    addData(data, DataKindOf<D>::Value);
     return data;
   }
 
@@ -130,8 +239,8 @@ public:
     return findArray<EnumArray>(n, ss);
   }
 
-  Space(const char* name);
-  ~Space();
+  Space(const char* name, Arena* arena = NULL);
+  virtual ~Space();
 };
 
 }
@@ -0,0 +1,189 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_STAGING_HPP
+
+#define _GCVIEW_STAGING_HPP
+
+#include "data.hpp"
+#include "utils.hpp"
+
+// The maximum number of threads that can register with a GCview.
+#define GCVIEW_MAX_THREADS 64
+
+// Per-thread staging
+//
+// GCview, Space and Data are not synchronized: a single thread updates
+// the data, starts / ends events and takes the snapshots. Other
+// threads (e.g., parallel GC workers) can register with the GCview
+// (see GCview::registerThread()) and then update:
+//
+//   Staged values : a StagedValue has one slot per thread and each
+//                   thread only adds to its own slot.
+//   Thread events : events started / ended with
+//                   GCview::threadEventStart() / threadEventEnd() are
+//                   tracked per thread, so the events of different
+//                   threads can overlap.
+//
+// Every slot has a single writer and the thread that takes the
+// snapshots only reads it, so neither needs locks or atomic
+// read-modify-writes: both sides use relaxed atomic loads and stores
+// (see AtomicUtils), so that a 64-bit slot is not torn on a 32-bit
+// target. Before every snapshot, GCview merges what the
+// slots accumulated since the previous one into the data (the event
+// counts, for thread events). A snapshot taken while other threads are
+// updating their slots sees each update either entirely or not at all.
+//
+// Staged values and events have to be added before threads register.
+
+namespace gcview {
+
+// What GCview merges before each snapshot.
+class Staging {
+public:
+  // thread_num is the number of threads that registered so far.
+  virtual void merge(unsigned thread_num) = 0;
+
+  virtual ~Staging() { }
+};
+
+// A per-thread accumulator for a value data D (IntValue /
+// DoubleValue), S is the type of the per-thread totals:
+//
+//   StagedIntValue* marked = gcview.addStagedValue(marked_value);
+//   ...
+//   marked->add(thread_id, n);     // on a registered thread
+//
+// Each merge adds the growth of the per-thread totals to the value, so
+// the thread that takes the snapshots can also update it directly.
+template <typename D, typename S>
+class StagedValue : public Staging {
+private:
+  D* const _data;
+  char*    _slot_memory;
+  void*    _slots;
+  // only accessed by the thread that merges
+  S        _merged[GCVIEW_MAX_THREADS];
+
+  volatile S* getSlot(unsigned thread_id) const {
+    GCVIEW_ASSERT(thread_id < GCVIEW_MAX_THREADS);
+    return (volatile S*) CacheLineUtils::getSlot(_slots, thread_id);
+  }
+
+  // not copyable
+  StagedValue(const StagedValue&);
+  StagedValue& operator=(const StagedValue&);
+
+public:
+  D* getData() const { return _data; }
+
+  // Only the thread with that ID can call it.
+  void add(unsigned thread_id, S delta) {
+    volatile S* slot = getSlot(thread_id);
+    AtomicUtils::store(slot, AtomicUtils::load(slot) + delta);
+  }
+
+  // What the thread has added so far.
+  S getThreadTotal(unsigned thread_id) const {
+    return AtomicUtils::load(getSlot(thread_id));
+  }
+
+  virtual void merge(unsigned thread_num) {
+    GCVIEW_ASSERT(thread_num <= GCVIEW_MAX_THREADS);
+    S delta = (S) 0;
+    for (unsigned i = 0; i < thread_num; i += 1) {
+      const S total = AtomicUtils::load(getSlot(i));
+      delta += total - _merged[i];
+      _merged[i] = total;
+    }
+    if (delta != (S) 0) {
+      _data->value() += delta;
+    }
+  }
+
+  StagedValue(D* data) : _data(data), _slot_memory(NULL), _slots(NULL) {
+    GCVIEW_ASSERT(data != NULL);
+    _slots = CacheLineUtils::alloc(GCVIEW_MAX_THREADS, sizeof(S),
+                                   &_slot_memory);
+    for (unsigned i = 0; i < GCVIEW_MAX_THREADS; i += 1) {
+      _merged[i] = (S) 0;
+    }
+  }
+
+  virtual ~StagedValue() {
+    CacheLineUtils::release(_slot_memory);
+  }
+};
+
+typedef StagedValue<IntValue, long long> StagedIntValue;
+typedef StagedValue<DoubleValue, double> StagedDoubleValue;
+
+// The events of a registered thread. Apart from the merged counts, it
+// is only updated by that thread.
+class ThreadEvents {
+  friend class GCview;
+
+private:
+  // the fields the thread updates, on their own cache line
+  typedef struct {
+    volatile double _last_timestamp_sec;
+    double          _event_start_timestamp_sec;
+  } Slot;
+
+  char* _slot_memory;
+  Slot* _slot;
+  // per event, on their own cache lines
+  char*              _count_memory;
+  volatile unsigned* _counts;
+  // only accessed by the thread that merges
+  unsigned*          _merged_counts;
+  const unsigned     _event_num;
+
+  // not copyable
+  ThreadEvents(const ThreadEvents&);
+  ThreadEvents& operator=(const ThreadEvents&);
+
+  // Only called by the thread.
+  void updateLastTimestampSec(double timestamp_sec) {
+    volatile double* last_timestamp_sec = &_slot->_last_timestamp_sec;
+    if (timestamp_sec > AtomicUtils::load(last_timestamp_sec)) {
+      AtomicUtils::store(last_timestamp_sec, timestamp_sec);
+    }
+  }
+
+  ThreadEvents(unsigned event_num) : _event_num(event_num) {
+    _slot = (Slot*) CacheLineUtils::alloc(1, sizeof(Slot), &_slot_memory);
+    _slot->_event_start_timestamp_sec = -1.0;
+    // enough cache lines for all counts, the alignment keeps them off
+    // the lines of other threads
+    const unsigned counts_per_line = GCVIEW_CACHE_LINE_SIZE / sizeof(unsigned);
+    const unsigned line_num =
+      (event_num + counts_per_line - 1) / counts_per_line;
+    _counts = (volatile unsigned*)
+      CacheLineUtils::alloc(line_num, GCVIEW_CACHE_LINE_SIZE, &_count_memory);
+    _merged_counts = new unsigned[event_num + 1];
+    GCVIEW_ALLOC_GUARANTEE(_merged_counts);
+    memset(_merged_counts, 0, (event_num + 1) * sizeof(unsigned));
+  }
+
+  ~ThreadEvents() {
+    delete[] _merged_counts;
+    CacheLineUtils::release(_count_memory);
+    CacheLineUtils::release(_slot_memory);
+  }
+};
+
+}
+
+#endif // _GCVIEW_STAGING_HPP
@@ -0,0 +1,527 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stream.hpp"
+
+#if GCVIEW_ENABLE_STREAMING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+
+namespace gcview {
+
+// the record separator of RFC 7464
+static const char RecordSeparator = 0x1E;
+
+static const unsigned MaxEpollEvents = 16;
+
+static void setNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  GCVIEW_GUARANTEE(flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0,
+                   "could not make file descriptor non-blocking");
+}
+
+#define ITERATE_SUBSCRIBERS(__cmd__) \
+  GCVIEW_ARRAY_ITERATE(&_subscribers, Subscriber*, the_subscriber, __cmd__)
+
+void* StreamServer::threadEntry(void* arg) {
+  ((StreamServer*) arg)->threadLoop();
+  return NULL;
+}
+
+void StreamServer::threadLoop() {
+  struct epoll_event events[MaxEpollEvents];
+  while (true) {
+    const int event_num = epoll_wait(_epoll_fd, events, MaxEpollEvents, -1);
+    GCVIEW_GUARANTEE(event_num >= 0 || errno == EINTR, "epoll_wait failed");
+
+    pthread_mutex_lock(&_lock);
+    if (_stopping) {
+      pthread_mutex_unlock(&_lock);
+      break;
+    }
+    for (int i = 0; i < event_num; i += 1) {
+      const int fd = events[i].data.fd;
+      if (fd == _wake_fds[0]) {
+        char buffer[64];
+        while (read(fd, buffer, sizeof(buffer)) > 0) { }
+        continue;
+      }
+
+      bool is_listen_fd = false;
+      GCVIEW_ARRAY_ITERATE(&_listen_fds, int, listen_fd, {
+        if (listen_fd == fd) {
+          is_listen_fd = true;
+        }
+      });
+      if (is_listen_fd) {
+        acceptSubscribers(fd);
+        continue;
+      }
+
+      Subscriber* subscriber = findSubscriber(fd);
+      if (subscriber != NULL &&
+          (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0) {
+        // the input is ignored, only closes matter
+        char buffer[256];
+        ssize_t length;
+        while ((length = recv(fd, buffer, sizeof(buffer), 0)) > 0) { }
+        if (length == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+          subscriber->_state = ClosedSubscriber;
+        }
+      }
+    }
+
+    takeBatch();
+    if (_sends.getLength() > 0) {
+      pthread_mutex_unlock(&_lock);
+      sendBatch();
+      pthread_mutex_lock(&_lock);
+      finishBatch();
+    }
+    updateSubscribers();
+    if (!hasQueued()) {
+      pthread_cond_broadcast(&_sent);
+    }
+    pthread_mutex_unlock(&_lock);
+  }
+}
+
+void StreamServer::acceptSubscribers(int listen_fd) {
+  while (true) {
+    const int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+      // EAGAIN, or a connection that went away
+      return;
+    }
+    setNonBlocking(fd);
+
+    Subscriber* subscriber = new Subscriber;
+    GCVIEW_ALLOC_GUARANTEE(subscriber);
+    subscriber->_fd = fd;
+    // it gets the full state at the next writeMetadata() / writeData()
+    subscriber->_state = PendingSubscriber;
+    subscriber->_queue = NULL;
+    subscriber->_queue_capacity = 0;
+    subscriber->_queue_head = 0;
+    subscriber->_queue_length = 0;
+    subscriber->_wants_output = false;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    GCVIEW_GUARANTEE(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0,
+                     "could not add subscriber");
+    _subscribers.add(subscriber);
+    _subscriber_num += 1;
+  }
+}
+
+StreamServer::Subscriber* StreamServer::findSubscriber(int fd) const {
+  for (unsigned i = 0; i < _subscribers.getLength(); i += 1) {
+    if (_subscribers[i]->_fd == fd) {
+      return _subscribers[i];
+    }
+  }
+  return NULL;
+}
+
+void StreamServer::copyQueued(const Subscriber* subscriber, size_t length,
+                              char* to) const {
+  GCVIEW_ASSERT(length <= subscriber->_queue_length);
+  const size_t capacity = subscriber->_queue_capacity;
+  const size_t head = subscriber->_queue_head;
+  const size_t first_length =
+    (length < capacity - head) ? length : capacity - head;
+  memcpy(to, subscriber->_queue + head, first_length);
+  if (first_length < length) {
+    memcpy(to + first_length, subscriber->_queue, length - first_length);
+  }
+}
+
+void StreamServer::reserveQueue(Subscriber* subscriber, size_t length) {
+  const size_t min_capacity = subscriber->_queue_length + length;
+  GCVIEW_ASSERT(min_capacity <= _queue_capacity);
+  size_t new_capacity = subscriber->_queue_capacity;
+  if (new_capacity >= min_capacity) return;
+
+  if (new_capacity == 0) {
+    new_capacity = GCVIEW_STREAM_QUEUE_INITIAL_CAPACITY;
+  }
+  while (new_capacity < min_capacity) {
+    new_capacity *= 2;
+  }
+  if (new_capacity > _queue_capacity) {
+    new_capacity = _queue_capacity;
+  }
+  char* new_queue = new char[new_capacity];
+  GCVIEW_ALLOC_GUARANTEE(new_queue);
+  if (subscriber->_queue != NULL) {
+    copyQueued(subscriber, subscriber->_queue_length, new_queue);
+    delete[] subscriber->_queue;
+  }
+  subscriber->_queue = new_queue;
+  subscriber->_queue_capacity = new_capacity;
+  subscriber->_queue_head = 0;
+}
+
+void StreamServer::enqueue(Subscriber* subscriber,
+                           const void* data, size_t length) {
+  reserveQueue(subscriber, length);
+  const size_t capacity = subscriber->_queue_capacity;
+  const size_t pos =
+    (subscriber->_queue_head + subscriber->_queue_length) % capacity;
+  const size_t first_length =
+    (length < capacity - pos) ? length : capacity - pos;
+  memcpy(subscriber->_queue + pos, data, first_length);
+  if (first_length < length) {
+    memcpy(subscriber->_queue, (const char*) data + first_length,
+           length - first_length);
+  }
+  subscriber->_queue_length += length;
+}
+
+void StreamServer::takeBatch() {
+  _send_buffer.clear();
+  _sends.clear();
+  ITERATE_SUBSCRIBERS({
+    if (the_subscriber->_state == ClosedSubscriber ||
+        the_subscriber->_queue_length == 0) {
+      continue;
+    }
+    Send send;
+    send._subscriber = the_subscriber;
+    send._offset = _send_buffer.getLength();
+    send._length = (the_subscriber->_queue_length <
+                    GCVIEW_STREAM_SEND_CHUNK_SIZE) ?
+      the_subscriber->_queue_length : GCVIEW_STREAM_SEND_CHUNK_SIZE;
+    send._sent = 0;
+    send._failed = false;
+    copyQueued(the_subscriber, send._length,
+               (char*) _send_buffer.extend(send._length));
+    _sends.add(send);
+  });
+}
+
+void StreamServer::sendBatch() {
+  for (unsigned i = 0; i < _sends.getLength(); i += 1) {
+    Send* chunk = &_sends[i];
+    const int fd = chunk->_subscriber->_fd;
+    const unsigned char* data = _send_buffer.getData() + chunk->_offset;
+    while (chunk->_sent < chunk->_length) {
+      const ssize_t sent = send(fd, data + chunk->_sent,
+                                chunk->_length - chunk->_sent, MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EINTR) continue;
+        chunk->_failed = errno != EAGAIN && errno != EWOULDBLOCK;
+        break;
+      }
+      chunk->_sent += (size_t) sent;
+    }
+  }
+}
+
+void StreamServer::finishBatch() {
+  for (unsigned i = 0; i < _sends.getLength(); i += 1) {
+    const Send* chunk = &_sends[i];
+    Subscriber* subscriber = chunk->_subscriber;
+    // only this thread takes bytes off the queue, and the ones that
+    // were sent are still at its head even if the queue grew since
+    GCVIEW_ASSERT(chunk->_sent <= subscriber->_queue_length);
+    subscriber->_queue_head = (subscriber->_queue_head + chunk->_sent) %
+      subscriber->_queue_capacity;
+    subscriber->_queue_length -= chunk->_sent;
+    if (chunk->_failed) {
+      subscriber->_state = ClosedSubscriber;
+    }
+  }
+  _sends.clear();
+}
+
+void StreamServer::updateSubscribers() {
+  unsigned i = 0;
+  while (i < _subscribers.getLength()) {
+    Subscriber* subscriber = _subscribers[i];
+    if (subscriber->_state == ClosedSubscriber) {
+      epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, subscriber->_fd, NULL);
+      close(subscriber->_fd);
+      delete[] subscriber->_queue;
+      delete subscriber;
+      // the order of the subscribers does not matter
+      _subscribers[i] = _subscribers[_subscribers.getLength() - 1];
+      _subscribers.removeLast();
+      continue;
+    }
+
+    const bool wants_output = subscriber->_queue_length > 0;
+    if (wants_output != subscriber->_wants_output) {
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = (wants_output) ? EPOLLIN | EPOLLOUT : EPOLLIN;
+      event.data.fd = subscriber->_fd;
+      epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, subscriber->_fd, &event);
+      subscriber->_wants_output = wants_output;
+    }
+    i += 1;
+  }
+}
+
+void StreamServer::moveSubscribers(SubscriberState from_state,
+                                   SubscriberState to_state) {
+  ITERATE_SUBSCRIBERS({
+    if (the_subscriber->_state == from_state) {
+      the_subscriber->_state = to_state;
+    }
+  });
+}
+
+bool StreamServer::hasQueued() const {
+  for (unsigned i = 0; i < _subscribers.getLength(); i += 1) {
+    if (_subscribers[i]->_queue_length > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void StreamServer::publish(const void* record, size_t length) {
+  const char newline = '\n';
+  pthread_mutex_lock(&_lock);
+  ITERATE_SUBSCRIBERS({
+    const bool is_target = the_subscriber->_state == JoiningSubscriber ||
+      (_target == AllTarget && the_subscriber->_state == LiveSubscriber);
+    if (is_target) {
+      if (length + 2 > _queue_capacity - the_subscriber->_queue_length) {
+        the_subscriber->_state = ClosedSubscriber;
+        _dropped_num += 1;
+      } else {
+        reserveQueue(the_subscriber, length + 2);
+        enqueue(the_subscriber, &RecordSeparator, 1);
+        enqueue(the_subscriber, record, length);
+        enqueue(the_subscriber, &newline, 1);
+      }
+    }
+  });
+  pthread_mutex_unlock(&_lock);
+  wake();
+}
+
+void StreamServer::addListenFD(int fd) {
+  setNonBlocking(fd);
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  pthread_mutex_lock(&_lock);
+  _listen_fds.add(fd);
+  GCVIEW_GUARANTEE(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0,
+                   "could not add listening socket");
+  pthread_mutex_unlock(&_lock);
+}
+
+void StreamServer::wake() {
+  const char c = 0;
+  // if the pipe is full, the server thread will wake up anyway
+  ssize_t res = write(_wake_fds[1], &c, 1);
+  (void) res;
+}
+
+void StreamServer::listenUnix(const char* path) {
+  GCVIEW_ASSERT(path != NULL);
+  GCVIEW_ASSERT(_unix_path == NULL);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  GCVIEW_GUARANTEE(strlen(path) < sizeof(addr.sun_path),
+                   "socket path too long");
+  strcpy(addr.sun_path, path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create socket");
+  unlink(path);
+  GCVIEW_GUARANTEE(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0 &&
+                   listen(fd, SOMAXCONN) == 0,
+                   "could not listen on socket");
+  _unix_path = Utils::cloneStr(path);
+  addListenFD(fd);
+}
+
+unsigned StreamServer::listenTCP(unsigned port) {
+  GCVIEW_ASSERT(port <= 0xFFFF);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((unsigned short) port);
+
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create socket");
+  const int reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  socklen_t addr_length = sizeof(addr);
+  GCVIEW_GUARANTEE(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0 &&
+                   listen(fd, SOMAXCONN) == 0 &&
+                   getsockname(fd, (struct sockaddr*) &addr,
+                               &addr_length) == 0,
+                   "could not listen on port");
+  addListenFD(fd);
+  return ntohs(addr.sin_port);
+}
+
+void StreamServer::writeMetadata() {
+  pthread_mutex_lock(&_lock);
+  moveSubscribers(PendingSubscriber, JoiningSubscriber);
+  pthread_mutex_unlock(&_lock);
+
+  _target = AllTarget;
+  _gcview->writeJSONMetadata(&_writer);
+
+  pthread_mutex_lock(&_lock);
+  moveSubscribers(JoiningSubscriber, LiveSubscriber);
+  pthread_mutex_unlock(&_lock);
+}
+
+void StreamServer::writeData() {
+  bool has_joining = false;
+  pthread_mutex_lock(&_lock);
+  moveSubscribers(PendingSubscriber, JoiningSubscriber);
+  ITERATE_SUBSCRIBERS({
+    if (the_subscriber->_state == JoiningSubscriber) {
+      has_joining = true;
+    }
+  });
+  pthread_mutex_unlock(&_lock);
+
+  if (has_joining) {
+    // the metadata becomes the previous snapshot, so the data record
+    // after it has to have the full values for the live subscribers
+    // too (it is a keyframe)
+    _target = JoiningTarget;
+    _gcview->writeJSONMetadata(&_writer);
+  }
+  _target = AllTarget;
+  _gcview->writeJSONData(&_writer, has_joining /* keyframe */);
+
+  pthread_mutex_lock(&_lock);
+  moveSubscribers(JoiningSubscriber, LiveSubscriber);
+  pthread_mutex_unlock(&_lock);
+}
+
+bool StreamServer::flush(double timeout_sec) {
+  // pthread_cond_timedwait() uses the real-time clock
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  const double deadline_sec =
+    (double) now.tv_sec + (double) now.tv_nsec / 1e9 + timeout_sec;
+  struct timespec deadline;
+  deadline.tv_sec = (time_t) deadline_sec;
+  deadline.tv_nsec = (long) ((deadline_sec - (double) deadline.tv_sec) * 1e9);
+
+  pthread_mutex_lock(&_lock);
+  bool sent = !hasQueued();
+  while (!sent) {
+    if (pthread_cond_timedwait(&_sent, &_lock, &deadline) == ETIMEDOUT) {
+      sent = !hasQueued();
+      break;
+    }
+    sent = !hasQueued();
+  }
+  pthread_mutex_unlock(&_lock);
+  return sent;
+}
+
+#define STREAM_SERVER_LOCKED_GETTER(__type__, __name__, __field__) \
+__type__ StreamServer::__name__() { \
+  pthread_mutex_lock(&_lock); \
+  const __type__ res = __field__; \
+  pthread_mutex_unlock(&_lock); \
+  return res; \
+}
+
+STREAM_SERVER_LOCKED_GETTER(unsigned long long, getSubscriberNum,
+                            _subscriber_num)
+STREAM_SERVER_LOCKED_GETTER(unsigned long long, getDroppedNum, _dropped_num)
+
+#undef STREAM_SERVER_LOCKED_GETTER
+
+StreamServer::StreamServer(GCview* gcview, size_t queue_capacity)
+    : _gcview(gcview), _queue_capacity(queue_capacity),
+      _sink(this), _writer(&_sink, GCVIEW_JSON_WRITER_BUFFER_SIZE),
+      _target(AllTarget),
+      _unix_path(NULL), _stopping(false),
+      _subscriber_num(0), _dropped_num(0), _epoll_fd(-1) {
+  GCVIEW_ASSERT(gcview != NULL);
+  GCVIEW_GUARANTEE(queue_capacity > 0, "the queue capacity should be positive");
+
+  _epoll_fd = epoll_create(MaxEpollEvents);
+  GCVIEW_GUARANTEE(_epoll_fd >= 0, "could not create epoll instance");
+  GCVIEW_GUARANTEE(pipe(_wake_fds) == 0, "could not create pipe");
+  setNonBlocking(_wake_fds[0]);
+  setNonBlocking(_wake_fds[1]);
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = _wake_fds[0];
+  GCVIEW_GUARANTEE(epoll_ctl(_epoll_fd, EPOLL_CTL_ADD,
+                             _wake_fds[0], &event) == 0,
+                   "could not add pipe");
+
+  GCVIEW_GUARANTEE(pthread_mutex_init(&_lock, NULL) == 0 &&
+                   pthread_cond_init(&_sent, NULL) == 0,
+                   "could not initialize the server thread synchronization");
+  GCVIEW_GUARANTEE(pthread_create(&_thread, NULL, threadEntry, this) == 0,
+                   "could not start the server thread");
+}
+
+StreamServer::~StreamServer() {
+  pthread_mutex_lock(&_lock);
+  _stopping = true;
+  pthread_mutex_unlock(&_lock);
+  wake();
+  pthread_join(_thread, NULL);
+
+  ITERATE_SUBSCRIBERS({
+    close(the_subscriber->_fd);
+    delete[] the_subscriber->_queue;
+    delete the_subscriber;
+  });
+  GCVIEW_ARRAY_ITERATE(&_listen_fds, int, listen_fd, {
+    close(listen_fd);
+  });
+  if (_unix_path != NULL) {
+    unlink(_unix_path);
+    delete[] _unix_path;
+  }
+  close(_wake_fds[0]);
+  close(_wake_fds[1]);
+  close(_epoll_fd);
+  pthread_cond_destroy(&_sent);
+  pthread_mutex_destroy(&_lock);
+}
+
+#undef ITERATE_SUBSCRIBERS
+
+}
+
+#endif // GCVIEW_ENABLE_STREAMING
@@ -0,0 +1,227 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_STREAM_HPP
+
+#define _GCVIEW_STREAM_HPP
+
+// Set to 0 to build without StreamServer (it needs epoll).
+#ifndef GCVIEW_ENABLE_STREAMING
+#if defined(__linux__)
+#define GCVIEW_ENABLE_STREAMING 1
+#else // defined(__linux__)
+#define GCVIEW_ENABLE_STREAMING 0
+#endif // defined(__linux__)
+#endif // GCVIEW_ENABLE_STREAMING
+
+#if GCVIEW_ENABLE_STREAMING
+
+#include <pthread.h>
+
+#include "array.hpp"
+#include "buffer.hpp"
+#include "json.hpp"
+#include "sink.hpp"
+#include "utils.hpp"
+
+// The bytes that can be queued for a subscriber before it is dropped.
+#define GCVIEW_STREAM_QUEUE_CAPACITY (4 * 1024 * 1024)
+// The size a queue starts with, when the first record is queued; it
+// doubles as needed, up to the capacity.
+#define GCVIEW_STREAM_QUEUE_INITIAL_CAPACITY (64 * 1024)
+// The most queued bytes the server thread sends to a subscriber at a
+// time.
+#define GCVIEW_STREAM_SEND_CHUNK_SIZE (64 * 1024)
+
+namespace gcview {
+
+class GCview;
+
+// Streams the records of a GCview to any number of subscribers that
+// connect to a Unix domain socket or to a localhost TCP port:
+//
+//   StreamServer server(&gcview);
+//   server.listenUnix("/tmp/gcview.sock");
+//   server.writeMetadata();
+//   ...
+//   gcview.eventEnd();
+//   server.writeData();
+//
+// The stream is a JSON text sequence (RFC 7464): every record is sent
+// as an RS character (0x1E), the record and a newline. A subscriber
+// first gets a metadata record with the current full state, at the
+// next writeMetadata() or writeData(), and then the data records. When
+// the metadata record is for subscribers that connected since the
+// previous record, the data record after it is a keyframe (see
+// index.hpp).
+//
+// The records are formatted once, on the calling thread, and queued
+// for each subscriber. A separate thread accepts the connections and
+// sends the queued records with non-blocking I/O and an epoll loop.
+// It copies a chunk of each queue out while holding the lock and sends
+// them after releasing it, so the calling thread never waits for a
+// send. A subscriber that does not keep up, i.e., whose queue would
+// grow past queue_capacity bytes, is disconnected. Whatever the
+// subscribers send is ignored.
+class StreamServer {
+  class RecordSink;
+  friend class RecordSink;
+
+private:
+  typedef enum {
+    // connected, waiting for the full state
+    PendingSubscriber,
+    // getting the full state
+    JoiningSubscriber,
+    LiveSubscriber,
+    // to be closed by the server thread
+    ClosedSubscriber
+  } SubscriberState;
+
+  typedef struct {
+    int             _fd;
+    SubscriberState _state;
+    // a ring of _queue_capacity bytes, NULL until the first record
+    char*           _queue;
+    size_t          _queue_capacity;
+    size_t          _queue_head;
+    size_t          _queue_length;
+    bool            _wants_output;
+  } Subscriber;
+
+  // A chunk of a subscriber queue, copied to _send_buffer.
+  typedef struct {
+    Subscriber* _subscriber;
+    size_t      _offset;
+    size_t      _length;
+    size_t      _sent;
+    bool        _failed;
+  } Send;
+
+  typedef enum {
+    JoiningTarget,
+    AllTarget
+  } Target;
+
+  // Hands each record the JSONWriter writes to the server.
+  class RecordSink : public OutputSink {
+  private:
+    StreamServer* const _server;
+    ByteBuffer _record;
+    unsigned long long _offset;
+
+  public:
+    virtual void write(const void* data, size_t length) {
+      _record.append(data, length);
+      _offset += (unsigned long long) length;
+    }
+    virtual void endFrame() {
+      if (_record.getLength() > 0) {
+        _server->publish(_record.getData(), _record.getLength());
+        _record.clear();
+      }
+    }
+    virtual unsigned long long getOffset() const { return _offset; }
+
+    RecordSink(StreamServer* server) : _server(server), _offset(0) { }
+  };
+
+  GCview* const _gcview;
+  const size_t _queue_capacity;
+
+  // only accessed by the calling thread
+  RecordSink _sink;
+  JSONWriter _writer;
+  Target _target;
+
+  // protected by _lock
+  pthread_mutex_t _lock;
+  pthread_cond_t _sent;
+  Array<Subscriber*> _subscribers;
+  Array<int> _listen_fds;
+  const char* _unix_path;
+  bool _stopping;
+  unsigned long long _subscriber_num;
+  unsigned long long _dropped_num;
+
+  // only accessed by the server thread
+  ByteBuffer _send_buffer;
+  Array<Send> _sends;
+
+  int _epoll_fd;
+  // written to wake the server thread up
+  int _wake_fds[2];
+  pthread_t _thread;
+
+  static void* threadEntry(void* arg);
+  void threadLoop();
+
+  // Called without _lock held: the subscribers are only deleted by the
+  // server thread and the chunks are copies.
+  void sendBatch();
+
+  // All are called with _lock held.
+  void acceptSubscribers(int listen_fd);
+  Subscriber* findSubscriber(int fd) const;
+  void copyQueued(const Subscriber* subscriber, size_t length,
+                  char* to) const;
+  void reserveQueue(Subscriber* subscriber, size_t length);
+  void enqueue(Subscriber* subscriber, const void* data, size_t length);
+  void takeBatch();
+  void finishBatch();
+  void updateSubscribers();
+  void moveSubscribers(SubscriberState from_state, SubscriberState to_state);
+  bool hasQueued() const;
+
+  void publish(const void* record, size_t length);
+  void addListenFD(int fd);
+  void wake();
+
+  // not copyable
+  StreamServer(const StreamServer&);
+  StreamServer& operator=(const StreamServer&);
+
+public:
+  // Both abort if they cannot listen. listenTCP() only listens on the
+  // loopback interface, a port of 0 picks a free one; it returns the
+  // port.
+  void listenUnix(const char* path);
+  unsigned listenTCP(unsigned port);
+
+  // The full state, to all subscribers.
+  void writeMetadata();
+  // A data record, after the full state to subscribers that connected
+  // since the previous one.
+  void writeData();
+
+  // Waits until the records written so far have been handed to the OS
+  // for all subscribers, or for timeout_sec. Returns whether they
+  // have.
+  bool flush(double timeout_sec);
+
+  // Statistics: subscribers that connected and that were disconnected
+  // because they did not keep up.
+  unsigned long long getSubscriberNum();
+  unsigned long long getDroppedNum();
+
+  StreamServer(GCview* gcview,
+               size_t queue_capacity = GCVIEW_STREAM_QUEUE_CAPACITY);
+  ~StreamServer();
+};
+
+}
+
+#endif // GCVIEW_ENABLE_STREAMING
+
+#endif // _GCVIEW_STREAM_HPP
@@ -0,0 +1,474 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "data.hpp"
+#include "encoding.hpp"
+#include "json.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+namespace gcview {
+
+////////// TraceWriter //////////
+
+void TraceWriter::writeHeader() {
+  const unsigned char version = Version;
+  baseWrite(getMagic(), strlen(getMagic()));
+  baseWrite(&version, 1);
+}
+
+void TraceWriter::startRecord(RecordType type) {
+  GCVIEW_ASSERT(!_in_record);
+  _in_record = true;
+  _record.clear();
+  _record.appendByte((unsigned char) type);
+}
+
+void TraceWriter::endRecord() {
+  GCVIEW_ASSERT(_in_record);
+  _in_record = false;
+
+  // the record buffer holds the type followed by the payload, the
+  // length of the payload goes between them
+  const unsigned char* data = _record.getData();
+  const size_t payload_length = _record.getLength() - 1;
+  unsigned char header[16];
+  unsigned header_length = 0;
+  header[header_length] = data[0];
+  header_length += 1;
+  unsigned long long val = payload_length;
+  while (val >= 0x80) {
+    header[header_length] = (unsigned char) (val | 0x80);
+    header_length += 1;
+    val >>= 7;
+  }
+  header[header_length] = (unsigned char) val;
+  header_length += 1;
+
+  baseWrite(header, header_length);
+  baseWrite(data + 1, payload_length);
+}
+
+TraceWriter::TraceWriter(FILE* fout)
+    : _fout(fout), _file_name(NULL), _out_buffer(NULL),
+      _in_record(false), _bytes_written(0) {
+  writeHeader();
+}
+
+TraceWriter::TraceWriter(const char* file_name)
+    : _fout(NULL), _file_name(file_name), _out_buffer(NULL),
+      _in_record(false), _bytes_written(0) {
+  GCVIEW_ASSERT(file_name != NULL);
+  _fout = fopen(file_name, "wb");
+  GCVIEW_GUARANTEE(_fout != NULL, "could not open file");
+  writeHeader();
+}
+
+TraceWriter::TraceWriter(ByteBuffer* out_buffer)
+    : _fout(NULL), _file_name(NULL), _out_buffer(out_buffer),
+      _in_record(false), _bytes_written(0) {
+  GCVIEW_ASSERT(out_buffer != NULL);
+}
+
+TraceWriter::~TraceWriter() {
+  GCVIEW_ASSERT(!_in_record);
+
+  if (_file_name != NULL) {
+    fclose(_fout);
+  } else if (_fout != NULL) {
+    fflush(_fout);
+  }
+}
+
+////////// TraceConverter //////////
+
+#define ITERATE_CONVERTER_SPACES(__cmd__) \
+  GCVIEW_ARRAY_ITERATE(&_spaces, Vector<unsigned char>*, the_space, __cmd__)
+
+bool TraceConverter::readRecord(TraceWriter::RecordType* type) {
+  int c = fgetc(_fin);
+  if (c == EOF) {
+    return false;
+  }
+  *type = (TraceWriter::RecordType) c;
+
+  unsigned long long length = 0;
+  unsigned shift = 0;
+  while (true) {
+    c = fgetc(_fin);
+    if (c == EOF) {
+      // truncated record (e.g., the traced process crashed)
+      return false;
+    }
+    length |= (unsigned long long) (c & 0x7f) << shift;
+    if ((c & 0x80) == 0) break;
+    shift += 7;
+    GCVIEW_GUARANTEE(shift < 64, "malformed trace");
+  }
+
+  _record.clear();
+  unsigned char* payload = _record.extend((size_t) length);
+  if (fread(payload, 1, (size_t) length, _fin) != (size_t) length) {
+    return false;
+  }
+  _pos = _record.getData();
+  _end = _pos + length;
+  return true;
+}
+
+double TraceConverter::readDouble() {
+  uint64_t bits = 0;
+  for (unsigned i = 0; i < 8; i += 1) {
+    bits |= (uint64_t) readByte() << (8 * i);
+  }
+  double val;
+  memcpy(&val, &bits, sizeof(val));
+  return val;
+}
+
+const char* TraceConverter::readStr() {
+  const unsigned long long length = readVarint();
+  GCVIEW_GUARANTEE(length <= (unsigned long long) (_end - _pos),
+                   "malformed trace");
+  _str.clear();
+  _str.append(_pos, (size_t) length);
+  _str.appendByte('\0');
+  _pos += length;
+  return (length > 0) ? (const char*) _str.getData() : NULL;
+}
+
+void TraceConverter::reclaimSpaces() {
+  ITERATE_CONVERTER_SPACES({ delete the_space; });
+  _spaces.clear();
+}
+
+void TraceConverter::convertElem(JSONWriter* writer, unsigned data_type) {
+  switch (data_type) {
+  case Data::BoolType:
+    writer->write(readByte() != 0);
+    break;
+  case Data::ByteType:
+  case Data::EnumType:
+    writer->write((unsigned) readVarint());
+    break;
+  case Data::IntType:
+    writer->write(readZigZag());
+    break;
+  case Data::DoubleType:
+    writer->write(readDouble());
+    break;
+  case Data::StringType:
+    writer->write(readStr());
+    break;
+  default:
+    GCVIEW_UNREACHABLE_BREAK("unknown data type");
+  }
+}
+
+void TraceConverter::convertEncoded(JSONWriter* writer, unsigned data_type,
+                                    unsigned encoding,
+                                    unsigned long long length) {
+  JSONObjectWriter x(writer);
+  x.startPair(Data::getEncodingStr((Data::Encoding) encoding));
+  switch (encoding) {
+  case Data::DeltaEncoding: {
+    JSONArrayWriter y(writer);
+    for (unsigned long long i = 0; i < length; i += 1) {
+      y.writeElem(readZigZag());
+    }
+    break;
+  }
+  case Data::VarintEncoding: {
+    // the zig-zag varints are the bytes to be base64-encoded
+    const unsigned char* start = _pos;
+    for (unsigned long long i = 0; i < length; i += 1) {
+      readVarint();
+    }
+    _str.clear();
+    EncodingUtils::appendBase64(&_str, start, _pos - start);
+    writer->write((const char*) _str.getData());
+    break;
+  }
+  case Data::XorFloatEncoding: {
+    const unsigned long long byte_num = readVarint();
+    GCVIEW_GUARANTEE(byte_num <= (unsigned long long) (_end - _pos),
+                     "malformed trace");
+    _str.clear();
+    EncodingUtils::appendBase64(&_str, _pos, (size_t) byte_num);
+    _pos += byte_num;
+    writer->write((const char*) _str.getData());
+    break;
+  }
+  case Data::RunLengthEncoding: {
+    JSONArrayWriter y(writer);
+    unsigned long long covered = 0;
+    while (covered < length) {
+      y.startElem();
+      convertElem(writer, data_type);
+      const unsigned long long run = readVarint();
+      GCVIEW_GUARANTEE(run > 0 && run <= length - covered, "malformed trace");
+      y.writeElem((unsigned) run);
+      covered += run;
+    }
+    break;
+  }
+  default:
+    GCVIEW_UNREACHABLE_BREAK("unknown encoding");
+  }
+}
+
+void TraceConverter::convertValue(JSONWriter* writer, unsigned char desc) {
+  const unsigned data_type = desc & DataTypeMask;
+  if ((desc & IsArrayFlag) != 0) {
+    const unsigned long long header = readVarint();
+    const unsigned long long length = header >> 2;
+    const unsigned form = (unsigned) (header & 3);
+    if (form == TraceWriter::FullArray) {
+      JSONArrayWriter y(writer);
+      for (unsigned long long i = 0; i < length; i += 1) {
+        y.startElem();
+        convertElem(writer, data_type);
+      }
+    } else if (form == TraceWriter::EncodedArray) {
+      const unsigned encoding = (desc & ~IsArrayFlag) >> EncodingShift;
+      GCVIEW_GUARANTEE(encoding != Data::PlainEncoding, "malformed trace");
+      convertEncoded(writer, data_type, encoding, length);
+    } else if (form == TraceWriter::RunPatchArray) {
+      JSONObjectWriter x(writer);
+      x.startPair("RunPatch");
+      JSONArrayWriter y(writer);
+      unsigned index = 0;
+      for (unsigned long long i = 0; i < length; i += 1) {
+        index += (unsigned) readVarint();
+        const unsigned run = (unsigned) readVarint();
+        y.writeElem(index);
+        y.writeElem(run);
+        y.startElem();
+        convertElem(writer, data_type);
+        index += run;
+      }
+    } else {
+      GCVIEW_GUARANTEE(form == TraceWriter::PatchArray, "malformed trace");
+      JSONObjectWriter x(writer);
+      x.startPair("Patch");
+      JSONArrayWriter y(writer);
+      unsigned index = 0;
+      for (unsigned long long i = 0; i < length; i += 1) {
+        index += (unsigned) readVarint();
+        y.writeElem(index);
+        y.startElem();
+        convertElem(writer, data_type);
+      }
+    }
+  } else {
+    convertElem(writer, data_type);
+  }
+}
+
+void TraceConverter::convertMetadata(JSONWriter* writer) {
+  reclaimSpaces();
+
+  JSONObjectWriter x(writer);
+  x.startPair("GCviewMetadata");
+  {
+    JSONObjectWriter y(writer);
+    y.startPair("Spaces");
+    {
+      JSONArrayWriter z(writer, true /* add_newlines */);
+      const unsigned long long space_num = readVarint();
+      for (unsigned long long i = 0; i < space_num; i += 1) {
+        z.startElem();
+
+        Vector<unsigned char>* space = new Vector<unsigned char>();
+        GCVIEW_ALLOC_GUARANTEE(space);
+        unsigned space_id = _spaces.add(space);
+        GCVIEW_GUARANTEE(readVarint() == space_id, "malformed trace");
+
+        JSONObjectWriter s(writer);
+        s.writePair("ID", space_id);
+        s.writePair("Name", readStr());
+        s.startPair("Data");
+        {
+          JSONArrayWriter d(writer, true /* add_newlines */);
+          const unsigned long long data_num = readVarint();
+          space->resize((unsigned) data_num);
+          for (unsigned data_id = 0; data_id < data_num; data_id += 1) {
+            d.startElem();
+            GCVIEW_GUARANTEE(readVarint() == data_id, "malformed trace");
+
+            JSONObjectWriter o(writer);
+            o.writePair("ID", data_id);
+            o.writePair("Name", readStr());
+            const unsigned data_type = readByte();
+            const bool is_array = readByte() != 0;
+            o.writePair("DataType",
+                        Data::getDataTypeStr((Data::DataType) data_type));
+            o.writePair("IsArray", is_array);
+            const char* group_name = readStr();
+            if (group_name != NULL) {
+              o.writePair("Group", group_name);
+            }
+            const unsigned encoding = (unsigned) readVarint();
+            GCVIEW_GUARANTEE(encoding <= Data::RunLengthEncoding,
+                             "malformed trace");
+            if (encoding != Data::PlainEncoding) {
+              o.writePair("Encoding",
+                          Data::getEncodingStr((Data::Encoding) encoding));
+            }
+            if (data_type == Data::EnumType) {
+              o.startPair("Members");
+              JSONArrayWriter m(writer);
+              const unsigned long long member_num = readVarint();
+              for (unsigned long long i = 0; i < member_num; i += 1) {
+                m.writeElem(readStr());
+              }
+            }
+            const unsigned long long label_num = readVarint();
+            if (label_num > 0) {
+              o.startPair("Labels");
+              JSONArrayWriter l(writer);
+              for (unsigned long long i = 0; i < label_num; i += 1) {
+                l.writeElem(readStr());
+              }
+            }
+            const unsigned char desc =
+                (unsigned char) (data_type | (encoding << EncodingShift) |
+                                 ((is_array) ? IsArrayFlag : 0));
+            space->set(data_id, desc);
+            o.startPair("Value");
+            convertValue(writer, desc);
+          }
+        }
+      }
+    }
+  }
+}
+
+void TraceConverter::convertData(JSONWriter* writer) {
+  JSONObjectWriter x(writer);
+  x.startPair("GCviewData");
+
+  unsigned long long space_num = readVarint();
+  if (space_num == 0) {
+    writer->writeNull();
+    return;
+  }
+
+  JSONArrayWriter y(writer);
+  unsigned next_space_id = (unsigned) readVarint();
+  ITERATE_CONVERTER_SPACES({
+    y.startElem();
+    if (space_num == 0 || the_index != next_space_id) {
+      writer->writeNull();
+    } else {
+      JSONArrayWriter z(writer, true /* add_newlines */);
+      unsigned long long data_num = readVarint();
+      GCVIEW_GUARANTEE(data_num > 0, "malformed trace");
+      unsigned next_data_id = (unsigned) readVarint();
+      const unsigned length = the_space->getLength();
+      for (unsigned data_id = 0; data_id < length; data_id += 1) {
+        z.startElem();
+        if (data_num == 0 || data_id != next_data_id) {
+          writer->writeNull();
+        } else {
+          convertValue(writer, the_space->get(data_id));
+          data_num -= 1;
+          if (data_num > 0) {
+            next_data_id = (unsigned) readVarint();
+          }
+        }
+      }
+      GCVIEW_GUARANTEE(data_num == 0, "malformed trace");
+
+      space_num -= 1;
+      if (space_num > 0) {
+        next_space_id = (unsigned) readVarint();
+      }
+    }
+  });
+  GCVIEW_GUARANTEE(space_num == 0, "malformed trace");
+}
+
+void TraceConverter::convert(JSONWriter* writer) {
+  GCVIEW_ASSERT(_fin != NULL);
+  const char* magic = TraceWriter::getMagic();
+  const size_t magic_length = strlen(magic);
+  char header[8];
+  GCVIEW_GUARANTEE(fread(header, 1, magic_length + 1, _fin) == magic_length + 1,
+                   "not a GCview trace");
+  GCVIEW_GUARANTEE(memcmp(header, magic, magic_length) == 0,
+                   "not a GCview trace");
+  GCVIEW_GUARANTEE((unsigned char) header[magic_length] == TraceWriter::Version,
+                   "unsupported trace version");
+
+  JSONArrayWriter array_writer(writer, true /* add_newlines */);
+  TraceWriter::RecordType type;
+  while (readRecord(&type)) {
+    array_writer.startElem();
+    convertRecord(writer, type);
+  }
+}
+
+void TraceConverter::convertRecord(JSONWriter* writer,
+                                   TraceWriter::RecordType type) {
+  switch (type) {
+  case TraceWriter::MetadataRecord:
+    convertMetadata(writer);
+    break;
+  case TraceWriter::DataRecord:
+    GCVIEW_GUARANTEE(_spaces.getLength() > 0, "data before metadata");
+    convertData(writer);
+    break;
+  default:
+    GCVIEW_UNREACHABLE_BREAK("unknown record type");
+  }
+  GCVIEW_GUARANTEE(_pos == _end, "malformed trace");
+}
+
+size_t TraceConverter::convertRecord(JSONWriter* writer,
+                                     const unsigned char* data,
+                                     size_t length) {
+  _pos = data;
+  _end = data + length;
+  const TraceWriter::RecordType type = (TraceWriter::RecordType) readByte();
+  const unsigned long long payload_length = readVarint();
+  GCVIEW_GUARANTEE(payload_length <= (unsigned long long) (_end - _pos),
+                   "malformed trace");
+  _end = _pos + payload_length;
+  const unsigned char* payload_end = _end;
+  convertRecord(writer, type);
+  return (size_t) (payload_end - data);
+}
+
+TraceConverter::TraceConverter(FILE* fin)
+    : _fin(fin), _file_name(NULL), _pos(NULL), _end(NULL) { }
+
+TraceConverter::TraceConverter()
+    : _fin(NULL), _file_name(NULL), _pos(NULL), _end(NULL) { }
+
+TraceConverter::TraceConverter(const char* file_name)
+    : _fin(NULL), _file_name(file_name), _pos(NULL), _end(NULL) {
+  GCVIEW_ASSERT(file_name != NULL);
+  _fin = fopen(file_name, "rb");
+  GCVIEW_GUARANTEE(_fin != NULL, "could not open file");
+}
+
+TraceConverter::~TraceConverter() {
+  reclaimSpaces();
+  if (_file_name != NULL) {
+    fclose(_fin);
+  }
+}
+
+}
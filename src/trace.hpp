@@ -0,0 +1,275 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef _GCVIEW_TRACE_HPP
+
+#define _GCVIEW_TRACE_HPP
+
+#include <stdio.h>
+
+#include "array.hpp"
+#include "buffer.hpp"
+#include "utils.hpp"
+#include "vector.hpp"
+
+// Binary trace format
+//
+//   trace    := magic:"GCVT" version:u8 record*
+//   record   := type:u8 length:varint payload:u8[length]
+//
+//   metadata := space_num:varint space*
+//   space    := id:varint name:str data_num:varint data*
+//   data     := id:varint name:str type:u8 is_array:u8 group:str
+//               encoding:varint
+//               [ member_num:varint member:str* ]   (Enum only)
+//               label_num:varint label:str*
+//               value
+//
+//   data record := space_num:varint
+//                  ( space_id:varint data_num:varint
+//                    ( data_id:varint value )* )*
+//
+// Only modified spaces / data are listed in a data record, so a data
+// record with no spaces corresponds to "GCviewData" : null.
+//
+//   value    := elem | array
+//   array    := ( length << 2 ):varint elem*
+//             | ( ( patch_num << 2 ) | 1 ):varint
+//               ( index_delta:varint elem )*          (patch)
+//             | ( ( length << 2 ) | 2 ):varint encoded (encoded)
+//             | ( ( run_num << 2 ) | 3 ):varint
+//               ( index_delta:varint run:varint elem )* (run patch)
+//   encoded  := ( delta:zig-zag varint )*              (Delta, Varint)
+//             | byte_num:varint u8[byte_num]          (XorFloat)
+//             | ( elem run:varint )*                  (RLE)
+//
+// The indexes of a patch are increasing, each one is written as the
+// difference from the previous one (the first one as is). Encoded
+// arrays use the encoding in the metadata of the data (see
+// encoding.hpp), the deltas are from the previous values. The runs of
+// an RLE array add up to its length. A run patch (see TileArray) sets
+// the tiles [ index, index + run ) to elem, each index is written as
+// the difference from the end of the previous run.
+//
+//   elem     := Bool: u8 | Byte, Enum: varint | Int: zig-zag varint |
+//               Double: 8 bytes, little endian | String: str
+//   str      := length:varint u8[length]           (empty means NULL)
+//   varint   := LEB128, 7 bits per byte, least significant first
+
+namespace gcview {
+
+class JSONWriter;
+
+class TraceWriter {
+public:
+  typedef enum {
+    MetadataRecord = 1,
+    DataRecord     = 2
+  } RecordType;
+
+  typedef enum {
+    FullArray    = 0,
+    PatchArray   = 1,
+    EncodedArray = 2,
+    RunPatchArray = 3
+  } ArrayForm;
+
+  static const unsigned char Version = 5;
+  static const char* getMagic() { return "GCVT"; }
+
+private:
+  FILE*       _fout;
+  const char* _file_name;
+  ByteBuffer* _out_buffer;
+  ByteBuffer  _record;
+  // reused by the data that format a part of a record before writing
+  // it (e.g., the bytes of an encoded array, after their length)
+  ByteBuffer  _scratch;
+  bool        _in_record;
+  unsigned long long _bytes_written;
+
+  void baseWrite(const void* data, size_t length) {
+    if (_out_buffer != NULL) {
+      _out_buffer->append(data, length);
+    } else {
+      fwrite(data, 1, length, _fout);
+    }
+    _bytes_written += (unsigned long long) length;
+  }
+
+  void writeHeader();
+
+public:
+  TraceWriter(FILE* fout = stdout);
+  TraceWriter(const char* file_name);
+  // Appends the records to out_buffer, without the trace header, so
+  // that they can be handed over to another thread (see async.hpp).
+  TraceWriter(ByteBuffer* out_buffer);
+
+  unsigned long long getBytesWritten() const { return _bytes_written; }
+
+  // Empty when returned and only valid until the next call.
+  ByteBuffer* getScratch() {
+    _scratch.clear();
+    return &_scratch;
+  }
+
+  void startRecord(RecordType type);
+  void endRecord();
+
+  void writeVarint(unsigned long long val) {
+    GCVIEW_ASSERT(_in_record);
+    while (val >= 0x80) {
+      _record.appendByte((unsigned char) (val | 0x80));
+      val >>= 7;
+    }
+    _record.appendByte((unsigned char) val);
+  }
+
+  void writeZigZag(long long val) {
+    writeVarint(((unsigned long long) val << 1) ^
+                (unsigned long long) (val >> 63));
+  }
+
+  void writeLength(unsigned length) { writeVarint(length); }
+
+  void writeArrayHeader(unsigned length, ArrayForm form) {
+    writeVarint(((unsigned long long) length << 2) | (unsigned) form);
+  }
+
+  void writeBytes(const void* data, size_t length) {
+    GCVIEW_ASSERT(_in_record);
+    _record.append(data, length);
+  }
+
+  void write(bool val) {
+    GCVIEW_ASSERT(_in_record);
+    _record.appendByte((val) ? 1 : 0);
+  }
+
+  void write(unsigned char val) { writeVarint(val); }
+  void write(unsigned val)      { writeVarint(val); }
+  void write(int val)           { writeZigZag(val); }
+  void write(long long val)     { writeZigZag(val); }
+
+  void write(double val) {
+    GCVIEW_ASSERT(_in_record);
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    unsigned char* bytes = _record.extend(8);
+    for (unsigned i = 0; i < 8; i += 1) {
+      bytes[i] = (unsigned char) (bits >> (8 * i));
+    }
+  }
+
+  void write(const char* str) {
+    const size_t length = (str != NULL) ? strlen(str) : 0;
+    writeVarint(length);
+    if (length > 0) {
+      _record.append(str, length);
+    }
+  }
+
+  void flush() {
+    if (_fout != NULL) {
+      fflush(_fout);
+    }
+  }
+
+  ~TraceWriter();
+};
+
+// Turns a binary trace back into the JSON trace that GCview would
+// have written for the same sequence of writeJSONMetadata /
+// writeJSONData calls.
+class TraceConverter {
+private:
+  FILE*       _fin;
+  const char* _file_name;
+
+  ByteBuffer  _record;
+  const unsigned char* _pos;
+  const unsigned char* _end;
+  ByteBuffer  _str;
+
+  // For each space, one byte per data: the data type in the lower
+  // bits, the encoding shifted by EncodingShift, and IsArrayFlag if
+  // the data is an array.
+  Array<Vector<unsigned char>*> _spaces;
+
+  static const unsigned char IsArrayFlag   = 0x80;
+  static const unsigned char EncodingShift = 4;
+  static const unsigned char DataTypeMask  = 0x0f;
+
+  bool readRecord(TraceWriter::RecordType* type);
+
+  unsigned char readByte() {
+    GCVIEW_GUARANTEE(_pos < _end, "malformed trace");
+    unsigned char b = *_pos;
+    _pos += 1;
+    return b;
+  }
+
+  unsigned long long readVarint() {
+    unsigned long long val = 0;
+    unsigned shift = 0;
+    while (true) {
+      unsigned char b = readByte();
+      val |= (unsigned long long) (b & 0x7f) << shift;
+      if ((b & 0x80) == 0) break;
+      shift += 7;
+      GCVIEW_GUARANTEE(shift < 64, "malformed trace");
+    }
+    return val;
+  }
+
+  long long readZigZag() {
+    unsigned long long val = readVarint();
+    return (long long) (val >> 1) ^ -(long long) (val & 1);
+  }
+
+  double readDouble();
+  const char* readStr();
+
+  void reclaimSpaces();
+
+  void convertRecord(JSONWriter* writer, TraceWriter::RecordType type);
+  void convertMetadata(JSONWriter* writer);
+  void convertData(JSONWriter* writer);
+  void convertValue(JSONWriter* writer, unsigned char desc);
+  void convertElem(JSONWriter* writer, unsigned data_type);
+  void convertEncoded(JSONWriter* writer, unsigned data_type,
+                      unsigned encoding, unsigned long long length);
+
+public:
+  TraceConverter(FILE* fin);
+  TraceConverter(const char* file_name);
+  // For converting records that are already in memory.
+  TraceConverter();
+
+  // Writes a JSON array with one element per record in the trace.
+  void convert(JSONWriter* writer);
+
+  // Writes the JSON element that corresponds to the record at the
+  // start of data (without the trace header) and returns the length
+  // of the record.
+  size_t convertRecord(JSONWriter* writer,
+                       const unsigned char* data, size_t length);
+
+  ~TraceConverter();
+};
+
+}
+
+#endif // _GCVIEW_TRACE_HPP
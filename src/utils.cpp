@@ -12,7 +12,11 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include "utils.hpp"
 
@@ -26,10 +30,95 @@ void Utils::formatStr(char* buffer, size_t buffer_size,
   va_end(args);
 }
 
+static unsigned formatDoubleSlow(char* buffer, double val) {
+  Utils::formatStr(buffer, Utils::FormatBufferSize, "%1.10f", val);
+  unsigned index = strlen(buffer) - 1;
+  while (buffer[index] == '0') {
+    index -= 1;
+  }
+  if (buffer[index] == '.') {
+    index -= 1;
+  }
+  buffer[index + 1] = '\0';
+  return index + 1;
+}
+
+unsigned Utils::formatDouble(char* buffer, double val) {
+  // The fast path splits the value into its integral part and its
+  // fractional part scaled to 10 digits. The scaling is inexact, so
+  // we only trust it when it is not too close to a rounding boundary
+  // (its error is below 2e-6 for the range we accept). Everything
+  // else (large values, NaN, infinities, near-ties) is handed to
+  // vsnprintf so that the output is always identical to "%1.10f".
+  const bool negative = (val < 0.0) || (val == 0.0 && 1.0 / val < 0.0);
+  const double abs_val = (negative) ? -val : val;
+  if (!(abs_val < 1e15)) {
+    return formatDoubleSlow(buffer, val);
+  }
+
+  unsigned long long int_part = (unsigned long long) abs_val;
+  const double scaled = (abs_val - (double) int_part) * 1e10;
+  const double scaled_floor = floor(scaled);
+  const double rem = scaled - scaled_floor;
+  if (rem > 0.4999 && rem < 0.5001) {
+    return formatDoubleSlow(buffer, val);
+  }
+  unsigned long long frac_part = (unsigned long long) scaled_floor;
+  if (rem > 0.5) {
+    frac_part += 1;
+  }
+  if (frac_part >= 10000000000ULL) {
+    frac_part -= 10000000000ULL;
+    int_part += 1;
+  }
+
+  unsigned length = 0;
+  if (negative) {
+    buffer[length] = '-';
+    length += 1;
+  }
+  length += formatUnsigned(buffer + length, int_part);
+  if (frac_part > 0) {
+    unsigned frac_length = 10;
+    while (frac_part % 10 == 0) {
+      frac_part /= 10;
+      frac_length -= 1;
+    }
+    buffer[length] = '.';
+    length += 1;
+    for (unsigned i = frac_length; i > 0; i -= 1) {
+      buffer[length + i - 1] = (char) ('0' + (unsigned) (frac_part % 10));
+      frac_part /= 10;
+    }
+    length += frac_length;
+    buffer[length] = '\0';
+  }
+  return length;
+}
+
+double Utils::getNowSec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+unsigned Utils::getCPUIndex() {
+#if defined(__linux__)
+  const int cpu = sched_getcpu();
+  if (cpu >= 0) {
+    return (unsigned) cpu;
+  }
+#endif // defined(__linux__)
+  // spreads the threads over the slots, if not over the CPUs
+  const uintptr_t self = (uintptr_t) pthread_self();
+  return (unsigned) ((self >> 4) ^ (self >> 12));
+}
+
 void Utils::raiseError(const char* str,
                        const char* file,
                        unsigned line) {
   printf("## ERROR [%s:%u] : %s\n", file, line, str);
+  fflush(stdout);
   abort();
 }
 
@@ -16,6 +16,7 @@
 
 #define _GCVIEW_UTILS_HPP
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +25,10 @@
 
 #define GCVIEW_ENABLE_ASSERT 1
 
+// Data that different threads update is aligned / padded to this size,
+// so that the threads do not write to the same cache line.
+#define GCVIEW_CACHE_LINE_SIZE 64
+
 #define GCVIEW_RAISE_ERROR(__str__) \
 do { \
   Utils::raiseError((__str__), __FILE__, __LINE__); \
@@ -114,9 +119,160 @@ public:
   static void formatStr(char* buffer, size_t buffer_size,
                         const char* format, ...);
 
+  ///// Number formatting that bypasses the stdio format parser /////
+
+  // Buffer size that is large enough for any of the format methods below.
+  static const unsigned FormatBufferSize = 64;
+
+  // The format methods write the textual representation of the value
+  // into buffer, NULL-terminate it, and return its length.
+
+  static unsigned formatUnsigned(char* buffer, unsigned long long val) {
+    char digits[24];
+    unsigned num = 0;
+    do {
+      digits[num] = (char) ('0' + (unsigned) (val % 10));
+      num += 1;
+      val /= 10;
+    } while (val > 0);
+    for (unsigned i = 0; i < num; i += 1) {
+      buffer[i] = digits[num - 1 - i];
+    }
+    buffer[num] = '\0';
+    return num;
+  }
+
+  static unsigned formatInt(char* buffer, long long val) {
+    if (val < 0) {
+      buffer[0] = '-';
+      // negate in unsigned arithmetic so that the minimum value works
+      return 1 + formatUnsigned(buffer + 1,
+                                (unsigned long long) 0 -
+                                (unsigned long long) val);
+    } else {
+      return formatUnsigned(buffer, (unsigned long long) val);
+    }
+  }
+
+  // Produces the same output as "%1.10f" with the trailing zeros (and,
+  // if no fractional digits are left, the decimal point) removed.
+  static unsigned formatDouble(char* buffer, double val);
+
+  // Monotonic time in seconds, from an arbitrary starting point.
+  static double getNowSec();
+
+  // The CPU the calling thread is running on, or another number that
+  // is stable for the thread if that is not known.
+  static unsigned getCPUIndex();
+
   static void raiseError(const char* str, const char* file, unsigned line);
 };
 
+// Aligns per-thread / per-CPU slots to cache lines.
+class CacheLineUtils {
+public:
+  // Allocates num slots of size slot_size (at most the cache line
+  // size), each at the start of its own cache line and zeroed. The
+  // result has to be released with release() along with *memory.
+  static void* alloc(unsigned num, size_t slot_size, char** memory) {
+    GCVIEW_ASSERT(slot_size <= GCVIEW_CACHE_LINE_SIZE);
+    const size_t size = (size_t) (num + 1) * GCVIEW_CACHE_LINE_SIZE;
+    *memory = new char[size];
+    GCVIEW_ALLOC_GUARANTEE(*memory);
+    memset(*memory, 0, size);
+    const uintptr_t mask = GCVIEW_CACHE_LINE_SIZE - 1;
+    return (void*) (((uintptr_t) *memory + mask) & ~mask);
+  }
+
+  static void* getSlot(void* slots, unsigned index) {
+    return (char*) slots + (size_t) index * GCVIEW_CACHE_LINE_SIZE;
+  }
+
+  static void release(char* memory) {
+    delete[] memory;
+  }
+};
+
+// Relaxed atomic operations: they are atomic but do not order other
+// memory accesses (see AtomicIntValue).
+class AtomicUtils {
+public:
+  static void add(volatile long long* ptr, long long delta) {
+#if defined(__ATOMIC_RELAXED)
+    __atomic_fetch_add(ptr, delta, __ATOMIC_RELAXED);
+#else
+    __sync_fetch_and_add(ptr, delta);
+#endif
+  }
+
+  static long long load(const volatile long long* ptr) {
+#if defined(__ATOMIC_RELAXED)
+    return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+#else
+    return __sync_fetch_and_add((volatile long long*) ptr, 0);
+#endif
+  }
+
+  static void store(volatile long long* ptr, long long val) {
+#if defined(__ATOMIC_RELAXED)
+    __atomic_store_n(ptr, val, __ATOMIC_RELAXED);
+#else
+    __sync_lock_test_and_set(ptr, val);
+#endif
+  }
+
+  // The same for the other types of single-writer slots (e.g., the
+  // doubles of StagedDoubleValue). Without the __atomic builtins they
+  // are only atomic for types no wider than a pointer.
+  template <typename T>
+  static T load(const volatile T* ptr) {
+#if defined(__ATOMIC_RELAXED)
+    T res;
+    __atomic_load(ptr, &res, __ATOMIC_RELAXED);
+    return res;
+#else
+    __sync_synchronize();
+    return *ptr;
+#endif
+  }
+
+  template <typename T>
+  static void store(volatile T* ptr, T val) {
+#if defined(__ATOMIC_RELAXED)
+    __atomic_store(ptr, &val, __ATOMIC_RELAXED);
+#else
+    *ptr = val;
+    __sync_synchronize();
+#endif
+  }
+
+  // For publishing an object to other threads: the stores that
+  // initialized it are visible to a thread that loads the pointer to
+  // it with loadAcquire().
+  template <typename T>
+  static void storeRelease(volatile T* ptr, T val) {
+#if defined(__ATOMIC_RELEASE)
+    __atomic_store(ptr, &val, __ATOMIC_RELEASE);
+#else
+    __sync_synchronize();
+    *ptr = val;
+#endif
+  }
+
+  template <typename T>
+  static T loadAcquire(const volatile T* ptr) {
+#if defined(__ATOMIC_ACQUIRE)
+    T res;
+    __atomic_load(ptr, &res, __ATOMIC_ACQUIRE);
+    return res;
+#else
+    const T res = *ptr;
+    __sync_synchronize();
+    return res;
+#endif
+  }
+};
+
 class ScopePrinter {
 private:
   const char* _class_name;
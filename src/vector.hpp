@@ -16,50 +16,138 @@
 
 #define _GCVIEW_VECTOR_HPP
 
+#include <string.h>
+
 #include "utils.hpp"
 
 namespace gcview {
 
+// Whether T can be copied with memcpy(). Element types can specialize
+// it (see data.hpp).
+template <typename T>
+struct IsTriviallyCopyable {
+  static const bool Value = false;
+};
+
+template <typename T>
+struct IsTriviallyCopyable<T*> {
+  static const bool Value = true;
+};
+
+#define GCVIEW_TRIVIALLY_COPYABLE(__type__) \
+template <> \
+struct IsTriviallyCopyable<__type__> { \
+  static const bool Value = true; \
+}
+
+GCVIEW_TRIVIALLY_COPYABLE(bool);
+GCVIEW_TRIVIALLY_COPYABLE(char);
+GCVIEW_TRIVIALLY_COPYABLE(unsigned char);
+GCVIEW_TRIVIALLY_COPYABLE(int);
+GCVIEW_TRIVIALLY_COPYABLE(unsigned int);
+GCVIEW_TRIVIALLY_COPYABLE(long);
+GCVIEW_TRIVIALLY_COPYABLE(unsigned long);
+GCVIEW_TRIVIALLY_COPYABLE(long long);
+GCVIEW_TRIVIALLY_COPYABLE(unsigned long long);
+GCVIEW_TRIVIALLY_COPYABLE(double);
+
+// A fixed-length array that can be resized. The storage is kept when
+// the vector shrinks and grows geometrically, so resizing back and
+// forth (e.g., an array whose length changes every snapshot) does not
+// allocate once the capacity is reached. The elements past the length
+// are reset to T() when the vector shrinks, so the elements that
+// resize() adds are always T().
 template <typename T>
 class Vector {
 private:
   unsigned _length;
+  unsigned _capacity;
   T*       _array;
 
+  static void copyElems(T* to, const T* from, unsigned length) {
+    if (IsTriviallyCopyable<T>::Value) {
+      if (length > 0) {
+        memcpy((void*) to, (const void*) from, (size_t) length * sizeof(T));
+      }
+    } else {
+      for (unsigned i = 0; i < length; i += 1) {
+        to[i] = from[i];
+      }
+    }
+  }
+
+  void reserve(unsigned new_capacity) {
+    GCVIEW_ASSERT(new_capacity > _capacity);
+    if (new_capacity < 2 * _capacity) {
+      new_capacity = 2 * _capacity;
+    }
+    // value-initialized, so that the elements past the length are T()
+    // for built-in types too
+    T* new_array = new T[new_capacity]();
+    GCVIEW_ALLOC_GUARANTEE(new_array);
+    copyElems(new_array, _array, _length);
+    if (_array != NULL) {
+      delete[] _array;
+    }
+    _array = new_array;
+    _capacity = new_capacity;
+  }
+
+  // not copyable
+  Vector(const Vector&);
+  Vector& operator=(const Vector&);
+
 public:
   unsigned getLength() const { return _length; }
+  unsigned getCapacity() const { return _capacity; }
 
   void resize(unsigned new_length) {
-    if (new_length != _length) {
-      T* new_array = NULL;
-      if (new_length > 0) {
-        new_array = new T[new_length];
-        GCVIEW_ALLOC_GUARANTEE(new_array);
-        const unsigned copy_length =
-          (new_length < _length) ? new_length : _length;
-        for (unsigned i = 0; i < copy_length; i += 1) {
-          new_array[i] = _array[i];
-        }
+    if (new_length > _capacity) {
+      reserve(new_length);
+    } else if (new_length < _length) {
+      for (unsigned i = new_length; i < _length; i += 1) {
+        _array[i] = T();
       }
+    }
+    _length = new_length;
+  }
 
-      reclaim();
+  // Makes this vector a copy of other, reusing its storage.
+  void copyFrom(const Vector<T>& other) {
+    resize(other._length);
+    copyElems(_array, other._array, _length);
+  }
 
-      if (new_length > 0) {
-        GCVIEW_ASSERT(new_array != NULL);
-        _array = new_array;
-        _length = new_length;
-      }
-    }
+  // Copies the elements in [from, to) of other, which should be at
+  // least as long, to the same indexes.
+  void copyRangeFrom(const Vector<T>& other, unsigned from, unsigned to) {
+    GCVIEW_ASSERT(from <= to && to <= _length && to <= other._length);
+    copyElems(_array + from, other._array + from, to - from);
   }
 
+  // Exchanges the elements (and the storage) of the two vectors.
+  void swap(Vector<T>* other) {
+    const unsigned length = _length;
+    const unsigned capacity = _capacity;
+    T* array = _array;
+    _length = other->_length;
+    _capacity = other->_capacity;
+    _array = other->_array;
+    other->_length = length;
+    other->_capacity = capacity;
+    other->_array = array;
+  }
+
+  // Also frees the storage.
   void reclaim() {
     if (_array != NULL) {
-      GCVIEW_ASSERT(_length > 0);
+      GCVIEW_ASSERT(_capacity > 0);
       delete[] _array;
       _array = NULL;
       _length = 0;
+      _capacity = 0;
     } else {
-      GCVIEW_ASSERT(_length == 0);
+      GCVIEW_ASSERT(_capacity == 0);
     }
   }
 
@@ -81,7 +169,10 @@ public:
     return _array[index];
   }
 
-  Vector() : _length(0), _array(NULL) { }
+  // The elements, NULL if the vector never had any.
+  T* getData() const { return _array; }
+
+  Vector() : _length(0), _capacity(0), _array(NULL) { }
   ~Vector() { reclaim(); }
 };
 
@@ -0,0 +1,198 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "index.hpp"
+#include "reader.hpp"
+
+using namespace gcview;
+
+// Reads a JSON trace (optionally gzip-compressed) with a TraceReader.
+//
+//   read_trace <JSON trace file>
+//   read_trace -v <JSON trace file>
+//   read_trace -r <record> <JSON trace file> <index file>
+//
+// The first form dumps the metadata and the state after each snapshot
+// in the same format as json_reader.py, except that Double values are
+// always shown with 10 decimals. The second form only validates the
+// trace and reports its size and the read throughput; a malformed
+// trace is reported with the offset of the error. The third form dumps
+// the state after the given record (numbered from 0), which it reaches
+// through the index sidecar of the trace (see index.hpp) without
+// reading the records before the closest keyframe.
+
+static void printElem(const ReaderData* data, unsigned index) {
+  switch (data->getDataType()) {
+  case Data::BoolType:
+    fputs((data->getBool(index)) ? "True" : "False", stdout);
+    break;
+  case Data::ByteType:
+  case Data::IntType:
+    printf("%lld", data->getInt(index));
+    break;
+  case Data::DoubleType:
+    printf("%1.10f", data->getDouble(index));
+    break;
+  case Data::StringType:
+    printf("'%s'", data->getStr(index));
+    break;
+  case Data::EnumType:
+    printf("'%s'", data->getEnumMemberOf(index));
+    break;
+  default:
+    GCVIEW_UNREACHABLE_BREAK("unknown data type");
+  }
+}
+
+static void printValue(const ReaderData* data) {
+  if (data->isModified()) {
+    fputs("(DIRTY) ", stdout);
+  }
+  if (!data->isArray()) {
+    printElem(data, 0);
+    return;
+  }
+  printf("len:%u [", data->getLength());
+  for (unsigned i = 0; i < data->getLength(); i += 1) {
+    fputs(" ", stdout);
+    printElem(data, i);
+  }
+  fputs(" ]", stdout);
+}
+
+static void printMetadata(const TraceReader* reader) {
+  printf("Metadata GCview | %u Spaces\n", reader->getSpaceNum());
+  for (unsigned i = 0; i < reader->getSpaceNum(); i += 1) {
+    const ReaderSpace* space = reader->getSpace(i);
+    printf("Metadata   Space [%2u] \"%s\" | %u Data\n",
+           space->getID(), space->getName(), space->getDataNum());
+    for (unsigned j = 0; j < space->getDataNum(); j += 1) {
+      const ReaderData* data = space->getData(j);
+      printf("Metadata     Data [%2u] ", data->getID());
+      if (data->getGroupName() != NULL) {
+        printf("\"%s\" / ", data->getGroupName());
+      }
+      printf("\"%s\" | %s %s | ", data->getName(),
+             Data::getDataTypeStr(data->getDataType()),
+             (data->isArray()) ? "Array" : "Value");
+      printValue(data);
+      printf("\n");
+      if (data->getDataType() == Data::EnumType) {
+        printf("Metadata       Enum Members len:%u [",
+               data->getEnumMemberNum());
+        for (unsigned k = 0; k < data->getEnumMemberNum(); k += 1) {
+          printf(" '%s'", data->getEnumMember(k));
+        }
+        printf(" ]\n");
+      }
+      if (data->getLabelNum() > 0) {
+        printf("Metadata       Labels len:%u [", data->getLabelNum());
+        for (unsigned k = 0; k < data->getLabelNum(); k += 1) {
+          printf(" '%s'", data->getLabel(k));
+        }
+        printf(" ]\n");
+      }
+    }
+  }
+  printf("\n");
+}
+
+static void printData(const TraceReader* reader) {
+  printf("GCview\n");
+  for (unsigned i = 0; i < reader->getSpaceNum(); i += 1) {
+    const ReaderSpace* space = reader->getSpace(i);
+    printf("  Space[%2u] \"%s\"\n", space->getID(), space->getName());
+    for (unsigned j = 0; j < space->getDataNum(); j += 1) {
+      const ReaderData* data = space->getData(j);
+      printf("    Data [%2u] \"%s\" | ", data->getID(), data->getName());
+      printValue(data);
+      printf("\n");
+    }
+  }
+  printf("\n");
+}
+
+static int readRecord(const char* record_str, const char* file_name,
+                      const char* index_file_name) {
+  char* end;
+  const unsigned long long record = strtoull(record_str, &end, 10);
+  if (*record_str == '\0' || *end != '\0') {
+    printf("invalid record number: %s\n", record_str);
+    return 1;
+  }
+  TraceIndex index(index_file_name);
+  if (record >= index.getEntryNum()) {
+    printf("record %llu is not in the index (%llu records)\n",
+           record, index.getEntryNum());
+    return 1;
+  }
+
+  TraceReader reader(file_name);
+  if (!reader.readRecord(&index, record)) {
+    fprintf(stderr, "trace ends before record %llu\n", record);
+    return 1;
+  }
+  const TraceIndex::Entry* entry = index.getEntry(record);
+  printf("Record %llu | %s | Event %u | Timestamp %1.10f\n", record,
+         TraceIndexWriter::getRecordKindStr(entry->getKind()),
+         entry->getEventID(), entry->getTimestampSec());
+  if (reader.isMetadata()) {
+    printMetadata(&reader);
+  } else {
+    printData(&reader);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 5 && strcmp(argv[1], "-r") == 0) {
+    return readRecord(argv[2], argv[3], argv[4]);
+  }
+
+  const bool validate_only = (argc == 3 && strcmp(argv[1], "-v") == 0);
+  if (argc != 2 && !validate_only) {
+    printf("usage: %s [ -v ] <JSON trace file>\n"
+           "       %s -r <record> <JSON trace file> <index file>\n",
+           argv[0], argv[0]);
+    return 1;
+  }
+
+  TraceReader reader(argv[argc - 1]);
+  const double start_sec = Utils::getNowSec();
+  while (reader.next()) {
+    if (validate_only) continue;
+
+    if (reader.isMetadata()) {
+      printMetadata(&reader);
+    } else {
+      printData(&reader);
+    }
+  }
+
+  if (validate_only) {
+    const double sec = Utils::getNowSec() - start_sec;
+    printf("%llu records, %llu snapshots, %llu bytes, %.3f sec, %.1f MB/s\n",
+           reader.getRecordNum(), reader.getSnapshotNum(),
+           reader.getBytesRead(), sec,
+           (double) reader.getBytesRead() / (1024.0 * 1024.0) / sec);
+  }
+  if (reader.isTruncated()) {
+    fprintf(stderr, "trace is truncated after %llu records\n",
+            reader.getRecordNum());
+  }
+  return 0;
+}
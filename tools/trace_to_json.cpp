@@ -0,0 +1,42 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "json.hpp"
+#include "trace.hpp"
+
+using namespace gcview;
+
+// Converts a binary GCview trace into the JSON trace that the
+// visualizer and json_reader.py expect.
+//
+//   trace_to_json <binary trace file> [ <JSON trace file> ]
+//
+// The JSON trace is written to stdout if no file name is given.
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 3) {
+    printf("usage: %s <binary trace file> [ <JSON trace file> ]\n", argv[0]);
+    return 1;
+  }
+
+  TraceConverter converter(argv[1]);
+  if (argc == 3) {
+    JSONWriter writer(argv[2], GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    converter.convert(&writer);
+  } else {
+    JSONWriter writer(stdout, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    converter.convert(&writer);
+  }
+  return 0;
+}
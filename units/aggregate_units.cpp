@@ -0,0 +1,142 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "aggregate.hpp"
+#include "units_shared.hpp"
+
+// Checks the quantile estimates against the exact quantiles of a few
+// distributions, and that the binary trace of AggregateValue updates
+// converts back to the same JSON.
+
+static const unsigned VALUE_NUM = 100000;
+
+static int compareDoubles(const void* a, const void* b) {
+  const double x = *(const double*) a;
+  const double y = *(const double*) b;
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+// The estimates should be within max_error of the range of the values
+// of the exact quantiles.
+static bool checkEstimates(const char* name, double (*next)(unsigned),
+                           double max_error) {
+  static double values[VALUE_NUM];
+  Aggregate aggregate;
+  for (unsigned i = 0; i < VALUE_NUM; i += 1) {
+    values[i] = next(i);
+    aggregate.add(values[i]);
+  }
+  qsort(values, VALUE_NUM, sizeof(double), compareDoubles);
+  const double range = values[VALUE_NUM - 1] - values[0];
+  const double p50 = values[VALUE_NUM / 2 - 1];
+  const double p90 = values[VALUE_NUM * 9 / 10 - 1];
+  const double p99 = values[VALUE_NUM * 99 / 100 - 1];
+  const bool ok =
+    aggregate.getCount() == (long long) VALUE_NUM &&
+    aggregate.get(Aggregate::MinStat) == values[0] &&
+    aggregate.get(Aggregate::MaxStat) == values[VALUE_NUM - 1] &&
+    fabs(aggregate.get(Aggregate::P50Stat) - p50) <= max_error * range &&
+    fabs(aggregate.get(Aggregate::P90Stat) - p90) <= max_error * range &&
+    fabs(aggregate.get(Aggregate::P99Stat) - p99) <= max_error * range;
+  printf("%-12s : %s\n", name, (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+static double nextUniform(unsigned) {
+  return (double) rand() / (double) RAND_MAX;
+}
+
+static double nextExponential(unsigned) {
+  return -log(1.0 - (double) rand() / ((double) RAND_MAX + 1.0));
+}
+
+static double nextIncreasing(unsigned i) {
+  return (double) i;
+}
+
+// Up to five values the quantiles are exact (nearest rank).
+static bool checkFewValues() {
+  Aggregate aggregate;
+  bool ok = aggregate.get(Aggregate::P50Stat) == 0.0 &&
+    aggregate.get(Aggregate::MeanStat) == 0.0;
+  aggregate.add(4.0);
+  aggregate.add(1.0);
+  aggregate.add(3.0);
+  aggregate.add(2.0);
+  ok = ok && aggregate.get(Aggregate::P50Stat) == 2.0 &&
+    aggregate.get(Aggregate::P99Stat) == 4.0 &&
+    aggregate.get(Aggregate::MeanStat) == 2.5 &&
+    aggregate.get(Aggregate::SumStat) == 10.0;
+  aggregate.reset();
+  aggregate.add(-7.0);
+  ok = ok && aggregate.get(Aggregate::MinStat) == -7.0 &&
+    aggregate.get(Aggregate::MaxStat) == -7.0 &&
+    aggregate.get(Aggregate::P90Stat) == -7.0;
+  printf("%-12s : %s\n", "few values", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+template <typename W>
+static void doAggregateIteration(W* iteration_writer) {
+  GCview gcview("GCview Aggregate Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Aggregates");
+  AggregateValue* pauses = space->addData<AggregateValue>("Pause Times");
+
+  iteration_writer->writeMetadata(&gcview);
+
+  // a burst of values between two snapshots
+  for (unsigned i = 1; i <= 100; i += 1) {
+    pauses->set((double) ((i * 37) % 101) / 4.0);
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the metadata (e.g., for a late subscriber) does not end the window
+  pauses->set(1.0);
+  pauses->set(3.0);
+  iteration_writer->writeMetadata(&gcview);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // a single value
+  pauses->set(2.5);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the same single value: not modified
+  pauses->set(2.5);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // no values: all stats are 0
+  dumpData(&gcview, event_id, iteration_writer);
+}
+
+int main() {
+  srand(42);
+  bool ok = checkEstimates("uniform", nextUniform, 0.01);
+  ok = checkEstimates("exponential", nextExponential, 0.01) && ok;
+  ok = checkEstimates("increasing", nextIncreasing, 0.01) && ok;
+  ok = checkFewValues() && ok;
+  const bool lookup_ok = checkKindLookup<AggregateValue, DoubleArray>();
+  printf("%-12s : %s\n", "lookup", (lookup_ok) ? "OK" : "FAILED");
+  ok = lookup_ok && ok;
+
+  const bool same =
+    checkTraceRoundTrip(doAggregateIteration, doAggregateIteration);
+
+  MM::print_report();
+  return (ok && same) ? 0 : 1;
+}
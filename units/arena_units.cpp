@@ -0,0 +1,202 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gcview.hpp"
+
+using namespace gcview;
+
+// Checks that the StringPool interns equal strings to the same pointer
+// and that StringElement falls back to heap copies (and frees them)
+// for the strings it cannot intern, and that the spaces and the data
+// of a GCview, which are in its arena, are destroyed. The heap copies
+// are only counted with GCVIEW_ENABLE_MM_SUMMARY; without it those
+// checks always pass.
+//
+// The pool is process-wide, so the check that fills it runs last.
+
+static const unsigned DATA_NUM = 100;
+static const unsigned ARRAY_LENGTH = 50;
+
+// Counts its destructions.
+class CountedValue : public IntValue {
+public:
+  static unsigned _destroyed_num;
+
+  CountedValue(const char* name, const char* group_name = NULL,
+               Arena* arena = NULL)
+      : IntValue(name, group_name, arena) { }
+  virtual ~CountedValue() { _destroyed_num += 1; }
+};
+
+unsigned CountedValue::_destroyed_num = 0;
+
+// A string of the given length that the pool has not seen.
+static void makeLongStr(char* buffer, size_t length, char c) {
+  memset(buffer, c, length);
+  buffer[length] = '\0';
+}
+
+static bool checkIntern() {
+  char buffer[GCVIEW_STRING_POOL_MAX_LENGTH + 2];
+  strcpy(buffer, "Old Space");
+  const char* interned = StringPool::intern("Old Space");
+  bool ok = interned != NULL && StringPool::intern(buffer) == interned &&
+    interned != buffer && strcmp(interned, buffer) == 0 &&
+    StringPool::intern("Old Spaces") != interned &&
+    StringPool::intern(NULL) == StringPool::intern("") &&
+    *StringPool::intern(NULL) == '\0';
+
+  // the longest string it interns, and one more character
+  makeLongStr(buffer, GCVIEW_STRING_POOL_MAX_LENGTH, 'a');
+  const char* longest = StringPool::intern(buffer);
+  ok = ok && longest != NULL && StringPool::intern(buffer) == longest;
+  makeLongStr(buffer, GCVIEW_STRING_POOL_MAX_LENGTH + 1, 'a');
+  ok = ok && StringPool::intern(buffer) == NULL;
+
+  printf("%-16s : %s\n", "intern", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+// Interned elements share the pool's copy, the others have their own,
+// and either kind compares and copies to the other by value.
+static bool checkStringElements() {
+  char buffer[GCVIEW_STRING_POOL_MAX_LENGTH + 2];
+  makeLongStr(buffer, GCVIEW_STRING_POOL_MAX_LENGTH + 1, 'b');
+  const char* interned = StringPool::intern("Eden");
+
+  const unsigned long long allocated_count = MM::getCurrAllocatedCount();
+  bool ok = true;
+  {
+    StringElement elem;
+    StringElement prev;
+    ok = ok && *elem.get() == '\0' && elem.isEqualTo(prev) &&
+      elem.isEqualTo((const char*) NULL) && elem.isEqualTo("");
+
+    elem.set("Eden");
+    ok = ok && elem.get() == interned && !elem.isEqualTo(prev);
+    prev.set(elem);
+    ok = ok && prev.get() == interned && prev.isEqualTo(elem);
+
+    // not interned: a copy of its own
+    elem.set(buffer);
+    ok = ok && elem.get() != buffer && strcmp(elem.get(), buffer) == 0 &&
+      elem.isEqualTo(buffer) && !elem.isEqualTo(prev);
+    prev.set(elem);
+    ok = ok && prev.get() != elem.get() && prev.isEqualTo(elem) &&
+      prev.isEqualTo(buffer);
+
+    // the copy outlives the original
+    elem.reset();
+    ok = ok && *elem.get() == '\0' && strcmp(prev.get(), buffer) == 0;
+
+    // back to an interned one, which frees the copy
+    prev.set("Eden");
+    elem.set(prev);
+    ok = ok && prev.get() == interned && elem.get() == interned;
+    elem.set(buffer);
+    prev.set(buffer);
+  }
+  // always OK without GCVIEW_ENABLE_MM_SUMMARY
+  ok = ok && MM::getCurrAllocatedCount() == allocated_count;
+
+  printf("%-16s : %s\n", "string elements", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+static void doGCview(bool long_strs) {
+  GCview gcview("GCview Arena Unit Tests", 0.0);
+  gcview.addEvent("Event 0");
+  for (unsigned i = 0; i < 4; i += 1) {
+    char name[32];
+    sprintf(name, "Space %u", i);
+    Space* space = gcview.addSpace(name);
+    for (unsigned j = 0; j < DATA_NUM / 4; j += 1) {
+      sprintf(name, "Value %u", j);
+      space->addData<CountedValue>(name, "Counted")->set((int) j);
+    }
+  }
+  // with long strings the elements have heap copies
+  StringArray* names = gcview.addSpace("Strings")->addData<StringArray>(
+    "Names");
+  names->resize(ARRAY_LENGTH);
+  char buffer[GCVIEW_STRING_POOL_MAX_LENGTH + 2];
+  for (unsigned i = 0; i < ARRAY_LENGTH; i += 1) {
+    makeLongStr(buffer, (long_strs) ? GCVIEW_STRING_POOL_MAX_LENGTH + 1 : 8,
+                (char) ('A' + i % 26));
+    names->value(i) = buffer;
+  }
+}
+
+// The spaces and data are in the arena of the GCview and are not
+// deleted (the MM summary operators would reject those pointers), but
+// their destructors run and free what they allocated.
+static bool checkGCview() {
+  // interns the GCview's own strings and the short ones
+  doGCview(false /* long_strs */);
+
+  CountedValue::_destroyed_num = 0;
+  const unsigned long long allocated_count = MM::getCurrAllocatedCount();
+  doGCview(true /* long_strs */);
+  // always OK without GCVIEW_ENABLE_MM_SUMMARY
+  const bool ok = CountedValue::_destroyed_num == DATA_NUM &&
+    MM::getCurrAllocatedCount() == allocated_count;
+
+  printf("%-16s : %s\n", "gcview", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+// Once the pool holds GCVIEW_STRING_POOL_MAX_STRS strings it only
+// returns the ones it has, and the elements copy the others.
+static bool checkFullPool() {
+  const char* interned = StringPool::intern("Eden");
+  char buffer[32];
+  unsigned i = 0;
+  while (StringPool::getLength() < GCVIEW_STRING_POOL_MAX_STRS) {
+    sprintf(buffer, "pool.%u", i++);
+    StringPool::intern(buffer);
+  }
+  sprintf(buffer, "pool.%u", i++);
+  bool ok = StringPool::intern(buffer) == NULL &&
+    StringPool::intern("Eden") == interned &&
+    StringPool::getLength() == GCVIEW_STRING_POOL_MAX_STRS;
+
+  const unsigned long long allocated_count = MM::getCurrAllocatedCount();
+  {
+    StringElement elem;
+    StringElement prev;
+    elem.set(buffer);
+    prev.set(elem);
+    ok = ok && elem.get() != buffer && prev.get() != elem.get() &&
+      prev.isEqualTo(elem) && prev.isEqualTo(buffer);
+    prev.set("Eden");
+    ok = ok && prev.get() == interned && !prev.isEqualTo(elem);
+    elem.set(prev);
+    ok = ok && elem.get() == interned;
+  }
+  // always OK without GCVIEW_ENABLE_MM_SUMMARY
+  ok = ok && MM::getCurrAllocatedCount() == allocated_count;
+
+  printf("%-16s : %s\n", "full pool", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = checkIntern();
+  ok = checkStringElements() && ok;
+  ok = checkGCview() && ok;
+  ok = checkFullPool() && ok;
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "async.hpp"
+#include "reader.hpp"
+#include "units_shared.hpp"
+
+// Writes the same iteration synchronously and through an AsyncWriter
+// with each policy. With the Block policy the two JSON traces should be
+// identical; with the others every snapshot should be either written
+// out or accounted for as dropped / coalesced. Also checks that what
+// is left of a trace after drops decodes to the values the producer
+// had when it took the snapshots that were written out.
+
+class AsyncIterationWriter {
+private:
+  AsyncWriter* _writer;
+
+public:
+  bool isEnabled() const { return _writer != NULL; }
+
+  void writeMetadata(GCview* gcview) { _writer->writeMetadata(gcview); }
+  void writeData(GCview* gcview)     { _writer->writeData(gcview);     }
+  void finish(GCview* gcview)        { _writer->flush(gcview);         }
+
+  AsyncIterationWriter(AsyncWriter* writer) : _writer(writer) { }
+};
+
+static const char* getPolicyStr(AsyncWriter::Policy policy) {
+  switch (policy) {
+  case AsyncWriter::Block      : return "Block";
+  case AsyncWriter::DropNewest : return "DropNewest";
+  case AsyncWriter::Coalesce   : return "Coalesce";
+  default: return "?";
+  }
+}
+
+static bool doAsyncIteration(FILE* json_file, AsyncWriter::Policy policy,
+                             unsigned queue_length, FILE* async_file) {
+  bool res;
+  {
+    JSONWriter writer(async_file, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    AsyncWriter async_writer(&writer, &array_writer, policy, queue_length,
+                             false /* charge_snapshot_time */);
+    AsyncIterationWriter iteration_writer(&async_writer);
+    doIterationWith(&iteration_writer);
+
+    const unsigned long long snapshot_num = async_writer.getSnapshotNum();
+    const unsigned long long written_num = async_writer.getWrittenNum();
+    const unsigned long long dropped_num = async_writer.getDroppedNum();
+    const unsigned long long coalesced_num = async_writer.getCoalescedNum();
+    // the metadata is written too
+    res = (written_num == 1 + snapshot_num - dropped_num - coalesced_num);
+    if (policy == AsyncWriter::Block) {
+      res = res && dropped_num == 0 && coalesced_num == 0;
+    }
+  }
+  if (policy == AsyncWriter::Block) {
+    res = res && compareFiles(json_file, async_file);
+  }
+  printf("%-10s queue length %2u : %s\n",
+         getPolicyStr(policy), queue_length, (res) ? "OK" : "FAILED");
+  return res;
+}
+
+static const unsigned DROP_ARRAY_LENGTH = 4096;
+static const unsigned DROP_SNAPSHOT_NUM = 1000;
+
+// A hash of the elements and their indexes, so that a stale element
+// is found wherever it is.
+static unsigned long long hashElems(unsigned index, long long value,
+                                    unsigned long long hash) {
+  return hash * 31ULL + (unsigned long long) value * (index + 1);
+}
+
+static bool checkDrops() {
+  char file_name[] = "/tmp/gcview_async_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  GCview gcview("GCview Async Drop Unit Tests");
+  const unsigned event_id = gcview.addEvent("Event 0");
+  Space* space = gcview.addSpace("Space 0");
+  IntValue* snapshot = space->addData<IntValue>("Snapshot");
+  IntArray* array = space->addData<IntArray>("Array");
+  array->resize(DROP_ARRAY_LENGTH);
+
+  // the hash of the array when each snapshot was taken
+  unsigned long long* hashes = new unsigned long long[DROP_SNAPSHOT_NUM];
+  GCVIEW_ALLOC_GUARANTEE(hashes);
+  unsigned long long dropped_num;
+  {
+    JSONWriter writer(file_name, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    AsyncWriter async_writer(&writer, &array_writer, AsyncWriter::DropNewest,
+                             1 /* queue_length */,
+                             false /* charge_snapshot_time */);
+    async_writer.writeMetadata(&gcview);
+    for (unsigned i = 0; i < DROP_SNAPSHOT_NUM; i += 1) {
+      // a few elements per snapshot, so that most updates are patches
+      snapshot->set(i);
+      array->set((i * 7) % DROP_ARRAY_LENGTH, (int) i);
+      array->set((i * 13 + 1) % DROP_ARRAY_LENGTH, -(int) i);
+      unsigned long long hash = 0;
+      for (unsigned j = 0; j < DROP_ARRAY_LENGTH; j += 1) {
+        hash = hashElems(j, array->get(j), hash);
+      }
+      hashes[i] = hash;
+
+      gcview.eventStart(event_id, 0.0);
+      gcview.eventEnd(0.0);
+      async_writer.writeData(&gcview);
+    }
+    async_writer.flush(&gcview);
+    dropped_num = async_writer.getDroppedNum();
+  }
+
+  unsigned record_num = 0;
+  bool values_ok = true;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      if (reader.isMetadata()) continue;
+      record_num += 1;
+      const ReaderSpace* reader_space = reader.findSpace("Space 0");
+      const long long i = reader_space->findData("Snapshot")->getInt();
+      const ReaderData* reader_array = reader_space->findData("Array");
+      unsigned long long hash = 0;
+      for (unsigned j = 0; j < reader_array->getLength(); j += 1) {
+        hash = hashElems(j, reader_array->getInt(j), hash);
+      }
+      values_ok = values_ok && i >= 0 && i < (long long) DROP_SNAPSHOT_NUM &&
+        reader_array->getLength() == DROP_ARRAY_LENGTH &&
+        hash == hashes[i];
+    }
+  }
+  unlink(file_name);
+  delete[] hashes;
+
+  // the snapshots are much faster to take than to write out
+  const bool ok = values_ok && dropped_num > 0 &&
+    record_num == DROP_SNAPSHOT_NUM - dropped_num;
+  printf("%-10s decoded values  : %s\n", "DropNewest", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  FILE* json_file = tmpfile();
+  GCVIEW_GUARANTEE(json_file != NULL, "could not create temp file");
+  {
+    JSONWriter writer(json_file, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    doIteration(&writer, &array_writer);
+  }
+
+  const AsyncWriter::Policy policies[] = {
+    AsyncWriter::Block, AsyncWriter::DropNewest, AsyncWriter::Coalesce
+  };
+  const unsigned queue_lengths[] = { 1, GCVIEW_ASYNC_WRITER_QUEUE_LENGTH };
+
+  bool res = true;
+  for (unsigned i = 0; i < sizeof(policies) / sizeof(policies[0]); i += 1) {
+    for (unsigned j = 0; j < sizeof(queue_lengths) / sizeof(queue_lengths[0]);
+         j += 1) {
+      FILE* async_file = tmpfile();
+      GCVIEW_GUARANTEE(async_file != NULL, "could not create temp file");
+      if (!doAsyncIteration(json_file, policies[i], queue_lengths[j],
+                            async_file)) {
+        res = false;
+      }
+      fclose(async_file);
+    }
+  }
+
+  fclose(json_file);
+
+  if (!checkDrops()) {
+    res = false;
+  }
+
+  MM::print_report();
+  return (res) ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "reader.hpp"
+
+using namespace gcview;
+
+// Worker threads update atomic values and an atomic array, without
+// registering, while the main thread takes snapshots. The snapshots,
+// read back, should show Int data that only grows, and after the
+// workers are done the values should be exact.
+
+static const unsigned THREAD_NUM    =     4;
+static const unsigned ITERATION_NUM = 20000;
+static const unsigned ARRAY_LENGTH  =    32;
+// so that the values do not fit in 32 bits
+static const long long BASE_VALUE   = 1LL << 40;
+
+typedef struct {
+  AtomicIntValue*   _allocs;
+  ShardedIntValue*  _bytes;
+  AtomicIntArray*   _sizes;
+  volatile unsigned _next_thread_num;
+  volatile unsigned _done_num;
+} Shared;
+
+static void* workerEntry(void* arg) {
+  Shared* shared = (Shared*) arg;
+  const unsigned thread_num =
+    __sync_fetch_and_add(&shared->_next_thread_num, 1);
+  for (unsigned i = 0; i < ITERATION_NUM; i += 1) {
+    shared->_allocs->increment();
+    shared->_bytes->add(3);
+    // each thread updates a few elements, so most snapshots are patches
+    shared->_sizes->increment((thread_num * 7 + i % 2) % ARRAY_LENGTH);
+    if (i % 256 == 0) {
+      // let the snapshots interleave with the updates
+      sched_yield();
+    }
+  }
+  __sync_fetch_and_add(&shared->_done_num, 1);
+  return NULL;
+}
+
+int main() {
+  char file_name[] = "/tmp/gcview_atomic_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  GCview gcview("GCview Atomic Unit Tests", 1.0);
+  gcview.addEvent("Event 0");
+  Space* space = gcview.addSpace("Workers");
+  Shared shared;
+  shared._allocs = space->addData<AtomicIntValue>("Allocs");
+  shared._bytes = space->addData<ShardedIntValue>("Bytes");
+  shared._sizes = space->addData<AtomicIntArray>("Sizes");
+  shared._allocs->set(BASE_VALUE);
+  shared._sizes->resize(ARRAY_LENGTH);
+  shared._next_thread_num = 0;
+  shared._done_num = 0;
+
+  const bool typed_lookups =
+    space->findTypedData<AtomicIntValue>("Allocs") == shared._allocs &&
+    space->findTypedData<ShardedIntValue>("Bytes") == shared._bytes &&
+    space->findTypedData<AtomicIntArray>("Sizes") == shared._sizes;
+
+  {
+    JSONWriter writer(file_name, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+
+    pthread_t threads[THREAD_NUM];
+    for (unsigned i = 0; i < THREAD_NUM; i += 1) {
+      GCVIEW_GUARANTEE(pthread_create(&threads[i], NULL,
+                                      workerEntry, &shared) == 0,
+                       "could not create thread");
+    }
+    while (shared._done_num < THREAD_NUM) {
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+      sched_yield();
+    }
+    for (unsigned i = 0; i < THREAD_NUM; i += 1) {
+      pthread_join(threads[i], NULL);
+    }
+    // the last updates of the workers
+    array_writer.startElem();
+    gcview.writeJSONData(&writer);
+  }
+
+  bool ints = true;
+  bool monotonic = true;
+  long long allocs = 0;
+  long long bytes = 0;
+  long long sizes[ARRAY_LENGTH] = { 0 };
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      const ReaderSpace* workers = reader.findSpace("Workers");
+      const ReaderData* allocs_data = workers->findData("Allocs");
+      const ReaderData* bytes_data = workers->findData("Bytes");
+      const ReaderData* sizes_data = workers->findData("Sizes");
+      if (reader.isMetadata()) {
+        ints = allocs_data->getDataType() == Data::IntType &&
+          !allocs_data->isArray() &&
+          bytes_data->getDataType() == Data::IntType &&
+          !bytes_data->isArray() &&
+          sizes_data->getDataType() == Data::IntType &&
+          sizes_data->isArray();
+      }
+      monotonic = monotonic && allocs_data->getInt() >= allocs &&
+        bytes_data->getInt() >= bytes &&
+        sizes_data->getLength() == ARRAY_LENGTH;
+      allocs = allocs_data->getInt();
+      bytes = bytes_data->getInt();
+      for (unsigned i = 0; i < ARRAY_LENGTH && monotonic; i += 1) {
+        monotonic = sizes_data->getInt(i) >= sizes[i];
+        sizes[i] = sizes_data->getInt(i);
+      }
+    }
+  }
+  unlink(file_name);
+
+  const long long update_num = (long long) THREAD_NUM * ITERATION_NUM;
+  long long sizes_total = 0;
+  for (unsigned i = 0; i < ARRAY_LENGTH; i += 1) {
+    sizes_total += sizes[i];
+  }
+  const bool exact = allocs == BASE_VALUE + update_num &&
+    bytes == 3 * update_num && sizes_total == update_num &&
+    shared._allocs->get() == allocs && shared._bytes->get() == bytes;
+
+  printf("%u threads x %u updates\n", THREAD_NUM, ITERATION_NUM);
+  printf("metadata has Int data : %s\n", (ints) ? "OK" : "FAILED");
+  printf("typed lookups : %s\n", (typed_lookups) ? "OK" : "FAILED");
+  printf("snapshots only grow : %s\n", (monotonic) ? "OK" : "FAILED");
+  printf("final values : %s\n", (exact) ? "OK" : "FAILED");
+
+  MM::print_report();
+  return (ints && typed_lookups && monotonic && exact) ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "clock.hpp"
+#include "gcview.hpp"
+#include "json.hpp"
+#include "reader.hpp"
+
+using namespace gcview;
+
+// Checks that the clocks of all sources never go backwards and tick at
+// the rate of Utils::getNowSec(), and that a GCview with a clock times
+// its events itself and records the time and the bytes of its writes.
+
+static const unsigned READ_NUM = 100000;
+static const unsigned SLEEP_US = 20000;
+static const unsigned EVENT_NUM = 20;
+static const unsigned EVENT_SLEEP_US = 2000;
+
+static bool checkClock(Clock::Source source) {
+  Clock* clock = Clock::create(source);
+  bool ok = clock->getSource() >= source;
+
+  unsigned long long prev_ns = clock->getNowNs();
+  for (unsigned i = 0; i < READ_NUM; i += 1) {
+    const unsigned long long now_ns = clock->getNowNs();
+    ok = ok && now_ns >= prev_ns;
+    prev_ns = now_ns;
+  }
+
+  // generous, the machine might be busy
+  const double start_sec = Utils::getNowSec();
+  const unsigned long long start_ns = clock->getNowNs();
+  usleep(SLEEP_US);
+  const double sec = Utils::getNowSec() - start_sec;
+  const double clock_sec = (double) (clock->getNowNs() - start_ns) / 1.0e9;
+  ok = ok && clock_sec > sec * 0.9 && clock_sec < sec * 1.1 + 0.001;
+
+  printf("%-19s : %s\n", Clock::getSourceStr(source), (ok) ? "OK" : "FAILED");
+  delete clock;
+  return ok;
+}
+
+static bool checkGCviewClock() {
+  char file_name[] = "/tmp/gcview_clock_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  Clock* clock = Clock::create(Clock::MonotonicSource);
+  GCview gcview("GCview Clock Unit Tests");
+  const unsigned event_id = gcview.addEvent("Event 0");
+  gcview.setClock(clock);
+
+  // the bytes of each record, metadata included
+  unsigned long long record_bytes[EVENT_NUM + 1];
+  bool durations_ok = true;
+  {
+    JSONWriter writer(file_name, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    unsigned long long bytes = writer.getBytesWritten();
+    gcview.writeJSONMetadata(&writer);
+    record_bytes[0] = writer.getBytesWritten() - bytes;
+
+    for (unsigned i = 0; i < EVENT_NUM; i += 1) {
+      gcview.eventStart(event_id);
+      usleep(EVENT_SLEEP_US);
+      gcview.eventEnd();
+      durations_ok = durations_ok &&
+        gcview.getLastEventDurationSec() >= EVENT_SLEEP_US / 1.0e6;
+
+      array_writer.startElem();
+      bytes = writer.getBytesWritten();
+      gcview.writeJSONData(&writer);
+      record_bytes[i + 1] = writer.getBytesWritten() - bytes;
+    }
+  }
+  durations_ok = durations_ok &&
+    gcview.getEventDurationHistogram(event_id).getTotalCount() == EVENT_NUM &&
+    gcview.getEventDurationHistogram(event_id).getMaxValue() >=
+      EVENT_SLEEP_US * 1000ULL;
+
+  unsigned record_num = 0;
+  bool writes_ok = true;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      if (reader.isMetadata()) continue;
+      record_num += 1;
+      const ReaderSpace* gcview_data = reader.findSpace("GCview Data");
+      // each record has the bytes of the one before it
+      const long long last_write_bytes =
+        gcview_data->findData("Last Write Bytes")->getInt();
+      const double total_write_sec =
+        gcview_data->findData("Total Write Time")->getDouble();
+      const double collection_sec =
+        gcview_data->findData("Total Data Collection Time")->getDouble();
+      const double elapsed_sec =
+        gcview_data->findData("Elapsed Time")->getDouble();
+      const double actual_elapsed_sec =
+        gcview_data->findData("Actual Elapsed Time")->getDouble();
+      writes_ok = writes_ok &&
+        last_write_bytes == (long long) record_bytes[record_num - 1] &&
+        total_write_sec > 0.0 &&
+        // the writes are charged to the data collection time
+        collection_sec >= total_write_sec +
+                          record_num * EVENT_SLEEP_US / 1.0e6 - 1.0e-6 &&
+        elapsed_sec >= collection_sec &&
+        actual_elapsed_sec >= elapsed_sec - collection_sec - 1.0e-6;
+    }
+  }
+  unlink(file_name);
+
+  gcview.setClock(NULL);
+  delete clock;
+
+  const bool ok = durations_ok && writes_ok && record_num == EVENT_NUM;
+  printf("GCview clock        : %s\n", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = true;
+  for (unsigned source = 0; source < Clock::SourceNum; source += 1) {
+    ok = checkClock((Clock::Source) source) && ok;
+  }
+  ok = checkGCviewClock() && ok;
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}
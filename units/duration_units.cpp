@@ -0,0 +1,162 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "reader.hpp"
+
+using namespace gcview;
+
+// Ends events of known durations, and checks the event duration
+// percentiles, the pause budget violation counts and the over pause
+// budget flag that the trace has after each event, and that recording
+// the durations does not allocate.
+
+static const unsigned EVENT_NUM = 1000;
+// the scavenges take 10 us, 20 us, ..., 10 ms, in a shuffled order,
+// every 10th event is a mark sweep that takes 30 ms
+static const double SCAVENGE_UNIT_SEC = 0.00001;
+static const double MARK_SWEEP_SEC = 0.03;
+// between two scavenge durations, so that rounding does not matter
+static const double PAUSE_BUDGET_SEC = 0.008005;
+
+static double getScavengeSec(unsigned i) {
+  // 997 is prime, so that this is a permutation of 1..1000
+  return (double) ((i * 997) % EVENT_NUM + 1) * SCAVENGE_UNIT_SEC;
+}
+
+static bool isClose(double value_sec, double expected_sec) {
+  return fabs(value_sec - expected_sec) < 1.0e-9;
+}
+
+// The exact percentile of the scavenges is n * 10 us, where n is the
+// nearest rank, and the one of the histogram at most 12.5% above it.
+static bool checkPercentile(double percentile, double value_sec) {
+  const unsigned rank = (unsigned) (percentile / 100.0 * EVENT_NUM + 0.5);
+  const double exact_sec = (double) rank * SCAVENGE_UNIT_SEC;
+  return value_sec >= exact_sec - 1.0e-9 &&
+    value_sec <= exact_sec * 1.125 + 1.0e-9;
+}
+
+int main() {
+  char file_name[] = "/tmp/gcview_duration_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  GCview gcview("GCview Duration Unit Tests", 0.0);
+  const unsigned scavenge_id = gcview.addEvent("Scavenge");
+  const unsigned mark_sweep_id = gcview.addEvent("Mark Sweep");
+  gcview.setPauseBudgetSec(PAUSE_BUDGET_SEC);
+
+  unsigned long long event_allocated_count = 0;
+  unsigned over_budget_num = 0;
+  {
+    JSONWriter writer(file_name, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+
+    double now_sec = 1.0;
+    unsigned scavenge_num = 0;
+    for (unsigned i = 0; scavenge_num < EVENT_NUM; i += 1) {
+      const bool mark_sweep = i % 10 == 9;
+      const double duration_sec =
+        (mark_sweep) ? MARK_SWEEP_SEC : getScavengeSec(scavenge_num++);
+      if (duration_sec > PAUSE_BUDGET_SEC) {
+        over_budget_num += 1;
+      }
+
+      const unsigned long long allocated_count = MM::getTotalAllocatedCount();
+      gcview.eventStart((mark_sweep) ? mark_sweep_id : scavenge_id, now_sec);
+      gcview.eventEnd(now_sec + duration_sec);
+      event_allocated_count +=
+        MM::getTotalAllocatedCount() - allocated_count;
+      now_sec += 1.0;
+
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+    }
+  }
+
+  unsigned snapshot_num = 0;
+  unsigned flag_mismatch_num = 0;
+  double scavenge_p50 = 0.0, scavenge_p99 = 0.0, scavenge_p999 = 0.0;
+  double scavenge_max = 0.0, mark_sweep_p50 = 0.0, mark_sweep_max = 0.0;
+  long long scavenge_violation_num = 0, mark_sweep_violation_num = 0;
+  double budget = 0.0;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      if (reader.isMetadata()) continue;
+      snapshot_num += 1;
+      const ReaderSpace* gcview_data = reader.findSpace("GCview Data");
+      // the flag is true after the events that took longer than the
+      // budget (the nth event starts at n s)
+      const double duration_sec =
+        gcview_data->findData("Elapsed Time")->getDouble() -
+        (double) snapshot_num;
+      const bool over_budget =
+        gcview_data->findData("Over Pause Budget")->getBool();
+      if (over_budget != (duration_sec > PAUSE_BUDGET_SEC)) {
+        flag_mismatch_num += 1;
+      }
+
+      const ReaderData* p50 = gcview_data->findData("Event Duration P50");
+      const ReaderData* p99 = gcview_data->findData("Event Duration P99");
+      const ReaderData* p999 = gcview_data->findData("Event Duration P999");
+      const ReaderData* max = gcview_data->findData("Event Duration Max");
+      const ReaderData* violations =
+        gcview_data->findData("Pause Budget Violation Count");
+      scavenge_p50 = p50->getDouble(scavenge_id);
+      scavenge_p99 = p99->getDouble(scavenge_id);
+      scavenge_p999 = p999->getDouble(scavenge_id);
+      scavenge_max = max->getDouble(scavenge_id);
+      mark_sweep_p50 = p50->getDouble(mark_sweep_id);
+      mark_sweep_max = max->getDouble(mark_sweep_id);
+      scavenge_violation_num = violations->getInt(scavenge_id);
+      mark_sweep_violation_num = violations->getInt(mark_sweep_id);
+      budget = gcview_data->findData("Pause Budget")->getDouble();
+    }
+  }
+  unlink(file_name);
+
+  const Histogram& histogram = gcview.getEventDurationHistogram(scavenge_id);
+  const bool percentiles_ok =
+    histogram.getTotalCount() == EVENT_NUM &&
+    checkPercentile(50.0, scavenge_p50) &&
+    checkPercentile(99.0, scavenge_p99) &&
+    checkPercentile(99.9, scavenge_p999) &&
+    isClose(scavenge_max, EVENT_NUM * SCAVENGE_UNIT_SEC) &&
+    // all the mark sweeps take the same time
+    isClose(mark_sweep_p50, MARK_SWEEP_SEC) &&
+    isClose(mark_sweep_max, MARK_SWEEP_SEC);
+  const bool budget_ok = budget == PAUSE_BUDGET_SEC &&
+    scavenge_violation_num + mark_sweep_violation_num == over_budget_num &&
+    mark_sweep_violation_num == snapshot_num - EVENT_NUM &&
+    flag_mismatch_num == 0;
+  const bool allocation_ok = event_allocated_count == 0;
+  printf("percentiles : %s\n", (percentiles_ok) ? "OK" : "FAILED");
+  printf("budget      : %lld violations in %u events : %s\n",
+         scavenge_violation_num + mark_sweep_violation_num, snapshot_num,
+         (budget_ok) ? "OK" : "FAILED");
+  printf("allocation  : %s\n", (allocation_ok) ? "OK" : "FAILED");
+
+  MM::print_report();
+  return (percentiles_ok && budget_ok && allocation_ok) ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "units_shared.hpp"
+
+// Updates arrays that use the Delta, Varint and XorFloat encodings and
+// checks that the binary trace of the same updates converts back to
+// the same JSON.
+
+static const unsigned ARRAY_LENGTH = 16;
+
+template <typename W>
+static void doEncodingIteration(W* iteration_writer) {
+  GCview gcview("GCview Encoding Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Encoded Arrays");
+  IntArray* delta_array = space->addData<IntArray>("Delta Array");
+  IntArray* varint_array = space->addData<IntArray>("Varint Array");
+  DoubleArray* xor_array = space->addData<DoubleArray>("XorFloat Array");
+  delta_array->setEncoding(Data::DeltaEncoding);
+  varint_array->setEncoding(Data::VarintEncoding);
+  xor_array->setEncoding(Data::XorFloatEncoding);
+  delta_array->resize(ARRAY_LENGTH);
+  varint_array->resize(ARRAY_LENGTH);
+  xor_array->resize(ARRAY_LENGTH);
+  for (unsigned i = 0; i < ARRAY_LENGTH; i += 1) {
+    delta_array->value(i) = (int) (1000 * i);
+    varint_array->value(i) = (int) (1000 * i);
+    xor_array->value(i) = 0.5 * i;
+  }
+
+  // the metadata has the full arrays
+  iteration_writer->writeMetadata(&gcview);
+
+  // all elements change by small amounts: encoded arrays
+  for (unsigned i = 0; i < ARRAY_LENGTH; i += 1) {
+    delta_array->value(i) += (int) i - 8;
+    varint_array->value(i) += (int) i - 8;
+    xor_array->value(i) += 0.25;
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // large changes, in both directions
+  delta_array->value(0) = 2147483646;
+  delta_array->value(1) = -2147483647;
+  varint_array->value(0) = -2147483647;
+  varint_array->value(1) = 2147483646;
+  for (unsigned i = 0; i < ARRAY_LENGTH; i += 1) {
+    if (i > 1) {
+      delta_array->value(i) = (int) (i * i * i * i * i) - 500000;
+      varint_array->value(i) = 500000 - (int) (i * i * i * i * i);
+    }
+    xor_array->value(i) = (i % 2 == 0) ? -1e300 : 3.141592653589793;
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // a few elements change: patches take precedence
+  delta_array->value(3) += 1;
+  varint_array->value(5) -= 1;
+  xor_array->value(7) = 0.0;
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the length changes: full arrays for Delta / Varint, XorFloat does
+  // not depend on the previous values
+  delta_array->resize(ARRAY_LENGTH / 2);
+  varint_array->resize(ARRAY_LENGTH * 2);
+  xor_array->resize(ARRAY_LENGTH / 2 + 1);
+  for (unsigned i = 0; i < ARRAY_LENGTH / 2 + 1; i += 1) {
+    xor_array->value(i) = (double) i;
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // same length again: encoded arrays
+  for (unsigned i = 0; i < delta_array->getLength(); i += 1) {
+    delta_array->value(i) -= 1;
+  }
+  for (unsigned i = 0; i < varint_array->getLength(); i += 1) {
+    varint_array->value(i) += 1;
+  }
+  for (unsigned i = 0; i < xor_array->getLength(); i += 1) {
+    xor_array->value(i) = -xor_array->value(i);
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the metadata is written again and still has the full arrays
+  iteration_writer->writeMetadata(&gcview);
+  dumpData(&gcview, event_id, iteration_writer);
+}
+
+int main() {
+  const bool same =
+    checkTraceRoundTrip(doEncodingIteration, doEncodingIteration);
+
+  MM::print_report();
+  return (same) ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gcview.hpp"
+#include "handle.hpp"
+#include "json.hpp"
+
+using namespace gcview;
+
+static const unsigned SPACE_NUM = 100;
+static const unsigned DATA_NUM  = 120;
+static const unsigned EVENT_NUM =  70;
+
+static bool checkLookups(GCview* gcview) {
+  char buffer[32];
+  bool res = true;
+  for (unsigned s = 0; s < SPACE_NUM; s += 1) {
+    snprintf(buffer, 32, "Space %u", s);
+    Space* space = gcview->findSpace(buffer);
+    if (strcmp(space->getName(), buffer) != 0) {
+      res = false;
+    }
+    for (unsigned d = 0; d < DATA_NUM; d += 1) {
+      snprintf(buffer, 32, "Data %u.%u", s, d);
+      Data* data = (d % 2 == 0) ? (Data*) space->findIntValue(buffer)
+                                : (Data*) space->findIntArray(buffer);
+      if (strcmp(data->getName(), buffer) != 0) {
+        res = false;
+      }
+    }
+    if (space->findData("Missing", false /* should_succeed */) != NULL) {
+      res = false;
+    }
+  }
+  if (gcview->findSpace("Missing", false /* should_succeed */) != NULL) {
+    res = false;
+  }
+  for (unsigned e = 0; e < EVENT_NUM; e += 1) {
+    snprintf(buffer, 32, "Event %u", e);
+    if (gcview->findEventID(buffer) != e) {
+      res = false;
+    }
+  }
+  return res;
+}
+
+int main() {
+  {
+    GCview gcview("GCview Handle Unit Tests");
+
+    char buffer[32];
+    for (unsigned e = 0; e < EVENT_NUM; e += 1) {
+      snprintf(buffer, 32, "Event %u", e);
+      gcview.addEvent(buffer);
+    }
+    for (unsigned s = 0; s < SPACE_NUM; s += 1) {
+      snprintf(buffer, 32, "Space %u", s);
+      Space* space = gcview.addSpace(buffer);
+      for (unsigned d = 0; d < DATA_NUM; d += 1) {
+        snprintf(buffer, 32, "Data %u.%u", s, d);
+        if (d % 2 == 0) {
+          space->addData<IntValue>(buffer);
+        } else {
+          space->addData<IntArray>(buffer);
+        }
+      }
+    }
+    printf("lookups: %s\n", (checkLookups(&gcview)) ? "OK" : "FAILED");
+
+    // resolve once, update through the handles
+    DataHandle<IntValue> value(&gcview, "Space 42", "Data 42.10");
+    DataHandle<IntArray> array(gcview.findSpace("Space 7"), "Data 7.3");
+    DataHandle<IntValue> unresolved;
+    const unsigned event_id = gcview.findEventID("Event 65");
+
+    gcview.eventStart(event_id, 1.0);
+    value->value() = 1234;
+    array->resize(3);
+    array->value(2) = 5678;
+    gcview.eventEnd(1.5);
+
+    printf("handles: %s\n",
+           (value.isResolved() && array.isResolved() &&
+            !unresolved.isResolved() &&
+            gcview.findSpace("Space 42")->findIntValue("Data 42.10")->get()
+              == 1234 &&
+            gcview.findSpace("Space 7")->findIntArray("Data 7.3")->get(2)
+              == 5678) ? "OK" : "FAILED");
+  }
+
+  MM::print_report();
+}
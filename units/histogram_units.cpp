@@ -0,0 +1,132 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "histogram.hpp"
+#include "units_shared.hpp"
+
+// Checks that the buckets of several Histogram layouts cover all
+// values without gaps, that merged histograms add up, and that the
+// binary trace of HistogramData updates converts back to the same
+// JSON (with the bucket labels in the metadata).
+
+static bool checkLayout(unsigned sub_bucket_bits, unsigned max_value_bits) {
+  Histogram histogram(sub_bucket_bits, max_value_bits);
+  const unsigned bucket_num = histogram.getBucketNum();
+  bool ok = histogram.getBucketLowerBound(0) == 0;
+  for (unsigned i = 0; i < bucket_num; i += 1) {
+    const unsigned long long lower = histogram.getBucketLowerBound(i);
+    const unsigned long long upper = histogram.getBucketUpperBound(i);
+    ok = ok && lower <= upper &&
+      histogram.getBucketIndex(lower) == i &&
+      (i + 1 == bucket_num || histogram.getBucketIndex(upper) == i);
+    if (i + 1 < bucket_num) {
+      ok = ok && histogram.getBucketLowerBound(i + 1) == upper + 1;
+    }
+  }
+  // the values out of range go to the last bucket
+  ok = ok && histogram.getBucketIndex(~0ULL) == bucket_num - 1;
+  if (max_value_bits < 64) {
+    ok = ok &&
+      histogram.getBucketIndex(1ULL << max_value_bits) == bucket_num - 1;
+  }
+  // a bucket is at most 1 / 2^sub_bucket_bits of its lower bound wide
+  for (unsigned i = 1u << sub_bucket_bits; i + 1 < bucket_num; i += 1) {
+    const unsigned long long width = histogram.getBucketUpperBound(i) -
+      histogram.getBucketLowerBound(i) + 1;
+    ok = ok && (width << sub_bucket_bits) <= histogram.getBucketLowerBound(i);
+  }
+  return ok;
+}
+
+static bool checkLayouts() {
+  static const unsigned SUB_BUCKET_BITS[] = { 0, 1, 2, 3, 5, 8 };
+  static const unsigned MAX_VALUE_BITS[] = { 9, 16, 32, 63, 64 };
+  bool ok = true;
+  for (unsigned s = 0; s < sizeof(SUB_BUCKET_BITS) / sizeof(unsigned);
+       s += 1) {
+    for (unsigned m = 0; m < sizeof(MAX_VALUE_BITS) / sizeof(unsigned);
+         m += 1) {
+      ok = checkLayout(SUB_BUCKET_BITS[s], MAX_VALUE_BITS[m]) && ok;
+    }
+  }
+  return ok;
+}
+
+static bool checkMerge() {
+  Histogram h0;
+  Histogram h1;
+  for (unsigned long long v = 1; v <= 1000; v += 1) {
+    ((v % 2 == 0) ? h0 : h1).record(v);
+  }
+  h0.merge(h1);
+  // the percentiles are at most a bucket (25%) above the exact ones
+  const unsigned long long p50 = h0.getValueAtPercentile(50.0);
+  const unsigned long long p99 = h0.getValueAtPercentile(99.0);
+  return h0.getTotalCount() == 1000 && h0.getMaxValue() == 1000 &&
+    p50 >= 500 && p50 <= 625 && p99 >= 990 && p99 <= 1000 &&
+    h0.getValueAtPercentile(100.0) == 1000;
+}
+
+template <typename W>
+static void doHistogramIteration(W* iteration_writer) {
+  GCview gcview("GCview Histogram Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Histograms");
+  HistogramData* sizes = space->addData<HistogramData>("Alloc Sizes");
+  sizes->configure(1, 12);
+
+  // the metadata has the labels and the (empty) counts
+  iteration_writer->writeMetadata(&gcview);
+
+  // a few buckets change: patch
+  sizes->record(16);
+  sizes->record(17);
+  sizes->record(1000, 3);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the same bucket as before changes
+  sizes->record(20);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // counts merged from per-thread histograms change many buckets
+  Histogram thread_histogram(sizes->getHistogram().getSubBucketBits(),
+                             sizes->getHistogram().getMaxValueBits());
+  for (unsigned long long v = 0; v < 5000; v += 7) {
+    thread_histogram.record(v);
+  }
+  sizes->merge(thread_histogram);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // no change
+  dumpData(&gcview, event_id, iteration_writer);
+
+  sizes->reset();
+  dumpData(&gcview, event_id, iteration_writer);
+}
+
+int main() {
+  const bool layouts_ok = checkLayouts();
+  const bool merge_ok = checkMerge();
+  const bool lookup_ok = checkKindLookup<HistogramData, IntArray>();
+  printf("layouts: %s\n", (layouts_ok) ? "OK" : "FAILED");
+  printf("merge: %s\n", (merge_ok) ? "OK" : "FAILED");
+  printf("lookup: %s\n", (lookup_ok) ? "OK" : "FAILED");
+
+  const bool same =
+    checkTraceRoundTrip(doHistogramIteration, doHistogramIteration);
+
+  MM::print_report();
+  return (layouts_ok && merge_ok && lookup_ok && same) ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "index.hpp"
+#include "reader.hpp"
+#include "units_shared.hpp"
+
+// Writes a trace with an index sidecar and keyframes, plain and
+// gzip-compressed, and checks that the state after each record, read
+// through the index after jumping to another record first, is the
+// same as the one read sequentially. Also checks the index entries
+// against the records.
+
+class IndexedIterationWriter {
+private:
+  JSONWriter* _writer;
+  JSONArrayWriter* _array_writer;
+
+public:
+  bool isEnabled() const { return true; }
+
+  void writeMetadata(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONMetadata(_writer);
+  }
+
+  void writeData(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONData(_writer);
+  }
+
+  void finish(GCview*) { }
+
+  IndexedIterationWriter(JSONWriter* writer, JSONArrayWriter* array_writer)
+      : _writer(writer), _array_writer(array_writer) { }
+};
+
+static bool areStatesEqual(const TraceReader* r0, const TraceReader* r1) {
+  if (r0->getSpaceNum() != r1->getSpaceNum()) return false;
+  for (unsigned i = 0; i < r0->getSpaceNum(); i += 1) {
+    const ReaderSpace* s0 = r0->getSpace(i);
+    const ReaderSpace* s1 = r1->getSpace(i);
+    if (s0->getDataNum() != s1->getDataNum()) return false;
+    for (unsigned j = 0; j < s0->getDataNum(); j += 1) {
+      const ReaderData* d0 = s0->getData(j);
+      const ReaderData* d1 = s1->getData(j);
+      if (d0->getDataType() != d1->getDataType() ||
+          d0->getLength() != d1->getLength()) {
+        return false;
+      }
+      for (unsigned k = 0; k < d0->getLength(); k += 1) {
+        bool equal;
+        switch (d0->getDataType()) {
+        case Data::DoubleType:
+          // keyframes have the full values, with 10 decimals
+          equal = fabs(d0->getDouble(k) - d1->getDouble(k)) <= 1e-10;
+          break;
+        case Data::StringType:
+          equal = strcmp(d0->getStr(k), d1->getStr(k)) == 0;
+          break;
+        default:
+          equal = d0->getInt(k) == d1->getInt(k);
+          break;
+        }
+        if (!equal) return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool checkTrace(const char* name, bool compressed,
+                       unsigned keyframe_interval) {
+  char file_name[] = "/tmp/gcview_index_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+  char index_file_name[64];
+  Utils::formatStr(index_file_name, 64, "%s.index", file_name);
+
+  {
+    TraceIndexWriter index_writer(index_file_name, keyframe_interval);
+    OutputSink* sink;
+#if GCVIEW_ENABLE_ZLIB
+    if (compressed) {
+      sink = new GzipSink(file_name);
+    } else {
+      sink = new FileSink(file_name);
+    }
+#else // GCVIEW_ENABLE_ZLIB
+    sink = new FileSink(file_name);
+#endif // GCVIEW_ENABLE_ZLIB
+    GCVIEW_ALLOC_GUARANTEE(sink);
+    {
+      JSONWriter writer(sink, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+      writer.setIndexWriter(&index_writer);
+      JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+      IndexedIterationWriter iteration_writer(&writer, &array_writer);
+      doIterationWith(&iteration_writer);
+    }
+    delete sink;
+  }
+
+  TraceIndex index(index_file_name);
+  const unsigned long long record_num = index.getEntryNum();
+  bool ok = record_num > 0;
+
+  // the entries against the records, read sequentially
+  unsigned keyframe_num = 0;
+  {
+    TraceReader reader(file_name);
+    unsigned long long offset = 0;
+    for (unsigned long long r = 0; r < record_num; r += 1) {
+      const TraceIndex::Entry* entry = index.getEntry(r);
+      ok = ok && reader.next() && entry->getOffset() == offset &&
+        reader.isMetadata() ==
+          (entry->getKind() == TraceIndexWriter::MetadataRecord) &&
+        reader.getSnapshotNum() ==
+          entry->getSnapshotNum() + ((reader.isMetadata()) ? 0 : 1);
+      offset += entry->getLength();
+      if (entry->getKind() == TraceIndexWriter::KeyframeRecord) {
+        keyframe_num += 1;
+      } else {
+        for (unsigned i = 0; i < reader.getSpaceNum(); i += 1) {
+          ok = ok && entry->isSpaceModified(i) ==
+            reader.getSpace(i)->isModified();
+        }
+      }
+    }
+    ok = ok && !reader.next() && !reader.isTruncated();
+
+    struct stat st;
+    ok = ok && stat(file_name, &st) == 0 &&
+      offset <= (unsigned long long) st.st_size;
+  }
+  ok = ok && keyframe_num == (record_num - 1) / (keyframe_interval + 1);
+
+  // random access, after jumping somewhere else first
+  {
+    TraceReader reader(file_name);
+    TraceReader random_reader(file_name);
+    for (unsigned long long r = 0; r < record_num && ok; r += 1) {
+      ok = reader.next() &&
+        random_reader.readRecord(&index, (r * 37 + 11) % record_num) &&
+        random_reader.readRecord(&index, r) &&
+        random_reader.getRecordNum() == r + 1 &&
+        random_reader.getSnapshotNum() == reader.getSnapshotNum() &&
+        areStatesEqual(&reader, &random_reader);
+    }
+  }
+  printf("%-10s %4llu records, %3u keyframes : %s\n", name,
+         record_num, keyframe_num, (ok) ? "OK" : "FAILED");
+
+  unlink(file_name);
+  unlink(index_file_name);
+  return ok;
+}
+
+int main() {
+  bool ok = checkTrace("plain", false /* compressed */, 5);
+#if GCVIEW_ENABLE_ZLIB
+  ok = checkTrace("gzip", true /* compressed */, 7) && ok;
+#endif // GCVIEW_ENABLE_ZLIB
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}
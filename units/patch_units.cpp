@@ -0,0 +1,95 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "units_shared.hpp"
+
+// Updates a few elements of long arrays at a time, so that the arrays
+// are written as patches, and checks that the binary trace of the same
+// updates converts back to the same JSON.
+
+static const unsigned INT_ARRAY_LENGTH    = 64;
+static const unsigned STRING_ARRAY_LENGTH = 32;
+static const unsigned BOOL_ARRAY_LENGTH   =  8;
+
+template <typename W>
+static void doPatchIteration(W* iteration_writer) {
+  GCview gcview("GCview Patch Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Arrays");
+  IntArray* int_array = space->addData<IntArray>("Int Array");
+  StringArray* string_array = space->addData<StringArray>("String Array");
+  BoolArray* bool_array = space->addData<BoolArray>("Bool Array");
+  int_array->resize(INT_ARRAY_LENGTH);
+  string_array->resize(STRING_ARRAY_LENGTH);
+  bool_array->resize(BOOL_ARRAY_LENGTH);
+
+  iteration_writer->writeMetadata(&gcview);
+
+  // all elements change: full arrays
+  char buffer[16];
+  for (unsigned i = 0; i < INT_ARRAY_LENGTH; i += 1) {
+    int_array->value(i) = (int) (100 + i);
+  }
+  for (unsigned i = 0; i < STRING_ARRAY_LENGTH; i += 1) {
+    snprintf(buffer, 16, "str %u", i);
+    string_array->value(i) = buffer;
+  }
+  for (unsigned i = 0; i < BOOL_ARRAY_LENGTH; i += 1) {
+    bool_array->value(i) = true;
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // a few elements change: patches, except for the short array
+  int_array->value(3) += 1000;
+  int_array->set(40, -5);
+  int_array->value(63) = 7;
+  string_array->value(31) = "changed";
+  bool_array->value(2) = false;
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // elements are accessed / set to the same value: no update
+  int_array->value(10) += 0;
+  int_array->set(11, int_array->get(11));
+  string_array->value(0) = "str 0";
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // too many elements change: full array
+  for (unsigned i = 0; i < INT_ARRAY_LENGTH; i += 2) {
+    int_array->value(i) = (int) i;
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // shrink and grow back to the same length: the elements past the
+  // shrunk length are reset
+  int_array->resize(60);
+  int_array->resize(INT_ARRAY_LENGTH);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the length changes: full array
+  int_array->resize(INT_ARRAY_LENGTH / 2);
+  int_array->value(0) = 1;
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // same length again: patch
+  int_array->value(31) = 31;
+  dumpData(&gcview, event_id, iteration_writer);
+}
+
+int main() {
+  const bool same = checkTraceRoundTrip(doPatchIteration, doPatchIteration);
+
+  MM::print_report();
+  return (same) ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "reader.hpp"
+
+using namespace gcview;
+
+// Takes a snapshot after each event only if the snapshot policy says
+// it is due (and a last one at the end), and checks the number of
+// snapshots and that the event counts and values in the last one are
+// exact.
+
+static const unsigned EVENT_NUM = 1000;
+// 1 event per ms
+static const double EVENT_PERIOD_SEC = 0.001;
+
+typedef enum {
+  EveryEvent,
+  EventInterval,
+  MinInterval,
+  Watched
+} PolicyKind;
+
+static bool checkPolicy(const char* name, PolicyKind kind,
+                        unsigned long long expected_snapshot_num) {
+  char file_name[] = "/tmp/gcview_policy_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  GCview gcview("GCview Policy Unit Tests", 0.0);
+  const unsigned scavenge_id = gcview.addEvent("Scavenge");
+  const unsigned mark_sweep_id = gcview.addEvent("Mark Sweep");
+  Space* space = gcview.addSpace("Heap");
+  IntValue* bytes = space->addData<IntValue>("Bytes");
+
+  SnapshotPolicy policy;
+  switch (kind) {
+  case EventInterval:
+    policy.setEventInterval(10);
+    break;
+  case MinInterval:
+    policy.setMinIntervalSec(0.05);
+    break;
+  case Watched:
+    policy.watch(bytes, 64);
+    break;
+  default:
+    break;
+  }
+  gcview.setSnapshotPolicy(&policy);
+
+  unsigned long long skipped_num = 0;
+  {
+    JSONWriter writer(file_name, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+
+    bool last_written = true;
+    for (unsigned i = 0; i < EVENT_NUM; i += 1) {
+      const double now_sec = (double) (i + 1) * EVENT_PERIOD_SEC;
+      gcview.eventStart((i % 4 == 3) ? mark_sweep_id : scavenge_id, now_sec);
+      bytes->value() += 1;
+      gcview.eventEnd(now_sec + EVENT_PERIOD_SEC / 2.0);
+      last_written = gcview.isSnapshotDue();
+      if (last_written) {
+        array_writer.startElem();
+        gcview.writeJSONData(&writer);
+      } else {
+        skipped_num += 1;
+      }
+    }
+    if (!last_written) {
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+    }
+  }
+
+  unsigned long long snapshot_num = 0;
+  long long total_count = 0;
+  long long scavenge_count = 0;
+  long long mark_sweep_count = 0;
+  long long last_bytes = 0;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      if (reader.isMetadata()) continue;
+      snapshot_num += 1;
+      const ReaderSpace* gcview_data = reader.findSpace("GCview Data");
+      total_count = gcview_data->findData("Total Event Count")->getInt();
+      const ReaderData* counts = gcview_data->findData("Event Count");
+      scavenge_count = counts->getInt(scavenge_id);
+      mark_sweep_count = counts->getInt(mark_sweep_id);
+      last_bytes = reader.findSpace("Heap")->findData("Bytes")->getInt();
+    }
+  }
+  unlink(file_name);
+
+  const bool ok = snapshot_num == expected_snapshot_num &&
+    snapshot_num + skipped_num >= EVENT_NUM &&
+    policy.getSnapshotNum() == snapshot_num + 1 /* metadata */ &&
+    total_count == EVENT_NUM &&
+    scavenge_count == 3 * EVENT_NUM / 4 &&
+    mark_sweep_count == EVENT_NUM / 4 &&
+    last_bytes == EVENT_NUM;
+  printf("%-15s %4llu snapshots, %4llu skipped : %s\n", name,
+         snapshot_num, skipped_num, (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = checkPolicy("every event", EveryEvent, EVENT_NUM);
+  ok = checkPolicy("every 10th", EventInterval, EVENT_NUM / 10) && ok;
+  // the first after 50 ms, then every 50 ms
+  ok = checkPolicy("every 50 ms", MinInterval, 20) && ok;
+  // every 64 bytes, and the last one
+  ok = checkPolicy("64 bytes", Watched, EVENT_NUM / 64 + 1) && ok;
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "array.hpp"
+#include "reader.hpp"
+#include "units_shared.hpp"
+
+// Writes each trace twice: as usual, and as a trace that has a
+// metadata record (i.e., the full values) after each snapshot. Reading
+// both with TraceReaders in lockstep, the state reconstructed from the
+// data records has to match the full values after every snapshot.
+// Also checks that a trace that ends between records is read up to
+// its last record.
+
+class CheckedIterationWriter {
+private:
+  JSONWriter* _writer;
+  JSONArrayWriter* _array_writer;
+  JSONWriter* _full_writer;
+  JSONArrayWriter* _full_array_writer;
+  FILE* _fout;
+
+public:
+  // offset of the end of each record of the trace
+  Array<long> _record_ends;
+
+  bool isEnabled() const { return true; }
+
+  void writeMetadata(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONMetadata(_writer);
+    _record_ends.add(ftell(_fout));
+    _full_array_writer->startElem();
+    gcview->writeJSONMetadata(_full_writer);
+  }
+
+  void writeData(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONData(_writer);
+    _record_ends.add(ftell(_fout));
+    _full_array_writer->startElem();
+    gcview->writeJSONMetadata(_full_writer);
+  }
+
+  void finish(GCview*) { }
+
+  CheckedIterationWriter(JSONWriter* writer, JSONArrayWriter* array_writer,
+                         JSONWriter* full_writer,
+                         JSONArrayWriter* full_array_writer, FILE* fout)
+      : _writer(writer), _array_writer(array_writer),
+        _full_writer(full_writer), _full_array_writer(full_array_writer),
+        _fout(fout) { }
+};
+
+template <typename W>
+static void doEncodedIteration(W* iteration_writer) {
+  GCview gcview("GCview Reader Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Arrays");
+  IntArray* delta_array = space->addData<IntArray>("Delta Array");
+  IntArray* varint_array = space->addData<IntArray>("Varint Array");
+  DoubleArray* xor_array = space->addData<DoubleArray>("XorFloat Array");
+  StringArray* string_array = space->addData<StringArray>("String Array");
+  delta_array->setEncoding(Data::DeltaEncoding);
+  varint_array->setEncoding(Data::VarintEncoding);
+  xor_array->setEncoding(Data::XorFloatEncoding);
+
+  iteration_writer->writeMetadata(&gcview);
+  char buffer[32];
+  for (unsigned iter = 0; iter < 40; iter += 1) {
+    const unsigned length = 8 + iter / 10;
+    delta_array->resize(length);
+    varint_array->resize(length);
+    xor_array->resize(length);
+    string_array->resize(length);
+    // all elements change on some iterations, a few on the others
+    const unsigned step = (iter % 3 == 0) ? 1 : 5;
+    for (unsigned i = iter % step; i < length; i += step) {
+      delta_array->value(i) = (int) (iter * iter * 31 - i * 1000);
+      varint_array->value(i) = (int) (i * 77 - iter * 5);
+      xor_array->value(i) = (double) iter / (i + 1);
+      Utils::formatStr(buffer, 32, "str %u.%u", iter, i);
+      string_array->value(i) = buffer;
+    }
+    gcview.eventStart(event_id, (double) iter);
+    gcview.eventEnd((double) iter + 0.5);
+    iteration_writer->writeData(&gcview);
+  }
+  iteration_writer->finish(&gcview);
+}
+
+template <typename W>
+static void doTileIteration(W* iteration_writer) {
+  GCview gcview("GCview Reader Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Heap Map");
+  TileArray* tiles = space->addData<TileArray>("Tiles");
+  tiles->addEnumMember("Free");
+  tiles->addEnumMember("Young");
+  tiles->addEnumMember("Old");
+  tiles->resize(1000);
+
+  iteration_writer->writeMetadata(&gcview);
+  for (unsigned iter = 0; iter < 40; iter += 1) {
+    if (iter % 10 == 9) {
+      tiles->resize(1000 + iter * 10);
+    }
+    // a few ranges change on most iterations, many tiles on the others
+    const unsigned step = (iter % 4 == 0) ? 3 : 97;
+    for (unsigned i = iter % step; i + 20 < tiles->getLength(); i += step) {
+      tiles->setRange(i, i + (iter + i) % 20, (unsigned char) ((i + iter) % 3));
+    }
+    gcview.eventStart(event_id, (double) iter);
+    gcview.eventEnd((double) iter + 0.5);
+    iteration_writer->writeData(&gcview);
+  }
+  iteration_writer->finish(&gcview);
+}
+
+static bool areElemsEqual(const ReaderData* d0, const ReaderData* d1,
+                          unsigned index) {
+  switch (d0->getDataType()) {
+  case Data::DoubleType:
+    // the full values are written with 10 decimals, XorFloat arrays
+    // are exact
+    return fabs(d0->getDouble(index) - d1->getDouble(index)) <= 1e-10;
+  case Data::StringType:
+    return strcmp(d0->getStr(index), d1->getStr(index)) == 0;
+  default:
+    return d0->getInt(index) == d1->getInt(index);
+  }
+}
+
+static bool areStatesEqual(const TraceReader* r0, const TraceReader* r1) {
+  if (r0->getSpaceNum() != r1->getSpaceNum()) return false;
+  for (unsigned i = 0; i < r0->getSpaceNum(); i += 1) {
+    const ReaderSpace* s0 = r0->getSpace(i);
+    const ReaderSpace* s1 = r1->getSpace(i);
+    if (strcmp(s0->getName(), s1->getName()) != 0 ||
+        s0->getDataNum() != s1->getDataNum()) {
+      return false;
+    }
+    for (unsigned j = 0; j < s0->getDataNum(); j += 1) {
+      const ReaderData* d0 = s0->getData(j);
+      const ReaderData* d1 = s1->getData(j);
+      if (strcmp(d0->getName(), d1->getName()) != 0 ||
+          d0->getDataType() != d1->getDataType() ||
+          d0->getLength() != d1->getLength()) {
+        return false;
+      }
+      for (unsigned k = 0; k < d0->getLength(); k += 1) {
+        if (!areElemsEqual(d0, d1, k)) return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool createTempFile(char* file_name, FILE** f) {
+  const int fd = mkstemp(file_name);
+  if (fd < 0) return false;
+  *f = fdopen(fd, "w");
+  return *f != NULL;
+}
+
+template <typename F>
+static bool checkTrace(const char* name, F doIterationFunc) {
+  char file_name[] = "/tmp/gcview_reader_units_XXXXXX";
+  char full_file_name[] = "/tmp/gcview_reader_units_XXXXXX";
+  FILE* fout = NULL;
+  FILE* full_fout = NULL;
+  GCVIEW_GUARANTEE(createTempFile(file_name, &fout) &&
+                   createTempFile(full_file_name, &full_fout),
+                   "could not create temp files");
+  Array<long> record_ends;
+  {
+    JSONWriter writer(fout);
+    JSONWriter full_writer(full_fout, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    JSONArrayWriter full_array_writer(&full_writer, true /* add_newlines */);
+    CheckedIterationWriter iteration_writer(&writer, &array_writer,
+                                            &full_writer, &full_array_writer,
+                                            fout);
+    doIterationFunc(&iteration_writer);
+    for (unsigned i = 0; i < iteration_writer._record_ends.getLength();
+         i += 1) {
+      record_ends.add(iteration_writer._record_ends[i]);
+    }
+  }
+  fclose(fout);
+  fclose(full_fout);
+
+  bool ok = true;
+  {
+    TraceReader reader(file_name);
+    TraceReader full_reader(full_file_name);
+    while (reader.next()) {
+      ok = ok && full_reader.next() && full_reader.isMetadata() &&
+        areStatesEqual(&reader, &full_reader);
+    }
+    ok = ok && !full_reader.next() && !reader.isTruncated() &&
+      reader.getRecordNum() == record_ends.getLength();
+  }
+  printf("%-10s %4u records : %s\n", name, record_ends.getLength(),
+         (ok) ? "OK" : "FAILED");
+
+  // cut the trace after one of the records
+  const unsigned record_num = record_ends.getLength() / 2;
+  GCVIEW_GUARANTEE(truncate(file_name, record_ends[record_num - 1]) == 0,
+                   "could not truncate temp file");
+  bool truncated_ok;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) { }
+    truncated_ok = reader.isTruncated() &&
+      reader.getRecordNum() == record_num;
+  }
+  printf("%-10s %4u records (truncated) : %s\n", name, record_num,
+         (truncated_ok) ? "OK" : "FAILED");
+
+  unlink(file_name);
+  unlink(full_file_name);
+  return ok && truncated_ok;
+}
+
+int main() {
+  bool ok = checkTrace("standard", doIterationWith<CheckedIterationWriter>);
+  ok = checkTrace("encoded", doEncodedIteration<CheckedIterationWriter>) && ok;
+  ok = checkTrace("tiles", doTileIteration<CheckedIterationWriter>) && ok;
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}
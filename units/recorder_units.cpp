@@ -0,0 +1,161 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "reader.hpp"
+#include "recorder.hpp"
+
+using namespace gcview;
+
+// Records the snapshots after each event with a FlightRecorder whose
+// ring only has room for a few of them, and has it dump on a long
+// event, on a signal and when asked to. Each dump, read back, should
+// have consecutive records that end with the last event and have the
+// values the GCview had after each of them. Also checks that, with
+// GCVIEW_ENABLE_MM_SUMMARY, record() does not allocate once it has
+// recorded encoded arrays.
+
+static const unsigned EVENT_NUM     = 200;
+static const unsigned ARRAY_LENGTH  =  20;
+static const unsigned LONG_EVENT    = 150;
+static const unsigned SIGNAL_EVENT  = 180;
+static const unsigned MAX_RECORDS   =  16;
+static const unsigned KEYFRAME_INTERVAL = 4;
+static const size_t   CAPACITY      = 2048;
+
+static bool checkDump(const char* name, const char* file_name,
+                      unsigned last_count) {
+  unsigned record_num = 0;
+  long long prev_count = -1;
+  bool ok = true;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      if (reader.isMetadata()) continue;
+      record_num += 1;
+      const ReaderSpace* heap = reader.findSpace("Heap");
+      const long long count = heap->findData("Count")->getInt();
+      ok = ok && (prev_count < 0 || count == prev_count + 1);
+      prev_count = count;
+      const ReaderData* sizes = heap->findData("Sizes");
+      for (unsigned j = 0; j < ARRAY_LENGTH; j += 1) {
+        // the events so far that updated element j
+        const long long expected =
+          (count + (long long) ARRAY_LENGTH - 1 - j) / ARRAY_LENGTH;
+        ok = ok && sizes->getInt(j) == expected;
+      }
+    }
+    ok = ok && !reader.isTruncated();
+  }
+  unlink(file_name);
+
+  ok = ok && record_num > 0 && record_num <= MAX_RECORDS &&
+    prev_count == (long long) last_count;
+  printf("%-10s %2u records, last %3lld : %s\n", name,
+         record_num, prev_count, (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+static const unsigned ENCODED_ARRAY_LENGTH = 64;
+static const unsigned ENCODED_RECORD_NUM   = 100;
+
+static bool checkEncodedAllocations() {
+  GCview gcview("GCview Recorder Encoded Unit Tests", 0.0);
+  const unsigned scavenge_id = gcview.addEvent("Scavenge");
+  Space* space = gcview.addSpace("Heap");
+  IntArray* ages = space->addData<IntArray>("Ages");
+  ages->setEncoding(Data::VarintEncoding);
+  ages->resize(ENCODED_ARRAY_LENGTH);
+  DoubleArray* rates = space->addData<DoubleArray>("Rates");
+  rates->setEncoding(Data::XorFloatEncoding);
+  rates->resize(ENCODED_ARRAY_LENGTH);
+
+  FlightRecorder recorder(&gcview, 64 * 1024, MAX_RECORDS, KEYFRAME_INTERVAL);
+  unsigned long long allocated_count = 0;
+  for (unsigned i = 0; i < ENCODED_RECORD_NUM; i += 1) {
+    // the first record is a keyframe, the second one grows the
+    // scratch buffers of the writer
+    if (i == 2) {
+      allocated_count = MM::getTotalAllocatedCount();
+    }
+    gcview.eventStart(scavenge_id, (double) i);
+    for (unsigned j = 0; j < ENCODED_ARRAY_LENGTH; j += 1) {
+      ages->set(j, (int) ((i * 31 + j * 7) % 1000));
+      rates->set(j, (double) (i + j) / 3.0);
+    }
+    gcview.eventEnd((double) i + 0.001);
+    recorder.record();
+  }
+  // always OK without GCVIEW_ENABLE_MM_SUMMARY
+  const bool ok = MM::getTotalAllocatedCount() == allocated_count;
+  printf("%-10s no allocations : %s\n", "encoded", (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  char prefix[] = "/tmp/gcview_recorder_units_XXXXXX";
+  const int fd = mkstemp(prefix);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  GCview gcview("GCview Recorder Unit Tests", 0.0);
+  const unsigned scavenge_id = gcview.addEvent("Scavenge");
+  Space* space = gcview.addSpace("Heap");
+  IntValue* count = space->addData<IntValue>("Count");
+  IntArray* sizes = space->addData<IntArray>("Sizes");
+  sizes->resize(ARRAY_LENGTH);
+
+  bool ok = true;
+  {
+    FlightRecorder recorder(&gcview, CAPACITY, MAX_RECORDS,
+                            KEYFRAME_INTERVAL);
+    recorder.setDumpFileName(prefix);
+    recorder.setLatencyThresholdSec(0.1);
+    recorder.dumpOnSignal(SIGUSR1);
+
+    for (unsigned i = 0; i < EVENT_NUM; i += 1) {
+      const double start_sec = (double) i;
+      const double duration_sec = (i + 1 == LONG_EVENT) ? 0.5 : 0.001;
+      gcview.eventStart(scavenge_id, start_sec);
+      count->value() = (int) (i + 1);
+      sizes->value(i % ARRAY_LENGTH) += 1;
+      gcview.eventEnd(start_sec + duration_sec);
+      if (i + 1 == SIGNAL_EVENT) {
+        raise(SIGUSR1);
+      }
+      recorder.record();
+    }
+    ok = recorder.getDumpNum() == 2 && recorder.getRecordNum() <= MAX_RECORDS;
+
+    char file_name[64];
+    Utils::formatStr(file_name, 64, "%s.last", prefix);
+    recorder.dump(file_name);
+    ok = checkDump("dump()", file_name, EVENT_NUM) && ok;
+  }
+
+  char file_name[64];
+  Utils::formatStr(file_name, 64, "%s.0", prefix);
+  ok = checkDump("latency", file_name, LONG_EVENT) && ok;
+  Utils::formatStr(file_name, 64, "%s.1", prefix);
+  ok = checkDump("signal", file_name, SIGNAL_EVENT) && ok;
+  unlink(prefix);
+
+  ok = checkEncodedAllocations() && ok;
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}
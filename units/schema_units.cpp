@@ -0,0 +1,171 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "buffer.hpp"
+#include "gcview.hpp"
+#include "json.hpp"
+#include "schema.hpp"
+#include "sink.hpp"
+#include "trace.hpp"
+
+using namespace gcview;
+
+// Builds the same space twice, once with addData() and once as a
+// StaticSpace, updates both in the same way, and checks that the JSON
+// and the binary traces of the two are identical.
+
+static const unsigned EVENT_NUM    = 40;
+static const unsigned ARRAY_LENGTH = 24;
+
+#define HEAP_FIELDS(__field__) \
+  __field__(BoolValue,      is_full,  "Is Full",  NULL) \
+  __field__(IntValue,       size,     "Size",     "Sizes") \
+  __field__(DoubleValue,    ratio,    "Ratio",    NULL) \
+  __field__(StringValue,    phase,    "Phase",    NULL) \
+  __field__(EnumValue,      kind,     "Kind",     NULL) \
+  __field__(IntArray,       used,     "Used",     "Pages") \
+  __field__(DoubleArray,    live,     "Live",     "Pages") \
+  __field__(AtomicIntValue, allocs,   "Allocs",   NULL)
+
+GCVIEW_SPACE_LAYOUT(HeapLayout, HEAP_FIELDS);
+
+class BufferSink : public OutputSink {
+private:
+  ByteBuffer* const _buffer;
+
+public:
+  virtual void write(const void* data, size_t length) {
+    _buffer->append(data, length);
+  }
+  virtual void endFrame() { }
+  virtual unsigned long long getOffset() const { return _buffer->getLength(); }
+
+  BufferSink(ByteBuffer* buffer) : _buffer(buffer) { }
+};
+
+static void addEnumMembers(EnumValue* kind) {
+  kind->addEnumMember("young");
+  kind->addEnumMember("old");
+  kind->addEnumMember("large");
+}
+
+static void update(unsigned e, BoolValue* is_full, IntValue* size,
+                   DoubleValue* ratio, StringValue* phase, EnumValue* kind,
+                   IntArray* used, DoubleArray* live, AtomicIntValue* allocs) {
+  is_full->set(e % 7 == 0);
+  if (e % 3 != 0) {
+    size->value() += (int) e;
+  }
+  ratio->set((double) (e / 4) * 0.25);
+  phase->set((e % 5 < 2) ? "marking" : "sweeping");
+  kind->set((unsigned char) (e % 3));
+  used->resize(ARRAY_LENGTH - e % 2);
+  used->set(e % used->getLength(), (int) e);
+  live->resize(ARRAY_LENGTH);
+  if (e % 4 == 0) {
+    for (unsigned i = 0; i < ARRAY_LENGTH; i += 1) {
+      live->set(i, (double) (i * e) * 0.5);
+    }
+  }
+  allocs->add((long long) e);
+}
+
+static void writeAll(bool use_static_space, ByteBuffer* json,
+                     ByteBuffer* trace, bool* lookups_ok) {
+  BufferSink sink(json);
+  JSONWriter json_writer(&sink);
+  TraceWriter trace_writer(trace);
+
+  GCview gcview("GCview Schema Unit Tests", 0.0);
+  const unsigned event_id = gcview.addEvent("GC");
+
+  BoolValue* is_full;
+  IntValue* size;
+  DoubleValue* ratio;
+  StringValue* phase;
+  EnumValue* kind;
+  IntArray* used;
+  DoubleArray* live;
+  AtomicIntValue* allocs;
+  if (use_static_space) {
+    StaticSpace<HeapLayout>* space =
+      gcview.addStaticSpace<HeapLayout>("Heap");
+    HeapLayout& heap = space->fields();
+    is_full = &heap.is_full;
+    size    = &heap.size;
+    ratio   = &heap.ratio;
+    phase   = &heap.phase;
+    kind    = &heap.kind;
+    used    = &heap.used;
+    live    = &heap.live;
+    allocs  = &heap.allocs;
+    *lookups_ok = space->findData("Size") == size &&
+      space->findTypedData<AtomicIntValue>("Allocs") == allocs &&
+      space->findData("Missing", false /* should_succeed */) == NULL;
+  } else {
+    Space* space = gcview.addSpace("Heap");
+    is_full = space->addData<BoolValue>("Is Full");
+    size    = space->addData<IntValue>("Size", "Sizes");
+    ratio   = space->addData<DoubleValue>("Ratio");
+    phase   = space->addData<StringValue>("Phase");
+    kind    = space->addData<EnumValue>("Kind");
+    used    = space->addData<IntArray>("Used", "Pages");
+    live    = space->addData<DoubleArray>("Live", "Pages");
+    allocs  = space->addData<AtomicIntValue>("Allocs");
+  }
+  addEnumMembers(kind);
+  used->setEncoding(Data::DeltaEncoding);
+
+  {
+    JSONArrayWriter y(&json_writer, true /* add_newlines */);
+    y.startElem();
+    gcview.writeJSONMetadata(&json_writer);
+    gcview.writeTraceMetadata(&trace_writer);
+    for (unsigned e = 0; e < EVENT_NUM; e += 1) {
+      gcview.eventStart(event_id, (double) e);
+      update(e, is_full, size, ratio, phase, kind, used, live, allocs);
+      gcview.eventEnd((double) e + 0.5);
+      y.startElem();
+      const bool keyframe = e % 10 == 9;
+      gcview.writeJSONData(&json_writer, keyframe);
+      gcview.writeTraceData(&trace_writer, keyframe);
+    }
+  }
+  json_writer.flush();
+}
+
+static bool areEqual(const ByteBuffer* a, const ByteBuffer* b) {
+  return a->getLength() == b->getLength() &&
+    memcmp(a->getData(), b->getData(), a->getLength()) == 0;
+}
+
+int main() {
+  {
+    ByteBuffer dynamic_json, dynamic_trace;
+    ByteBuffer static_json, static_trace;
+    bool lookups_ok = false;
+    writeAll(false, &dynamic_json, &dynamic_trace, &lookups_ok);
+    writeAll(true, &static_json, &static_trace, &lookups_ok);
+
+    printf("lookups: %s\n", (lookups_ok) ? "OK" : "FAILED");
+    printf("json:    %s (%lu bytes)\n",
+           (areEqual(&dynamic_json, &static_json)) ? "OK" : "FAILED",
+           (unsigned long) static_json.getLength());
+    printf("trace:   %s (%lu bytes)\n",
+           (areEqual(&dynamic_trace, &static_trace)) ? "OK" : "FAILED",
+           (unsigned long) static_trace.getLength());
+  }
+
+  MM::print_report();
+}
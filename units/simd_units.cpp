@@ -0,0 +1,108 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+
+#include "simd.hpp"
+
+using namespace gcview;
+
+// Checks the scans of each SIMD level the CPU supports against a plain
+// loop, for all lengths up to a few vectors, unaligned starts, and a
+// difference at every index (or none).
+
+static const unsigned MAX_LENGTH = 140;
+static const unsigned MAX_OFFSET =   5;
+
+template <typename T>
+static unsigned findFirstDiffSlow(const T* a, const T* b,
+                                  unsigned from, unsigned to) {
+  for (unsigned i = from; i < to; i += 1) {
+    if (a[i] != b[i]) {
+      return i;
+    }
+  }
+  return to;
+}
+
+template <typename T>
+static bool checkScans(T value, T other_value) {
+  T a[MAX_OFFSET + MAX_LENGTH];
+  T b[MAX_OFFSET + MAX_LENGTH];
+  for (unsigned i = 0; i < MAX_OFFSET + MAX_LENGTH; i += 1) {
+    a[i] = value;
+    b[i] = value;
+  }
+  bool ok = true;
+  for (unsigned offset = 0; offset < MAX_OFFSET; offset += 1) {
+    for (unsigned length = 0; length <= MAX_LENGTH; length += 1) {
+      const unsigned to = offset + length;
+      // diff == length : no difference
+      for (unsigned diff = 0; diff <= length; diff += 1) {
+        if (diff < length) {
+          b[offset + diff] = other_value;
+        }
+        const unsigned expected = findFirstDiffSlow(a, b, offset, to);
+        ok = ok && expected == offset + diff &&
+          SimdUtils::findFirstDiff(a, b, offset, to) == expected;
+        if (diff < length) {
+          b[offset + diff] = value;
+        }
+      }
+    }
+  }
+  return ok;
+}
+
+static bool checkAllScans() {
+  const double nan = sqrt(-1.0);
+  return checkScans<unsigned char>(7, 8) &&
+    checkScans<bool>(false, true) &&
+    checkScans<int>(1 << 20, (1 << 20) + 1) &&
+    checkScans<int>(-5, 5) &&
+    checkScans<unsigned int>(0x100u, 0x200u) &&
+    checkScans<long long>(1LL << 40, 1LL << 41) &&
+    checkScans<double>(1.5, 1.5000001) &&
+    checkScans<double>(0.0, 1.0) &&
+    // a NaN always differs, as with operator!=
+    checkScans<double>(2.0, nan);
+}
+
+// 0.0 and -0.0 are equal, as with operator==.
+static bool checkSignedZeros() {
+  double a[MAX_LENGTH];
+  double b[MAX_LENGTH];
+  for (unsigned i = 0; i < MAX_LENGTH; i += 1) {
+    a[i] = 0.0;
+    b[i] = -0.0;
+  }
+  return SimdUtils::areEqual(a, b, MAX_LENGTH);
+}
+
+int main() {
+  const SimdUtils::Level supported_level = SimdUtils::getSupportedLevel();
+  for (unsigned l = SimdUtils::ScalarLevel; l <= SimdUtils::AVX2Level;
+       l += 1) {
+    const SimdUtils::Level level = (SimdUtils::Level) l;
+    if (level > supported_level) {
+      continue;
+    }
+    SimdUtils::setLevel(level);
+    printf("%-6s : %s\n", SimdUtils::getLevelStr(level),
+           (SimdUtils::getLevel() == level && checkAllScans() &&
+            checkSignedZeros()) ? "OK" : "FAILED");
+  }
+
+  MM::print_report();
+}
@@ -0,0 +1,160 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "array.hpp"
+#include "buffer.hpp"
+#include "sink.hpp"
+#include "units_shared.hpp"
+
+// Writes the standard iteration through a GzipSink and checks that the
+// compressed file decompresses to the uncompressed JSON, that any
+// prefix of whole frames (e.g., what a crashed process leaves behind)
+// decompresses to the corresponding prefix of the JSON, and that
+// decompression can start at any frame.
+
+#if GCVIEW_ENABLE_ZLIB
+
+// Remembers where each frame ends, before and after compression.
+class FrameRecordingSink : public OutputSink {
+private:
+  GzipSink* const _sink;
+
+public:
+  Array<unsigned long long> _json_ends;
+  Array<unsigned long long> _gzip_ends;
+
+  virtual void write(const void* data, size_t length) {
+    _sink->write(data, length);
+  }
+
+  virtual void endFrame() {
+    const unsigned long long frame_num = _sink->getFrameNum();
+    _sink->endFrame();
+    if (_sink->getFrameNum() > frame_num) {
+      _json_ends.add(_sink->getBytesIn());
+      _gzip_ends.add(_sink->getBytesWritten());
+    }
+  }
+
+  virtual unsigned long long getOffset() const { return _sink->getOffset(); }
+
+  FrameRecordingSink(GzipSink* sink) : _sink(sink) { }
+};
+
+static void readFile(FILE* f, ByteBuffer* buffer) {
+  rewind(f);
+  buffer->clear();
+  unsigned char chunk[4096];
+  size_t length;
+  while ((length = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    buffer->append(chunk, length);
+  }
+}
+
+// Decompresses all the gzip members in [start, end) of in.
+static void gunzip(const ByteBuffer* in, size_t start, size_t end,
+                   ByteBuffer* out) {
+  out->clear();
+  z_stream stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+  stream.next_in = Z_NULL;
+  stream.avail_in = 0;
+  GCVIEW_GUARANTEE(inflateInit2(&stream, 16 + MAX_WBITS) == Z_OK,
+                   "could not initialize zlib");
+  stream.next_in = (Bytef*) in->getData() + start;
+  stream.avail_in = (uInt) (end - start);
+  unsigned char chunk[4096];
+  while (stream.avail_in > 0) {
+    stream.next_out = chunk;
+    stream.avail_out = sizeof(chunk);
+    const int ret = inflate(&stream, Z_NO_FLUSH);
+    GCVIEW_GUARANTEE(ret == Z_OK || ret == Z_STREAM_END, "inflate failed");
+    out->append(chunk, sizeof(chunk) - stream.avail_out);
+    if (ret == Z_STREAM_END) {
+      inflateReset(&stream);
+    }
+  }
+  inflateEnd(&stream);
+}
+
+static bool isSame(const ByteBuffer* buffer, const ByteBuffer* json,
+                   size_t json_start, size_t json_end) {
+  return buffer->getLength() == json_end - json_start &&
+    memcmp(buffer->getData(), json->getData() + json_start,
+           json_end - json_start) == 0;
+}
+
+int main() {
+  FILE* json_file = tmpfile();
+  FILE* gzip_file = tmpfile();
+  GCVIEW_GUARANTEE(json_file != NULL && gzip_file != NULL,
+                   "could not create temp files");
+  {
+    JSONWriter writer(json_file);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    doIteration(&writer, &array_writer);
+  }
+  GzipSink gzip_sink(gzip_file);
+  FrameRecordingSink sink(&gzip_sink);
+  {
+    JSONWriter writer(&sink, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    {
+      JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+      doIteration(&writer, &array_writer);
+    }
+    writer.flush();
+  }
+
+  ByteBuffer json;
+  ByteBuffer gzip;
+  ByteBuffer out;
+  readFile(json_file, &json);
+  readFile(gzip_file, &gzip);
+  const unsigned frame_num = sink._json_ends.getLength();
+  printf("frames: %u, uncompressed bytes: %llu\n",
+         frame_num, gzip_sink.getBytesIn());
+
+  gunzip(&gzip, 0, gzip.getLength(), &out);
+  bool whole_ok = isSame(&out, &json, 0, json.getLength());
+  printf("whole file: %s\n", (whole_ok) ? "OK" : "FAILED");
+
+  bool prefixes_ok = true;
+  bool suffixes_ok = true;
+  for (unsigned i = 0; i < frame_num; i += 1) {
+    gunzip(&gzip, 0, (size_t) sink._gzip_ends[i], &out);
+    prefixes_ok = prefixes_ok &&
+      isSame(&out, &json, 0, (size_t) sink._json_ends[i]);
+    gunzip(&gzip, (size_t) sink._gzip_ends[i], gzip.getLength(), &out);
+    suffixes_ok = suffixes_ok &&
+      isSame(&out, &json, (size_t) sink._json_ends[i], json.getLength());
+  }
+  printf("frame prefixes: %s\n", (prefixes_ok) ? "OK" : "FAILED");
+  printf("from each frame: %s\n", (suffixes_ok) ? "OK" : "FAILED");
+
+  fclose(json_file);
+
+  MM::print_report();
+  return (whole_ok && prefixes_ok && suffixes_ok) ? 0 : 1;
+}
+
+#else // GCVIEW_ENABLE_ZLIB
+
+int main() {
+  printf("zlib is not enabled\n");
+  return 0;
+}
+
+#endif // GCVIEW_ENABLE_ZLIB
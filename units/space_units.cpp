@@ -0,0 +1,116 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "units_shared.hpp"
+
+// Uses many more spaces, data per space, and enum members than fit in
+// an Array's inline storage, updates a few of the data at a time, and
+// checks that the JSON trace and the converted binary trace agree.
+
+static const unsigned SPACE_NUM       = 150;
+static const unsigned DATA_NUM        = 100;
+static const unsigned ENUM_MEMBER_NUM =  80;
+static const unsigned SNAPSHOTS       =  20;
+
+static Data* addSpaceData(Space* space, unsigned index, const char* name) {
+  switch (index % 5) {
+  case 0: return space->addData<IntValue>(name);
+  case 1: return space->addData<DoubleArray>(name);
+  case 2: return space->addData<StringValue>(name);
+  case 3: return space->addData<EnumValue>(name);
+  default: {
+    // not added through the template, so the space does not know its
+    // exact class
+    IntArray* data = new IntArray(name);
+    GCVIEW_ALLOC_GUARANTEE(data);
+    space->addData(data);
+    return data;
+  }
+  }
+}
+
+static void updateSpaceData(Data* data, unsigned index, unsigned iter) {
+  char buffer[32];
+  switch (index % 5) {
+  case 0:
+    ((IntValue*) data)->value() = (int) (iter * 10 + index);
+    break;
+  case 1: {
+    DoubleArray* array = (DoubleArray*) data;
+    array->resize(iter % 7);
+    for (unsigned i = 0; i < array->getLength(); i += 1) {
+      array->value(i) = (double) (iter + i) * 0.5;
+    }
+    break;
+  }
+  case 2:
+    snprintf(buffer, 32, "iter %u", iter);
+    ((StringValue*) data)->value() = buffer;
+    break;
+  case 3:
+    ((EnumValue*) data)->value() = (iter + index) % ENUM_MEMBER_NUM;
+    break;
+  default: {
+    IntArray* array = (IntArray*) data;
+    array->resize(3);
+    array->value(iter % 3) = (int) iter;
+    break;
+  }
+  }
+}
+
+template <typename W>
+static void doSpaceIteration(W* iteration_writer) {
+  GCview gcview("GCview Space Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  char buffer[32];
+  Array<Data*> all_data;
+  for (unsigned s = 0; s < SPACE_NUM; s += 1) {
+    snprintf(buffer, 32, "Space %u", s);
+    Space* space = gcview.addSpace(buffer);
+    for (unsigned d = 0; d < DATA_NUM; d += 1) {
+      snprintf(buffer, 32, "Data %u", d);
+      Data* data = addSpaceData(space, d, buffer);
+      if (data->getDataType() == Data::EnumType) {
+        for (unsigned m = 0; m < ENUM_MEMBER_NUM; m += 1) {
+          snprintf(buffer, 32, "Member %u", m);
+          data->addEnumMember(buffer);
+        }
+      }
+      all_data.add(data);
+    }
+  }
+  iteration_writer->writeMetadata(&gcview);
+
+  for (unsigned iter = 1; iter <= SNAPSHOTS; iter += 1) {
+    // a different subset of the data changes every time
+    for (unsigned i = iter % 11; i < all_data.getLength(); i += 11 + iter) {
+      updateSpaceData(all_data[i], i % DATA_NUM, iter);
+    }
+    gcview.eventStart(event_id, (double) iter);
+    gcview.eventEnd((double) iter + 0.5);
+    iteration_writer->writeData(&gcview);
+  }
+
+  printf("spaces: %u, data: %u\n", SPACE_NUM, all_data.getLength());
+}
+
+int main() {
+  const bool same = checkTraceRoundTrip(doSpaceIteration, doSpaceIteration,
+                                        false /* print_json */);
+
+  MM::print_report();
+  return (same) ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+#include "json.hpp"
+#include "reader.hpp"
+
+using namespace gcview;
+
+// Worker threads update staged values and have overlapping events
+// while the main thread takes snapshots. The snapshots, read back,
+// should only see the staged values and the event counts grow, and
+// after the workers are done the values and counts should be exact.
+
+static const unsigned THREAD_NUM    =     4;
+static const unsigned ITERATION_NUM = 20000;
+static const unsigned EVENT_NUM     =     3;
+
+typedef struct {
+  GCview*            _gcview;
+  StagedIntValue*    _work;
+  StagedDoubleValue* _bytes;
+  unsigned           _event_ids[EVENT_NUM];
+  volatile unsigned  _done_num;
+} Shared;
+
+static void* workerEntry(void* arg) {
+  Shared* shared = (Shared*) arg;
+  const unsigned thread_id = shared->_gcview->registerThread();
+  for (unsigned i = 0; i < ITERATION_NUM; i += 1) {
+    const double now_sec = 1.0 + (double) i * 0.001;
+    shared->_gcview->threadEventStart(thread_id,
+                                      shared->_event_ids[i % EVENT_NUM],
+                                      now_sec);
+    shared->_work->add(thread_id, 1);
+    shared->_bytes->add(thread_id, 0.5);
+    shared->_gcview->threadEventEnd(thread_id, now_sec + 0.0005);
+    if (i % 256 == 0) {
+      // let the snapshots interleave with the updates
+      sched_yield();
+    }
+  }
+  __sync_fetch_and_add(&shared->_done_num, 1);
+  return NULL;
+}
+
+int main() {
+  char file_name[] = "/tmp/gcview_staging_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  close(fd);
+
+  GCview gcview("GCview Staging Unit Tests", 1.0);
+  Shared shared;
+  shared._gcview = &gcview;
+  for (unsigned e = 0; e < EVENT_NUM; e += 1) {
+    char buffer[32];
+    Utils::formatStr(buffer, 32, "Worker Event %u", e);
+    shared._event_ids[e] = gcview.addEvent(buffer);
+  }
+  Space* space = gcview.addSpace("Workers");
+  shared._work = gcview.addStagedValue(space->addData<IntValue>("Work"));
+  shared._bytes =
+    gcview.addStagedValue(space->addData<DoubleValue>("Bytes"));
+  shared._done_num = 0;
+
+  {
+    JSONWriter writer(file_name, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    array_writer.startElem();
+    gcview.writeJSONMetadata(&writer);
+
+    pthread_t threads[THREAD_NUM];
+    for (unsigned i = 0; i < THREAD_NUM; i += 1) {
+      GCVIEW_GUARANTEE(pthread_create(&threads[i], NULL,
+                                      workerEntry, &shared) == 0,
+                       "could not create thread");
+    }
+    while (AtomicUtils::load(&shared._done_num) < THREAD_NUM) {
+      array_writer.startElem();
+      gcview.writeJSONData(&writer);
+      sched_yield();
+    }
+    for (unsigned i = 0; i < THREAD_NUM; i += 1) {
+      pthread_join(threads[i], NULL);
+    }
+    // the last updates of the workers
+    array_writer.startElem();
+    gcview.writeJSONData(&writer);
+  }
+
+  bool monotonic = true;
+  long long work = 0;
+  double bytes = 0.0;
+  long long total_event_count = 0;
+  long long event_counts[EVENT_NUM] = { 0 };
+  double elapsed_sec = 0.0;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      const ReaderSpace* workers = reader.findSpace("Workers");
+      const ReaderSpace* gcview_data = reader.findSpace("GCview Data");
+      const long long new_work = workers->findData("Work")->getInt();
+      const double new_bytes = workers->findData("Bytes")->getDouble();
+      const long long new_total_event_count =
+        gcview_data->findData("Total Event Count")->getInt();
+      const ReaderData* counts = gcview_data->findData("Event Count");
+      monotonic = monotonic && new_work >= work && new_bytes >= bytes &&
+        new_total_event_count >= total_event_count;
+      for (unsigned e = 0; e < EVENT_NUM; e += 1) {
+        monotonic = monotonic && counts->getInt(e) >= event_counts[e];
+        event_counts[e] = counts->getInt(e);
+      }
+      work = new_work;
+      bytes = new_bytes;
+      total_event_count = new_total_event_count;
+      elapsed_sec = gcview_data->findData("Elapsed Time")->getDouble();
+    }
+  }
+  unlink(file_name);
+
+  const long long update_num = (long long) THREAD_NUM * ITERATION_NUM;
+  bool exact = work == update_num &&
+    bytes == 0.5 * (double) update_num &&
+    total_event_count == update_num;
+  for (unsigned e = 0; e < EVENT_NUM; e += 1) {
+    const long long per_thread_count = ITERATION_NUM / EVENT_NUM +
+      ((e < ITERATION_NUM % EVENT_NUM) ? 1 : 0);
+    exact = exact && event_counts[e] == THREAD_NUM * per_thread_count;
+  }
+  const double last_end_sec = (double) (ITERATION_NUM - 1) * 0.001 + 0.0005;
+  exact = exact && elapsed_sec > last_end_sec - 1e-9 &&
+    elapsed_sec < last_end_sec + 1e-9;
+
+  printf("%u threads x %u updates\n", THREAD_NUM, ITERATION_NUM);
+  printf("snapshots only grow : %s\n", (monotonic) ? "OK" : "FAILED");
+  printf("merged values and event counts : %s\n",
+         (exact) ? "OK" : "FAILED");
+
+  MM::print_report();
+  return (monotonic && exact) ? 0 : 1;
+}
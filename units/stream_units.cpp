@@ -0,0 +1,259 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "gcview.hpp"
+#include "reader.hpp"
+#include "stream.hpp"
+
+using namespace gcview;
+
+// Streams snapshots to three subscribers: one that connects over the
+// Unix domain socket before the first record, one that connects over
+// TCP halfway through and one that never reads. The first two should
+// get a valid stream that starts with the full state and ends with
+// the last values, the third one should be dropped.
+
+#if GCVIEW_ENABLE_STREAMING
+
+static const unsigned SNAPSHOT_NUM = 200;
+static const unsigned ARRAY_LENGTH = 4096;
+static const size_t QUEUE_CAPACITY = 64 * 1024;
+
+typedef struct {
+  int             _fd;
+  bool            _reads;
+  pthread_mutex_t _lock;
+  ByteBuffer      _received;
+  bool            _closed;
+} Client;
+
+static void initClient(Client* client, int fd, bool reads) {
+  client->_fd = fd;
+  client->_reads = reads;
+  pthread_mutex_init(&client->_lock, NULL);
+  client->_closed = false;
+}
+
+static int connectUnix(const char* path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  GCVIEW_GUARANTEE(fd >= 0 &&
+                   connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0,
+                   "could not connect");
+  return fd;
+}
+
+static int connectTCP(unsigned port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((unsigned short) port);
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  GCVIEW_GUARANTEE(fd >= 0 &&
+                   connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == 0,
+                   "could not connect");
+  return fd;
+}
+
+static void* clientEntry(void* arg) {
+  Client* client = (Client*) arg;
+  char buffer[16 * 1024];
+  while (true) {
+    pthread_mutex_lock(&client->_lock);
+    const bool reads = client->_reads;
+    pthread_mutex_unlock(&client->_lock);
+    if (!reads) {
+      usleep(1000);
+      continue;
+    }
+    const ssize_t length = recv(client->_fd, buffer, sizeof(buffer), 0);
+    pthread_mutex_lock(&client->_lock);
+    if (length <= 0) {
+      client->_closed = true;
+      pthread_mutex_unlock(&client->_lock);
+      break;
+    }
+    client->_received.append(buffer, (size_t) length);
+    pthread_mutex_unlock(&client->_lock);
+  }
+  return NULL;
+}
+
+// Turns the records into a JSON trace and reads it back.
+static bool checkStream(const char* name, Client* client,
+                        bool connected_late) {
+  char file_name[] = "/tmp/gcview_stream_units_XXXXXX";
+  const int fd = mkstemp(file_name);
+  GCVIEW_GUARANTEE(fd >= 0, "could not create temp file");
+  FILE* fout = fdopen(fd, "w");
+  GCVIEW_GUARANTEE(fout != NULL, "could not open temp file");
+
+  bool ok = true;
+  unsigned record_num = 0;
+  const unsigned char* data = client->_received.getData();
+  const size_t length = client->_received.getLength();
+  fputs("[\n", fout);
+  for (size_t i = 0; i < length; i += 1) {
+    if (data[i] == 0x1E) {
+      if (record_num > 0) {
+        // every record ends with a newline
+        ok = ok && data[i - 1] == '\n';
+        fputs(",", fout);
+      }
+      record_num += 1;
+    } else {
+      fputc(data[i], fout);
+    }
+  }
+  ok = ok && length > 0 && data[0] == 0x1E && data[length - 1] == '\n';
+  fputs("]\n", fout);
+  fclose(fout);
+
+  unsigned data_record_num = 0;
+  long long first_count = -1;
+  long long count = -1;
+  {
+    TraceReader reader(file_name);
+    while (reader.next()) {
+      if (reader.isMetadata()) {
+        ok = ok && data_record_num == 0;
+        continue;
+      }
+      data_record_num += 1;
+      const ReaderSpace* heap = reader.findSpace("Heap");
+      const long long new_count = heap->findData("Count")->getInt();
+      ok = ok && (count < 0 || new_count == count + 1);
+      count = new_count;
+      if (first_count < 0) {
+        first_count = count;
+      }
+      const ReaderData* sizes = heap->findData("Sizes");
+      for (unsigned j = 0; j < ARRAY_LENGTH; j += 1) {
+        ok = ok && sizes->getInt(j) == count + (long long) j;
+      }
+    }
+    ok = ok && !reader.isTruncated();
+  }
+  unlink(file_name);
+
+  ok = ok && record_num == data_record_num + 1 &&
+    count == (long long) SNAPSHOT_NUM &&
+    (connected_late ? first_count > 1 : first_count == 1);
+  printf("%-8s : %s\n", name, (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  char path[64];
+  Utils::formatStr(path, 64, "/tmp/gcview_stream_units_%d.sock",
+                   (int) getpid());
+
+  GCview gcview("GCview Stream Unit Tests", 0.0);
+  const unsigned event_id = gcview.addEvent("Scavenge");
+  Space* space = gcview.addSpace("Heap");
+  StringValue* phase = space->addData<StringValue>("Phase");
+  IntValue* count = space->addData<IntValue>("Count");
+  IntArray* sizes = space->addData<IntArray>("Sizes");
+  sizes->resize(ARRAY_LENGTH);
+  phase->value() = "Running";
+
+  Client early;
+  Client late;
+  Client slow;
+  pthread_t threads[3];
+  unsigned long long subscriber_num;
+  unsigned long long dropped_num;
+  bool flushed;
+  {
+    StreamServer server(&gcview, QUEUE_CAPACITY);
+    server.listenUnix(path);
+    const unsigned port = server.listenTCP(0);
+
+    initClient(&early, connectUnix(path), true /* reads */);
+    initClient(&slow, connectUnix(path), false /* reads */);
+    pthread_create(&threads[0], NULL, clientEntry, &early);
+    pthread_create(&threads[2], NULL, clientEntry, &slow);
+    // let the server accept them
+    usleep(100000);
+    server.writeMetadata();
+
+    for (unsigned i = 1; i <= SNAPSHOT_NUM; i += 1) {
+      if (i == SNAPSHOT_NUM / 2) {
+        initClient(&late, connectTCP(port), true /* reads */);
+        pthread_create(&threads[1], NULL, clientEntry, &late);
+        usleep(100000);
+      }
+      gcview.eventStart(event_id, (double) i);
+      count->value() = (int) i;
+      for (unsigned j = 0; j < ARRAY_LENGTH; j += 1) {
+        sizes->value(j) = (int) (i + j);
+      }
+      if (i == SNAPSHOT_NUM) {
+        phase->value() = "Done";
+      }
+      gcview.eventEnd((double) i + 0.5);
+      server.writeData();
+      // let the subscribers keep up
+      usleep(2000);
+    }
+
+    flushed = server.flush(10.0);
+    subscriber_num = server.getSubscriberNum();
+    dropped_num = server.getDroppedNum();
+
+    pthread_mutex_lock(&slow._lock);
+    slow._reads = true;
+    pthread_mutex_unlock(&slow._lock);
+  }
+  // the server closed all connections, the clients read up to the end
+  for (unsigned i = 0; i < 3; i += 1) {
+    pthread_join(threads[i], NULL);
+  }
+
+  bool ok = checkStream("early", &early, false /* connected_late */);
+  ok = checkStream("late", &late, true /* connected_late */) && ok;
+  // it got some of the records, but not the last one
+  const bool dropped = flushed && subscriber_num == 3 && dropped_num == 1 &&
+    slow._closed && memmem(slow._received.getData(),
+                           slow._received.getLength(), "\"Done\"", 6) == NULL;
+  printf("%-8s : %s\n", "slow", (dropped) ? "OK" : "FAILED");
+
+  close(early._fd);
+  close(late._fd);
+  close(slow._fd);
+  MM::print_report();
+  return (ok && dropped) ? 0 : 1;
+}
+
+#else // GCVIEW_ENABLE_STREAMING
+
+int main() {
+  printf("streaming is not enabled\n");
+  return 0;
+}
+
+#endif // GCVIEW_ENABLE_STREAMING
@@ -0,0 +1,96 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "units_shared.hpp"
+
+// Updates a TileArray in ways that are written as run patches and as
+// full RLE values and checks that the binary trace of the same updates
+// converts back to the same JSON.
+
+static const unsigned TILE_NUM = 4096;
+
+typedef enum {
+  FREE,
+  YOUNG,
+  OLD,
+  PINNED
+} TileState;
+
+template <typename W>
+static void doTileIteration(W* iteration_writer) {
+  GCview gcview("GCview Tile Unit Tests");
+  unsigned event_id = gcview.addEvent("Event 0");
+
+  Space* space = gcview.addSpace("Heap Map");
+  TileArray* regions = space->addData<TileArray>("Regions");
+  TileArray* empty = space->addData<TileArray>("Empty");
+  regions->addEnumMember("Free");
+  regions->addEnumMember("Young");
+  regions->addEnumMember("Old");
+  regions->addEnumMember("Pinned");
+  empty->addEnumMember("Free");
+  regions->resize(TILE_NUM);
+
+  // the metadata has the full value, a single run
+  iteration_writer->writeMetadata(&gcview);
+
+  // a few ranges change: run patch
+  regions->setRange(0, 256, YOUNG);
+  regions->setRange(1024, 1536, OLD);
+  regions->set(2000, PINNED);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the same states again: not modified
+  regions->setRange(0, 128, YOUNG);
+  regions->set(1100, OLD);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // a range that partly had the new state is still a single run
+  regions->setRange(1000, 1600, OLD);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // many runs change: full value
+  for (unsigned i = 0; i < TILE_NUM; i += 1) {
+    regions->set(i, (unsigned char) ((i / 8) % 4));
+  }
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // back to a few runs: full value, since it is now the shorter one
+  regions->reset();
+  regions->setRange(64, 128, OLD);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the length changes: full value
+  regions->resize(TILE_NUM + TILE_NUM / 2);
+  regions->setRange(TILE_NUM, TILE_NUM + 16, YOUNG);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  regions->resize(TILE_NUM / 4);
+  dumpData(&gcview, event_id, iteration_writer);
+
+  // the metadata is written again and still has the full value
+  iteration_writer->writeMetadata(&gcview);
+  regions->set(10, PINNED);
+  dumpData(&gcview, event_id, iteration_writer);
+}
+
+int main() {
+  const bool lookup_ok = checkKindLookup<TileArray, EnumArray>();
+  printf("lookup: %s\n", (lookup_ok) ? "OK" : "FAILED");
+
+  const bool same = checkTraceRoundTrip(doTileIteration, doTileIteration);
+
+  MM::print_report();
+  return (lookup_ok && same) ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "units_shared.hpp"
+
+// Writes the same iteration as a JSON trace and as a binary trace,
+// converts the latter back to JSON, and checks that the two JSON
+// traces are identical.
+
+static long getFileSize(FILE* f) {
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  rewind(f);
+  return size;
+}
+
+int main() {
+  FILE* json_file = tmpfile();
+  FILE* trace_file = tmpfile();
+  FILE* converted_file = tmpfile();
+  GCVIEW_GUARANTEE(json_file != NULL && trace_file != NULL &&
+                   converted_file != NULL, "could not create temp files");
+
+  {
+    JSONWriter writer(json_file, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    doIteration(&writer, &array_writer);
+  }
+  {
+    TraceWriter writer(trace_file);
+    doIteration(&writer);
+  }
+  rewind(trace_file);
+  {
+    TraceConverter converter(trace_file);
+    JSONWriter writer(converted_file, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    converter.convert(&writer);
+  }
+
+  const long json_size = getFileSize(json_file);
+  const long trace_size = getFileSize(trace_file);
+  const long converted_size = getFileSize(converted_file);
+  printf("JSON trace      : %8ld bytes\n", json_size);
+  printf("binary trace    : %8ld bytes\n", trace_size);
+  printf("converted trace : %8ld bytes\n", converted_size);
+
+  bool same = (json_size == converted_size);
+  while (same) {
+    int c0 = fgetc(json_file);
+    int c1 = fgetc(converted_file);
+    if (c0 != c1) {
+      same = false;
+    }
+    if (c0 == EOF) break;
+  }
+  printf("converted trace is %s\n", (same) ? "identical" : "DIFFERENT");
+
+  fclose(json_file);
+  fclose(trace_file);
+  fclose(converted_file);
+
+  MM::print_report();
+  return (same) ? 0 : 1;
+}
@@ -14,6 +14,7 @@
 
 #include "gcview.hpp"
 #include "json.hpp"
+#include "trace.hpp"
 
 using namespace gcview;
 
@@ -21,7 +22,46 @@ static const unsigned ARRAY_LENGTH_MIN          =     0;
 static const unsigned ARRAY_LENGTH_MAX          =   250;
 static const unsigned ARRAY_LENGTH_STEP         =     1;
 
-void doIteration(JSONWriter* writer, JSONArrayWriter* array_writer) {
+class JSONIterationWriter {
+private:
+  JSONWriter* _writer;
+  JSONArrayWriter* _array_writer;
+
+public:
+  bool isEnabled() const { return _writer != NULL; }
+
+  void writeMetadata(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONMetadata(_writer);
+  }
+
+  void writeData(GCview* gcview) {
+    _array_writer->startElem();
+    gcview->writeJSONData(_writer);
+  }
+
+  void finish(GCview*) { }
+
+  JSONIterationWriter(JSONWriter* writer, JSONArrayWriter* array_writer)
+      : _writer(writer), _array_writer(array_writer) { }
+};
+
+class TraceIterationWriter {
+private:
+  TraceWriter* _writer;
+
+public:
+  bool isEnabled() const { return _writer != NULL; }
+
+  void writeMetadata(GCview* gcview) { gcview->writeTraceMetadata(_writer); }
+  void writeData(GCview* gcview)     { gcview->writeTraceData(_writer);     }
+  void finish(GCview*)               { }
+
+  TraceIterationWriter(TraceWriter* writer) : _writer(writer) { }
+};
+
+template <typename W>
+void doIterationWith(W* iteration_writer) {
   GCview gcview("GCview Unit Tests", 1.0);
   unsigned event0 = gcview.addEvent("Event 0");
   unsigned event1 = gcview.addEvent("Event 1");
@@ -58,15 +98,13 @@ void doIteration(JSONWriter* writer, JSONArrayWriter* array_writer) {
   enum_array->addEnumMember("javascript");
   enum_array->addEnumMember("haskell");
 
-  if (writer != NULL) {
-    array_writer->startElem();
-    gcview.writeJSONMetadata(writer);
+  if (iteration_writer->isEnabled()) {
+    iteration_writer->writeMetadata(&gcview);
 
     gcview.eventStart(event0, 2.0);
     gcview.eventEnd(2.2);
 
-    array_writer->startElem();
-    gcview.writeJSONData(writer);
+    iteration_writer->writeData(&gcview);
   }
 
   byte_value->value() = 160;
@@ -147,9 +185,110 @@ void doIteration(JSONWriter* writer, JSONArrayWriter* array_writer) {
     double end_sec = start_sec + 0.1;
     gcview.eventEnd(end_sec);
 
-    if (writer != NULL) {
-      array_writer->startElem();
-      gcview.writeJSONData(writer);
+    if (iteration_writer->isEnabled()) {
+      iteration_writer->writeData(&gcview);
+    }
+  }
+
+  if (iteration_writer->isEnabled()) {
+    iteration_writer->finish(&gcview);
+  }
+}
+
+void doIteration(JSONWriter* writer, JSONArrayWriter* array_writer) {
+  JSONIterationWriter iteration_writer(writer, array_writer);
+  doIterationWith(&iteration_writer);
+}
+
+void doIteration(TraceWriter* writer) {
+  TraceIterationWriter iteration_writer(writer);
+  doIterationWith(&iteration_writer);
+}
+
+bool compareFiles(FILE* f0, FILE* f1) {
+  rewind(f0);
+  rewind(f1);
+  while (true) {
+    int c0 = fgetc(f0);
+    int c1 = fgetc(f1);
+    if (c0 != c1) return false;
+    if (c0 == EOF) return true;
+  }
+}
+
+// Ends an event and writes a data record, so that each call is one
+// snapshot of the iteration.
+template <typename W>
+void dumpData(GCview* gcview, unsigned event_id, W* iteration_writer) {
+  gcview->eventStart(event_id, 0.0);
+  gcview->eventEnd(0.0);
+  iteration_writer->writeData(gcview);
+}
+
+// Checks that a D, which has the type of a B (e.g., a TileArray and an
+// EnumArray), is found as a D, and that its kind tells it apart from a
+// B.
+template <typename D, typename B>
+bool checkKindLookup() {
+  Space space("Lookup");
+  D* data = space.addData<D>("Data");
+  B* base = space.addData<B>("Base");
+  return data->getKind() == DataKindOf<D>::Value &&
+    DataKindOf<D>::Value != DataKindOf<B>::Value &&
+    base->getKind() == DataKindOf<B>::Value &&
+    space.findTypedData<D>("Data") == data &&
+    space.findTypedData<B>("Base") == base &&
+    space.findData("Data")->getKind() != DataKindOf<B>::Value;
+}
+
+// Writes an iteration as JSON and as a binary trace, converts the
+// trace to JSON and checks that it is identical to the JSON written
+// directly. The two functions are usually the JSON and the trace
+// instantiations of the same template, e.g.:
+//
+//   checkTraceRoundTrip(doTileIteration, doTileIteration);
+//
+// If print_json is true, the JSON is also written to stdout first.
+bool checkTraceRoundTrip(void (*json_iteration)(JSONIterationWriter*),
+                         void (*trace_iteration)(TraceIterationWriter*),
+                         bool print_json = true) {
+  if (print_json) {
+    {
+      JSONWriter writer;
+      JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+      JSONIterationWriter iteration_writer(&writer, &array_writer);
+      json_iteration(&iteration_writer);
     }
+    printf("\n");
   }
+
+  FILE* json_file = tmpfile();
+  FILE* trace_file = tmpfile();
+  FILE* converted_file = tmpfile();
+  GCVIEW_GUARANTEE(json_file != NULL && trace_file != NULL &&
+                   converted_file != NULL, "could not create temp files");
+  {
+    JSONWriter writer(json_file, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    JSONArrayWriter array_writer(&writer, true /* add_newlines */);
+    JSONIterationWriter iteration_writer(&writer, &array_writer);
+    json_iteration(&iteration_writer);
+  }
+  {
+    TraceWriter writer(trace_file);
+    TraceIterationWriter iteration_writer(&writer);
+    trace_iteration(&iteration_writer);
+  }
+  rewind(trace_file);
+  {
+    TraceConverter converter(trace_file);
+    JSONWriter writer(converted_file, GCVIEW_JSON_WRITER_BUFFER_SIZE);
+    converter.convert(&writer);
+  }
+  const bool same = compareFiles(json_file, converted_file);
+  printf("converted trace is %s\n", (same) ? "identical" : "DIFFERENT");
+
+  fclose(json_file);
+  fclose(trace_file);
+  fclose(converted_file);
+  return same;
 }
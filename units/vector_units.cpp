@@ -0,0 +1,230 @@
+// Copyright (c) 2013 Adobe Systems Incorporated. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vector.hpp"
+
+using namespace gcview;
+
+// Checks that a Vector grows geometrically and keeps its storage when
+// it shrinks, that the elements it adds are always T(), and the copies
+// and swaps, both for a trivially copyable type (memcpy) and for one
+// that is copied element by element.
+
+static const unsigned MAX_LENGTH = 1000;
+
+// Not trivially copyable: copied with operator=.
+class Pair {
+public:
+  int _a;
+  int _b;
+
+  bool operator==(const Pair& other) const {
+    return _a == other._a && _b == other._b;
+  }
+
+  Pair() : _a(0), _b(0) { }
+  Pair(int a, int b) : _a(a), _b(b) { }
+};
+
+static int makeElem(int*, unsigned i, unsigned seed) {
+  return (int) (i * 31 + seed);
+}
+
+static Pair makeElem(Pair*, unsigned i, unsigned seed) {
+  return Pair((int) i, (int) seed);
+}
+
+template <typename T>
+static void fill(Vector<T>* vector, unsigned seed) {
+  for (unsigned i = 0; i < vector->getLength(); i += 1) {
+    vector->set(i, makeElem((T*) NULL, i, seed));
+  }
+}
+
+template <typename T>
+static bool hasElems(const Vector<T>& vector, unsigned from, unsigned to,
+                     unsigned seed) {
+  for (unsigned i = from; i < to; i += 1) {
+    if (!(vector.get(i) == makeElem((T*) NULL, i, seed))) return false;
+  }
+  return true;
+}
+
+template <typename T>
+static bool hasDefaultElems(const Vector<T>& vector, unsigned from,
+                            unsigned to) {
+  for (unsigned i = from; i < to; i += 1) {
+    if (!(vector.get(i) == T())) return false;
+  }
+  return true;
+}
+
+// Growing one element at a time reallocates a logarithmic number of
+// times, and keeps the elements.
+template <typename T>
+static bool checkGrowth() {
+  Vector<T> vector;
+  bool ok = vector.getLength() == 0 && vector.getCapacity() == 0 &&
+    vector.getData() == NULL;
+  unsigned realloc_num = 0;
+  for (unsigned length = 1; length <= MAX_LENGTH; length += 1) {
+    const unsigned capacity = vector.getCapacity();
+    const T* data = vector.getData();
+    vector.resize(length);
+    if (vector.getCapacity() != capacity) {
+      realloc_num += 1;
+      ok = ok && vector.getCapacity() >= 2 * capacity;
+    } else {
+      ok = ok && vector.getData() == data;
+    }
+    ok = ok && vector.getLength() == length &&
+      vector.getCapacity() >= length &&
+      hasDefaultElems(vector, length - 1, length);
+    vector.set(length - 1, makeElem((T*) NULL, length - 1, 1));
+  }
+  // 1, 2, 4, ..., 1024
+  return ok && realloc_num <= 11 && hasElems(vector, 0, MAX_LENGTH, 1);
+}
+
+// Shrinking keeps the storage and resets the elements past the new
+// length, so that growing again adds T()s.
+template <typename T>
+static bool checkShrink() {
+  Vector<T> vector;
+  vector.resize(MAX_LENGTH);
+  fill(&vector, 2);
+  const unsigned capacity = vector.getCapacity();
+  const T* data = vector.getData();
+
+  vector.resize(MAX_LENGTH / 2);
+  bool ok = vector.getLength() == MAX_LENGTH / 2 &&
+    vector.getCapacity() == capacity && vector.getData() == data &&
+    hasElems(vector, 0, MAX_LENGTH / 2, 2);
+
+  vector.resize(MAX_LENGTH);
+  ok = ok && vector.getCapacity() == capacity && vector.getData() == data &&
+    hasElems(vector, 0, MAX_LENGTH / 2, 2) &&
+    hasDefaultElems(vector, MAX_LENGTH / 2, MAX_LENGTH);
+
+  vector.resize(0);
+  vector.resize(1);
+  ok = ok && vector.getData() == data && hasDefaultElems(vector, 0, 1);
+
+  vector.reclaim();
+  return ok && vector.getLength() == 0 && vector.getCapacity() == 0 &&
+    vector.getData() == NULL;
+}
+
+// copyFrom() makes a copy of any length and only reallocates if the
+// other vector is longer than the capacity.
+template <typename T>
+static bool checkCopyFrom() {
+  Vector<T> vector;
+  Vector<T> other;
+  other.resize(MAX_LENGTH);
+  fill(&other, 3);
+
+  vector.copyFrom(other);
+  const T* data = vector.getData();
+  bool ok = vector.getLength() == MAX_LENGTH &&
+    hasElems(vector, 0, MAX_LENGTH, 3) && data != other.getData();
+
+  other.resize(MAX_LENGTH / 3);
+  fill(&other, 4);
+  vector.copyFrom(other);
+  ok = ok && vector.getLength() == MAX_LENGTH / 3 &&
+    vector.getData() == data && hasElems(vector, 0, MAX_LENGTH / 3, 4);
+
+  // the elements the shorter copy left out were reset
+  vector.resize(MAX_LENGTH);
+  ok = ok && hasDefaultElems(vector, MAX_LENGTH / 3, MAX_LENGTH);
+
+  Vector<T> empty;
+  vector.copyFrom(empty);
+  return ok && vector.getLength() == 0 && vector.getData() == data;
+}
+
+// copyRangeFrom() only copies [from, to).
+template <typename T>
+static bool checkCopyRangeFrom() {
+  Vector<T> vector;
+  Vector<T> other;
+  vector.resize(MAX_LENGTH);
+  fill(&vector, 5);
+  other.resize(MAX_LENGTH + 10);
+  fill(&other, 6);
+
+  const unsigned from = 100;
+  const unsigned to = 357;
+  vector.copyRangeFrom(other, from, to);
+  bool ok = hasElems(vector, 0, from, 5) && hasElems(vector, from, to, 6) &&
+    hasElems(vector, to, MAX_LENGTH, 5);
+
+  // empty ranges, at both ends
+  vector.copyRangeFrom(other, 0, 0);
+  vector.copyRangeFrom(other, MAX_LENGTH, MAX_LENGTH);
+  ok = ok && hasElems(vector, 0, from, 5) &&
+    hasElems(vector, to, MAX_LENGTH, 5);
+
+  vector.copyRangeFrom(other, 0, MAX_LENGTH);
+  return ok && vector.getLength() == MAX_LENGTH &&
+    hasElems(vector, 0, MAX_LENGTH, 6);
+}
+
+// swap() exchanges the lengths, capacities and storage.
+template <typename T>
+static bool checkSwap() {
+  Vector<T> vector;
+  Vector<T> other;
+  vector.resize(MAX_LENGTH);
+  fill(&vector, 7);
+  other.resize(10);
+  fill(&other, 8);
+  const T* data = vector.getData();
+  const T* other_data = other.getData();
+  const unsigned capacity = vector.getCapacity();
+  const unsigned other_capacity = other.getCapacity();
+
+  vector.swap(&other);
+  bool ok = vector.getLength() == 10 && other.getLength() == MAX_LENGTH &&
+    vector.getCapacity() == other_capacity &&
+    other.getCapacity() == capacity &&
+    vector.getData() == other_data && other.getData() == data &&
+    hasElems(vector, 0, 10, 8) && hasElems(other, 0, MAX_LENGTH, 7);
+
+  // with an empty vector: the storage moves over
+  Vector<T> empty;
+  other.swap(&empty);
+  ok = ok && other.getLength() == 0 && other.getData() == NULL &&
+    empty.getLength() == MAX_LENGTH && empty.getData() == data;
+
+  vector.swap(&vector);
+  return ok && vector.getLength() == 10 && hasElems(vector, 0, 10, 8);
+}
+
+template <typename T>
+static bool checkAll(const char* name) {
+  const bool ok = checkGrowth<T>() && checkShrink<T>() &&
+    checkCopyFrom<T>() && checkCopyRangeFrom<T>() && checkSwap<T>();
+  printf("%-6s : %s\n", name, (ok) ? "OK" : "FAILED");
+  return ok;
+}
+
+int main() {
+  bool ok = checkAll<int>("int");
+  ok = checkAll<Pair>("Pair") && ok;
+
+  MM::print_report();
+  return (ok) ? 0 : 1;
+}